@@ -55,6 +55,7 @@
 
 #include <atomic>
 #include <algorithm>
+#include <bit>
 #include <fstream>
 #include <memory>
 #include <version>
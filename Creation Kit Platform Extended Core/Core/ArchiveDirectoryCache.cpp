@@ -0,0 +1,596 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "DataDirectoryIndex.h"
+#include "ArchiveDirectoryCache.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		constexpr static uint32_t CACHE_MAGIC = 'CRAC';
+		constexpr static uint32_t CACHE_VERSION = 2;
+		constexpr static uint32_t CACHE_MAX_SIZE = 64 * 1024 * 1024;
+		constexpr static char CACHE_FILE_NAME[] = "CreationKitPlatformExtended_Archives.cache";
+
+		constexpr static uint32_t BSA_FLAG_DIRECTORY_NAMES = 0x1;
+		constexpr static uint32_t BSA_FLAG_FILE_NAMES = 0x2;
+		constexpr static uint32_t BA2_GENERAL_RECORD_SIZE = 36;
+		constexpr static uint32_t BA2_TEXTURE_CHUNK_SIZE = 24;
+
+#pragma pack(push, 1)
+		struct ArchiveCacheHeader
+		{
+			uint32_t Magic;
+			uint32_t Version;
+			uint32_t Count;
+			uint32_t DataSize;
+			uint32_t DataCRC32;
+		};
+
+		struct ArchiveBSAHeader
+		{
+			char FileId[4];
+			uint32_t Version;
+			uint32_t Offset;
+			uint32_t ArchiveFlags;
+			uint32_t FolderCount;
+			uint32_t FileCount;
+			uint32_t TotalFolderNameLength;
+			uint32_t TotalFileNameLength;
+			uint16_t FileFlags;
+			uint16_t Padding;
+		};
+
+		struct ArchiveBA2Header
+		{
+			char FileId[4];
+			uint32_t Version;
+			char Type[4];
+			uint32_t FileCount;
+			uint64_t NameTableOffset;
+		};
+
+		struct ArchiveBA2TextureRecord
+		{
+			uint32_t NameHash;
+			char Extension[4];
+			uint32_t DirHash;
+			uint8_t Unk0C;
+			uint8_t ChunkCount;
+			uint16_t ChunkHeaderSize;
+			uint16_t Height;
+			uint16_t Width;
+			uint8_t MipCount;
+			uint8_t Format;
+			uint8_t IsCubemap;
+			uint8_t TileMode;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(ArchiveBSAHeader) == 36, "ArchiveBSAHeader should be the size of 36");
+		static_assert(sizeof(ArchiveBA2Header) == 24, "ArchiveBA2Header should be the size of 24");
+		static_assert(sizeof(ArchiveBA2TextureRecord) == 24, "ArchiveBA2TextureRecord should be the size of 24");
+
+		// Чтение заголовков окнами по READ_CHUNK, записи DX10 идут подряд и почти все попадают в одно окно
+		class ArchiveDirectoryCache::Reader
+		{
+		public:
+			Reader(HANDLE file) : _file(file) {}
+
+			const uint8_t* At(uint64_t offset, size_t size)
+			{
+				if ((offset >= _start) && ((offset + size) <= (_start + _length)))
+					return _buffer.data() + (offset - _start);
+
+				if (size > READ_CHUNK)
+					return nullptr;
+
+				_buffer.resize(READ_CHUNK);
+
+				OVERLAPPED overlapped = {};
+				overlapped.Offset = (DWORD)offset;
+				overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+				DWORD read = 0;
+				if (!ReadFile(_file, _buffer.data(), (DWORD)READ_CHUNK, &read, &overlapped))
+					read = 0;
+
+				_start = offset;
+				_length = read;
+
+				return (size <= read) ? _buffer.data() : nullptr;
+			}
+		private:
+			HANDLE _file;
+			Array<uint8_t> _buffer;
+			uint64_t _start = 0;
+			size_t _length = 0;
+		};
+
+		struct ArchiveDirectoryCache::Job
+		{
+			enum State : uint32_t
+			{
+				kQueued = 0,
+				kRunning,		// Готовит рабочий поток, подключение ждёт
+				kCancelled,		// Подключение пришло раньше рабочих потоков
+				kDone,
+			};
+
+			String fileName;
+			String key;
+			State state = kQueued;
+			bool found = false;
+			uint64_t fileSize = 0;
+		};
+
+		SRWLOCK ArchiveDirectoryCache::_lock = SRWLOCK_INIT;
+		INIT_ONCE ArchiveDirectoryCache::_loaded = INIT_ONCE_STATIC_INIT;
+		std::unordered_map<String, ArchiveDirectoryCache::Entry> ArchiveDirectoryCache::_entries;
+		std::atomic<bool> ArchiveDirectoryCache::_dirty = false;
+		SRWLOCK ArchiveDirectoryCache::_jobLock = SRWLOCK_INIT;
+		CONDITION_VARIABLE ArchiveDirectoryCache::_jobDone = CONDITION_VARIABLE_INIT;
+		CONDITION_VARIABLE ArchiveDirectoryCache::_jobAdded = CONDITION_VARIABLE_INIT;
+		uint32_t ArchiveDirectoryCache::_workers = 0;
+		std::unordered_map<String, std::shared_ptr<ArchiveDirectoryCache::Job>> ArchiveDirectoryCache::_jobs;
+		std::deque<std::shared_ptr<ArchiveDirectoryCache::Job>> ArchiveDirectoryCache::_queue;
+
+		bool ArchiveDirectoryCache::Attach(const char* fileName, uint64_t& fileSize)
+		{
+			std::shared_ptr<Job> job;
+
+			String key;
+			if (MakeKey(fileName, key))
+			{
+				AcquireSRWLockExclusive(&_jobLock);
+				auto it = _jobs.find(key);
+				if (it != _jobs.end())
+				{
+					job = std::move(it->second);
+					_jobs.erase(it);
+
+					// Рабочие потоки до архива ещё не дошли, читать его здесь значит читать дважды: сейчас и движком
+					if (job->state == Job::kQueued)
+					{
+						job->state = Job::kCancelled;
+						job = nullptr;
+					}
+					else
+					{
+						while (job->state != Job::kDone)
+							SleepConditionVariableSRW(&_jobDone, &_jobLock, INFINITE, 0);
+					}
+				}
+				ReleaseSRWLockExclusive(&_jobLock);
+			}
+
+			if (job)
+			{
+				fileSize = job->fileSize;
+				return job->found;
+			}
+
+			uint64_t lastWriteTime = 0;
+			return Stat(fileName, fileSize, lastWriteTime);
+		}
+
+		void ArchiveDirectoryCache::Prefetch(const Array<String>& fileNames)
+		{
+			EnsureLoaded();
+
+			AcquireSRWLockExclusive(&_jobLock);
+			for (auto& fileName : fileNames)
+			{
+				String key;
+				if (!MakeKey(fileName.c_str(), key) || _jobs.count(key))
+					continue;
+
+				auto job = std::make_shared<Job>();
+				job->fileName = fileName;
+				job->key = key;
+
+				_jobs.emplace(std::move(key), job);
+				_queue.push_back(std::move(job));
+			}
+
+			// Потоки не завершаются, новые нужны, только пока их меньше, чем архивов в очереди
+			auto needed = (uint32_t)std::min<size_t>(_queue.size(), MAX_WORKERS);
+			while (_workers < needed)
+			{
+				HANDLE thread = CreateThread(nullptr, 0, Worker, nullptr, 0, nullptr);
+				if (!thread)
+					break;
+
+				CloseHandle(thread);
+				_workers++;
+			}
+			ReleaseSRWLockExclusive(&_jobLock);
+
+			WakeAllConditionVariable(&_jobAdded);
+		}
+
+		void ArchiveDirectoryCache::CancelPrefetch()
+		{
+			AcquireSRWLockExclusive(&_jobLock);
+			_jobs.clear();
+			_queue.clear();
+			ReleaseSRWLockExclusive(&_jobLock);
+		}
+
+		void ArchiveDirectoryCache::EnsureLoaded()
+		{
+			InitOnceExecuteOnce(&_loaded, [](PINIT_ONCE, PVOID, PVOID*) -> BOOL
+				{
+					Load();
+					return TRUE;
+				}, nullptr, nullptr);
+		}
+
+		bool ArchiveDirectoryCache::MakeKey(const char* fileName, String& key)
+		{
+			char path[MAX_PATH * 2];
+			DWORD length = GetFullPathNameA(fileName, _ARRAYSIZE(path), path, nullptr);
+			if (!length || (length >= _ARRAYSIZE(path)))
+				return false;
+
+			CharLowerBuffA(path, length);
+			key.assign(path, length);
+
+			return true;
+		}
+
+		bool ArchiveDirectoryCache::WarmNow(const char* fileName, const String& key, uint64_t& fileSize)
+		{
+			uint64_t lastWriteTime = 0;
+			if (!Stat(fileName, fileSize, lastWriteTime))
+				return false;
+
+			Array<Region> regions;
+			bool hit = false;
+
+			AcquireSRWLockShared(&_lock);
+			auto it = _entries.find(key);
+			if ((it != _entries.end()) && (it->second.size == fileSize) && (it->second.lastWriteTime == lastWriteTime))
+			{
+				regions = it->second.regions;
+				hit = true;
+			}
+			ReleaseSRWLockShared(&_lock);
+
+			HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return true;
+
+			bool persist = false;
+			if (!hit && Parse(file, fileSize, regions, persist) && persist)
+			{
+				AcquireSRWLockExclusive(&_lock);
+				_entries[key] = { fileSize, lastWriteTime, regions };
+				ReleaseSRWLockExclusive(&_lock);
+
+				_dirty = true;
+			}
+
+			Read(file, regions);
+			CloseHandle(file);
+
+			return true;
+		}
+
+		DWORD WINAPI ArchiveDirectoryCache::Worker(LPVOID lpArg)
+		{
+			for (;;)
+			{
+				std::shared_ptr<Job> job;
+
+				AcquireSRWLockExclusive(&_jobLock);
+				while (!job)
+				{
+					// Очередь пуста, поток ждёт следующего вызова Prefetch
+					while (_queue.empty())
+						SleepConditionVariableSRW(&_jobAdded, &_jobLock, INFINITE, 0);
+
+					if (_queue.front()->state == Job::kQueued)
+					{
+						job = _queue.front();
+						job->state = Job::kRunning;
+					}
+
+					_queue.pop_front();
+				}
+				ReleaseSRWLockExclusive(&_jobLock);
+
+				uint64_t fileSize = 0;
+				bool found = WarmNow(job->fileName.c_str(), job->key, fileSize);
+
+				AcquireSRWLockExclusive(&_jobLock);
+				job->fileSize = fileSize;
+				job->found = found;
+				job->state = Job::kDone;
+				ReleaseSRWLockExclusive(&_jobLock);
+
+				WakeAllConditionVariable(&_jobDone);
+			}
+
+			return 0;
+		}
+
+		void ArchiveDirectoryCache::Save()
+		{
+			if (!_dirty.exchange(false))
+				return;
+
+			Array<uint8_t> data;
+			auto write = [&data](const void* in, size_t size)
+			{
+				data.insert(data.end(), (const uint8_t*)in, (const uint8_t*)in + size);
+			};
+
+			ArchiveCacheHeader header;
+			header.Magic = CACHE_MAGIC;
+			header.Version = CACHE_VERSION;
+
+			AcquireSRWLockShared(&_lock);
+			header.Count = (uint32_t)_entries.size();
+			for (auto& [key, entry] : _entries)
+			{
+				uint16_t nameLength = (uint16_t)key.length();
+				uint32_t regionCount = (uint32_t)entry.regions.size();
+
+				write(&nameLength, sizeof(nameLength));
+				write(key.c_str(), nameLength);
+				write(&entry.size, sizeof(entry.size));
+				write(&entry.lastWriteTime, sizeof(entry.lastWriteTime));
+				write(&regionCount, sizeof(regionCount));
+				for (auto& region : entry.regions)
+				{
+					write(&region.offset, sizeof(region.offset));
+					write(&region.size, sizeof(region.size));
+				}
+			}
+			ReleaseSRWLockShared(&_lock);
+
+			header.DataSize = (uint32_t)data.size();
+			header.DataCRC32 = ::Utils::CRC32Buffer(data.data(), header.DataSize);
+
+			// Пишем во временный файл и подменяем, чтобы прерванная запись не оставила обрезанный кеш
+			auto cacheFileName = Utils::GetApplicationPath() + CACHE_FILE_NAME;
+			auto tempFileName = cacheFileName + ".tmp";
+			FILE* file = _fsopen(tempFileName.c_str(), "wb", _SH_DENYWR);
+
+			bool written = file && (fwrite(&header, 1, sizeof(ArchiveCacheHeader), file) == sizeof(ArchiveCacheHeader)) &&
+				(fwrite(data.data(), 1, data.size(), file) == data.size());
+			if (file)
+				written = !fclose(file) && written;
+
+			if (!written || !MoveFileExA(tempFileName.c_str(), cacheFileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+			{
+				DeleteFileA(tempFileName.c_str());
+				_WARNING("Failed to write the archive cache \"%s\"", cacheFileName.c_str());
+			}
+		}
+
+		void ArchiveDirectoryCache::Load()
+		{
+			auto cacheFileName = Utils::GetApplicationPath() + CACHE_FILE_NAME;
+			FILE* file = _fsopen(cacheFileName.c_str(), "rb", _SH_DENYWR);
+			if (!file)
+				return;
+
+			ArchiveCacheHeader header;
+			Array<uint8_t> data;
+
+			bool valid = (fread(&header, 1, sizeof(ArchiveCacheHeader), file) == sizeof(ArchiveCacheHeader)) &&
+				(header.Magic == CACHE_MAGIC) && (header.Version == CACHE_VERSION) && (header.DataSize <= CACHE_MAX_SIZE);
+
+			if (valid)
+			{
+				data.resize(header.DataSize);
+				valid = (fread(data.data(), 1, data.size(), file) == data.size()) &&
+					(::Utils::CRC32Buffer(data.data(), header.DataSize) == header.DataCRC32);
+			}
+
+			fclose(file);
+
+			if (!valid)
+				return;
+
+			size_t pos = 0;
+			auto read = [&data, &pos](void* out, size_t size) -> bool
+			{
+				if ((data.size() - pos) < size)
+					return false;
+
+				memcpy(out, data.data() + pos, size);
+				pos += size;
+				return true;
+			};
+
+			std::unordered_map<String, Entry> entries;
+			for (uint32_t i = 0; i < header.Count; i++)
+			{
+				uint16_t nameLength = 0;
+				uint32_t regionCount = 0;
+				String key;
+				Entry entry;
+
+				if (!read(&nameLength, sizeof(nameLength)) || (nameLength >= (MAX_PATH * 2)))
+					return;
+
+				key.resize(nameLength);
+				if (!read(key.data(), nameLength) || !read(&entry.size, sizeof(entry.size)) ||
+					!read(&entry.lastWriteTime, sizeof(entry.lastWriteTime)) ||
+					!read(&regionCount, sizeof(regionCount)) || (regionCount > MAX_REGIONS))
+					return;
+
+				entry.regions.resize(regionCount);
+				for (auto& region : entry.regions)
+				{
+					if (!read(&region.offset, sizeof(region.offset)) || !read(&region.size, sizeof(region.size)))
+						return;
+				}
+
+				entries.emplace(std::move(key), std::move(entry));
+			}
+
+			AcquireSRWLockExclusive(&_lock);
+			_entries = std::move(entries);
+			ReleaseSRWLockExclusive(&_lock);
+		}
+
+		bool ArchiveDirectoryCache::Stat(const char* fileName, uint64_t& size, uint64_t& lastWriteTime)
+		{
+			DataDirectoryIndex::FileInfo info;
+			switch (DataDirectoryIndex::Query(fileName, info))
+			{
+			case DataDirectoryIndex::kMissing:
+				return false;
+			case DataDirectoryIndex::kFound:
+				size = info.size;
+				lastWriteTime = info.lastWriteTime;
+				return !(info.attributes & FILE_ATTRIBUTE_DIRECTORY);
+			}
+
+			WIN32_FILE_ATTRIBUTE_DATA fileData;
+			if (!GetFileAttributesExA(fileName, GetFileExInfoStandard, &fileData) ||
+				(fileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				return false;
+
+			size = ((uint64_t)fileData.nFileSizeHigh << 32) | fileData.nFileSizeLow;
+			lastWriteTime = ((uint64_t)fileData.ftLastWriteTime.dwHighDateTime << 32) |
+				fileData.ftLastWriteTime.dwLowDateTime;
+
+			return true;
+		}
+
+		bool ArchiveDirectoryCache::Parse(HANDLE file, uint64_t fileSize, Array<Region>& regions, bool& persist)
+		{
+			Reader reader(file);
+			auto fileId = reader.At(0, 4);
+			if (!fileId)
+				return false;
+
+			if (!memcmp(fileId, "BSA\0", 4))
+				return ParseBSA(reader, fileSize, regions);
+			else if (!memcmp(fileId, "BTDX", 4))
+				return ParseBA2(reader, fileSize, regions, persist);
+
+			return false;
+		}
+
+		bool ArchiveDirectoryCache::ParseBSA(Reader& reader, uint64_t fileSize, Array<Region>& regions)
+		{
+			auto data = reader.At(0, sizeof(ArchiveBSAHeader));
+			if (!data)
+				return false;
+
+			ArchiveBSAHeader header;
+			memcpy(&header, data, sizeof(ArchiveBSAHeader));
+
+			if (((header.Version != 104) && (header.Version != 105)) || (header.Offset != sizeof(ArchiveBSAHeader)))
+				return false;
+
+			// Папки, их имена, записи файлов и имена файлов лежат одним блоком сразу за заголовком
+			uint64_t extent = header.Offset + (uint64_t)header.FolderCount * ((header.Version == 105) ? 24 : 16) +
+				(uint64_t)header.FileCount * 16;
+			if (header.ArchiveFlags & BSA_FLAG_DIRECTORY_NAMES)
+				extent += (uint64_t)header.TotalFolderNameLength + header.FolderCount;
+			if (header.ArchiveFlags & BSA_FLAG_FILE_NAMES)
+				extent += header.TotalFileNameLength;
+
+			if (extent > fileSize)
+				return false;
+
+			regions.assign({ { 0, extent } });
+			return true;
+		}
+
+		bool ArchiveDirectoryCache::ParseBA2(Reader& reader, uint64_t fileSize, Array<Region>& regions, bool& persist)
+		{
+			auto data = reader.At(0, sizeof(ArchiveBA2Header));
+			if (!data)
+				return false;
+
+			ArchiveBA2Header header;
+			memcpy(&header, data, sizeof(ArchiveBA2Header));
+
+			uint64_t extent = 0;
+			switch (header.Version)
+			{
+			case 1:
+			case 7:
+			case 8:
+				extent = 24;
+				break;
+			case 2:
+				extent = 32;
+				break;
+			case 3:
+				extent = 36;
+				break;
+			default:
+				return false;
+			}
+
+			if (!memcmp(header.Type, "GNRL", 4))
+				extent += (uint64_t)header.FileCount * BA2_GENERAL_RECORD_SIZE;
+			else if (!memcmp(header.Type, "DX10", 4))
+			{
+				// У каждой текстуры своё число частей, границу таблицы даёт только полный проход
+				for (uint32_t i = 0; i < header.FileCount; i++)
+				{
+					auto record = (const ArchiveBA2TextureRecord*)reader.At(extent, sizeof(ArchiveBA2TextureRecord));
+					if (!record)
+						return false;
+
+					extent += sizeof(ArchiveBA2TextureRecord) + (uint64_t)record->ChunkCount * BA2_TEXTURE_CHUNK_SIZE;
+				}
+
+				persist = true;
+			}
+			else
+				return false;
+
+			if (extent > fileSize)
+				return false;
+
+			regions.assign({ { 0, extent } });
+
+			// Таблица имён лежит в конце архива после данных
+			if (header.NameTableOffset)
+			{
+				if ((header.NameTableOffset < extent) || (header.NameTableOffset > fileSize))
+					return false;
+
+				regions.push_back({ header.NameTableOffset, fileSize - header.NameTableOffset });
+			}
+
+			return true;
+		}
+
+		void ArchiveDirectoryCache::Read(HANDLE file, const Array<Region>& regions)
+		{
+			Array<uint8_t> buffer(READ_CHUNK);
+
+			for (auto& region : regions)
+			{
+				for (uint64_t offset = region.offset, end = region.offset + region.size; offset < end;)
+				{
+					OVERLAPPED overlapped = {};
+					overlapped.Offset = (DWORD)offset;
+					overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+					DWORD read = 0;
+					DWORD size = (DWORD)std::min<uint64_t>(end - offset, READ_CHUNK);
+					if (!ReadFile(file, buffer.data(), size, &read, &overlapped) || !read)
+						break;
+
+					offset += read;
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
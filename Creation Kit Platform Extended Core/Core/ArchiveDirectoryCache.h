@@ -0,0 +1,81 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <deque>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Кеш расположения таблиц архивов BSA (104, 105) и BA2 (GNRL, DX10).
+		// Архивы всего порядка загрузки подготавливаются заранее рабочими потоками: заголовок, записи файлов
+		// и таблица имён читаются крупными последовательными блоками, и мелкие чтения движка попадают в системный
+		// кеш. Сам движок читает таблицы своим кодом, поэтому эти области читаются с диска и при попадании в кеш.
+		// Поток загрузки архивы не читает: подключение ждёт только подготовку, которая уже идёт, а архив, до
+		// которого потоки не дошли, снимается с очереди, иначе его прочитали бы дважды подряд.
+		// Между запусками сохраняются только границы таблиц DX10: записи текстур переменной длины, и без кеша
+		// границу можно узнать только пройдя все записи. У BSA и GNRL граница считается по заголовку,
+		// поэтому такие архивы в файл кеша не попадают.
+		// Рабочие потоки создаются один раз, не больше MAX_WORKERS, и между вызовами Prefetch спят.
+		class ArchiveDirectoryCache
+		{
+		public:
+			constexpr static uint32_t MAX_REGIONS = 4;
+			constexpr static uint32_t MAX_WORKERS = 4;
+			constexpr static size_t READ_CHUNK = 1024 * 1024;
+
+			struct Region
+			{
+				uint64_t offset;
+				uint64_t size;
+			};
+
+			// Подключение архива движком: размер и ожидание подготовки, если она уже идёт.
+			// Возвращает false, если архива нет
+			static bool Attach(const char* fileName, uint64_t& fileSize);
+			// Ставит архивы в очередь подготовки в порядке загрузки
+			static void Prefetch(const Array<String>& fileNames);
+			// Забывает архивы из очереди, которые так и не понадобились
+			static void CancelPrefetch();
+			// Записывает кеш на диск, если появились новые архивы
+			static void Save();
+			// Границы таблиц по заголовку (и записям DX10). persist - стоит ли сохранять их между запусками
+			static bool Parse(HANDLE file, uint64_t fileSize, Array<Region>& regions, bool& persist);
+		private:
+			struct Entry
+			{
+				uint64_t size;
+				uint64_t lastWriteTime;
+				Array<Region> regions;
+			};
+
+			class Reader;
+			struct Job;
+
+			static void Load();
+			static void EnsureLoaded();
+			static bool MakeKey(const char* fileName, String& key);
+			static bool WarmNow(const char* fileName, const String& key, uint64_t& fileSize);
+			static DWORD WINAPI Worker(LPVOID lpArg);
+			static bool Stat(const char* fileName, uint64_t& size, uint64_t& lastWriteTime);
+			static bool ParseBSA(Reader& reader, uint64_t fileSize, Array<Region>& regions);
+			static bool ParseBA2(Reader& reader, uint64_t fileSize, Array<Region>& regions, bool& persist);
+			static void Read(HANDLE file, const Array<Region>& regions);
+
+			static SRWLOCK _lock;
+			static INIT_ONCE _loaded;
+			static std::unordered_map<String, Entry> _entries;
+			static std::atomic<bool> _dirty;
+
+			static SRWLOCK _jobLock;
+			static CONDITION_VARIABLE _jobDone;
+			static CONDITION_VARIABLE _jobAdded;
+			static uint32_t _workers;
+			static std::unordered_map<String, std::shared_ptr<Job>> _jobs;
+			static std::deque<std::shared_ptr<Job>> _queue;
+		};
+	}
+}
\ No newline at end of file
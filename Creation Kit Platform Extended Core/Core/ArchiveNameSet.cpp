@@ -0,0 +1,105 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "ArchiveNameSet.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		void ArchiveNameSet::Initialize(const char* dataPath, const char* mask)
+		{
+			_names.clear();
+
+			char buffer[MAX_PATH];
+			std::string_view folded;
+
+			WIN32_FIND_DATAA FileFindData;
+			ZeroMemory(&FileFindData, sizeof(WIN32_FIND_DATAA));
+			HANDLE hFindFile = FindFirstFileExA((String(dataPath) + mask).c_str(), FindExInfoBasic, &FileFindData,
+				FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+			if (hFindFile != INVALID_HANDLE_VALUE)
+			{
+				do
+				{
+					if (Fold(FileFindData.cFileName, buffer, _ARRAYSIZE(buffer), folded))
+						_names.emplace(folded);
+				} while (FindNextFileA(hFindFile, &FileFindData));
+
+				FindClose(hFindFile);
+			}
+
+			static const char* SC_NONE = "<NONE>";
+			static const char* Lists[] =
+			{
+				"sResourceArchiveList",
+				"sResourceArchiveList2",
+				"sResourceArchiveMemoryCacheList",
+				"sResourceStartUpArchiveList",
+				"sResourceIndexFileList",
+			};
+
+			INIConfig _conf("CreationKit.ini");
+			INIConfig _User_conf("CreationKitCustom.ini");
+
+			for (auto list : Lists)
+			{
+				auto s = _User_conf.ReadString("Archive", list, SC_NONE);
+				RemoveList((s == SC_NONE) ? _conf.ReadString("Archive", list, "") : s);
+			}
+		}
+
+		bool ArchiveNameSet::Contains(const char* fileName) const
+		{
+			char buffer[MAX_PATH];
+			std::string_view folded;
+
+			if (!fileName || !Fold(fileName, buffer, _ARRAYSIZE(buffer), folded))
+				return false;
+
+			return _names.find(folded) != _names.end();
+		}
+
+		void ArchiveNameSet::RemoveList(const String& list)
+		{
+			char buffer[MAX_PATH];
+			std::string_view folded;
+
+			for (size_t start = 0; start < list.length();)
+			{
+				auto end = list.find(',', start);
+				if (end == String::npos)
+					end = list.length();
+
+				if (Fold(list.substr(start, end - start).c_str(), buffer, _ARRAYSIZE(buffer), folded))
+				{
+					auto it = _names.find(folded);
+					if (it != _names.end())
+						_names.erase(it);
+				}
+
+				start = end + 1;
+			}
+		}
+
+		bool ArchiveNameSet::Fold(const char* fileName, char* buffer, size_t size, std::string_view& folded)
+		{
+			std::string_view name(fileName);
+
+			auto first = name.find_first_not_of(Utils::whitespaceDelimiters);
+			if (first == std::string_view::npos)
+				return false;
+
+			name = name.substr(first, name.find_last_not_of(Utils::whitespaceDelimiters) - first + 1);
+			if (name.length() >= size)
+				return false;
+
+			memcpy(buffer, name.data(), name.length());
+			CharLowerBuffA(buffer, (DWORD)name.length());
+
+			folded = std::string_view(buffer, name.length());
+			return true;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Имена архивов, которые можно подключать вместе с плагинами.
+		// Набор собирается один раз из папки Data за вычетом архивов из списков CreationKit.ini и
+		// CreationKitCustom.ini, которые редактор грузит сам. Имена хранятся в нижнем регистре,
+		// поэтому проверка имени это поиск в хеш таблице, а не сравнение со всеми архивами.
+		class ArchiveNameSet
+		{
+		public:
+			ArchiveNameSet() = default;
+			~ArchiveNameSet() = default;
+
+			// Маска вида "*.ba2", путь к Data с завершающим слэшем
+			void Initialize(const char* dataPath, const char* mask);
+			bool Contains(const char* fileName) const;
+
+			inline size_t Size() const { return _names.size(); }
+		private:
+			ArchiveNameSet(const ArchiveNameSet&) = default;
+			ArchiveNameSet& operator=(const ArchiveNameSet&) = default;
+
+			struct Hash
+			{
+				using is_transparent = void;
+
+				inline size_t operator()(std::string_view s) const noexcept
+				{
+					return std::hash<std::string_view>{}(s);
+				}
+			};
+
+			struct Equal
+			{
+				using is_transparent = void;
+
+				inline bool operator()(std::string_view lhs, std::string_view rhs) const noexcept
+				{
+					return lhs == rhs;
+				}
+			};
+
+			void RemoveList(const String& list);
+			static bool Fold(const char* fileName, char* buffer, size_t size, std::string_view& folded);
+
+			std::unordered_set<String, Hash, Equal> _names;
+		};
+	}
+}
\ No newline at end of file
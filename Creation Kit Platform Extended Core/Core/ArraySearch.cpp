@@ -0,0 +1,297 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Engine.h"
+#include "ArraySearch.h"
+
+#include <immintrin.h>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		static inline uint32_t LowestBit(uint64_t mask)
+		{
+			unsigned long index;
+			_BitScanForward64(&index, mask);
+			return (uint32_t)index;
+		}
+
+		// Для шага 2 годятся только чётные слова массива, маска зависит от чётности начала блока
+		static inline uint64_t KeyLanes(size_t i, uint32_t stride)
+		{
+			if (stride == 1)
+				return ~0ull;
+
+			return (i & 1) ? 0xAAAAAAAAAAAAAAAAull : 0x5555555555555555ull;
+		}
+
+		// Начало массива до выравнивания блока, i - текущее слово, n - всего слов
+		#define SEARCH64_HEAD(ALIGN) \
+			for (; (i < n) && ((uintptr_t)(data + i) & ((ALIGN) - 1)); i++) \
+				if (!(i % stride) && (data[i] == value)) return (uint32_t)(i / stride);
+
+		#define SEARCH64_TAIL() \
+			for (; i < n; i++) \
+				if (!(i % stride) && (data[i] == value)) return (uint32_t)(i / stride); \
+			return INVALID_INDEX;
+
+		void ArraySearch::Initialize()
+		{
+			if (GlobalEnginePtr->HasAVX512())
+			{
+				_find32 = &Find32AVX512;
+				_find64 = &Find64AVX512;
+				_variantName = "AVX-512";
+			}
+			else if (GlobalEnginePtr->HasAVX2())
+			{
+				_find32 = &Find32AVX2;
+				_find64 = &Find64AVX2;
+				_variantName = "AVX2";
+			}
+			else if (GlobalEnginePtr->HasSSE41())
+			{
+				// Для 32-битных значений SSE 4.1 ничего не добавляет
+				_find32 = &Find32SSE2;
+				_find64 = &Find64SSE41;
+				_variantName = "SSE 4.1";
+			}
+			else
+			{
+				_find32 = &Find32SSE2;
+				_find64 = &Find64SSE2;
+				_variantName = "SSE2";
+			}
+		}
+
+		const char* ArraySearch::GetVariantName()
+		{
+			return _variantName;
+		}
+
+		uint32_t ArraySearch::Find32SSE2(const uint32_t* data, uint32_t count, uint32_t value)
+		{
+			size_t i = 0;
+			for (; (i < count) && ((uintptr_t)(data + i) & 15); i++)
+				if (data[i] == value) return (uint32_t)i;
+
+			// 16 значений за проход
+			const __m128i target = _mm_set1_epi32((int)value);
+			for (; (i + 16) <= count; i += 16)
+			{
+				auto p = (const __m128i*)(data + i);
+				__m128i test0 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 0));
+				__m128i test1 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 1));
+				__m128i test2 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 2));
+				__m128i test3 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 3));
+
+				if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(test0, test1), _mm_or_si128(test2, test3))))
+				{
+					uint32_t mask = _mm_movemask_ps(_mm_castsi128_ps(test0)) |
+						(_mm_movemask_ps(_mm_castsi128_ps(test1)) << 4) |
+						(_mm_movemask_ps(_mm_castsi128_ps(test2)) << 8) |
+						(_mm_movemask_ps(_mm_castsi128_ps(test3)) << 12);
+					return (uint32_t)i + LowestBit(mask);
+				}
+			}
+
+			for (; i < count; i++)
+				if (data[i] == value) return (uint32_t)i;
+
+			return INVALID_INDEX;
+		}
+
+		uint32_t ArraySearch::Find32AVX2(const uint32_t* data, uint32_t count, uint32_t value)
+		{
+			size_t i = 0;
+			for (; (i < count) && ((uintptr_t)(data + i) & 31); i++)
+				if (data[i] == value) return (uint32_t)i;
+
+			// 32 значения за проход
+			const __m256i target = _mm256_set1_epi32((int)value);
+			for (; (i + 32) <= count; i += 32)
+			{
+				auto p = (const __m256i*)(data + i);
+				__m256i test0 = _mm256_cmpeq_epi32(target, _mm256_load_si256(p + 0));
+				__m256i test1 = _mm256_cmpeq_epi32(target, _mm256_load_si256(p + 1));
+				__m256i test2 = _mm256_cmpeq_epi32(target, _mm256_load_si256(p + 2));
+				__m256i test3 = _mm256_cmpeq_epi32(target, _mm256_load_si256(p + 3));
+
+				if (!_mm256_testz_si256(_mm256_or_si256(test0, test1), _mm256_or_si256(test0, test1)) ||
+					!_mm256_testz_si256(_mm256_or_si256(test2, test3), _mm256_or_si256(test2, test3)))
+				{
+					uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(test0)) |
+						(_mm256_movemask_ps(_mm256_castsi256_ps(test1)) << 8) |
+						(_mm256_movemask_ps(_mm256_castsi256_ps(test2)) << 16) |
+						((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(test3)) << 24);
+					return (uint32_t)i + LowestBit(mask);
+				}
+			}
+
+			for (; i < count; i++)
+				if (data[i] == value) return (uint32_t)i;
+
+			return INVALID_INDEX;
+		}
+
+		uint32_t ArraySearch::Find32AVX512(const uint32_t* data, uint32_t count, uint32_t value)
+		{
+			if (!count)
+				return INVALID_INDEX;
+
+			// Маскированная загрузка не трогает память вне маски, поэтому начало и конец
+			// читаются выровненными блоками без побайтового прохода
+			const __m512i target = _mm512_set1_epi32((int)value);
+			auto block = (const uint32_t*)((uintptr_t)data & ~(uintptr_t)63);
+			auto skip = (size_t)(data - block);
+			auto end = data + count;
+
+			__mmask16 lanes = (__mmask16)(0xFFFF << skip);
+			if ((size_t)(end - block) < 16)
+				lanes &= (__mmask16)((1u << (end - block)) - 1);
+
+			auto mask = _mm512_mask_cmpeq_epi32_mask(lanes, target, _mm512_maskz_load_epi32(lanes, block));
+			if (mask)
+				return (uint32_t)(block - data) + LowestBit(mask);
+
+			// 32 значения за проход
+			block += 16;
+			for (; (block + 32) <= end; block += 32)
+			{
+				auto mask0 = _mm512_cmpeq_epi32_mask(target, _mm512_load_si512(block));
+				auto mask1 = _mm512_cmpeq_epi32_mask(target, _mm512_load_si512(block + 16));
+				if (mask0 | mask1)
+					return (uint32_t)(block - data) + LowestBit(mask0 | ((uint32_t)mask1 << 16));
+			}
+
+			for (; block < end; block += 16)
+			{
+				lanes = ((size_t)(end - block) < 16) ? (__mmask16)((1u << (end - block)) - 1) : (__mmask16)0xFFFF;
+				mask = _mm512_mask_cmpeq_epi32_mask(lanes, target, _mm512_maskz_load_epi32(lanes, block));
+				if (mask)
+					return (uint32_t)(block - data) + LowestBit(mask);
+			}
+
+			return INVALID_INDEX;
+		}
+
+		uint32_t ArraySearch::Find64SSE2(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride)
+		{
+			size_t i = 0, n = (size_t)count * stride;
+			SEARCH64_HEAD(16);
+
+			// 8 слов за проход, без SSE 4.1 слово равно, если равны обе его половины
+			const __m128i target = _mm_set1_epi64x((__int64)value);
+			auto lanes = KeyLanes(i, stride);
+			for (; (i + 8) <= n; i += 8)
+			{
+				auto p = (const __m128i*)(data + i);
+				__m128i test0 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 0));
+				__m128i test1 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 1));
+				__m128i test2 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 2));
+				__m128i test3 = _mm_cmpeq_epi32(target, _mm_load_si128(p + 3));
+				test0 = _mm_and_si128(test0, _mm_shuffle_epi32(test0, _MM_SHUFFLE(2, 3, 0, 1)));
+				test1 = _mm_and_si128(test1, _mm_shuffle_epi32(test1, _MM_SHUFFLE(2, 3, 0, 1)));
+				test2 = _mm_and_si128(test2, _mm_shuffle_epi32(test2, _MM_SHUFFLE(2, 3, 0, 1)));
+				test3 = _mm_and_si128(test3, _mm_shuffle_epi32(test3, _MM_SHUFFLE(2, 3, 0, 1)));
+
+				uint64_t mask = (_mm_movemask_pd(_mm_castsi128_pd(test0)) |
+					(_mm_movemask_pd(_mm_castsi128_pd(test1)) << 2) |
+					(_mm_movemask_pd(_mm_castsi128_pd(test2)) << 4) |
+					(_mm_movemask_pd(_mm_castsi128_pd(test3)) << 6)) & lanes;
+				if (mask)
+					return (uint32_t)((i + LowestBit(mask)) / stride);
+			}
+
+			SEARCH64_TAIL();
+		}
+
+		uint32_t ArraySearch::Find64SSE41(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride)
+		{
+			size_t i = 0, n = (size_t)count * stride;
+			SEARCH64_HEAD(16);
+
+			// 8 слов за проход
+			const __m128i target = _mm_set1_epi64x((__int64)value);
+			auto lanes = KeyLanes(i, stride);
+			for (; (i + 8) <= n; i += 8)
+			{
+				auto p = (const __m128i*)(data + i);
+				__m128i test0 = _mm_cmpeq_epi64(target, _mm_load_si128(p + 0));
+				__m128i test1 = _mm_cmpeq_epi64(target, _mm_load_si128(p + 1));
+				__m128i test2 = _mm_cmpeq_epi64(target, _mm_load_si128(p + 2));
+				__m128i test3 = _mm_cmpeq_epi64(target, _mm_load_si128(p + 3));
+
+				uint64_t mask = (_mm_movemask_pd(_mm_castsi128_pd(test0)) |
+					(_mm_movemask_pd(_mm_castsi128_pd(test1)) << 2) |
+					(_mm_movemask_pd(_mm_castsi128_pd(test2)) << 4) |
+					(_mm_movemask_pd(_mm_castsi128_pd(test3)) << 6)) & lanes;
+				if (mask)
+					return (uint32_t)((i + LowestBit(mask)) / stride);
+			}
+
+			SEARCH64_TAIL();
+		}
+
+		uint32_t ArraySearch::Find64AVX2(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride)
+		{
+			size_t i = 0, n = (size_t)count * stride;
+			SEARCH64_HEAD(32);
+
+			// 16 слов за проход
+			const __m256i target = _mm256_set1_epi64x((__int64)value);
+			auto lanes = KeyLanes(i, stride);
+			for (; (i + 16) <= n; i += 16)
+			{
+				auto p = (const __m256i*)(data + i);
+				__m256i test0 = _mm256_cmpeq_epi64(target, _mm256_load_si256(p + 0));
+				__m256i test1 = _mm256_cmpeq_epi64(target, _mm256_load_si256(p + 1));
+				__m256i test2 = _mm256_cmpeq_epi64(target, _mm256_load_si256(p + 2));
+				__m256i test3 = _mm256_cmpeq_epi64(target, _mm256_load_si256(p + 3));
+
+				uint64_t mask = (_mm256_movemask_pd(_mm256_castsi256_pd(test0)) |
+					(_mm256_movemask_pd(_mm256_castsi256_pd(test1)) << 4) |
+					(_mm256_movemask_pd(_mm256_castsi256_pd(test2)) << 8) |
+					(_mm256_movemask_pd(_mm256_castsi256_pd(test3)) << 12)) & lanes;
+				if (mask)
+					return (uint32_t)((i + LowestBit(mask)) / stride);
+			}
+
+			SEARCH64_TAIL();
+		}
+
+		uint32_t ArraySearch::Find64AVX512(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride)
+		{
+			size_t i = 0, n = (size_t)count * stride;
+			SEARCH64_HEAD(64);
+
+			// 16 слов за проход
+			const __m512i target = _mm512_set1_epi64((__int64)value);
+			auto lanes = KeyLanes(i, stride);
+			for (; (i + 16) <= n; i += 16)
+			{
+				uint64_t mask = (_mm512_cmpeq_epi64_mask(target, _mm512_load_si512(data + i)) |
+					((uint32_t)_mm512_cmpeq_epi64_mask(target, _mm512_load_si512(data + i + 8)) << 8)) & lanes;
+				if (mask)
+					return (uint32_t)((i + LowestBit(mask)) / stride);
+			}
+
+			// Остаток меньше блока одной маскированной загрузкой на каждые 8 слов
+			for (; i < n; i += 8)
+			{
+				auto left = n - i;
+				auto valid = (__mmask8)((left < 8) ? ((1u << left) - 1) : 0xFF);
+				uint64_t mask = _mm512_mask_cmpeq_epi64_mask(valid, target, _mm512_maskz_load_epi64(valid, data + i)) & lanes;
+				if (mask)
+					return (uint32_t)((i + LowestBit(mask)) / stride);
+			}
+
+			return INVALID_INDEX;
+		}
+
+		#undef SEARCH64_HEAD
+		#undef SEARCH64_TAIL
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Поиск первого вхождения значения в массиве.
+		// Вариант под SSE2, SSE 4.1, AVX2 или AVX-512 выбирается один раз при запуске, все варианты
+		// возвращают одно и то же: индекс первого совпадения или INVALID_INDEX.
+		// Векторная часть работает только с выровненными блоками, начало и конец массива проверяются отдельно.
+		class ArraySearch
+		{
+		public:
+			constexpr static uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+			static void Initialize();
+			static const char* GetVariantName();
+
+			inline static uint32_t Find32(const uint32_t* data, uint32_t count, uint32_t value)
+			{
+				return _find32(data, count, value);
+			}
+
+			inline static uint32_t Find64(const uint64_t* data, uint32_t count, uint64_t value)
+			{
+				return _find64(data, count, value, 1);
+			}
+
+			inline static uint32_t FindPointer(const void* const* data, uint32_t count, const void* value)
+			{
+				return _find64((const uint64_t*)data, count, (uint64_t)value, 1);
+			}
+
+			// Элементы по 16 байт, сравнивается первое 64-битное слово
+			inline static uint32_t FindKey128(const void* data, uint32_t count, uint64_t key)
+			{
+				return _find64((const uint64_t*)data, count, key, 2);
+			}
+		private:
+			static uint32_t Find32SSE2(const uint32_t* data, uint32_t count, uint32_t value);
+			static uint32_t Find32AVX2(const uint32_t* data, uint32_t count, uint32_t value);
+			static uint32_t Find32AVX512(const uint32_t* data, uint32_t count, uint32_t value);
+
+			// stride - шаг между сравниваемыми 64-битными словами, 1 или 2
+			static uint32_t Find64SSE2(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride);
+			static uint32_t Find64SSE41(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride);
+			static uint32_t Find64AVX2(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride);
+			static uint32_t Find64AVX512(const uint64_t* data, uint32_t count, uint64_t value, uint32_t stride);
+
+			inline static uint32_t(*_find32)(const uint32_t*, uint32_t, uint32_t) = &Find32SSE2;
+			inline static uint32_t(*_find64)(const uint64_t*, uint32_t, uint64_t, uint32_t) = &Find64SSE2;
+			inline static const char* _variantName = "SSE2";
+		};
+	}
+}
\ No newline at end of file
@@ -295,7 +295,7 @@ namespace CreationKitPlatformExtended
 						SendMessageA(rich, EM_EXSETSEL, 0, reinterpret_cast<LPARAM>(&range));
 						SendMessageA(rich, EM_REPLACESEL, FALSE, reinterpret_cast<LPARAM>(message));
 
-						voltek::scalable_free(message);
+						GlobalMemoryManagerPtr->MemFree((void*)message);
 						LineCount++;
 					}
 
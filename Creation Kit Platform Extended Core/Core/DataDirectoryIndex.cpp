@@ -0,0 +1,314 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Engine.h"
+#include "DataDirectoryIndex.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		struct DataDirectoryIndex::Snapshot
+		{
+			struct Hash
+			{
+				using is_transparent = void;
+
+				inline size_t operator()(std::string_view s) const noexcept
+				{
+					uint64_t hash = 0xCBF29CE484222325ull;
+					for (auto c : s)
+						hash = (hash ^ (uint8_t)c) * 0x100000001B3ull;
+					return (size_t)hash;
+				}
+			};
+
+			struct Equal
+			{
+				using is_transparent = void;
+
+				inline bool operator()(std::string_view lhs, std::string_view rhs) const noexcept
+				{
+					return lhs == rhs;
+				}
+			};
+
+			// Ключ это путь относительно Data в нижнем регистре, папки тоже входят в таблицу
+			std::unordered_map<String, FileInfo, Hash, Equal> files;
+		};
+
+		struct DataDirectoryIndex::Walk
+		{
+			const String* root;
+			SRWLOCK lock = SRWLOCK_INIT;
+			CONDITION_VARIABLE changed = CONDITION_VARIABLE_INIT;
+			Array<String> pending;
+			uint32_t busy = 0;
+			std::vector<Array<std::pair<String, FileInfo>>> results;
+			std::atomic<uint32_t> nextResult = 0;
+		};
+
+		SRWLOCK DataDirectoryIndex::_lock = SRWLOCK_INIT;
+		INIT_ONCE DataDirectoryIndex::_initOnce = INIT_ONCE_STATIC_INIT;
+		String DataDirectoryIndex::_root;
+		std::shared_ptr<const DataDirectoryIndex::Snapshot> DataDirectoryIndex::_snapshot;
+		std::atomic<bool> DataDirectoryIndex::_enabled = true;
+
+		DataDirectoryIndex::QueryResult DataDirectoryIndex::Query(const char* fileName, FileInfo& info)
+		{
+			if (!fileName || !_enabled)
+				return kUnknown;
+
+			auto snapshot = Get();
+			if (!snapshot)
+				return kUnknown;
+
+			char path[MAX_PATH * 2];
+			size_t length = 0;
+			if (!Normalize(fileName, path, _ARRAYSIZE(path), length))
+				return kUnknown;
+
+			const size_t rootLength = _root.length();
+			if ((length <= rootLength) || memcmp(path, _root.c_str(), rootLength))
+				return kUnknown;
+
+			std::string_view relative(path + rootLength, length - rootLength);
+			auto it = snapshot->files.find(relative);
+			if (it != snapshot->files.end())
+			{
+				info = it->second;
+				return kFound;
+			}
+
+			// Отсутствие в снимке ещё не значит отсутствие на диске: файл мог только что записать сам редактор,
+			// а уведомление об этом пока не дошло до Watcher, или файл лежит за ссылкой, внутрь которой обход
+			// не заходит. Промах подтверждается системой
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			if (!GetFileAttributesExA(fileName, GetFileExInfoStandard, &data))
+			{
+				auto error = GetLastError();
+				return ((error == ERROR_FILE_NOT_FOUND) || (error == ERROR_PATH_NOT_FOUND)) ? kMissing : kUnknown;
+			}
+
+			info.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+			info.lastWriteTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+			info.attributes = data.dwFileAttributes;
+			return kFound;
+		}
+
+		std::shared_ptr<const DataDirectoryIndex::Snapshot> DataDirectoryIndex::Get()
+		{
+			InitOnceExecuteOnce(&_initOnce, [](PINIT_ONCE, PVOID, PVOID*) -> BOOL
+				{
+					char path[MAX_PATH * 2];
+					size_t length = 0;
+					if (!Normalize("Data\\", path, _ARRAYSIZE(path), length))
+					{
+						_enabled = false;
+						return TRUE;
+					}
+
+					_root.assign(path, length);
+
+					// Слежение начинается до обхода, чтобы изменения во время обхода тоже сбросили снимок
+					HANDLE change = FindFirstChangeNotificationA(_root.c_str(), TRUE, FILE_NOTIFY_CHANGE_FILE_NAME |
+						FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+					if (change == INVALID_HANDLE_VALUE)
+					{
+						_enabled = false;
+						return TRUE;
+					}
+
+					Publish(Build(_root));
+
+					HANDLE thread = CreateThread(nullptr, 0, Watcher, change, 0, nullptr);
+					if (thread)
+						CloseHandle(thread);
+					else
+					{
+						// Без слежения снимок быстро устареет
+						_enabled = false;
+						Publish(nullptr);
+						FindCloseChangeNotification(change);
+					}
+
+					return TRUE;
+				}, nullptr, nullptr);
+
+			AcquireSRWLockShared(&_lock);
+			auto snapshot = _snapshot;
+			ReleaseSRWLockShared(&_lock);
+
+			return snapshot;
+		}
+
+		void DataDirectoryIndex::Publish(std::shared_ptr<const Snapshot> snapshot)
+		{
+			AcquireSRWLockExclusive(&_lock);
+			_snapshot.swap(snapshot);
+			ReleaseSRWLockExclusive(&_lock);
+		}
+
+		std::shared_ptr<const DataDirectoryIndex::Snapshot> DataDirectoryIndex::Build(const String& root)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+
+			Walk walk;
+			walk.root = &root;
+			walk.pending.emplace_back();
+
+			uint32_t workers = std::clamp<uint32_t>(GlobalEnginePtr->GetTotalLogicalCores(), 1, MAX_WORKERS);
+			walk.results.resize(workers);
+
+			Array<HANDLE> threads;
+			for (uint32_t i = 1; i < workers; i++)
+			{
+				auto thread = CreateThread(nullptr, 0, Walker, &walk, 0, nullptr);
+				if (thread)
+					threads.push_back(thread);
+			}
+
+			// Текущий поток обходит наравне с остальными
+			Walker(&walk);
+
+			if (!threads.empty())
+				WaitForMultipleObjects((DWORD)threads.size(), threads.data(), TRUE, INFINITE);
+			for (auto thread : threads)
+				CloseHandle(thread);
+
+			size_t total = 0;
+			for (auto& result : walk.results)
+				total += result.size();
+
+			auto snapshot = std::make_shared<Snapshot>();
+			snapshot->files.reserve(total);
+
+			for (auto& result : walk.results)
+			{
+				for (auto& item : result)
+					snapshot->files.emplace(std::move(item.first), item.second);
+			}
+
+			_CONSOLE("Data directory index: %llu entries in %llu ms", (uint64_t)snapshot->files.size(),
+				(uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::high_resolution_clock::now() - start).count());
+
+			return snapshot;
+		}
+
+		bool DataDirectoryIndex::Normalize(const char* fileName, char* buffer, size_t size, size_t& length)
+		{
+			// Разбор пути без обращения к диску: слэши, "." и ".." приводятся к одному виду
+			length = GetFullPathNameA(fileName, (DWORD)size, buffer, nullptr);
+			if (!length || (length >= size))
+				return false;
+
+			CharLowerBuffA(buffer, (DWORD)length);
+			return true;
+		}
+
+		DWORD WINAPI DataDirectoryIndex::Walker(LPVOID lpArg)
+		{
+			auto walk = (Walk*)lpArg;
+			auto& result = walk->results[walk->nextResult++];
+
+			WIN32_FIND_DATAA data;
+			Array<String> directories;
+
+			for (;;)
+			{
+				String directory;
+
+				AcquireSRWLockExclusive(&walk->lock);
+				while (walk->pending.empty() && walk->busy)
+					SleepConditionVariableSRW(&walk->changed, &walk->lock, INFINITE, 0);
+
+				if (walk->pending.empty())
+				{
+					ReleaseSRWLockExclusive(&walk->lock);
+					WakeAllConditionVariable(&walk->changed);
+					break;
+				}
+
+				directory = std::move(walk->pending.back());
+				walk->pending.pop_back();
+				walk->busy++;
+				ReleaseSRWLockExclusive(&walk->lock);
+
+				HANDLE handle = FindFirstFileExA((*walk->root + directory + "*").c_str(), FindExInfoBasic, &data,
+					FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+				if (handle != INVALID_HANDLE_VALUE)
+				{
+					do
+					{
+						if (!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, ".."))
+							continue;
+
+						CharLowerBuffA(data.cFileName, (DWORD)strlen(data.cFileName));
+
+						FileInfo info
+						{
+							.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow,
+							.lastWriteTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) |
+								data.ftLastWriteTime.dwLowDateTime,
+							.attributes = data.dwFileAttributes,
+						};
+
+						result.emplace_back(directory + data.cFileName, info);
+
+						// Ссылки могут зациклиться, их содержимое остаётся системе
+						if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+							!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+							directories.push_back(result.back().first + "\\");
+					} while (FindNextFileA(handle, &data));
+
+					FindClose(handle);
+				}
+
+				AcquireSRWLockExclusive(&walk->lock);
+				for (auto& it : directories)
+					walk->pending.push_back(std::move(it));
+				walk->busy--;
+				ReleaseSRWLockExclusive(&walk->lock);
+				WakeAllConditionVariable(&walk->changed);
+
+				directories.clear();
+			}
+
+			return 0;
+		}
+
+		DWORD WINAPI DataDirectoryIndex::Watcher(LPVOID lpArg)
+		{
+			HANDLE change = (HANDLE)lpArg;
+
+			while (WaitForSingleObject(change, INFINITE) == WAIT_OBJECT_0)
+			{
+				Publish(nullptr);
+
+				// Ждём, пока изменения утихнут, иначе запись каждого файла вызывала бы полный обход
+				bool rearmed = true;
+				do
+				{
+					rearmed = FindNextChangeNotification(change);
+				} while (rearmed && (WaitForSingleObject(change, REBUILD_DELAY_MS) == WAIT_OBJECT_0));
+
+				if (!rearmed)
+					break;
+
+				auto snapshot = Build(_root);
+
+				// Папка изменилась во время обхода, снимок уже устарел
+				if (WaitForSingleObject(change, 0) != WAIT_OBJECT_0)
+					Publish(std::move(snapshot));
+			}
+
+			_enabled = false;
+			Publish(nullptr);
+			FindCloseChangeNotification(change);
+
+			return 0;
+		}
+	}
+}
\ No newline at end of file
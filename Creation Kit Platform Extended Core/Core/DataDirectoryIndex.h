@@ -0,0 +1,55 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Снимок папки Data для проверки свободных файлов.
+		// При первом запросе папка обходится несколькими потоками, пути без учёта регистра складываются
+		// в хеш таблицу вместе с размером, атрибутами и временем записи. Любое изменение в папке сбрасывает
+		// снимок, пока изменения идут запросы уходят системе, а после затишья снимок строится заново.
+		// Из снимка отдаются только найденные файлы, промах всегда подтверждается системой.
+		class DataDirectoryIndex
+		{
+		public:
+			constexpr static uint32_t MAX_WORKERS = 8;
+			constexpr static uint32_t REBUILD_DELAY_MS = 2000;
+
+			enum QueryResult : uint32_t
+			{
+				kUnknown = 0,		// Путь вне Data или снимка сейчас нет, спросить систему
+				kMissing,			// Нет ни в снимке, ни на диске
+				kFound,
+			};
+
+			struct FileInfo
+			{
+				uint64_t size;
+				uint64_t lastWriteTime;
+				DWORD attributes;
+			};
+
+			static QueryResult Query(const char* fileName, FileInfo& info);
+		private:
+			struct Snapshot;
+			struct Walk;
+
+			static std::shared_ptr<const Snapshot> Get();
+			static void Publish(std::shared_ptr<const Snapshot> snapshot);
+			static std::shared_ptr<const Snapshot> Build(const String& root);
+			static bool Normalize(const char* fileName, char* buffer, size_t size, size_t& length);
+			static DWORD WINAPI Walker(LPVOID lpArg);
+			static DWORD WINAPI Watcher(LPVOID lpArg);
+
+			static SRWLOCK _lock;
+			static INIT_ONCE _initOnce;
+			static String _root;
+			static std::shared_ptr<const Snapshot> _snapshot;
+			static std::atomic<bool> _enabled;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Decompressor.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		struct Decompressor::ThreadCache
+		{
+			libdeflate_decompressor* decompressor = nullptr;
+
+			~ThreadCache()
+			{
+				if (decompressor)
+					libdeflate_free_decompressor(decompressor);
+			}
+		};
+
+		thread_local Decompressor::ThreadCache Decompressor::_cache;
+
+		libdeflate_decompressor* Decompressor::Get()
+		{
+			if (!_cache.decompressor)
+				_cache.decompressor = libdeflate_alloc_decompressor();
+
+			return _cache.decompressor;
+		}
+
+		bool Decompressor::HasZlibHeader(const void* in, size_t inSize)
+		{
+			if (inSize < 2)
+				return false;
+
+			auto cmf = ((const uint8_t*)in)[0];
+			auto flg = ((const uint8_t*)in)[1];
+
+			// deflate, окно не больше 32 Кб, верная проверка заголовка и без словаря
+			return ((cmf & 0x0F) == 8) && ((cmf >> 4) <= 7) && (((cmf << 8) | flg) % 31 == 0) && !(flg & 0x20);
+		}
+
+		libdeflate_result Decompressor::Zlib(const void* in, size_t inSize, void* out, size_t outSize,
+			size_t* inBytes, size_t* outBytes)
+		{
+			auto decompressor = Get();
+			if (!decompressor)
+				return LIBDEFLATE_BAD_DATA;
+
+			// libdeflate заранее отрезает от потока шесть байт под заголовок и сумму, поэтому при обрезанной сумме
+			// ему не хватает конца самих данных, и он отвечает LIBDEFLATE_INSUFFICIENT_SPACE, а не LIBDEFLATE_BAD_DATA.
+			// Если места и правда мало, deflate ответит так же.
+			auto result = libdeflate_zlib_decompress_ex(decompressor, in, inSize, out, outSize, inBytes, outBytes);
+			if (((result != LIBDEFLATE_BAD_DATA) && (result != LIBDEFLATE_INSUFFICIENT_SPACE)) ||
+				!HasZlibHeader(in, inSize))
+				return result;
+
+			// Заголовок в порядке, значит libdeflate не понравился хвост потока, сами данные проверяет deflate
+			size_t deflateBytes = 0;
+			result = libdeflate_deflate_decompress_ex(decompressor, (const uint8_t*)in + 2, inSize - 2,
+				out, outSize, &deflateBytes, outBytes);
+			if (result != LIBDEFLATE_SUCCESS)
+				return result;
+
+			// Контрольная сумма Adler-32 (big-endian) сразу за данными. Целая сумма обязана совпасть,
+			// прощается только обрезанная или отсутствующая.
+			auto trailer = (const uint8_t*)in + 2 + deflateBytes;
+			auto trailerSize = std::min(inSize - 2 - deflateBytes, (size_t)4);
+			if (trailerSize == 4)
+			{
+				auto expected = ((uint32_t)trailer[0] << 24) | ((uint32_t)trailer[1] << 16) |
+					((uint32_t)trailer[2] << 8) | (uint32_t)trailer[3];
+				if (expected != libdeflate_adler32(1, out, outBytes ? *outBytes : outSize))
+					return LIBDEFLATE_BAD_DATA;
+			}
+
+			if (inBytes)
+				*inBytes = 2 + deflateBytes + trailerSize;
+
+			return result;
+		}
+	}
+}
\ No newline at end of file
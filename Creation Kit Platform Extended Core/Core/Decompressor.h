@@ -0,0 +1,33 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <libdeflate.h>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Распаковка zlib потоков через libdeflate.
+		// Распаковщик создаётся один раз на поток и живёт до его завершения, а не на каждую запись.
+		class Decompressor
+		{
+		public:
+			// Распаковывает zlib поток целиком.
+			// Поток, который libdeflate отвергает из-за обрезанной или отсутствующей контрольной суммы в конце,
+			// распаковывается повторно как deflate тем же распаковщиком. Если все четыре байта суммы на месте,
+			// она сверяется с распакованными данными.
+			static libdeflate_result Zlib(const void* in, size_t inSize, void* out, size_t outSize,
+				size_t* inBytes, size_t* outBytes);
+		private:
+			struct ThreadCache;
+
+			static libdeflate_decompressor* Get();
+			static bool HasZlibHeader(const void* in, size_t inSize);
+
+			static thread_local ThreadCache _cache;
+		};
+	}
+}
\ No newline at end of file
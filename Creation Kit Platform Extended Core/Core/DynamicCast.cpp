@@ -22,8 +22,16 @@ namespace CreationKitPlatformExtended
 	{
 		DynamicCast* GlobalDynamicCastPtr = nullptr;
 
+		constexpr static intptr_t CAST_FAILED = INTPTR_MIN;
+
 		DynamicCast::DynamicCast()
 		{
+			for (auto& Entry : _Cache)
+			{
+				Entry.Sequence.store(0, std::memory_order_relaxed);
+				Entry.VTable.store(0, std::memory_order_relaxed);
+			}
+
 			MSRTTI::Initialize();
 		}
 
@@ -40,43 +48,89 @@ namespace CreationKitPlatformExtended
 			return false;
 		}
 
-		void* DynamicCast::Cast(const void* InPtr, long VfDelta, const char* lpstrFromType,
-			const char* lpstrTargetType, bool isReference)
+		const void* DynamicCast::GetTypeDescriptor(const char* lpstrType)
+		{
+			if (!lpstrType)
+				return nullptr;
+
+			auto It = _Types.find(lpstrType);
+			if (It != _Types.end())
+				return It->second;
+
+			// У класса может быть несколько vtable, но TypeDescriptor у них общий
+			auto Infos = MSRTTI::FindAll(lpstrType);
+			if (Infos.empty())
+				return nullptr;
+
+			const void* Type = Infos[0]->Locator->TypeDescriptor.Get();
+			auto Name = _strdup(lpstrType);
+			if (!_Types.insert(std::make_pair(std::string_view(Name), Type)).second)
+				free(Name);
+
+			return Type;
+		}
+
+		void* DynamicCast::CastByDescriptor(const void* InPtr, long VfDelta, const void* FromType,
+			const void* TargetType, bool isReference)
 		{
-			const MSRTTI::Info* FromInfo = nullptr;
-			const MSRTTI::Info* TargetInfo = nullptr;
-			
-			if (!_CacheFrom.first.compare(lpstrFromType))
-				FromInfo = reinterpret_cast<const MSRTTI::Info*>(_CacheFrom.second);
-			else
+			if (!InPtr || !FromType || !TargetType)
+				return nullptr;
+
+			auto VTable = *(const uintptr_t*)((uintptr_t)InPtr + VfDelta);
+			auto Locator = *(const MSRTTI::detail::CompleteObjectLocator**)(VTable - sizeof(uintptr_t));
+
+			uint64_t Hash = VTable ^ ((uintptr_t)TargetType * 0x9E3779B97F4A7C15ull) ^ 
+				((uintptr_t)FromType >> 4) ^ ((uint64_t)(uint32_t)VfDelta << 32);
+			Hash ^= Hash >> 29;
+			auto& Entry = _Cache[(Hash * 0xBF58476D1CE4E5B9ull) >> (64 - CACHE_BITS)];
+
+			auto Sequence = Entry.Sequence.load(std::memory_order_acquire);
+			if (!(Sequence & 1))
 			{
-				FromInfo = MSRTTI::Find(lpstrFromType);
-				if (FromInfo)
+				bool Match = (Entry.VTable.load(std::memory_order_relaxed) == VTable) &&
+					(Entry.TargetType.load(std::memory_order_relaxed) == (uintptr_t)TargetType) &&
+					(Entry.FromType.load(std::memory_order_relaxed) == (uintptr_t)FromType) &&
+					(Entry.VfDelta.load(std::memory_order_relaxed) == VfDelta);
+				auto Delta = Entry.Delta.load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (Match && (Entry.Sequence.load(std::memory_order_relaxed) == Sequence))
 				{
-					_CacheFrom.first = lpstrFromType;
-					_CacheFrom.second = FromInfo;
+					if (Delta != CAST_FAILED)
+						return (void*)((uintptr_t)InPtr + Delta);
+					// Для ссылки исключение std::bad_cast бросит сама функция
+					if (!isReference)
+						return nullptr;
 				}
 			}
 
-			if (!_CacheTarget.first.compare(lpstrTargetType))
-				TargetInfo = reinterpret_cast<const MSRTTI::Info*>(_CacheTarget.second);
-			else
+			auto Result = __RTDynamicCast((PVOID)InPtr, VfDelta, (PVOID)FromType, (PVOID)TargetType, isReference);
+
+			// Во время работы конструктора с виртуальными базами смещение берётся из объекта, такое не кешируем
+			if (Locator->CDOffset)
+				return Result;
+
+			Sequence = Entry.Sequence.load(std::memory_order_relaxed);
+			if (!(Sequence & 1) && Entry.Sequence.compare_exchange_strong(Sequence, Sequence + 1, std::memory_order_acquire))
 			{
-				TargetInfo = MSRTTI::Find(lpstrTargetType);
-				if (TargetInfo)
-				{ 
-					_CacheTarget.first = lpstrTargetType;
-					_CacheTarget.second = TargetInfo;
-				}
+				std::atomic_thread_fence(std::memory_order_release);
+				Entry.VTable.store(VTable, std::memory_order_relaxed);
+				Entry.TargetType.store((uintptr_t)TargetType, std::memory_order_relaxed);
+				Entry.FromType.store((uintptr_t)FromType, std::memory_order_relaxed);
+				Entry.VfDelta.store(VfDelta, std::memory_order_relaxed);
+				Entry.Delta.store(Result ? (intptr_t)((uintptr_t)Result - (uintptr_t)InPtr) : CAST_FAILED,
+					std::memory_order_relaxed);
+				Entry.Sequence.store(Sequence + 2, std::memory_order_release);
 			}
 
-			if (!FromInfo || !TargetInfo) 
-				return nullptr;
+			return Result;
+		}
 
-			return __RTDynamicCast((PVOID)InPtr, VfDelta,
-				(PVOID)FromInfo->Locator->TypeDescriptor.Get(),
-				(PVOID)TargetInfo->Locator->TypeDescriptor.Get(),
-				isReference);
+		void* DynamicCast::Cast(const void* InPtr, long VfDelta, const char* lpstrFromType,
+			const char* lpstrTargetType, bool isReference)
+		{
+			return CastByDescriptor(InPtr, VfDelta, GetTypeDescriptor(lpstrFromType), 
+				GetTypeDescriptor(lpstrTargetType), isReference);
 		}
 
 		void* DynamicCast::CastNoCache(const void* InPtr, long VfDelta,
@@ -11,6 +11,9 @@ namespace CreationKitPlatformExtended
 		class DynamicCast
 		{
 		public:
+			constexpr static uint32_t CACHE_BITS = 12;
+			constexpr static uint32_t CACHE_SIZE = 1u << CACHE_BITS;
+
 			DynamicCast();
 
 			virtual bool Dump(const char* FileName) const;
@@ -18,12 +21,28 @@ namespace CreationKitPlatformExtended
 				const char* lpstrFromType, const char* lpstrTargetType, bool isReference = false);
 			virtual void* CastNoCache(const void* InPtr, long VfDelta,
 				const char* lpstrFromType, const char* lpstrTargetType, bool isReference = false);
+			virtual const void* GetTypeDescriptor(const char* lpstrType);
+			virtual void* CastByDescriptor(const void* InPtr, long VfDelta,
+				const void* FromType, const void* TargetType, bool isReference = false);
 		private:
 			DynamicCast(const DynamicCast&) = default;
 			DynamicCast& operator=(const DynamicCast&) = default;
 
-			std::pair<std::string_view, const void*> _CacheFrom;
-			std::pair<std::string_view, const void*> _CacheTarget;
+			// Результат приведения зависит только от vtable объекта, смещения и пары типов, поэтому
+			// в кеше хранится разница между исходным и полученным указателем.
+			// Запись защищена счётчиком (seqlock), писатель при конфликте просто пропускает запись.
+			struct CacheEntry
+			{
+				std::atomic<uint32_t> Sequence;
+				std::atomic<long> VfDelta;
+				std::atomic<uintptr_t> VTable;
+				std::atomic<uintptr_t> FromType;
+				std::atomic<uintptr_t> TargetType;
+				std::atomic<intptr_t> Delta;
+			};
+
+			ConcurrencyMap<std::string_view, const void*> _Types;
+			CacheEntry _Cache[CACHE_SIZE];
 		};
 
 		extern DynamicCast* GlobalDynamicCastPtr;
@@ -34,10 +53,21 @@ namespace CreationKitPlatformExtended
 			return GlobalDynamicCastPtr->Cast(InPtr, VfDelta, lpstrFromType, lpstrTargetType, isReference);
 		}
 
+		inline static void* _DYNAMIC_CAST(const void* InPtr, long VfDelta, const void* FromType,
+			const void* TargetType, bool isReference = false)
+		{
+			return GlobalDynamicCastPtr->CastByDescriptor(InPtr, VfDelta, FromType, TargetType, isReference);
+		}
+
 		inline static void* _DYNAMIC_CAST2(const void* InPtr, long VfDelta, const char* lpstrFromType,
 			const char* lpstrTargetType, bool isReference = false)
 		{
 			return GlobalDynamicCastPtr->CastNoCache(InPtr, VfDelta, lpstrFromType, lpstrTargetType, isReference);
 		}
+
+		inline static const void* _RTTI_TYPE(const char* lpstrType)
+		{
+			return GlobalDynamicCastPtr->GetTypeDescriptor(lpstrType);
+		}
 	}
 }
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "TracerManager.h"
 #include "RegistratorWindow.h"
 #include "CrashHandler.h"
+#include "ArraySearch.h"
 #include "ResourcesPackerManager.h"
 
 #include "Editor API/EditorUI.h"
@@ -123,8 +124,9 @@ namespace CreationKitPlatformExtended
 
 		//////////////////////////////////////////////
 
-		Engine::Engine(HMODULE hModule, EDITOR_EXECUTABLE_TYPE eEditorVersion, uintptr_t nModuleBase) :
-			_module(hModule), _moduleBase(nModuleBase), _editorVersion(eEditorVersion), 
+		Engine::Engine(HMODULE hModule, EDITOR_EXECUTABLE_TYPE eEditorVersion, uintptr_t nModuleBase,
+			uint32_t nExecutableCRC32) :
+			_module(hModule), _moduleBase(nModuleBase), _executableCRC32(nExecutableCRC32), _editorVersion(eEditorVersion), 
 			PatchesManager(new ModuleManager()), UserPluginsManager(new PluginManager())
 		{
 			GlobalEnginePtr = this;
@@ -142,10 +144,18 @@ namespace CreationKitPlatformExtended
 			int info[4];
 			__cpuid(info, 7);
 			_hasAVX2 = (info[1] & (1 << 5)) != 0;
+			_hasAVX512 = (info[1] & (1 << 16)) != 0;
 
 			__cpuid(info, 1);
 			_hasSSE41 = (info[2] & (1 << 19)) != 0;
 
+			// AVX2 и AVX-512 годятся, только если система сохраняет их регистры (OSXSAVE и XCR0)
+			uint64_t xcr0 = (info[2] & (1 << 27)) ? _xgetbv(0) : 0;
+			if ((xcr0 & 0x6) != 0x6)
+				_hasAVX2 = false;
+			if ((xcr0 & 0xE6) != 0xE6)
+				_hasAVX512 = false;
+
 			// Detect hyper-threads and cores
 			_hyperThreads = info[3] & (1 << 28);
 			_threads = (info[1] >> 16) & 0xff;
@@ -159,6 +169,10 @@ namespace CreationKitPlatformExtended
 			_MESSAGE("The processor implements hyper-threads technology: %s", (_hyperThreads ? "true" : "false"));
 			_MESSAGE("The processor supports the SSE 4.1 instruction set: %s", (_hasSSE41 ? "true" : "false"));
 			_MESSAGE("The processor supports the AVX 2 instruction set: %s", (_hasAVX2 ? "true" : "false"));
+			_MESSAGE("The processor supports the AVX-512 instruction set: %s", (_hasAVX512 ? "true" : "false"));
+
+			ArraySearch::Initialize();
+			_MESSAGE("Array search uses the %s variant", ArraySearch::GetVariantName());
 
 			// Передача приватных функций класса, для продолжения инициализации
 			VCoreDisableBreakpoint = &Engine::DisableBreakpoint;
@@ -399,6 +413,17 @@ namespace CreationKitPlatformExtended
 					// Закрываем Creation Kit
 					CreationKitPlatformExtended::Utils::Quit();
 				}
+				else if (!_stricmp(Command.c_str(), "-PEConvertDatabase"))
+				{
+					// Открываем базу данных
+					if (GlobalRelocationDatabasePtr->OpenDatabase())
+						// Сохраняем в формате для отображения в память
+						GlobalRelocationDatabasePtr->SaveMappedDatabase();
+					else
+						_FATALERROR("The database is not loaded");
+					// Закрываем Creation Kit
+					CreationKitPlatformExtended::Utils::Quit();
+				}
 				else if (!_stricmp(Command.c_str(), "-PEExportRTTI"))
 				{
 					if (CommandLine.Count() != 2)
@@ -441,10 +466,17 @@ namespace CreationKitPlatformExtended
 			// Парсинг командной строки
 			CommandLineRun();
 			
-			if (!GlobalRelocationDatabasePtr->OpenDatabase())
+			// Отображённая в память база не требует разбора, если её нет или она устарела,
+			// то открывается обычная и из неё собирается отображённая для следующего запуска
+			if (!GlobalRelocationDatabasePtr->OpenMappedDatabase())
 			{
-				_FATALERROR("The database is not loaded, patches are not installed");
-				return;
+				if (!GlobalRelocationDatabasePtr->OpenDatabase())
+				{
+					_FATALERROR("The database is not loaded, patches are not installed");
+					return;
+				}
+
+				GlobalRelocationDatabasePtr->SaveMappedDatabase();
 			}
 			
 			if (!PatchesManager)
@@ -689,7 +721,7 @@ namespace CreationKitPlatformExtended
 				{
 					_MESSAGE("Current CK version: %s", allowedEditorVersionStr[(int)editorVersion].data());
 
-					new Engine(hModule, editorVersion, moduleBase);
+					new Engine(hModule, editorVersion, moduleBase, hash_crc32);
 				}
 				else
 				{
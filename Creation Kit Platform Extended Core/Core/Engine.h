@@ -32,7 +32,8 @@ namespace CreationKitPlatformExtended
 		class Engine
 		{
 		public:
-			Engine(HMODULE hModule, EDITOR_EXECUTABLE_TYPE eEditorVersion, uintptr_t nModuleBase);
+			Engine(HMODULE hModule, EDITOR_EXECUTABLE_TYPE eEditorVersion, uintptr_t nModuleBase,
+				uint32_t nExecutableCRC32);
 			~Engine() = default;
 			
 			inline HINSTANCE GetInstanceDLL() const { return (HINSTANCE)_module; }
@@ -41,8 +42,10 @@ namespace CreationKitPlatformExtended
 			virtual EDITOR_EXECUTABLE_TYPE GetEditorVersion() const;
 			inline ModuleManager* GetPatchesManager() const { return PatchesManager; }
 			inline PluginManager* GetUserPluginsManager() const { return UserPluginsManager; }
+			inline uint32_t GetExecutableCRC32() const { return _executableCRC32; }
 			virtual bool HasAVX2() const;
 			virtual bool HasSSE41() const;
+			inline bool HasAVX512() const { return _hasAVX512; }
 			virtual bool HasCommandRun() const;
 			virtual Section GetSection(uint32_t nIndex) const;
 			virtual OsVersion GetSystemVersion() const;
@@ -65,8 +68,10 @@ namespace CreationKitPlatformExtended
 		private:
 			uintptr_t _moduleBase;
 			uint64_t _moduleSize;
+			uint32_t _executableCRC32;
 			bool _hasAVX2;
 			bool _hasSSE41;
+			bool _hasAVX512;
 			bool _hasCommandRun;
 			EDITOR_EXECUTABLE_TYPE _editorVersion;
 			HMODULE _module;
@@ -0,0 +1,489 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Engine.h"
+#include "MemoryArena.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		struct MemoryArena::ThreadCache
+		{
+			struct Bin
+			{
+				FreeBlock* head;
+				uint32_t count;
+			};
+
+			MemoryArena* owner = nullptr;
+			bool alive = true;
+			Bin bins[CLASS_COUNT] = {};
+
+			~ThreadCache()
+			{
+				// Поток завершается, всё накопленное возвращается в общие списки классов
+				alive = false;
+				if (!owner) return;
+
+				for (uint32_t i = 0; i < CLASS_COUNT; i++)
+				{
+					auto Head = bins[i].head;
+					if (!Head) continue;
+
+					auto Tail = Head;
+					while (Tail->next) Tail = Tail->next;
+
+					owner->Release(i, Head, Tail);
+					bins[i] = {};
+				}
+			}
+		};
+
+		thread_local MemoryArena::ThreadCache MemoryArena::_cache;
+
+		MemoryArena::MemoryArena() : _reserve(0), _base(0), _nextSpan(0), _central(), _largePageMinimum(0),
+			_largePages(false)
+		{
+			InitializeSRWLock(&_largeLock);
+		}
+
+		bool MemoryArena::Initialize()
+		{
+			// Только резервирование адресного пространства, физическая память выделяется по спанам
+			_reserve = (uintptr_t)VirtualAlloc(nullptr, RESERVE_SIZE + SPAN_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+			if (!_reserve)
+			{
+				_ERROR("MemoryArena: Failed to reserve address space %llu bytes", (uint64_t)RESERVE_SIZE);
+				return false;
+			}
+
+			_base = (_reserve + SPAN_SIZE - 1) & ~(SPAN_SIZE - 1);
+			_spanClass.resize(RESERVE_SIZE / SPAN_SIZE);
+
+			for (uint32_t i = 0; i < CLASS_COUNT; i++)
+			{
+				InitializeSRWLock(&_central[i].lock);
+				_central[i].head = nullptr;
+				_central[i].bump = 0;
+				_central[i].bumpEnd = 0;
+			}
+
+			// Большие страницы доступны, только если пользователю выдана привилегия SeLockMemoryPrivilege,
+			// сама привилегия в токене процесса по умолчанию выключена.
+			_largePageMinimum = GetLargePageMinimum();
+			if (_largePageMinimum)
+			{
+				HANDLE Token = nullptr;
+				if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &Token))
+				{
+					TOKEN_PRIVILEGES Privileges = {};
+					Privileges.PrivilegeCount = 1;
+					Privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+					if (LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &Privileges.Privileges[0].Luid) &&
+						AdjustTokenPrivileges(Token, FALSE, &Privileges, 0, nullptr, nullptr))
+						_largePages = GetLastError() == ERROR_SUCCESS;
+
+					CloseHandle(Token);
+				}
+			}
+
+			_MESSAGE("MemoryArena: Reserved %llu Gb, large pages: %s", (uint64_t)(RESERVE_SIZE >> 30),
+				_largePages ? "yes" : "no");
+
+			return true;
+		}
+
+		uint32_t MemoryArena::GetClass(size_t size)
+		{
+			if (size <= 128)
+				return (uint32_t)((size + 15) >> 4) - 1;
+
+			// 2^k < size <= 2^(k+1), шаг внутри удвоения 2^(k-2)
+			unsigned long k;
+			_BitScanReverse64(&k, size - 1);
+			return 8 + (k - 7) * 4 + (uint32_t)(((size - 1) - (1llu << k)) >> (k - 2));
+		}
+
+		size_t MemoryArena::GetClassSize(uint32_t nClass)
+		{
+			if (nClass < 8)
+				return (size_t)(nClass + 1) << 4;
+
+			auto k = 7 + ((nClass - 8) >> 2);
+			return (1llu << k) + ((size_t)(((nClass - 8) & 3) + 1) << (k - 2));
+		}
+
+		uint32_t MemoryArena::GetBatchCount(uint32_t nClass)
+		{
+			// Пачка около 64 Кб, но не больше 64 блоков
+			return (uint32_t)std::clamp<size_t>((64 * 1024) / GetClassSize(nClass), 1, 64);
+		}
+
+		uint32_t MemoryArena::GetClassFor(size_t& size, size_t alignment)
+		{
+			if (size < MIN_SIZE)
+				size = MIN_SIZE;
+
+			if (alignment > 1)
+				size = (size + alignment - 1) & ~(alignment - 1);
+
+			if (size > MAX_SMALL_SIZE)
+				return CLASS_COUNT;
+
+			// Класс подходит, если его размер кратен выравниванию.
+			// Не дальше чем через 4 класса будет степень двойки, которая подходит всегда.
+			auto nClass = GetClass(size);
+			while (nClass < CLASS_COUNT)
+			{
+				auto ClassSize = GetClassSize(nClass);
+				if ((ClassSize & (0 - ClassSize)) >= alignment)
+					break;
+
+				nClass++;
+			}
+
+			return nClass;
+		}
+
+		void* MemoryArena::Alloc(size_t size, size_t alignment, bool zeroed)
+		{
+			if (alignment > MAX_ALIGNMENT)
+				return nullptr;
+
+			auto nClass = GetClassFor(size, alignment);
+			if (nClass < CLASS_COUNT)
+			{
+				auto ptr = AllocSmall(nClass);
+				if (ptr && zeroed) memset(ptr, 0, size);
+
+				return ptr;
+			}
+
+			// Свежие страницы системы уже обнулены
+			return AllocLarge(size);
+		}
+
+		size_t MemoryArena::AllocBatch(void** blocks, size_t count, size_t size, size_t alignment, bool zeroed)
+		{
+			if (!blocks || !count || (alignment > MAX_ALIGNMENT))
+				return 0;
+
+			size_t Count = 0;
+			auto nClass = GetClassFor(size, alignment);
+			if (nClass >= CLASS_COUNT)
+			{
+				for (; Count < count; Count++)
+				{
+					blocks[Count] = AllocLarge(size);
+					if (!blocks[Count]) break;
+				}
+
+				return Count;
+			}
+
+			// Сначала то, что уже лежит в кеше потока
+			if (_cache.alive)
+			{
+				_cache.owner = this;
+
+				auto& Bin = _cache.bins[nClass];
+				while ((Count < count) && Bin.head)
+				{
+					blocks[Count++] = Bin.head;
+					Bin.head = Bin.head->next;
+					Bin.count--;
+				}
+			}
+
+			// Остаток одним захватом общего списка, новые блоки нарезаются подряд из спана
+			while (Count < count)
+			{
+				FreeBlock* Chain = nullptr;
+				auto Request = (uint32_t)std::min<size_t>(count - Count, 0xFFFFFFFFull);
+				if (!Refill(nClass, &Chain, Request))
+					break;
+
+				for (; Chain; Chain = Chain->next)
+					blocks[Count++] = Chain;
+			}
+
+			if (zeroed)
+			{
+				for (size_t i = 0; i < Count; i++)
+					memset(blocks[i], 0, size);
+			}
+
+			return Count;
+		}
+
+		bool MemoryArena::Free(void* block)
+		{
+			if (!block) return false;
+
+			if (IsSmall(block))
+			{
+				FreeSmall(block);
+				return true;
+			}
+
+			return FreeLarge(block);
+		}
+
+		size_t MemoryArena::Size(const void* block) const
+		{
+			if (!block) return 0;
+
+			if (IsSmall(block))
+				return GetClassSize(_spanClass[((uintptr_t)block - _base) / SPAN_SIZE]);
+
+			size_t Result = 0;
+			AcquireSRWLockShared(&_largeLock);
+			auto It = _large.find((uintptr_t)block);
+			if (It != _large.end())
+				Result = It->second.committed;
+			ReleaseSRWLockShared(&_largeLock);
+
+			return Result;
+		}
+
+		bool MemoryArena::Resize(void* block, size_t oldSize, size_t size, bool zeroed)
+		{
+			if (!block || !size) return false;
+
+			// Байты, которые станут частью блока и не являются свежими страницами системы
+			size_t ZeroEnd = size;
+
+			if (IsSmall(block))
+			{
+				auto ClassSize = GetClassSize(_spanClass[((uintptr_t)block - _base) / SPAN_SIZE]);
+
+				// Сильно уменьшившийся блок лучше переселить в свой класс
+				if ((size > ClassSize) || ((ClassSize > 128) && (size < (ClassSize >> 2))))
+					return false;
+			}
+			else
+			{
+				auto NewSize = (size + 0xFFF) & ~0xFFFllu;
+
+				AcquireSRWLockExclusive(&_largeLock);
+
+				auto It = _large.find((uintptr_t)block);
+				if (It == _large.end())
+				{
+					ReleaseSRWLockExclusive(&_largeLock);
+					return false;
+				}
+
+				auto& Block = It->second;
+				if (NewSize > Block.committed)
+				{
+					if (Block.largePages || (NewSize > Block.reserved) ||
+						!VirtualAlloc((LPVOID)((uintptr_t)block + Block.committed), NewSize - Block.committed,
+							MEM_COMMIT, PAGE_READWRITE))
+					{
+						ReleaseSRWLockExclusive(&_largeLock);
+						return false;
+					}
+
+					ZeroEnd = Block.committed;
+					Block.committed = NewSize;
+				}
+				else if (!Block.largePages && (NewSize <= (Block.committed >> 1)))
+				{
+					// Хвост возвращается системе, адреса остаются за блоком
+					VirtualFree((LPVOID)((uintptr_t)block + NewSize), Block.committed - NewSize, MEM_DECOMMIT);
+					Block.committed = NewSize;
+				}
+
+				ReleaseSRWLockExclusive(&_largeLock);
+			}
+
+			if (zeroed && (ZeroEnd > oldSize))
+				memset((uint8_t*)block + oldSize, 0, ZeroEnd - oldSize);
+
+			return true;
+		}
+
+		void* MemoryArena::AllocSmall(uint32_t nClass)
+		{
+			FreeBlock* Block = nullptr;
+
+			// Кеш потока уже уничтожен (освобождение памяти в деструкторах thread_local)
+			if (!_cache.alive)
+				return Refill(nClass, &Block, 1) ? Block : nullptr;
+
+			auto& Bin = _cache.bins[nClass];
+			if (!Bin.head)
+			{
+				_cache.owner = this;
+				Bin.count = Refill(nClass, &Bin.head, GetBatchCount(nClass));
+				if (!Bin.head) return nullptr;
+			}
+
+			Block = Bin.head;
+			Bin.head = Block->next;
+			Bin.count--;
+
+			return Block;
+		}
+
+		void MemoryArena::FreeSmall(void* block)
+		{
+			auto nClass = (uint32_t)_spanClass[((uintptr_t)block - _base) / SPAN_SIZE];
+			auto Block = (FreeBlock*)block;
+
+			if (!_cache.alive)
+			{
+				Block->next = nullptr;
+				Release(nClass, Block, Block);
+				return;
+			}
+
+			_cache.owner = this;
+
+			auto& Bin = _cache.bins[nClass];
+			Block->next = Bin.head;
+			Bin.head = Block;
+			Bin.count++;
+
+			// Кеш потока не растёт бесконечно, лишняя пачка уходит в общий список
+			auto Batch = GetBatchCount(nClass);
+			if (Bin.count >= (Batch << 1))
+			{
+				auto Head = Bin.head;
+				auto Tail = Head;
+				for (uint32_t i = 1; i < Batch; i++)
+					Tail = Tail->next;
+
+				Bin.head = Tail->next;
+				Bin.count -= Batch;
+				Tail->next = nullptr;
+
+				Release(nClass, Head, Tail);
+			}
+		}
+
+		uint32_t MemoryArena::Refill(uint32_t nClass, FreeBlock** head, uint32_t count)
+		{
+			auto& Bin = _central[nClass];
+			auto ClassSize = GetClassSize(nClass);
+
+			FreeBlock* Chain = nullptr;
+			uint32_t Count = 0;
+
+			AcquireSRWLockExclusive(&Bin.lock);
+
+			while ((Count < count) && Bin.head)
+			{
+				auto Block = Bin.head;
+				Bin.head = Block->next;
+				Block->next = Chain;
+				Chain = Block;
+				Count++;
+			}
+
+			while (Count < count)
+			{
+				if ((Bin.bump + ClassSize) > Bin.bumpEnd)
+				{
+					// Новый спан для класса, хвост старого меньше размера блока и не используется
+					auto Span = _nextSpan.fetch_add(1);
+					if (((Span + 1) * SPAN_SIZE) > RESERVE_SIZE)
+						break;
+
+					auto Address = _base + Span * SPAN_SIZE;
+					if (!VirtualAlloc((LPVOID)Address, SPAN_SIZE, MEM_COMMIT, PAGE_READWRITE))
+						break;
+
+					_spanClass[Span] = (uint8_t)nClass;
+					Bin.bump = Address;
+					Bin.bumpEnd = Address + SPAN_SIZE;
+				}
+
+				auto Block = (FreeBlock*)Bin.bump;
+				Bin.bump += ClassSize;
+				Block->next = Chain;
+				Chain = Block;
+				Count++;
+			}
+
+			ReleaseSRWLockExclusive(&Bin.lock);
+
+			*head = Chain;
+			return Count;
+		}
+
+		void MemoryArena::Release(uint32_t nClass, FreeBlock* head, FreeBlock* tail)
+		{
+			auto& Bin = _central[nClass];
+
+			AcquireSRWLockExclusive(&Bin.lock);
+			tail->next = Bin.head;
+			Bin.head = head;
+			ReleaseSRWLockExclusive(&Bin.lock);
+		}
+
+		void* MemoryArena::AllocLarge(size_t size)
+		{
+			size = (size + 0xFFF) & ~0xFFFllu;
+
+			void* ptr = nullptr;
+			if (_largePages && (size >= LARGE_PAGE_THRESHOLD))
+			{
+				auto LargeSize = (size + _largePageMinimum - 1) & ~(_largePageMinimum - 1);
+				ptr = VirtualAlloc(nullptr, LargeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (ptr)
+					size = LargeSize;
+				else
+				{
+					// Физическая память фрагментирована или не хватает, больше не пытаемся
+					_largePages = false;
+					_WARNING("MemoryArena: Large pages are unavailable, disabled");
+				}
+			}
+
+			LargeBlock Block = { size, size, ptr != nullptr };
+
+			if (!ptr)
+			{
+				// Адресное пространство резервируется с запасом до степени двойки,
+				// тогда рост блока в Resize это только выделение страниц следом, без копирования
+				Block.reserved = std::bit_ceil(size);
+				ptr = VirtualAlloc(nullptr, Block.reserved, MEM_RESERVE, PAGE_READWRITE);
+				if (!ptr)
+				{
+					Block.reserved = size;
+					ptr = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+					if (!ptr) return nullptr;
+				}
+
+				if (!VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE))
+				{
+					VirtualFree(ptr, 0, MEM_RELEASE);
+					return nullptr;
+				}
+			}
+
+			AcquireSRWLockExclusive(&_largeLock);
+			_large.emplace((uintptr_t)ptr, Block);
+			ReleaseSRWLockExclusive(&_largeLock);
+
+			return ptr;
+		}
+
+		bool MemoryArena::FreeLarge(void* block)
+		{
+			AcquireSRWLockExclusive(&_largeLock);
+			auto Found = _large.erase((uintptr_t)block) != 0;
+			ReleaseSRWLockExclusive(&_largeLock);
+
+			if (Found)
+				VirtualFree(block, 0, MEM_RELEASE);
+
+			return Found;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Собственный распределитель памяти с честным выравниванием.
+		// Мелкие блоки (до MAX_SMALL_SIZE) выдаются из классов размеров, каждый класс нарезает свои
+		// спаны (SPAN_SIZE) внутри заранее зарезервированного адресного пространства. Спаны выровнены
+		// по своему размеру, поэтому блок класса выровнен по младшему биту размера класса.
+		// У каждого потока свой кеш свободных блоков, общий список класса трогается пачками.
+		// Крупные блоки берутся у системы целыми страницами, они уже обнулены, а очень крупные
+		// по возможности размещаются в больших страницах.
+		class MemoryArena
+		{
+		public:
+			constexpr static size_t RESERVE_SIZE = 128llu * 1024 * 1024 * 1024;
+			constexpr static size_t SPAN_SIZE = 1024 * 1024;
+			constexpr static size_t MIN_SIZE = 16;
+			constexpr static size_t MAX_SMALL_SIZE = 256 * 1024;
+			constexpr static size_t MAX_ALIGNMENT = 64 * 1024;
+			constexpr static size_t LARGE_PAGE_THRESHOLD = 64 * 1024 * 1024;
+			// 8 линейных классов по 16 байт до 128, затем по 4 класса на каждое удвоение до 256 Кб
+			constexpr static uint32_t CLASS_COUNT = 8 + 4 * 11;
+		public:
+			MemoryArena();
+			~MemoryArena() = default;
+
+			bool Initialize();
+
+			void* Alloc(size_t size, size_t alignment, bool zeroed);
+			// Возвращает количество выделенных блоков, может быть меньше запрошенного
+			size_t AllocBatch(void** blocks, size_t count, size_t size, size_t alignment, bool zeroed);
+			bool Free(void* block);
+			// Изменяет размер блока на месте, false если блок надо переселять
+			bool Resize(void* block, size_t oldSize, size_t size, bool zeroed);
+			size_t Size(const void* block) const;
+
+			inline bool IsSmall(const void* block) const
+			{
+				return ((uintptr_t)block - _base) < RESERVE_SIZE;
+			}
+		private:
+			MemoryArena(const MemoryArena&) = default;
+			MemoryArena& operator=(const MemoryArena&) = default;
+
+			struct FreeBlock
+			{
+				FreeBlock* next;
+			};
+
+			struct Central
+			{
+				SRWLOCK lock;
+				FreeBlock* head;
+				uintptr_t bump;
+				uintptr_t bumpEnd;
+			};
+
+			struct LargeBlock
+			{
+				size_t committed;
+				size_t reserved;
+				bool largePages;
+			};
+
+			struct ThreadCache;
+
+			static uint32_t GetClass(size_t size);
+			static uint32_t GetClassFor(size_t& size, size_t alignment);
+			static size_t GetClassSize(uint32_t nClass);
+			static uint32_t GetBatchCount(uint32_t nClass);
+
+			void* AllocSmall(uint32_t nClass);
+			void FreeSmall(void* block);
+			uint32_t Refill(uint32_t nClass, FreeBlock** head, uint32_t count);
+			void Release(uint32_t nClass, FreeBlock* head, FreeBlock* tail);
+
+			void* AllocLarge(size_t size);
+			bool FreeLarge(void* block);
+
+			static thread_local ThreadCache _cache;
+
+			uintptr_t _reserve;
+			uintptr_t _base;
+			std::atomic<size_t> _nextSpan;
+			Array<uint8_t> _spanClass;
+			Central _central[CLASS_COUNT];
+
+			mutable SRWLOCK _largeLock;
+			UnorderedMap<uintptr_t, LargeBlock> _large;
+			size_t _largePageMinimum;
+			std::atomic<bool> _largePages;
+		};
+	}
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "Engine.h"
 #include "MemoryManager.h"
+#include "MemoryArena.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -11,7 +12,7 @@ namespace CreationKitPlatformExtended
 	{
 		MemoryManager* GlobalMemoryManagerPtr = nullptr;
 
-		MemoryManager::MemoryManager()
+		MemoryManager::MemoryManager() : _arena(nullptr)
 		{
 			// Инициализация библиотеки vmm
 			voltek::scalable_memory_manager_initialize();
@@ -46,8 +47,17 @@ namespace CreationKitPlatformExtended
 			if ((size % alignment) != 0)
 				size = ((size + alignment - 1) / alignment) * alignment;
 
-			void* ptr = voltek::scalable_alloc(size);
-			if (ptr && zeroed) memset(ptr, 0, size);
+			// Арена учитывает выравнивание, если она не справилась, остаётся vmm
+			void* ptr = nullptr;
+			auto arena = _arena.load(std::memory_order_acquire);
+			if (arena)
+				ptr = arena->Alloc(size, alignment, zeroed);
+
+			if (!ptr)
+			{
+				ptr = voltek::scalable_alloc(size);
+				if (ptr && zeroed) memset(ptr, 0, size);
+			}
 
 			if (!ptr && size <= (128llu * 1024 * 1024))
 				AssertMsgVa(false, "A memory allocation failed. This is due to memory leaks in the Creation Kit or not"
@@ -58,12 +68,107 @@ namespace CreationKitPlatformExtended
 
 		void MemoryManager::MemFree(void* block)
 		{
+			auto arena = _arena.load(std::memory_order_acquire);
+			if (arena && arena->Free(block))
+				return;
+
 			voltek::scalable_free(block);
 		}
 
 		size_t MemoryManager::MemSize(void* block)
 		{
+			auto arena = _arena.load(std::memory_order_acquire);
+			if (arena)
+			{
+				auto size = arena->Size(block);
+				if (size) return size;
+			}
+
 			return voltek::scalable_msize(block);
 		}
+
+		void* MemoryManager::MemRealloc(void* block, size_t oldSize, size_t size, size_t alignment, bool aligned,
+			bool zeroed)
+		{
+			if (!size)
+			{
+				MemFree(block);
+				return nullptr;
+			}
+
+			if (!block)
+				return MemAlloc(size, alignment, aligned, zeroed);
+
+			if (MemResize(block, oldSize, size, zeroed))
+				return block;
+
+			void* ptr = MemAlloc(size, alignment, aligned, zeroed);
+			if (ptr)
+			{
+				memcpy(ptr, block, std::min(oldSize, size));
+				MemFree(block);
+			}
+
+			return ptr;
+		}
+
+		bool MemoryManager::MemResize(void* block, size_t oldSize, size_t size, bool zeroed)
+		{
+			if (!block || !size)
+				return false;
+
+			// Арена растит блок в пределах класса или зарезервированных страниц без копирования
+			auto arena = _arena.load(std::memory_order_acquire);
+			return arena && arena->Resize(block, oldSize, size, zeroed);
+		}
+
+		size_t MemoryManager::MemAllocBatch(void** blocks, size_t count, size_t size, size_t alignment,
+			bool aligned, bool zeroed)
+		{
+			if (!blocks || !count) return 0;
+
+			if (!aligned)
+				alignment = 4;
+
+			// Пачка из арены берётся одним захватом общего списка класса
+			size_t Count = 0;
+			auto arena = _arena.load(std::memory_order_acquire);
+			if (arena && size && alignment && !(alignment & (alignment - 1)))
+				Count = arena->AllocBatch(blocks, count, size, alignment, zeroed);
+
+			// Остальное по одному, со всеми проверками MemAlloc
+			for (; Count < count; Count++)
+				blocks[Count] = MemAlloc(size, alignment, aligned, zeroed);
+
+			return Count;
+		}
+
+		void MemoryManager::MemFreeBatch(void** blocks, size_t count)
+		{
+			if (!blocks) return;
+
+			auto arena = _arena.load(std::memory_order_acquire);
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!arena || !arena->Free(blocks[i]))
+					voltek::scalable_free(blocks[i]);
+			}
+		}
+
+		bool MemoryManager::EnableArena()
+		{
+			if (HasArena())
+				return true;
+
+			auto arena = new MemoryArena();
+			if (!arena->Initialize())
+			{
+				delete arena;
+				return false;
+			}
+
+			_arena.store(arena, std::memory_order_release);
+			return true;
+		}
 	}
 }
\ No newline at end of file
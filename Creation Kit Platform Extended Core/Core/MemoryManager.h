@@ -8,6 +8,8 @@ namespace CreationKitPlatformExtended
 {
 	namespace Core
 	{
+		class MemoryArena;
+
 		class MemoryManager
 		{
 		public:
@@ -16,9 +18,25 @@ namespace CreationKitPlatformExtended
 			virtual void* MemAlloc(size_t size, size_t alignment = 0, bool aligned = false, bool zeroed = false);
 			virtual void MemFree(void* block);
 			virtual size_t MemSize(void* block);
+
+			// Размер oldSize используется для копирования и обнуления новой части (zeroed)
+			void* MemRealloc(void* block, size_t oldSize, size_t size, size_t alignment = 0, bool aligned = false,
+				bool zeroed = false);
+			// Только изменение размера на месте, false если блок нужно переносить
+			bool MemResize(void* block, size_t oldSize, size_t size, bool zeroed = false);
+			// Пачка блоков одного размера, всегда возвращает count
+			size_t MemAllocBatch(void** blocks, size_t count, size_t size, size_t alignment = 0, bool aligned = false,
+				bool zeroed = false);
+			void MemFreeBatch(void** blocks, size_t count);
+
+			// Переключает новые выделения на MemoryArena, блоки vmm освобождаются как раньше
+			bool EnableArena();
+			inline bool HasArena() const { return _arena.load(std::memory_order_relaxed) != nullptr; }
 		private:
 			MemoryManager(const MemoryManager&) = default;
 			MemoryManager& operator=(const MemoryManager&) = default;
+
+			std::atomic<MemoryArena*> _arena;
 		};
 
 		extern MemoryManager* GlobalMemoryManagerPtr;
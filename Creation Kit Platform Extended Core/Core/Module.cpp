@@ -60,7 +60,7 @@ namespace CreationKitPlatformExtended
 								return;
 							}
 
-							Depend->Enable(lpRelocator, *Core::GlobalRelocationDatabasePtr->GetByName(it->c_str()));
+							Depend->Enable(lpRelocator, Core::GlobalRelocationDatabasePtr->FindByName(it->c_str()));
 							if (!Depend->HasActive())
 							{
 								_ERROR("the dependent module \"%s\" has not been enabled, this module will not be enabled: \"%s\"", it->c_str(), GetName());
@@ -111,14 +111,14 @@ namespace CreationKitPlatformExtended
 
 			for (auto It = _modules.begin(); It != _modules.end(); It++)
 			{
-				auto Patch = GlobalRelocationDatabasePtr->GetByName(It->first.c_str());
-				if (Patch.Empty())
+				auto Patch = GlobalRelocationDatabasePtr->FindByName(It->first.c_str());
+				if (!Patch)
 				{
 					_WARNING("No patch data was found in the database: \"%s\"", It->first.c_str());
 					continue;
 				}
 
-				It->second->Enable(GlobalRelocatorPtr, *Patch);
+				It->second->Enable(GlobalRelocatorPtr, Patch);
 				if (It->second->HasActive())
 					count++;
 			}
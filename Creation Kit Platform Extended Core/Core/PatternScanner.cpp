@@ -0,0 +1,458 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Engine.h"
+#include "PatternScanner.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		constexpr static uintptr_t PATTERN_SCANNER_CHUNK_SIZE = 1024 * 1024;
+		constexpr static char szPatternScannerCacheFormated[] = "CreationKitPlatformExtended_%s_Scan.cache";
+
+		// Байты, которые очень часто встречаются в коде x64 (префиксы REX, mov, ModRM для стека, int3 и т.д.),
+		// якорь из них даёт слишком много кандидатов
+		static uint8_t GetByteWeight(uint8_t byte)
+		{
+			switch (byte)
+			{
+			case 0x00: case 0xFF: case 0xCC: case 0x48: case 0x8B: case 0x89:
+				return 8;
+			case 0x24: case 0x44: case 0x4C: case 0x8D: case 0xE8: case 0x0F:
+			case 0x83: case 0x85: case 0x01: case 0xC3: case 0x90: case 0x41:
+				return 4;
+			case 0x74: case 0x75: case 0xEB: case 0x08: case 0x10: case 0x20:
+			case 0x28: case 0x30: case 0x38: case 0x40: case 0x49: case 0x4D:
+			case 0x45: case 0x33: case 0xC0: case 0x05: case 0x15: case 0x0D:
+			case 0x54: case 0x5C: case 0x84:
+				return 2;
+			default:
+				return 1;
+			}
+		}
+
+		bool PatternScanner::Parse(const char* pattern, Pattern& result)
+		{
+			result.Bytes.clear();
+			result.Mask.clear();
+
+			for (auto s = pattern; *s;)
+			{
+				if (*s == ' ')
+				{
+					s++;
+					continue;
+				}
+
+				if (*s == '?')
+				{
+					result.Bytes.push_back(0);
+					result.Mask.push_back(0);
+					while (*s == '?') s++;
+					continue;
+				}
+
+				if (!isxdigit((uint8_t)s[0]) || !isxdigit((uint8_t)s[1]))
+					return false;
+
+				char szByte[3] = { s[0], s[1], 0 };
+				result.Bytes.push_back((uint8_t)strtoul(szByte, nullptr, 16));
+				result.Mask.push_back(1);
+				s += 2;
+			}
+
+			// Выбор якоря: самая редкая пара известных соседних байт, иначе самый редкий одиночный байт
+			uint32_t BestWeight = 0xFFFFFFFFul;
+			bool Found = false;
+			auto Length = (uint32_t)result.Bytes.size();
+
+			for (uint32_t i = 0; (i + 1) < Length; i++)
+			{
+				if (!result.Mask[i] || !result.Mask[i + 1])
+					continue;
+
+				uint32_t Weight = (uint32_t)GetByteWeight(result.Bytes[i]) * GetByteWeight(result.Bytes[i + 1]);
+				if (Weight < BestWeight)
+				{
+					BestWeight = Weight;
+					result.AnchorOffset = i;
+					result.Anchor = (uint16_t)result.Bytes[i] | ((uint16_t)result.Bytes[i + 1] << 8);
+					result.AnchorPair = true;
+					Found = true;
+				}
+			}
+
+			if (!Found)
+			{
+				for (uint32_t i = 0; i < Length; i++)
+				{
+					if (!result.Mask[i])
+						continue;
+
+					uint32_t Weight = GetByteWeight(result.Bytes[i]);
+					if (Weight < BestWeight)
+					{
+						BestWeight = Weight;
+						result.AnchorOffset = i;
+						result.Anchor = result.Bytes[i];
+						result.AnchorPair = false;
+						Found = true;
+					}
+				}
+			}
+
+			return Found;
+		}
+
+		bool PatternScanner::Compare(const uint8_t* data, const Pattern& pattern)
+		{
+			auto Length = pattern.Bytes.size();
+			auto Bytes = pattern.Bytes.data();
+			auto Mask = pattern.Mask.data();
+
+			for (size_t i = 0; i < Length; i++)
+			{
+				if (Mask[i] && (data[i] != Bytes[i]))
+					return false;
+			}
+
+			return true;
+		}
+
+		uint32_t PatternScanner::Add(const char* pattern)
+		{
+			Pattern Result;
+			if (!pattern || !Parse(pattern, Result))
+			{
+				_ERROR("PatternScanner: Invalid pattern \"%s\"", pattern ? pattern : "");
+				return INVALID_ID;
+			}
+
+			_patterns.push_back(Result);
+			_matches.emplace_back();
+			return (uint32_t)(_patterns.size() - 1);
+		}
+
+		void PatternScanner::Clear()
+		{
+			_patterns.clear();
+			_matches.clear();
+			_groups.clear();
+		}
+
+		const PatternScanner::Matches& PatternScanner::Get(uint32_t id) const
+		{
+			static const Matches Empty;
+			return (id < _matches.size()) ? _matches[id] : Empty;
+		}
+
+		void PatternScanner::BuildGroups()
+		{
+			_groups.clear();
+
+			for (uint32_t i = 0; i < (uint32_t)_patterns.size(); i++)
+			{
+				auto& Entry = _patterns[i];
+				auto It = std::find_if(_groups.begin(), _groups.end(), [&Entry](const AnchorGroup& Group) {
+					return (Group.Anchor == Entry.Anchor) && (Group.Pair == Entry.AnchorPair);
+				});
+
+				if (It == _groups.end())
+					_groups.push_back({ Entry.Anchor, Entry.AnchorPair, { i } });
+				else
+					It->Patterns.push_back(i);
+			}
+		}
+
+		void PatternScanner::VerifyGroup(const AnchorGroup& group, uintptr_t base, uintptr_t end, uintptr_t anchor,
+			Array<std::pair<uint32_t, uintptr_t>>& found) const
+		{
+			auto Data = (const uint8_t*)anchor;
+			if (Data[0] != (uint8_t)group.Anchor)
+				return;
+			if (group.Pair && (((anchor + 1) >= end) || (Data[1] != (uint8_t)(group.Anchor >> 8))))
+				return;
+
+			for (auto Id : group.Patterns)
+			{
+				auto& Entry = _patterns[Id];
+				if (anchor < (base + Entry.AnchorOffset))
+					continue;
+
+				auto Match = anchor - Entry.AnchorOffset;
+				if ((Match + Entry.Bytes.size()) > end)
+					continue;
+
+				if (Compare((const uint8_t*)Match, Entry))
+					found.emplace_back(Id, Match);
+			}
+		}
+
+		void PatternScanner::ScanRange(uintptr_t base, uintptr_t end, uintptr_t rangeStart, uintptr_t rangeEnd,
+			Array<std::pair<uint32_t, uintptr_t>>& found) const
+		{
+			auto Position = rangeStart;
+			auto GroupCount = _groups.size();
+
+			// Для сравнения второго байта пары читается на один байт больше блока
+			if (GlobalEnginePtr && GlobalEnginePtr->HasAVX2())
+			{
+				for (; (Position + 33) <= end && Position < rangeEnd; Position += 32)
+				{
+					auto Block0 = _mm256_loadu_si256((const __m256i*)Position);
+					auto Block1 = _mm256_loadu_si256((const __m256i*)(Position + 1));
+					uint32_t Mask = 0;
+
+					for (size_t i = 0; i < GroupCount; i++)
+					{
+						auto& Group = _groups[i];
+						auto Equal = _mm256_cmpeq_epi8(Block0, _mm256_set1_epi8((char)(uint8_t)Group.Anchor));
+						if (Group.Pair)
+							Equal = _mm256_and_si256(Equal,
+								_mm256_cmpeq_epi8(Block1, _mm256_set1_epi8((char)(uint8_t)(Group.Anchor >> 8))));
+						Mask |= (uint32_t)_mm256_movemask_epi8(Equal);
+					}
+
+					unsigned long Bit;
+					while (Mask && _BitScanForward(&Bit, Mask))
+					{
+						Mask &= Mask - 1;
+						auto Anchor = Position + Bit;
+						if (Anchor >= rangeEnd)
+							break;
+						for (auto& Group : _groups)
+							VerifyGroup(Group, base, end, Anchor, found);
+					}
+				}
+			}
+			else
+			{
+				for (; (Position + 17) <= end && Position < rangeEnd; Position += 16)
+				{
+					auto Block0 = _mm_loadu_si128((const __m128i*)Position);
+					auto Block1 = _mm_loadu_si128((const __m128i*)(Position + 1));
+					uint32_t Mask = 0;
+
+					for (size_t i = 0; i < GroupCount; i++)
+					{
+						auto& Group = _groups[i];
+						auto Equal = _mm_cmpeq_epi8(Block0, _mm_set1_epi8((char)(uint8_t)Group.Anchor));
+						if (Group.Pair)
+							Equal = _mm_and_si128(Equal,
+								_mm_cmpeq_epi8(Block1, _mm_set1_epi8((char)(uint8_t)(Group.Anchor >> 8))));
+						Mask |= (uint32_t)_mm_movemask_epi8(Equal);
+					}
+
+					unsigned long Bit;
+					while (Mask && _BitScanForward(&Bit, Mask))
+					{
+						Mask &= Mask - 1;
+						auto Anchor = Position + Bit;
+						if (Anchor >= rangeEnd)
+							break;
+						for (auto& Group : _groups)
+							VerifyGroup(Group, base, end, Anchor, found);
+					}
+				}
+			}
+
+			// Хвост, который не помещается в блок
+			for (; Position < rangeEnd; Position++)
+			{
+				for (auto& Group : _groups)
+					VerifyGroup(Group, base, end, Position, found);
+			}
+		}
+
+		void PatternScanner::Scan(uintptr_t base, uintptr_t size)
+		{
+			for (auto& Result : _matches)
+				Result.clear();
+
+			if (_patterns.empty() || !size)
+				return;
+
+			BuildGroups();
+
+			auto End = base + size;
+			auto ChunkCount = (size + PATTERN_SCANNER_CHUNK_SIZE - 1) / PATTERN_SCANNER_CHUNK_SIZE;
+			Array<Array<std::pair<uint32_t, uintptr_t>>> Found(ChunkCount);
+			Array<uintptr_t> Chunks(ChunkCount);
+			for (uintptr_t i = 0; i < ChunkCount; i++)
+				Chunks[i] = i;
+
+			// Одна секция, один проход, но по частям в несколько потоков
+			std::for_each(std::execution::par, Chunks.begin(), Chunks.end(), [&](uintptr_t Chunk) {
+				auto RangeStart = base + Chunk * PATTERN_SCANNER_CHUNK_SIZE;
+				auto RangeEnd = std::min(RangeStart + PATTERN_SCANNER_CHUNK_SIZE, End);
+				ScanRange(base, End, RangeStart, RangeEnd, Found[Chunk]);
+			});
+
+			for (auto& ChunkFound : Found)
+			{
+				for (auto& [Id, Match] : ChunkFound)
+					_matches[Id].push_back(Match);
+			}
+
+			// Якоря у сигнатур на разных смещениях, порядок адресов как у voltek::find_patterns
+			for (auto& Result : _matches)
+				std::sort(Result.begin(), Result.end());
+		}
+
+		void PatternScanner::Scan(uintptr_t base, uintptr_t size, const char* cacheName)
+		{
+			auto crc32 = GlobalEnginePtr ? GlobalEnginePtr->GetExecutableCRC32() : 0;
+			if (!cacheName || !crc32 || _patterns.empty() || !size)
+			{
+				Scan(base, size);
+				return;
+			}
+
+			char szFileName[MAX_PATH];
+			sprintf_s(szFileName, szPatternScannerCacheFormated, cacheName);
+			auto FileName = Utils::GetApplicationPath() + szFileName;
+
+			if (LoadCache(FileName.c_str(), crc32, base, size))
+				return;
+
+			Scan(base, size);
+
+			if (!SaveCache(FileName.c_str(), crc32, base, size))
+				_WARNING("PatternScanner: The cache file could not be written: \"%s\"", FileName.c_str());
+		}
+
+		uint64_t PatternScanner::GetPatternSetHash() const
+		{
+			// FNV-1a 64 по длинам, байтам и маскам всех сигнатур в порядке добавления
+			uint64_t hash = 0xCBF29CE484222325ull;
+			auto Mix = [&hash](const uint8_t* data, size_t length) {
+				for (size_t i = 0; i < length; i++)
+				{
+					hash ^= data[i];
+					hash *= 0x100000001B3ull;
+				}
+			};
+
+			for (auto& Entry : _patterns)
+			{
+				auto Length = (uint32_t)Entry.Bytes.size();
+				Mix((const uint8_t*)&Length, sizeof(Length));
+				Mix(Entry.Bytes.data(), Length);
+				Mix(Entry.Mask.data(), Length);
+			}
+
+			return hash;
+		}
+
+		bool PatternScanner::LoadCache(const char* fileName, uint32_t crc32, uintptr_t base, uintptr_t size)
+		{
+			auto Stream = _fsopen(fileName, "rb", _SH_DENYWR);
+			if (!Stream)
+				return false;
+
+			CacheHeader Head;
+			Array<uint32_t> Data;
+			bool Readed = fread(&Head, 1, sizeof(CacheHeader), Stream) == sizeof(CacheHeader);
+			
+			// Любое несовпадение ключа означает, что кеш устарел и будет перезаписан
+			if (Readed)
+				Readed = (Head.Magic == CACHE_MAGIC) && (Head.Version == CACHE_VERSION) && 
+					(Head.ExecutableCRC32 == crc32) && (Head.SectionSize == (uint64_t)size) &&
+					(Head.PatternCount == (uint32_t)_patterns.size()) && (Head.PatternSetHash == GetPatternSetHash()) &&
+					(Head.MatchCount <= (uint32_t)(size / sizeof(uint32_t)));
+
+			if (Readed)
+			{
+				Data.resize((size_t)Head.PatternCount + Head.MatchCount);
+				Readed = fread(Data.data(), sizeof(uint32_t), Data.size(), Stream) == Data.size();
+			}
+
+			fclose(Stream);
+
+			if (!Readed || (::Utils::CRC32Buffer(Data.data(), (uint32_t)(Data.size() * sizeof(uint32_t))) != Head.DataCRC32))
+			{
+				_MESSAGE("PatternScanner: The cache \"%s\" is missing or outdated", fileName);
+				return false;
+			}
+
+			Array<Matches> Result(_patterns.size());
+			auto Offsets = Data.data() + Head.PatternCount;
+			uint32_t Total = 0;
+
+			for (uint32_t Id = 0; Id < Head.PatternCount; Id++)
+			{
+				auto Count = Data[Id];
+				if (Count > (Head.MatchCount - Total))
+					return false;
+
+				auto& Entry = _patterns[Id];
+				for (uint32_t i = 0; i < Count; i++)
+				{
+					auto Offset = (uintptr_t)Offsets[Total + i];
+
+					// Проверка на месте: совпадение должно находиться в секции и соответствовать сигнатуре
+					if (((Offset + Entry.Bytes.size()) > size) || !Compare((const uint8_t*)(base + Offset), Entry))
+					{
+						_WARNING("PatternScanner: The cache \"%s\" failed verification", fileName);
+						return false;
+					}
+
+					Result[Id].push_back(base + Offset);
+				}
+
+				Total += Count;
+			}
+
+			if (Total != Head.MatchCount)
+				return false;
+
+			_matches = std::move(Result);
+			return true;
+		}
+
+		bool PatternScanner::SaveCache(const char* fileName, uint32_t crc32, uintptr_t base, uintptr_t size) const
+		{
+			Array<uint32_t> Data;
+			Data.reserve(_matches.size());
+
+			for (auto& Result : _matches)
+				Data.push_back((uint32_t)Result.size());
+
+			for (auto& Result : _matches)
+			{
+				for (auto Match : Result)
+					Data.push_back((uint32_t)(Match - base));
+			}
+
+			CacheHeader Head;
+			Head.Magic = CACHE_MAGIC;
+			Head.Version = CACHE_VERSION;
+			Head.ExecutableCRC32 = crc32;
+			Head.PatternCount = (uint32_t)_patterns.size();
+			Head.PatternSetHash = GetPatternSetHash();
+			Head.SectionSize = (uint64_t)size;
+			Head.MatchCount = (uint32_t)(Data.size() - _matches.size());
+			Head.DataCRC32 = ::Utils::CRC32Buffer(Data.data(), (uint32_t)(Data.size() * sizeof(uint32_t)));
+
+			// Пишем во временный файл, чтобы прерванная запись не оставила обрезанный кеш
+			auto TempFileName = String(fileName) + ".tmp";
+			auto Stream = _fsopen(TempFileName.c_str(), "wb", _SH_DENYWR);
+			if (!Stream)
+				return false;
+
+			bool Written = (fwrite(&Head, 1, sizeof(CacheHeader), Stream) == sizeof(CacheHeader)) &&
+				(fwrite(Data.data(), sizeof(uint32_t), Data.size(), Stream) == Data.size());
+			Written = !fclose(Stream) && Written;
+
+			if (!Written || !MoveFileExA(TempFileName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING))
+			{
+				DeleteFileA(TempFileName.c_str());
+				return false;
+			}
+
+			return true;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Пакетный поиск сигнатур.
+		// Все сигнатуры регистрируются заранее, затем секция просматривается один раз: SIMD фильтр
+		// ищет "якорные" пары байт всех сигнатур одновременно, кандидаты проверяются по маске.
+		// Формат сигнатуры такой же, как у voltek::find_patterns: "48 8B ? ?? 05".
+		// Результаты можно сохранять на диск, ключ кеша: CRC32 исполняемого файла и хеш набора сигнатур.
+		class PatternScanner
+		{
+		public:
+			using Matches = Array<uintptr_t>;
+
+			constexpr static uint32_t INVALID_ID = 0xFFFFFFFFul;
+			constexpr static uint32_t CACHE_MAGIC = 'CSPC';
+			constexpr static uint32_t CACHE_VERSION = 1;
+
+#pragma pack(push, 1)
+			struct CacheHeader
+			{
+				uint32_t Magic;
+				uint32_t Version;
+				uint32_t ExecutableCRC32;
+				uint32_t PatternCount;
+				uint64_t PatternSetHash;
+				uint64_t SectionSize;
+				uint32_t MatchCount;
+				// CRC32 данных после заголовка: количество совпадений каждой сигнатуры и их смещения
+				uint32_t DataCRC32;
+			};
+#pragma pack(pop)
+		public:
+			PatternScanner() = default;
+			~PatternScanner() = default;
+
+			uint32_t Add(const char* pattern);
+			void Scan(uintptr_t base, uintptr_t size);
+			void Scan(uintptr_t base, uintptr_t size, const char* cacheName);
+			void Clear();
+
+			const Matches& Get(uint32_t id) const;
+			inline uint32_t Count() const { return (uint32_t)_patterns.size(); }
+		private:
+			PatternScanner(const PatternScanner&) = default;
+			PatternScanner& operator=(const PatternScanner&) = default;
+
+			struct Pattern
+			{
+				Array<uint8_t> Bytes;
+				Array<uint8_t> Mask;
+				uint32_t AnchorOffset;
+				uint16_t Anchor;
+				bool AnchorPair;
+			};
+
+			struct AnchorGroup
+			{
+				uint16_t Anchor;
+				bool Pair;
+				Array<uint32_t> Patterns;
+			};
+
+			static bool Parse(const char* pattern, Pattern& result);
+			static bool Compare(const uint8_t* data, const Pattern& pattern);
+
+			uint64_t GetPatternSetHash() const;
+			bool LoadCache(const char* fileName, uint32_t crc32, uintptr_t base, uintptr_t size);
+			bool SaveCache(const char* fileName, uint32_t crc32, uintptr_t base, uintptr_t size) const;
+
+			void BuildGroups();
+			void ScanRange(uintptr_t base, uintptr_t end, uintptr_t rangeStart, uintptr_t rangeEnd,
+				Array<std::pair<uint32_t, uintptr_t>>& found) const;
+			void VerifyGroup(const AnchorGroup& group, uintptr_t base, uintptr_t end, uintptr_t anchor,
+				Array<std::pair<uint32_t, uintptr_t>>& found) const;
+
+			Array<Pattern> _patterns;
+			Array<Matches> _matches;
+			Array<AnchorGroup> _groups;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,356 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Engine.h"
+#include "RecordPrefetcher.h"
+
+#include <deque>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		struct RecordPrefetcher::Entry
+		{
+			uint64_t seq;
+			uint64_t key;
+			const uint8_t* in;
+			size_t inSize;
+			size_t outSize;
+			Array<uint8_t> data;
+			size_t outBytes = 0;
+			libdeflate_result result = LIBDEFLATE_BAD_DATA;
+			bool ready = false;
+			bool removed = false;
+		};
+
+		struct RecordPrefetcher::Pipeline
+		{
+			HANDLE file = INVALID_HANDLE_VALUE;
+			HANDLE mapping = NULL;
+			const uint8_t* view = nullptr;
+			size_t size = 0;
+
+			SRWLOCK lock = SRWLOCK_INIT;
+			CONDITION_VARIABLE space = CONDITION_VARIABLE_INIT;
+			size_t cursor = 0;
+			uint64_t nextSeq = 0;
+			size_t reserved = 0;
+			bool cancel = false;
+			// Записи в порядке файла и они же по хешу сжатых данных
+			std::deque<std::shared_ptr<Entry>> window;
+			std::unordered_multimap<uint64_t, std::shared_ptr<Entry>> index;
+			Array<HANDLE> threads;
+
+			~Pipeline()
+			{
+				AcquireSRWLockExclusive(&lock);
+				cancel = true;
+				ReleaseSRWLockExclusive(&lock);
+				WakeAllConditionVariable(&space);
+
+				if (!threads.empty())
+					WaitForMultipleObjects((DWORD)threads.size(), threads.data(), TRUE, INFINITE);
+				for (auto thread : threads)
+					CloseHandle(thread);
+
+				if (view) UnmapViewOfFile(view);
+				if (mapping) CloseHandle(mapping);
+				if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+			}
+		};
+
+		SRWLOCK RecordPrefetcher::_lock = SRWLOCK_INIT;
+		String RecordPrefetcher::_pendingFileName;
+		std::unique_ptr<RecordPrefetcher::Pipeline> RecordPrefetcher::_pipeline;
+
+		void RecordPrefetcher::Open(const char* fileName)
+		{
+			// Плагин может открываться только ради заголовка, поэтому потоки ждут первой распаковки
+			std::unique_ptr<Pipeline> old;
+
+			// Без свободных ядер потокам нечем помочь загрузчику
+			if (GlobalEnginePtr->GetTotalLogicalCores() < MIN_LOGICAL_CORES)
+				fileName = nullptr;
+
+			AcquireSRWLockExclusive(&_lock);
+			old = std::move(_pipeline);
+			_pendingFileName = fileName ? fileName : "";
+			ReleaseSRWLockExclusive(&_lock);
+		}
+
+		void RecordPrefetcher::Close()
+		{
+			Open(nullptr);
+		}
+
+		void RecordPrefetcher::Release(Pipeline* pipeline)
+		{
+			// Закрывает только этот конвейер, ожидающий открытия плагин остаётся в силе
+			std::unique_ptr<Pipeline> old;
+
+			AcquireSRWLockExclusive(&_lock);
+			if (_pipeline.get() == pipeline)
+				old = std::move(_pipeline);
+			ReleaseSRWLockExclusive(&_lock);
+		}
+
+		uint64_t RecordPrefetcher::Hash(const void* in, size_t inSize)
+		{
+			// Размер, начало потока и контрольная сумма в его конце
+			auto data = (const uint8_t*)in;
+			auto hash = (0xCBF29CE484222325ull ^ inSize) * 0x100000001B3ull;
+
+			for (size_t i = 0; i < std::min(inSize, (size_t)16); i++)
+				hash = (hash ^ data[i]) * 0x100000001B3ull;
+			for (size_t i = inSize - std::min(inSize, (size_t)4); i < inSize; i++)
+				hash = (hash ^ data[i]) * 0x100000001B3ull;
+
+			return hash;
+		}
+
+		void RecordPrefetcher::Remove(Pipeline* pipeline, const std::shared_ptr<Entry>& entry)
+		{
+			// Вызывается под замком конвейера
+			auto range = pipeline->index.equal_range(entry->key);
+			for (auto it = range.first; it != range.second; it++)
+			{
+				if (it->second == entry)
+				{
+					pipeline->index.erase(it);
+					break;
+				}
+			}
+
+			entry->removed = true;
+			entry->data.clear();
+			entry->data.shrink_to_fit();
+			pipeline->reserved -= entry->outSize;
+		}
+
+		std::shared_ptr<RecordPrefetcher::Entry> RecordPrefetcher::NextJob(Pipeline* pipeline)
+		{
+			// Вызывается под замком конвейера
+			auto view = pipeline->view;
+			auto size = pipeline->size;
+
+			while (!pipeline->cancel && ((pipeline->cursor + RECORD_HEADER_SIZE) <= size))
+			{
+				auto header = view + pipeline->cursor;
+				auto recordSize = *(const uint32_t*)(header + 4);
+
+				if (!memcmp(header, "GRUP", 4))
+				{
+					// Размер группы включает заголовок, записи группы идут сразу за ним
+					if ((recordSize < RECORD_HEADER_SIZE) || ((pipeline->cursor + recordSize) > size))
+						break;
+
+					pipeline->cursor += RECORD_HEADER_SIZE;
+					continue;
+				}
+
+				auto flags = *(const uint32_t*)(header + 8);
+				auto dataOffset = pipeline->cursor + RECORD_HEADER_SIZE;
+				if ((dataOffset + recordSize) > size)
+					break;
+
+				if (!(flags & RECORD_FLAG_COMPRESSED) || (recordSize <= 4))
+				{
+					pipeline->cursor = dataOffset + recordSize;
+					continue;
+				}
+
+				// Сжатая запись: размер распакованных данных и zlib поток
+				auto outSize = (size_t)*(const uint32_t*)(view + dataOffset);
+				if (outSize > MAX_RECORD_SIZE)
+				{
+					pipeline->cursor = dataOffset + recordSize;
+					continue;
+				}
+
+				// Кеш полон, ждём, пока загрузчик заберёт уже готовое
+				if (((pipeline->reserved + outSize) > CACHE_LIMIT) && !pipeline->window.empty())
+				{
+					SleepConditionVariableSRW(&pipeline->space, &pipeline->lock, INFINITE, 0);
+					continue;
+				}
+
+				auto entry = std::make_shared<Entry>();
+				entry->seq = pipeline->nextSeq++;
+				entry->in = view + dataOffset + 4;
+				entry->inSize = recordSize - 4;
+				entry->outSize = outSize;
+				entry->key = Hash(entry->in, entry->inSize);
+
+				pipeline->cursor = dataOffset + recordSize;
+				pipeline->reserved += outSize;
+				pipeline->window.push_back(entry);
+				pipeline->index.insert({ entry->key, entry });
+
+				return entry;
+			}
+
+			// Дальше файл не читается
+			pipeline->cursor = size;
+			return nullptr;
+		}
+
+		DWORD WINAPI RecordPrefetcher::Worker(LPVOID lpArg)
+		{
+			auto pipeline = (Pipeline*)lpArg;
+
+			for (;;)
+			{
+				AcquireSRWLockExclusive(&pipeline->lock);
+				auto entry = NextJob(pipeline);
+				ReleaseSRWLockExclusive(&pipeline->lock);
+
+				if (!entry)
+					break;
+
+				Array<uint8_t> data(entry->outSize);
+				size_t inBytes = 0, outBytes = 0;
+				auto result = Decompressor::Zlib(entry->in, entry->inSize, data.data(), data.size(), &inBytes, &outBytes);
+
+				AcquireSRWLockExclusive(&pipeline->lock);
+				if (!entry->removed)
+				{
+					entry->data = std::move(data);
+					entry->outBytes = outBytes;
+					entry->result = result;
+					entry->ready = true;
+				}
+				ReleaseSRWLockExclusive(&pipeline->lock);
+			}
+
+			return 0;
+		}
+
+		bool RecordPrefetcher::Inflate(const void* in, size_t inSize, void* out, size_t outSize,
+			libdeflate_result& result, size_t& outBytes)
+		{
+			AcquireSRWLockShared(&_lock);
+			auto pipeline = _pipeline.get();
+			auto pending = !pipeline && !_pendingFileName.empty();
+			ReleaseSRWLockShared(&_lock);
+
+			if (pending)
+			{
+				// Первая распаковка после открытия плагина, значит он действительно загружается
+				AcquireSRWLockExclusive(&_lock);
+				if (!_pipeline && !_pendingFileName.empty())
+				{
+					auto fileName = std::move(_pendingFileName);
+					_pendingFileName.clear();
+
+					auto newPipeline = std::make_unique<Pipeline>();
+					newPipeline->file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+						nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+					LARGE_INTEGER fileSize = {};
+					if ((newPipeline->file != INVALID_HANDLE_VALUE) && GetFileSizeEx(newPipeline->file, &fileSize) &&
+						((size_t)fileSize.QuadPart >= MIN_FILE_SIZE))
+					{
+						newPipeline->size = (size_t)fileSize.QuadPart;
+						newPipeline->mapping = CreateFileMappingA(newPipeline->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+						if (newPipeline->mapping)
+							newPipeline->view = (const uint8_t*)MapViewOfFile(newPipeline->mapping, FILE_MAP_READ, 0, 0, 0);
+					}
+
+					if (newPipeline->view)
+					{
+						auto count = std::clamp((uint32_t)(GlobalEnginePtr->GetTotalLogicalCores() >> 1), (uint32_t)1, MAX_WORKERS);
+						for (uint32_t i = 0; i < count; i++)
+						{
+							auto thread = CreateThread(nullptr, 0, Worker, newPipeline.get(), 0, nullptr);
+							if (thread)
+							{
+								SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+								newPipeline->threads.push_back(thread);
+							}
+						}
+
+						_pipeline = std::move(newPipeline);
+					}
+				}
+				pipeline = _pipeline.get();
+				ReleaseSRWLockExclusive(&_lock);
+			}
+
+			if (!pipeline)
+				return false;
+
+			// Конвейер не уничтожается, пока читатели держат общий замок
+			AcquireSRWLockShared(&_lock);
+			if (pipeline != _pipeline.get())
+			{
+				ReleaseSRWLockShared(&_lock);
+				return false;
+			}
+
+			auto key = Hash(in, inSize);
+			std::shared_ptr<Entry> found;
+
+			AcquireSRWLockExclusive(&pipeline->lock);
+			auto range = pipeline->index.equal_range(key);
+			for (auto it = range.first; it != range.second; it++)
+			{
+				if ((it->second->inSize == inSize) && !memcmp(it->second->in, in, inSize))
+				{
+					found = it->second;
+					break;
+				}
+			}
+
+			if (found)
+			{
+				// Всё, что шло в файле раньше, загрузчику уже не понадобится
+				while (!pipeline->window.empty() && (pipeline->window.front()->seq < found->seq))
+				{
+					Remove(pipeline, pipeline->window.front());
+					pipeline->window.pop_front();
+				}
+
+				Array<uint8_t> data;
+				auto ready = found->ready;
+				if (ready)
+				{
+					data = std::move(found->data);
+					result = found->result;
+					outBytes = found->outBytes;
+				}
+
+				Remove(pipeline, found);
+				pipeline->window.pop_front();
+				// Файл пройден до конца и всё отдано загрузчику, держать его дальше незачем
+				auto drained = (pipeline->cursor >= pipeline->size) && pipeline->window.empty();
+				ReleaseSRWLockExclusive(&pipeline->lock);
+				WakeAllConditionVariable(&pipeline->space);
+				ReleaseSRWLockShared(&_lock);
+
+				if (drained)
+					Release(pipeline);
+
+				if (!ready)
+					// Поток ещё не успел, распакуем на месте, его результат будет выброшен
+					return false;
+
+				if ((result == LIBDEFLATE_SUCCESS) && (outBytes > outSize))
+				{
+					result = LIBDEFLATE_INSUFFICIENT_SPACE;
+					outBytes = 0;
+				}
+				else if (outBytes)
+					memcpy(out, data.data(), outBytes);
+
+				return true;
+			}
+
+			ReleaseSRWLockExclusive(&pipeline->lock);
+			ReleaseSRWLockShared(&_lock);
+
+			return false;
+		}
+	}
+}
\ No newline at end of file
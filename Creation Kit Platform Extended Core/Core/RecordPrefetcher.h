@@ -0,0 +1,51 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include "Decompressor.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Упреждающая распаковка сжатых записей плагина.
+		// Открытый на чтение плагин отображается в память, после первой распаковки записей рабочие потоки идут
+		// по заголовкам групп и записей впереди загрузчика и распаковывают сжатые записи в ограниченный кеш.
+		// Запись ищется в кеше по сжатым данным и сверяется с ними целиком, поэтому промах или чужой файл
+		// означают лишь обычную распаковку на месте.
+		class RecordPrefetcher
+		{
+		public:
+			constexpr static size_t CACHE_LIMIT = 32 * 1024 * 1024;
+			constexpr static size_t MIN_FILE_SIZE = 4 * 1024 * 1024;
+			constexpr static size_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+			constexpr static uint32_t MIN_LOGICAL_CORES = 4;
+			constexpr static uint32_t MAX_WORKERS = 4;
+			constexpr static uint32_t RECORD_HEADER_SIZE = 24;
+			constexpr static uint32_t RECORD_FLAG_COMPRESSED = 0x00040000;
+
+			// Плагин, из которого сейчас читаются записи, прежний конвейер останавливается
+			static void Open(const char* fileName);
+			// Останавливает потоки, освобождает кеш и отображение файла
+			static void Close();
+			// true, если запись уже распакована, тогда result и outBytes как у Decompressor::Zlib
+			static bool Inflate(const void* in, size_t inSize, void* out, size_t outSize,
+				libdeflate_result& result, size_t& outBytes);
+		private:
+			struct Entry;
+			struct Pipeline;
+
+			static uint64_t Hash(const void* in, size_t inSize);
+			static DWORD WINAPI Worker(LPVOID lpArg);
+			static std::shared_ptr<Entry> NextJob(Pipeline* pipeline);
+			static void Remove(Pipeline* pipeline, const std::shared_ptr<Entry>& entry);
+			static void Release(Pipeline* pipeline);
+
+			static SRWLOCK _lock;
+			static String _pendingFileName;
+			static std::unique_ptr<Pipeline> _pipeline;
+		};
+	}
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 // Contacts: <email:timencevaleksej@gmail.com>
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
+#include "Version/resource_version2.h"
 #include "Engine.h"
 #include "RelocationDatabase.h"
 
@@ -9,16 +10,23 @@ namespace CreationKitPlatformExtended
 {
 	namespace Core
 	{
-		RelocationDatabaseItem::RelocationDatabaseItem() : patch(nullptr)
+		RelocationDatabaseItem::RelocationDatabaseItem() : stream(nullptr), patch(nullptr), mapped(nullptr), 
+			mappedIndex(0)
 		{}
 
 		RelocationDatabaseItem::RelocationDatabaseItem(voltek::reldb_stream* stm, voltek::reldb_patch* pch) : 
-			stream(stm), patch(pch)
+			stream(stm), patch(pch), mapped(nullptr), mappedIndex(0)
 		{
 			Assert(stream);
 			Assert(patch);
 		}
 
+		RelocationDatabaseItem::RelocationDatabaseItem(const RelocationMappedDatabase* db, uint32_t index) :
+			stream(nullptr), patch(nullptr), mapped(db), mappedIndex(index)
+		{
+			Assert(mapped);
+		}
+
 		void RelocationDatabaseItem::Clear()
 		{
 			if (patch)
@@ -46,8 +54,27 @@ namespace CreationKitPlatformExtended
 			return true;
 		}
 
+		uint32_t RelocationDatabaseItem::Version() const
+		{
+			if (mapped)
+				return mapped->VersionAt(mappedIndex);
+
+			return (uint32_t)voltek::reldb_get_version_patch(patch);
+		}
+
+		uint32_t RelocationDatabaseItem::Count() const
+		{
+			if (mapped)
+				return mapped->CountAt(mappedIndex);
+
+			return (uint32_t)voltek::reldb_count_signatures_in_patch(patch);
+		}
+
 		String RelocationDatabaseItem::Name() const
 		{ 
+			if (mapped)
+				return mapped->NameAt(mappedIndex);
+
 			if (!patch)
 				return "";
 
@@ -60,6 +87,9 @@ namespace CreationKitPlatformExtended
 
 		uint32_t RelocationDatabaseItem::At(uint32_t nId) const
 		{ 
+			if (mapped)
+				return mapped->RVAAt(mappedIndex, nId);
+
 			voltek::reldb_signature* sign = nullptr;
 			if (voltek::reldb_get_signature_patch(patch, &sign, nId) != 0)
 				return 0;
@@ -68,6 +98,13 @@ namespace CreationKitPlatformExtended
 
 		String RelocationDatabaseItem::PatternAt(uint32_t nId) const
 		{ 
+			if (mapped)
+			{
+				uint32_t len = 0;
+				auto pattern = mapped->PatternAt(mappedIndex, nId, &len);
+				return pattern ? String(pattern, len) : "";
+			}
+
 			voltek::reldb_signature* sign = nullptr;
 			if (voltek::reldb_get_signature_patch(patch, &sign, nId) != 0)
 				return "";
@@ -83,15 +120,53 @@ namespace CreationKitPlatformExtended
 
 		RelocationDatabase* GlobalRelocationDatabasePtr = nullptr;
 
-		RelocationDatabase::RelocationDatabase(Engine* lpEngine) : _engine(lpEngine), _stm(nullptr)
+		RelocationDatabase::RelocationDatabase(Engine* lpEngine) : _engine(lpEngine), _stm(nullptr), 
+			_mappedItems(nullptr)
 		{}
 
 		RelocationDatabase::~RelocationDatabase()
 		{
+			ReleaseItems();
+
 			if (_stm)
 				voltek::reldb_release_db(_stm);
 		}
 
+		void RelocationDatabase::ReleaseItems()
+		{
+			for (auto It = _items.begin(); It != _items.end(); It++)
+				delete It->second;
+			_items.clear();
+
+			if (_mappedItems)
+			{
+				delete[] _mappedItems;
+				_mappedItems = nullptr;
+			}
+
+			_mapped.Close();
+		}
+
+		String RelocationDatabase::GetMappedFileName() const
+		{
+			auto fileName = String(allowedDatabaseVersion.at(_engine->GetEditorVersion()));
+			auto it_sep = fileName.find_last_of('.');
+			if (it_sep != String::npos)
+				fileName.erase(it_sep);
+			return fileName.append(".mapdb");
+		}
+
+		RelocationMappedDatabase::Stamp RelocationDatabase::GetMappedStamp() const
+		{
+			RelocationMappedDatabase::Stamp stamp = { 0 };
+			stamp.PlatformVersion = ((uint64_t)VERSION_MAJOR << 48) | ((uint64_t)VERSION_MINOR << 32) |
+				((uint64_t)VERSION_REVISION << 16) | (uint64_t)VERSION_BUILD;
+			stamp.EditorCRC32 = _engine->GetExecutableCRC32();
+			RelocationMappedDatabase::GetSourceStamp(allowedDatabaseVersion.at(_engine->GetEditorVersion()).data(),
+				&stamp.SourceSize, &stamp.SourceTime);
+			return stamp;
+		}
+
 		bool RelocationDatabase::CreateDatabase()
 		{
 			if (!allowedDatabaseVersion.contains(_engine->GetEditorVersion()))
@@ -117,6 +192,8 @@ namespace CreationKitPlatformExtended
 
 		bool RelocationDatabase::OpenDatabase()
 		{
+			ReleaseItems();
+
 			if (_stm)
 			{
 				voltek::reldb_release_db(_stm);
@@ -173,6 +250,85 @@ namespace CreationKitPlatformExtended
 			return true;
 		}
 
+		bool RelocationDatabase::OpenMappedDatabase()
+		{
+			ReleaseItems();
+
+			if (_stm)
+			{
+				voltek::reldb_release_db(_stm);
+				_stm = nullptr;
+			}
+
+			if (!allowedDatabaseVersion.contains(_engine->GetEditorVersion()))
+			{
+				_ERROR("The database name for this version of Creation Kit is not in the list");
+				return false;
+			}
+
+			auto fileName = GetMappedFileName();
+			if (!_mapped.Open(fileName.c_str(), GetMappedStamp()))
+				return false;
+
+			auto total_patches = _mapped.Count();
+			_mappedItems = new RelocationDatabaseItem[total_patches];
+			for (uint32_t i = 0; i < total_patches; i++)
+			{
+				_mappedItems[i].mapped = &_mapped;
+				_mappedItems[i].mappedIndex = i;
+			}
+
+			_MESSAGE("The mapped database has been opened: \"%s\"", fileName.c_str());
+			_MESSAGE("Total patches: %u", total_patches);
+			_MESSAGE("Total signatures: %u", _mapped.TotalSignatures());
+
+			return true;
+		}
+
+		bool RelocationDatabase::SaveMappedDatabase()
+		{
+			if (!_stm)
+				return false;
+
+			auto total_patches = voltek::reldb_count_patches(_stm);
+			Array<RelocationMappedDatabase::SourcePatch> patches(total_patches);
+
+			for (long i = 0; i < total_patches; i++)
+			{
+				voltek::reldb_patch* patch = nullptr;
+				auto resultErrno = voltek::reldb_get_patch_by_id(_stm, &patch, i);
+				if (resultErrno)
+				{
+					_ERROR("Couldn't get the patch: \"%s\" index %i",
+						voltek::reldb_get_error_text(resultErrno),
+						i);
+					return false;
+				}
+
+				RelocationDatabaseItem item(_stm, patch);
+				auto& source = patches[i];
+				source.Name = item.Name();
+				source.Version = item.Version();
+
+				auto sign_count = item.Count();
+				source.RVAs.resize(sign_count);
+				source.Patterns.resize(sign_count);
+				for (uint32_t j = 0; j < sign_count; j++)
+				{
+					source.RVAs[j] = item.At(j);
+					source.Patterns[j] = item.PatternAt(j);
+				}
+			}
+
+			auto fileName = GetMappedFileName();
+			if (!RelocationMappedDatabase::Build(fileName.c_str(), patches, GetMappedStamp()))
+				return false;
+
+			_MESSAGE("\tThe mapped database has been saved: \"%s\"", fileName.c_str());
+
+			return true;
+		}
+
 		bool RelocationDatabase::SaveDatabase()
 		{
 			if (!_stm)
@@ -191,8 +347,25 @@ namespace CreationKitPlatformExtended
 			return true;
 		}
 		
+		bool RelocationDatabase::Has(const char* name) const
+		{
+			if (_mapped.IsOpen())
+				return _mapped.IndexOf(name) != RelocationMappedDatabase::NOT_FOUND;
+
+			return voltek::reldb_has_patch(_stm, name);
+		}
+
 		SmartPointer<RelocationDatabaseItem> RelocationDatabase::GetByName(const char* name) const
 		{
+			if (_mapped.IsOpen())
+			{
+				auto index = _mapped.IndexOf(name);
+				if (index == RelocationMappedDatabase::NOT_FOUND)
+					return nullptr;
+
+				return new RelocationDatabaseItem(&_mapped, index);
+			}
+
 			voltek::reldb_patch* patch = nullptr;
 			if (voltek::reldb_get_patch_by_name(_stm, &patch, name) != 0)
 				return nullptr;
@@ -200,8 +373,35 @@ namespace CreationKitPlatformExtended
 			return new RelocationDatabaseItem(_stm, patch);
 		}
 
+		const RelocationDatabaseItem* RelocationDatabase::FindByName(const char* name) const
+		{
+			if (_mapped.IsOpen())
+			{
+				auto index = _mapped.IndexOf(name);
+				return (index == RelocationMappedDatabase::NOT_FOUND) ? nullptr : &_mappedItems[index];
+			}
+
+			if (!_stm)
+				return nullptr;
+
+			auto It = _items.find(name);
+			if (It != _items.end())
+				return It->second;
+
+			voltek::reldb_patch* patch = nullptr;
+			if (voltek::reldb_get_patch_by_name(_stm, &patch, name) != 0)
+				return nullptr;
+
+			auto item = new RelocationDatabaseItem(_stm, patch);
+			_items.insert(std::make_pair(String(name), item));
+			return item;
+		}
+
 		SmartPointer<RelocationDatabaseItem> RelocationDatabase::Append(const char* filename)
 		{
+			// Изменение базы делает недействительными выданные ранее патчи
+			ReleaseItems();
+
 			voltek::reldb_patch* patch = nullptr;
 			auto resultErrno = voltek::reldb_open_dev_file_patch(_stm, &patch, filename);
 			if (resultErrno)
@@ -231,6 +431,8 @@ namespace CreationKitPlatformExtended
 
 		bool RelocationDatabase::Remove(const char* name)
 		{
+			ReleaseItems();
+
 			auto resultErrno = voltek::reldb_remove_patch(_stm, name);
 			if (resultErrno)
 			{
@@ -245,6 +447,8 @@ namespace CreationKitPlatformExtended
 
 		void RelocationDatabase::Clear()
 		{
+			ReleaseItems();
+
 			auto resultErrno = voltek::reldb_clear_db(_stm);
 			if (resultErrno)
 			{
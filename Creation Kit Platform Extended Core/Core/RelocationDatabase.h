@@ -5,6 +5,7 @@
 #pragma once
 
 #include <Voltek.RelocationDatabase.h>
+#include "RelocationDatabaseMapped.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -17,25 +18,30 @@ namespace CreationKitPlatformExtended
 		public:
 			RelocationDatabaseItem();
 			RelocationDatabaseItem(voltek::reldb_stream* stm, voltek::reldb_patch* pch);
+			RelocationDatabaseItem(const RelocationMappedDatabase* db, uint32_t index);
 			~RelocationDatabaseItem() = default;
 		public:
 			void Clear();
 
 			bool SaveToFileDeveloped(const char* filename);
 
-			inline uint32_t Version() const { return (uint32_t)voltek::reldb_get_version_patch(patch); }
+			uint32_t Version() const;
 			String Name() const;
 			uint32_t At(uint32_t nId) const;
 			String PatternAt(uint32_t nId) const;
-			inline uint32_t Count() const { return (uint32_t)voltek::reldb_count_signatures_in_patch(patch); }
+			uint32_t Count() const;
 
 			inline uint32_t operator[](uint32_t nId) const { return At(nId); }
 		private:
+			friend class RelocationDatabase;
+
 			RelocationDatabaseItem(const RelocationDatabaseItem&) = default;
 			RelocationDatabaseItem& operator=(const RelocationDatabaseItem&) = default;
 
 			voltek::reldb_stream* stream;
 			voltek::reldb_patch* patch;
+			const RelocationMappedDatabase* mapped;
+			uint32_t mappedIndex;
 		};
 
 		class RelocationDatabase
@@ -46,17 +52,28 @@ namespace CreationKitPlatformExtended
 
 			bool CreateDatabase();
 			bool OpenDatabase();
+			bool OpenMappedDatabase();
 			bool SaveDatabase();
+			bool SaveMappedDatabase();
 
-			inline bool Has(const char* name) const { return voltek::reldb_has_patch(_stm, name); }
+			bool Has(const char* name) const;
 			SmartPointer<RelocationDatabaseItem> Append(const char* filename);
 			SmartPointer<RelocationDatabaseItem> GetByName(const char* name) const;
+			// Возвращает патч, принадлежащий базе данных, указатель действителен до её закрытия
+			const RelocationDatabaseItem* FindByName(const char* name) const;
 			bool Remove(const char* name);
 
 			void Clear();
 		private:
+			String GetMappedFileName() const;
+			RelocationMappedDatabase::Stamp GetMappedStamp() const;
+			void ReleaseItems();
+
 			Engine* _engine;
 			voltek::reldb_stream* _stm;
+			RelocationMappedDatabase _mapped;
+			RelocationDatabaseItem* _mappedItems;
+			mutable UnorderedMap<String, RelocationDatabaseItem*> _items;
 		};
 
 		extern RelocationDatabase* GlobalRelocationDatabasePtr;
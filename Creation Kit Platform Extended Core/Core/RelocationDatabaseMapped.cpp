@@ -0,0 +1,368 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "Engine.h"
+#include "RelocationDatabaseMapped.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		constexpr static uint32_t MAPPED_DATABASE_MAX_SEED = 0x100000ul;
+		constexpr static uint32_t MAPPED_DATABASE_KEYS_PER_BUCKET = 4;
+
+		RelocationMappedDatabase::RelocationMappedDatabase() : _file(INVALID_HANDLE_VALUE), _mapping(nullptr),
+			_view(nullptr), _header(nullptr), _buckets(nullptr), _patches(nullptr), _rvas(nullptr),
+			_patterns(nullptr), _strings(nullptr)
+		{}
+
+		RelocationMappedDatabase::~RelocationMappedDatabase()
+		{
+			Close();
+		}
+
+		uint64_t RelocationMappedDatabase::HashName(const char* name, uint32_t length)
+		{
+			// FNV-1a 64, без учёта регистра (как и ModuleManager)
+			uint64_t hash = 0xCBF29CE484222325ull;
+			for (uint32_t i = 0; i < length; i++)
+			{
+				hash ^= (uint8_t)tolower((uint8_t)name[i]);
+				hash *= 0x100000001B3ull;
+			}
+			return hash;
+		}
+
+		uint32_t RelocationMappedDatabase::HashSlot(uint64_t hash, uint32_t seed, uint32_t count)
+		{
+			// Перемешивание (splitmix64) основного хеша с номером смещения корзины
+			uint64_t x = hash + (uint64_t)seed * 0x9E3779B97F4A7C15ull;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			x ^= x >> 31;
+			return (uint32_t)(x % count);
+		}
+
+		bool RelocationMappedDatabase::GetSourceStamp(const char* fileName, uint64_t* sourceSize, uint64_t* sourceTime)
+		{
+			WIN32_FILE_ATTRIBUTE_DATA FileData;
+			if (!GetFileAttributesExA(fileName, GetFileExInfoStandard, &FileData))
+				return false;
+
+			*sourceSize = ((uint64_t)FileData.nFileSizeHigh << 32) | FileData.nFileSizeLow;
+			*sourceTime = ((uint64_t)FileData.ftLastWriteTime.dwHighDateTime << 32) | FileData.ftLastWriteTime.dwLowDateTime;
+			return true;
+		}
+
+		bool RelocationMappedDatabase::Open(const char* fileName, const Stamp& stamp)
+		{
+			Close();
+
+			_file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+			if (_file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER FileSize;
+			if (!GetFileSizeEx(_file, &FileSize) || (FileSize.QuadPart < (LONGLONG)sizeof(Header)) ||
+				(FileSize.QuadPart > 0xFFFFFFFFll))
+			{
+				Close();
+				return false;
+			}
+
+			_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!_mapping)
+			{
+				Close();
+				return false;
+			}
+
+			_view = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+			if (!_view)
+			{
+				Close();
+				return false;
+			}
+
+			// Проверяются только заголовок и границы разделов, сами записи не разбираются
+			auto Head = (const Header*)_view;
+			auto Size = (uint64_t)FileSize.QuadPart;
+			auto CheckRange = [Size](uint32_t offset, uint64_t length) -> bool {
+				return ((uint64_t)offset + length) <= Size;
+			};
+
+			if ((Head->Magic != MAGIC) || (Head->Version != VERSION) || (Head->FileSize != Size) ||
+				!Head->BucketCount ||
+				!CheckRange(Head->OffsetBuckets, (uint64_t)Head->BucketCount * sizeof(uint32_t)) ||
+				!CheckRange(Head->OffsetPatches, (uint64_t)Head->PatchCount * sizeof(Patch)) ||
+				!CheckRange(Head->OffsetRVAs, (uint64_t)Head->SignatureCount * sizeof(uint32_t)) ||
+				!CheckRange(Head->OffsetPatterns, (uint64_t)Head->SignatureCount * sizeof(Pattern)) ||
+				!CheckRange(Head->OffsetStrings, Head->StringsSize))
+			{
+				_WARNING("The mapped database file is damaged or has an unsupported version: \"%s\"", fileName);
+				Close();
+				return false;
+			}
+
+			// Файл должен быть собран этой версией платформы для этого редактора. Если рядом лежит
+			// исходная база, то и из неё, без исходной базы достаточно совпадения сборки.
+			if ((Head->Build.PlatformVersion != stamp.PlatformVersion) || (Head->Build.EditorCRC32 != stamp.EditorCRC32) ||
+				(stamp.SourceSize && ((Head->Build.SourceSize != stamp.SourceSize) || (Head->Build.SourceTime != stamp.SourceTime))))
+			{
+				_MESSAGE("The mapped database file is outdated: \"%s\"", fileName);
+				Close();
+				return false;
+			}
+
+			_header = Head;
+			_buckets = (const uint32_t*)(_view + Head->OffsetBuckets);
+			_patches = (const Patch*)(_view + Head->OffsetPatches);
+			_rvas = (const uint32_t*)(_view + Head->OffsetRVAs);
+			_patterns = (const Pattern*)(_view + Head->OffsetPatterns);
+			_strings = (const char*)(_view + Head->OffsetStrings);
+
+			return true;
+		}
+
+		void RelocationMappedDatabase::Close()
+		{
+			_header = nullptr;
+			_buckets = nullptr;
+			_patches = nullptr;
+			_rvas = nullptr;
+			_patterns = nullptr;
+			_strings = nullptr;
+
+			if (_view)
+			{
+				UnmapViewOfFile(_view);
+				_view = nullptr;
+			}
+
+			if (_mapping)
+			{
+				CloseHandle(_mapping);
+				_mapping = nullptr;
+			}
+
+			if (_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(_file);
+				_file = INVALID_HANDLE_VALUE;
+			}
+		}
+
+		uint32_t RelocationMappedDatabase::IndexOf(const char* name) const
+		{
+			if (!_header || !name || !_header->PatchCount)
+				return NOT_FOUND;
+
+			auto Length = (uint32_t)strlen(name);
+			auto Hash = HashName(name, Length);
+			auto Seed = _buckets[Hash % _header->BucketCount];
+			auto Index = HashSlot(Hash, Seed, _header->PatchCount);
+
+			// Идеальная хеш-функция отображает и чужие имена, поэтому имя нужно сверить
+			auto Entry = &_patches[Index];
+			if ((Entry->NameLength != Length) ||
+				((uint64_t)Entry->NameOffset + Length > _header->StringsSize) ||
+				_strnicmp(_strings + Entry->NameOffset, name, Length))
+				return NOT_FOUND;
+
+			return Index;
+		}
+
+		const char* RelocationMappedDatabase::NameAt(uint32_t nPatch) const
+		{
+			auto Entry = GetPatch(nPatch);
+			if (!Entry || ((uint64_t)Entry->NameOffset + Entry->NameLength >= _header->StringsSize))
+				return "";
+			return _strings + Entry->NameOffset;
+		}
+
+		uint32_t RelocationMappedDatabase::VersionAt(uint32_t nPatch) const
+		{
+			auto Entry = GetPatch(nPatch);
+			return Entry ? Entry->Version : 0;
+		}
+
+		uint32_t RelocationMappedDatabase::CountAt(uint32_t nPatch) const
+		{
+			auto Entry = GetPatch(nPatch);
+			if (!Entry || ((uint64_t)Entry->FirstSignature + Entry->SignatureCount > _header->SignatureCount))
+				return 0;
+			return Entry->SignatureCount;
+		}
+
+		uint32_t RelocationMappedDatabase::RVAAt(uint32_t nPatch, uint32_t nId) const
+		{
+			if (nId >= CountAt(nPatch))
+				return 0;
+			return _rvas[_patches[nPatch].FirstSignature + nId];
+		}
+
+		const char* RelocationMappedDatabase::PatternAt(uint32_t nPatch, uint32_t nId, uint32_t* nLength) const
+		{
+			*nLength = 0;
+			if (nId >= CountAt(nPatch))
+				return nullptr;
+
+			auto Ref = &_patterns[_patches[nPatch].FirstSignature + nId];
+			if (!Ref->Length || ((uint64_t)Ref->Offset + Ref->Length > _header->StringsSize))
+				return nullptr;
+
+			*nLength = Ref->Length;
+			return _strings + Ref->Offset;
+		}
+
+		bool RelocationMappedDatabase::Build(const char* fileName, const Array<SourcePatch>& patches, const Stamp& stamp)
+		{
+			auto Count = (uint32_t)patches.size();
+			auto BucketCount = std::max(1u, (Count + MAPPED_DATABASE_KEYS_PER_BUCKET - 1) / MAPPED_DATABASE_KEYS_PER_BUCKET);
+
+			// Распределяем имена по корзинам
+			Array<uint64_t> Hashes(Count);
+			Array<Array<uint32_t>> Buckets(BucketCount);
+			for (uint32_t i = 0; i < Count; i++)
+			{
+				Hashes[i] = HashName(patches[i].Name.c_str(), (uint32_t)patches[i].Name.length());
+				Buckets[Hashes[i] % BucketCount].push_back(i);
+			}
+
+			// Корзины с наибольшим числом ключей размещаются первыми
+			Array<uint32_t> Order(BucketCount);
+			for (uint32_t i = 0; i < BucketCount; i++)
+				Order[i] = i;
+			std::stable_sort(Order.begin(), Order.end(), [&Buckets](uint32_t a, uint32_t b) {
+				return Buckets[a].size() > Buckets[b].size();
+			});
+
+			Array<uint32_t> Seeds(BucketCount, 0);
+			Array<uint32_t> Slots(Count, NOT_FOUND);
+			Array<uint32_t> Probe;
+
+			for (auto BucketId : Order)
+			{
+				auto& Bucket = Buckets[BucketId];
+				if (Bucket.empty())
+					break;
+
+				uint32_t Seed = 0;
+				for (; Seed < MAPPED_DATABASE_MAX_SEED; Seed++)
+				{
+					Probe.clear();
+					bool Success = true;
+					for (auto Key : Bucket)
+					{
+						auto Slot = HashSlot(Hashes[Key], Seed, Count);
+						if ((Slots[Slot] != NOT_FOUND) || (std::find(Probe.begin(), Probe.end(), Slot) != Probe.end()))
+						{
+							Success = false;
+							break;
+						}
+						Probe.push_back(Slot);
+					}
+
+					if (Success)
+						break;
+				}
+
+				if (Seed == MAPPED_DATABASE_MAX_SEED)
+				{
+					_ERROR("Failed to build a perfect hash for the mapped database (duplicate patch names?)");
+					return false;
+				}
+
+				Seeds[BucketId] = Seed;
+				for (size_t i = 0; i < Bucket.size(); i++)
+					Slots[Probe[i]] = Bucket[i];
+			}
+
+			// Раскладываем патчи в порядке их слотов
+			Array<Patch> Patches(Count);
+			Array<uint32_t> RVAs;
+			Array<Pattern> Patterns;
+			String Strings;
+
+			for (uint32_t Slot = 0; Slot < Count; Slot++)
+			{
+				auto& Source = patches[Slots[Slot]];
+				auto& Entry = Patches[Slot];
+
+				Entry.NameOffset = (uint32_t)Strings.length();
+				Entry.NameLength = (uint32_t)Source.Name.length();
+				Entry.Version = Source.Version;
+				Entry.FirstSignature = (uint32_t)RVAs.size();
+				Entry.SignatureCount = (uint32_t)Source.RVAs.size();
+				Strings.append(Source.Name.c_str(), Source.Name.length() + 1);
+
+				for (size_t i = 0; i < Source.RVAs.size(); i++)
+				{
+					RVAs.push_back(Source.RVAs[i]);
+
+					Pattern Ref = { (uint32_t)Strings.length(), 0 };
+					if (i < Source.Patterns.size() && !Source.Patterns[i].empty())
+					{
+						Ref.Length = (uint32_t)Source.Patterns[i].length();
+						Strings.append(Source.Patterns[i].c_str(), Ref.Length + 1);
+					}
+					Patterns.push_back(Ref);
+				}
+			}
+
+			auto Align = [](uint32_t offset) -> uint32_t { return (offset + 7) & ~7u; };
+
+			Header Head = { 0 };
+			Head.Magic = MAGIC;
+			Head.Version = VERSION;
+			Head.PatchCount = Count;
+			Head.SignatureCount = (uint32_t)RVAs.size();
+			Head.BucketCount = BucketCount;
+			Head.OffsetBuckets = Align(sizeof(Header));
+			Head.OffsetPatches = Align(Head.OffsetBuckets + BucketCount * sizeof(uint32_t));
+			Head.OffsetRVAs = Align(Head.OffsetPatches + Count * sizeof(Patch));
+			Head.OffsetPatterns = Align(Head.OffsetRVAs + Head.SignatureCount * sizeof(uint32_t));
+			Head.OffsetStrings = Align(Head.OffsetPatterns + Head.SignatureCount * sizeof(Pattern));
+			Head.StringsSize = (uint32_t)Strings.length();
+			Head.FileSize = Head.OffsetStrings + Head.StringsSize;
+			Head.Build = stamp;
+			Head.Build.Reserved = 0;
+
+			Array<uint8_t> Image(Head.FileSize, 0);
+			memcpy(Image.data(), &Head, sizeof(Header));
+			memcpy(Image.data() + Head.OffsetBuckets, Seeds.data(), BucketCount * sizeof(uint32_t));
+			if (Count)
+				memcpy(Image.data() + Head.OffsetPatches, Patches.data(), Count * sizeof(Patch));
+			if (Head.SignatureCount)
+			{
+				memcpy(Image.data() + Head.OffsetRVAs, RVAs.data(), Head.SignatureCount * sizeof(uint32_t));
+				memcpy(Image.data() + Head.OffsetPatterns, Patterns.data(), Head.SignatureCount * sizeof(Pattern));
+			}
+			if (Head.StringsSize)
+				memcpy(Image.data() + Head.OffsetStrings, Strings.data(), Head.StringsSize);
+
+			// Пишем во временный файл, чтобы не оставить наполовину записанную базу
+			auto TempFileName = String(fileName) + ".tmp";
+			auto Stream = _fsopen(TempFileName.c_str(), "wb", _SH_DENYWR);
+			if (!Stream)
+			{
+				_ERROR("The mapped database file could not be created: \"%s\"", TempFileName.c_str());
+				return false;
+			}
+
+			bool Written = fwrite(Image.data(), 1, Image.size(), Stream) == Image.size();
+			fclose(Stream);
+
+			if (!Written || !MoveFileExA(TempFileName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING))
+			{
+				_ERROR("The mapped database file could not be written: \"%s\"", fileName);
+				DeleteFileA(TempFileName.c_str());
+				return false;
+			}
+
+			return true;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		// Второй формат базы данных патчей, предназначенный только для чтения.
+		// Файл целиком отображается в память, разбора при открытии нет, поиск патча по имени
+		// выполняется через минимальную идеальную хеш-функцию (hash and displace) за одно обращение.
+		//
+		// [Header][Buckets: uint32_t * BucketCount][Patches: Patch * PatchCount]
+		// [RVAs: uint32_t * SignatureCount][Patterns: Pattern * SignatureCount][Strings]
+		class RelocationMappedDatabase
+		{
+		public:
+			constexpr static uint32_t MAGIC = 'MBDR';
+			constexpr static uint32_t VERSION = 2;
+
+#pragma pack(push, 1)
+			// Отметка сборки, по которой определяется устаревший файл
+			struct Stamp
+			{
+				// Размер и время изменения исходного .database (нули, если его нет рядом)
+				uint64_t SourceSize;
+				uint64_t SourceTime;
+				// Версия платформы и CRC32 редактора, для которых собран файл
+				uint64_t PlatformVersion;
+				uint32_t EditorCRC32;
+				uint32_t Reserved;
+			};
+
+			struct Header
+			{
+				uint32_t Magic;
+				uint32_t Version;
+				uint32_t FileSize;
+				uint32_t PatchCount;
+				uint32_t SignatureCount;
+				uint32_t BucketCount;
+				uint32_t OffsetBuckets;
+				uint32_t OffsetPatches;
+				uint32_t OffsetRVAs;
+				uint32_t OffsetPatterns;
+				uint32_t OffsetStrings;
+				uint32_t StringsSize;
+				Stamp Build;
+			};
+
+			struct Patch
+			{
+				uint32_t NameOffset;
+				uint32_t NameLength;
+				uint32_t Version;
+				uint32_t FirstSignature;
+				uint32_t SignatureCount;
+			};
+
+			struct Pattern
+			{
+				uint32_t Offset;
+				uint32_t Length;
+			};
+#pragma pack(pop)
+
+			struct SourcePatch
+			{
+				String Name;
+				uint32_t Version;
+				Array<uint32_t> RVAs;
+				Array<String> Patterns;
+			};
+
+			constexpr static uint32_t NOT_FOUND = 0xFFFFFFFFul;
+		public:
+			RelocationMappedDatabase();
+			~RelocationMappedDatabase();
+
+			bool Open(const char* fileName, const Stamp& stamp);
+			void Close();
+
+			inline bool IsOpen() const { return _header != nullptr; }
+			inline uint32_t Count() const { return _header ? _header->PatchCount : 0; }
+			inline uint32_t TotalSignatures() const { return _header ? _header->SignatureCount : 0; }
+
+			uint32_t IndexOf(const char* name) const;
+
+			const char* NameAt(uint32_t nPatch) const;
+			uint32_t VersionAt(uint32_t nPatch) const;
+			uint32_t CountAt(uint32_t nPatch) const;
+			uint32_t RVAAt(uint32_t nPatch, uint32_t nId) const;
+			const char* PatternAt(uint32_t nPatch, uint32_t nId, uint32_t* nLength) const;
+
+			static bool Build(const char* fileName, const Array<SourcePatch>& patches, const Stamp& stamp);
+			static bool GetSourceStamp(const char* fileName, uint64_t* sourceSize, uint64_t* sourceTime);
+		private:
+			RelocationMappedDatabase(const RelocationMappedDatabase&) = default;
+			RelocationMappedDatabase& operator=(const RelocationMappedDatabase&) = default;
+
+			static uint64_t HashName(const char* name, uint32_t length);
+			static uint32_t HashSlot(uint64_t hash, uint32_t seed, uint32_t count);
+
+			inline const Patch* GetPatch(uint32_t nPatch) const
+			{
+				return (nPatch < _header->PatchCount) ? &_patches[nPatch] : nullptr;
+			}
+
+			HANDLE _file;
+			HANDLE _mapping;
+			const uint8_t* _view;
+			const Header* _header;
+			const uint32_t* _buckets;
+			const Patch* _patches;
+			const uint32_t* _rvas;
+			const Pattern* _patterns;
+			const char* _strings;
+		};
+	}
+}
\ No newline at end of file
@@ -9,6 +9,7 @@ namespace CreationKitPlatformExtended
 	namespace Core
 	{
 		Relocator* GlobalRelocatorPtr = nullptr;
+		static thread_local RelocatorTransaction* CurrentTransaction = nullptr;
 
 		Relocator::Relocator(Engine* lpEngine) : _engine(lpEngine)
 		{
@@ -26,7 +27,9 @@ namespace CreationKitPlatformExtended
 
 			auto offset = Rav2Off(rav);
 
-			if (IsLock(offset, size))
+			if (CurrentTransaction)
+				CurrentTransaction->Write(offset, bytes, size);
+			else if (IsLock(offset, size))
 				voltek::detours_patch_memory(offset, bytes, size);
 			else
 				voltek::detours_patch_memory_unsafe(offset, bytes, size);
@@ -38,7 +41,9 @@ namespace CreationKitPlatformExtended
 
 			auto offset = Rav2Off(rav);
 
-			if (IsLock(offset, data.size()))
+			if (CurrentTransaction)
+				CurrentTransaction->Write(offset, data.begin(), (uint32_t)data.size());
+			else if (IsLock(offset, data.size()))
 				voltek::detours_patch_memory(offset, data);
 			else
 				voltek::detours_patch_memory_unsafe(offset, data);
@@ -50,7 +55,9 @@ namespace CreationKitPlatformExtended
 
 			auto offset = Rav2Off(rav);
 
-			if (IsLock(offset, size))
+			if (CurrentTransaction)
+				CurrentTransaction->WriteNop(offset, size);
+			else if (IsLock(offset, size))
 				voltek::detours_patch_memory_nop(offset, size);
 			else
 				voltek::detours_patch_memory_nop_unsafe(offset, size);
@@ -89,6 +96,10 @@ namespace CreationKitPlatformExtended
 
 			auto offset = Rav2Off(rav);
 
+			// Перехват может читать исходные байты, накопленные записи должны быть уже в памяти
+			if (CurrentTransaction)
+				CurrentTransaction->Commit();
+
 			if (!IsLock(offset, 5))
 				return false;
 
@@ -103,6 +114,10 @@ namespace CreationKitPlatformExtended
 
 			auto offset = Rav2Off(rav);
 
+			// Перехват может читать исходные байты, накопленные записи должны быть уже в памяти
+			if (CurrentTransaction)
+				CurrentTransaction->Commit();
+
 			if (!IsLock(offset, 5))
 				return false;
 
@@ -117,6 +132,10 @@ namespace CreationKitPlatformExtended
 
 			auto offset = Rav2Off(rav);
 
+			// Перехват может читать исходные байты, накопленные записи должны быть уже в памяти
+			if (CurrentTransaction)
+				CurrentTransaction->Commit();
+
 			if (!IsLock(offset, 6))
 				return 0;
 
@@ -125,9 +144,9 @@ namespace CreationKitPlatformExtended
 
 		bool Relocator::IsLock(uintptr_t base, uint64_t size) const
 		{
-			for (auto It = Locks.begin(); It != Locks.end(); It++)
+			for (auto It = Locks.lower_bound(base); It != Locks.end(); It++)
 			{
-				if ((It->base >= base) && ((It->base + It->size) >= (base + size)))
+				if ((It->second.base + It->second.size) >= (base + size))
 					return false;
 			}
 
@@ -153,17 +172,17 @@ namespace CreationKitPlatformExtended
 			r.flag_lock = voltek::detours_unlock_protected(r.base, r.size);
 			//_MESSAGE("Removing protection from the region: %016X %llu", r.base, r.size);
 
-			Locks.push_back(r);
+			Locks.emplace(r.base, r);
 		}
 
 		void Relocator::Lock(uintptr_t base, uint64_t size)
 		{
-			for (auto It = Locks.begin(); It != Locks.end(); It++)
+			for (auto It = Locks.lower_bound(base); It != Locks.end(); It++)
 			{
-				if ((It->base >= base) && ((It->base + It->size) >= (base + size)))
+				if ((It->second.base + It->second.size) >= (base + size))
 				{
-					voltek::detours_lock_protected(It->base, It->size, It->flag_lock);
-					//_MESSAGE("Restore protection from the region: %016X %llu", It->base, It->size);
+					voltek::detours_lock_protected(It->second.base, It->second.size, It->second.flag_lock);
+					//_MESSAGE("Restore protection from the region: %016X %llu", It->second.base, It->second.size);
 					Locks.erase(It);
 
 					break;
@@ -204,5 +223,135 @@ namespace CreationKitPlatformExtended
 		{
 			GlobalRelocatorPtr->Lock(_base, _size);
 		}
+
+		RelocatorTransaction::RelocatorTransaction() : _previous(CurrentTransaction)
+		{
+			CurrentTransaction = this;
+		}
+
+		RelocatorTransaction::~RelocatorTransaction()
+		{
+			Commit();
+			CurrentTransaction = _previous;
+		}
+
+		RelocatorTransaction* RelocatorTransaction::GetCurrent()
+		{
+			return CurrentTransaction;
+		}
+
+		void RelocatorTransaction::Write(uintptr_t address, const uint8_t* bytes, uint32_t size)
+		{
+			if (!address || !bytes || !size) return;
+
+			_writes.push_back({ address, (uint32_t)_data.size(), size });
+			_data.insert(_data.end(), bytes, bytes + size);
+		}
+
+		void RelocatorTransaction::WriteNop(uintptr_t address, uint32_t size)
+		{
+			if (!address || !size) return;
+
+			_writes.push_back({ address, NOP_DATA, size });
+		}
+
+		void RelocatorTransaction::Commit()
+		{
+			if (_writes.empty()) return;
+
+			SYSTEM_INFO Info;
+			GetSystemInfo(&Info);
+			uintptr_t PageMask = (uintptr_t)Info.dwPageSize - 1;
+
+			// Затрагиваемые страницы, упорядоченные и слитые в непрерывные диапазоны
+
+			Array<std::pair<uintptr_t, uintptr_t>> Ranges;
+			Ranges.reserve(_writes.size());
+			for (auto& Write : _writes)
+				Ranges.emplace_back(Write.address & ~PageMask, (Write.address + Write.size + PageMask) & ~PageMask);
+
+			std::sort(Ranges.begin(), Ranges.end());
+
+			size_t Merged = 0;
+			for (size_t i = 1; i < Ranges.size(); i++)
+			{
+				if (Ranges[i].first <= Ranges[Merged].second)
+					Ranges[Merged].second = std::max(Ranges[Merged].second, Ranges[i].second);
+				else
+					Ranges[++Merged] = Ranges[i];
+			}
+			Ranges.resize(Merged + 1);
+
+			// Внутри диапазона страницы могут иметь разную защиту (например, граница секций),
+			// поэтому диапазон делится по регионам VirtualQuery, чтобы вернуть каждой странице её флаг
+
+			struct Protection
+			{
+				uintptr_t base;
+				uintptr_t size;
+				DWORD flag_lock;
+				bool unlocked;
+			};
+
+			Array<Protection> Protections;
+			bool Unlocked = true;
+			for (auto& Range : Ranges)
+			{
+				for (uintptr_t Current = Range.first; Current < Range.second;)
+				{
+					uintptr_t End = Range.second;
+
+					MEMORY_BASIC_INFORMATION Mbi;
+					if (VirtualQuery((LPCVOID)Current, &Mbi, sizeof(Mbi)))
+						End = std::min(End, (uintptr_t)Mbi.BaseAddress + (uintptr_t)Mbi.RegionSize);
+
+					Protection p = { Current, End - Current, 0, false };
+					p.unlocked = VirtualProtect((LPVOID)p.base, p.size, PAGE_EXECUTE_READWRITE, &p.flag_lock) != FALSE;
+					if (!p.unlocked)
+					{
+						Unlocked = false;
+						_ERROR("Failed to remove protection from the region: %016llX %llu", 
+							(uint64_t)p.base, (uint64_t)p.size);
+					}
+
+					Protections.push_back(p);
+					Current = End;
+				}
+			}
+
+			// Записи применяются в исходном порядке, перекрывающиеся патчи ведут себя как раньше.
+			// Если хоть один диапазон не удалось открыть, пишем по одному, как без пакета.
+
+			for (auto& Write : _writes)
+			{
+				if (Write.offset == NOP_DATA)
+				{
+					if (Unlocked)
+						memset((void*)Write.address, 0x90, Write.size);
+					else
+						voltek::detours_patch_memory_nop(Write.address, Write.size);
+				}
+				else
+				{
+					if (Unlocked)
+						memcpy((void*)Write.address, _data.data() + Write.offset, Write.size);
+					else
+						voltek::detours_patch_memory(Write.address, _data.data() + Write.offset, Write.size);
+				}
+			}
+
+			for (auto& p : Protections)
+			{
+				DWORD OldFlag;
+				if (p.unlocked)
+					VirtualProtect((LPVOID)p.base, p.size, p.flag_lock, &OldFlag);
+			}
+
+			FlushInstructionCache(GetCurrentProcess(), (LPCVOID)Ranges.front().first,
+				Ranges.back().second - Ranges.front().first);
+
+			_writes.clear();
+			_data.clear();
+		}
 	}
 }
\ No newline at end of file
@@ -65,7 +65,8 @@ namespace CreationKitPlatformExtended
 				uint64_t size;
 				DWORD flag_lock;
 			};
-			Array<Region> Locks;
+			// Упорядочены по началу региона, поиск начинается сразу с первого подходящего
+			MultiMap<uintptr_t, Region> Locks;
 		};
 
 		extern Relocator* GlobalRelocatorPtr;
@@ -84,6 +85,42 @@ namespace CreationKitPlatformExtended
 			uint64_t _size;
 		};
 
+		// Пакетная запись в память процесса.
+		// Пока объект существует, Patch/PatchNop текущего потока не пишут сразу, а накапливаются.
+		// При фиксации записи объединяются в диапазоны по границам страниц, защита снимается
+		// и восстанавливается один раз на диапазон, кеш инструкций сбрасывается один раз на пакет.
+		// Detour* перед установкой перехвата фиксируют всё накопленное, порядок записей сохраняется.
+		class RelocatorTransaction
+		{
+		public:
+			RelocatorTransaction();
+			~RelocatorTransaction();
+
+			void Write(uintptr_t address, const uint8_t* bytes, uint32_t size);
+			void WriteNop(uintptr_t address, uint32_t size);
+			void Commit();
+
+			inline uint32_t Count() const { return (uint32_t)_writes.size(); }
+
+			static RelocatorTransaction* GetCurrent();
+		private:
+			RelocatorTransaction(const RelocatorTransaction&) = default;
+			RelocatorTransaction& operator=(const RelocatorTransaction&) = default;
+
+			constexpr static uint32_t NOP_DATA = 0xFFFFFFFFul;
+
+			struct PendingWrite
+			{
+				uintptr_t address;
+				uint32_t offset;
+				uint32_t size;
+			};
+
+			Array<PendingWrite> _writes;
+			Array<uint8_t> _data;
+			RelocatorTransaction* _previous;
+		};
+
 		// thread-safe template versions of fastCall()
 
 		template<typename TR>
@@ -41,6 +41,12 @@ namespace CreationKitPlatformExtended
 				return *_singleton;
 			}
 
+			// Проверка без Assert, для кода, который может выполниться раньше, чем объект создан
+			inline bool HasSingleton() const
+			{
+				return _singleton && *_singleton;
+			}
+
 			READ_PROPERTY(GetSingleton) _Ty* Singleton;
 		private:
 			_Ty** _singleton;
@@ -13,135 +13,307 @@ namespace CreationKitPlatformExtended
 		TracerManager* GlobalTracerManagerPtr = nullptr;
 
 		TracerManager::TracerManager() : _Rec(false)
-		{}
+		{
+			_Shards = new Shard[SHARD_COUNT];
+			for (uint32_t i = 0; i < SHARD_COUNT; i++)
+			{
+				InitializeSRWLock(&_Shards[i].Lock);
+				_Shards[i].Count = 0;
+			}
+		}
 
-		void TracerManager::Push(const char* _Name, uintptr_t _MemAddress, size_t _Size, uintptr_t _RetAddress)
+		TracerManager::~TracerManager()
 		{
-			if (!_MemAddress || !_Rec)
-				return;
+			delete[] _Shards;
+		}
+
+		uint64_t TracerManager::Hash(uintptr_t _MemAddress)
+		{
+			// Младшие биты адреса всегда нули из-за выравнивания
+			return (uint64_t)(_MemAddress >> 4) * 0x9E3779B97F4A7C15ull;
+		}
+
+		void TracerManager::Grow(Shard& _Shard)
+		{
+			Array<TracerInfo> Old(std::move(_Shard.Table));
+			_Shard.Table.assign(Old.empty() ? SHARD_INITIAL_CAPACITY : (Old.size() << 1), TracerInfo{});
+			_Shard.Count = 0;
 
-			lock.lock();
+			for (auto& Info : Old)
 			{
-				TracerInfo info =
+				if (Info.MemAddress)
+					Insert(_Shard, Info, Hash(Info.MemAddress));
+			}
+		}
+
+		void TracerManager::Insert(Shard& _Shard, const TracerInfo& _Info, uint64_t _Hash)
+		{
+			// Заполнение не больше 3/4, иначе цепочки линейного поиска длинные
+			if (((_Shard.Count + 1) << 2) > (_Shard.Table.size() * 3))
+				Grow(_Shard);
+
+			auto Mask = _Shard.Table.size() - 1;
+			for (auto i = (size_t)_Hash & Mask;; i = (i + 1) & Mask)
+			{
+				auto& Slot = _Shard.Table[i];
+				if (!Slot.MemAddress)
 				{
-					.Name = _Name,
-					.RetAddress = _RetAddress,
-					.MemAddress = _MemAddress,
-					.Size = _Size
-				};
+					Slot = _Info;
+					_Shard.Count++;
+					return;
+				}
 
-				_Items.push_back(info);
+				// Блок уже был, его освобождение прошло мимо трассировки
+				if (Slot.MemAddress == _Info.MemAddress)
+				{
+					Slot = _Info;
+					return;
+				}
 			}
-			lock.unlock();
 		}
 
-		void TracerManager::Pop(uintptr_t _MemAddress)
+		void TracerManager::Erase(Shard& _Shard, uintptr_t _MemAddress, uint64_t _Hash)
 		{
-			if (!_MemAddress || !_Rec)
+			if (!_Shard.Count)
 				return;
 
-			lock.lock();
+			auto Mask = _Shard.Table.size() - 1;
+			auto i = (size_t)_Hash & Mask;
+			for (;; i = (i + 1) & Mask)
 			{
-				for (auto It = _Items.begin(); It != _Items.end(); It++)
+				auto& Slot = _Shard.Table[i];
+				if (!Slot.MemAddress)
+					return;
+				if (Slot.MemAddress == _MemAddress)
+					break;
+			}
+
+			// Удаление со сдвигом назад, без надгробий
+			for (auto j = i;;)
+			{
+				j = (j + 1) & Mask;
+				auto& Next = _Shard.Table[j];
+				if (!Next.MemAddress)
+					break;
+
+				auto Home = (size_t)Hash(Next.MemAddress) & Mask;
+				if (((j > i) && ((Home <= i) || (Home > j))) || ((j < i) && (Home <= i) && (Home > j)))
 				{
-					if (It->MemAddress == _MemAddress)
-					{
-						_Items.erase(It);
-						break;
-					}
+					_Shard.Table[i] = Next;
+					i = j;
 				}
 			}
-			lock.unlock();
+
+			_Shard.Table[i] = TracerInfo{};
+			_Shard.Count--;
 		}
 
-		void TracerManager::Record()
+		void TracerManager::Push(const char* _Name, uintptr_t _MemAddress, size_t _Size, uintptr_t _RetAddress)
 		{
-			if (_Rec)
+			if (!_MemAddress || !IsRecording())
 				return;
 
-			lock.lock();
+			TracerInfo info =
 			{
-				_Rec = true;
-				GlobalConsoleWindowPtr->InputLog("TRACER: Start of recording");
-			}
-			lock.unlock();
+				.Name = _Name,
+				.RetAddress = _RetAddress,
+				.MemAddress = _MemAddress,
+				.Size = _Size
+			};
+
+			auto HashAddress = Hash(_MemAddress);
+			auto& Shard = GetShard(HashAddress);
+
+			AcquireSRWLockExclusive(&Shard.Lock);
+			Insert(Shard, info, HashAddress);
+			ReleaseSRWLockExclusive(&Shard.Lock);
+		}
+
+		void TracerManager::Pop(uintptr_t _MemAddress)
+		{
+			if (!_MemAddress || !IsRecording())
+				return;
+
+			auto HashAddress = Hash(_MemAddress);
+			auto& Shard = GetShard(HashAddress);
+
+			AcquireSRWLockExclusive(&Shard.Lock);
+			Erase(Shard, _MemAddress, HashAddress);
+			ReleaseSRWLockExclusive(&Shard.Lock);
+		}
+
+		void TracerManager::Record()
+		{
+			if (_Rec.exchange(true))
+				return;
+
+			GlobalConsoleWindowPtr->InputLog("TRACER: Start of recording");
 		}
 
 		void TracerManager::Stop()
 		{
-			if (!_Rec)
+			if (!_Rec.exchange(false))
 				return;
 
-			lock.lock();
+			GlobalConsoleWindowPtr->InputLog("TRACER: End of recording");
+		}
+
+		void TracerManager::CollectItems(Array<TracerInfo>& _Items) const
+		{
+			for (uint32_t i = 0; i < SHARD_COUNT; i++)
+			{
+				auto& Shard = _Shards[i];
+
+				AcquireSRWLockShared(&Shard.Lock);
+				for (auto& Info : Shard.Table)
+				{
+					if (Info.MemAddress)
+						_Items.push_back(Info);
+				}
+				ReleaseSRWLockShared(&Shard.Lock);
+			}
+		}
+
+		TracerManager::Snapshot TracerManager::TakeSnapshot() const
+		{
+			Array<TracerInfo> Items;
+			CollectItems(Items);
+
+			UnorderedMap<uintptr_t, CallSite> Sites;
+			for (auto& Info : Items)
 			{
-				_Rec = false;
-				GlobalConsoleWindowPtr->InputLog("TRACER: End of recording");
+				auto& Site = Sites[Info.RetAddress];
+				Site.Name = Info.Name;
+				Site.RetAddress = Info.RetAddress;
+				Site.Count++;
+				Site.Bytes += (int64_t)Info.Size;
 			}
-			lock.unlock();
+
+			Snapshot Result;
+			Result.reserve(Sites.size());
+			for (auto& Site : Sites)
+				Result.push_back(Site.second);
+
+			std::sort(Result.begin(), Result.end(), [](const CallSite& lhs, const CallSite& rhs) {
+				return lhs.Bytes > rhs.Bytes;
+			});
+
+			return Result;
+		}
+
+		TracerManager::Snapshot TracerManager::Diff(const Snapshot& _Older, const Snapshot& _Newer)
+		{
+			UnorderedMap<uintptr_t, CallSite> Sites;
+			for (auto& Site : _Newer)
+				Sites[Site.RetAddress] = Site;
+
+			for (auto& Site : _Older)
+			{
+				auto& Delta = Sites[Site.RetAddress];
+				if (!Delta.RetAddress)
+				{
+					Delta.Name = Site.Name;
+					Delta.RetAddress = Site.RetAddress;
+				}
+
+				Delta.Count -= Site.Count;
+				Delta.Bytes -= Site.Bytes;
+			}
+
+			Snapshot Result;
+			for (auto& Site : Sites)
+			{
+				if (Site.second.Count || Site.second.Bytes)
+					Result.push_back(Site.second);
+			}
+
+			std::sort(Result.begin(), Result.end(), [](const CallSite& lhs, const CallSite& rhs) {
+				return lhs.Bytes > rhs.Bytes;
+			});
+
+			return Result;
 		}
 
 		void TracerManager::Dump()
 		{
-			if (_Rec)
+			if (IsRecording())
+				return;
+
+			Array<TracerInfo> Items;
+			CollectItems(Items);
+
+			char szBuf[130] = { 0 };
+			sprintf_s(szBuf, "Now the \"%llu\" number of lines will be written. Continue?", Items.size());
+			if (MessageBoxA(0, szBuf, "Question", MB_OKCANCEL | MB_ICONQUESTION) != IDOK)
 				return;
 
-			lock.lock();
+			auto Steam = _fsopen((Utils::GetApplicationPath() + "CreationKitPlatformExtendedTracerMemory.log").c_str(),
+				"wt+", _SH_DENYWR);
+
+			if (Steam)
 			{
-				auto Steam = _fsopen((Utils::GetApplicationPath() + "CreationKitPlatformExtendedTracerMemory.log").c_str(),
-					"wt+", _SH_DENYWR);
+				auto Sites = TakeSnapshot();
+				auto Changes = Diff(_LastSnapshot, Sites);
+
+				size_t TotalMemAllocSize = 0;
+				Utils::ScopeFileStream FileStream(Steam);
+
+				fprintf(Steam, "Dumping call sites.\n");
+				for (auto& Site : Sites)
+					fprintf(Steam, "%s -> from %p, %lld blocks, %lld bytes\n",
+						(Site.Name ? Site.Name : "UNKNOWN"), (void*)Site.RetAddress, Site.Count, Site.Bytes);
 
-				if (Steam)
+				fprintf(Steam, "Changes since the previous dump.\n");
+				for (auto& Site : Changes)
+					fprintf(Steam, "%s -> from %p, %+lld blocks, %+lld bytes\n",
+						(Site.Name ? Site.Name : "UNKNOWN"), (void*)Site.RetAddress, Site.Count, Site.Bytes);
+
+				fprintf(Steam, "Dumping objects.\n");
+				for (auto It = Items.begin(); It != Items.end(); It++)
 				{
-					char szBuf[130] = { 0 };
-					sprintf_s(szBuf, "Now the \"%llu\" number of lines will be written. Continue?", _Items.size());
-					if (MessageBoxA(0, szBuf, "Question", MB_OKCANCEL | MB_ICONQUESTION) != IDOK)
-						return;
-
-					{
-						size_t TotalMemAllocSize = 0;
-						Utils::ScopeFileStream FileStream(Steam);
-
-						fprintf(Steam, "Dumping objects.\n");
-						for (auto It = _Items.begin(); It != _Items.end(); It++)
-						{
-							fprintf(Steam, "%s -> normal block at %p, %llu bytes, where from %p\n",
-								(It->Name ? It->Name : "UNKNOWN"), It->MemAddress, It->Size, It->RetAddress);
-
-							fprintf(Steam, "  Data <");
-							char* Data = (char*)It->MemAddress;
-							for (size_t i = 0; i < It->Size; i++)
-								fputc((isprint(Data[i]) ? Data[i] : ' '), Steam);
-							fputs("> ", Steam);
-							for (size_t i = 0; i < It->Size; i++)
-								fprintf(Steam, "%02X ", (unsigned char)(Data[i]));
-							fputc('\n', Steam);
-
-							TotalMemAllocSize += It->Size;
-						}
-						if (TotalMemAllocSize >= (1024 * 1024))
-							fprintf(Steam, "Total memory allocated size %.3f Mb.\n", ((double)TotalMemAllocSize / (1024 * 1024)));
-						else
-							fprintf(Steam, "Total memory allocated size %llu bytes.\n", TotalMemAllocSize);
-						fprintf(Steam, "Object dump complete.\n");
-					}
-
-					GlobalConsoleWindowPtr->InputLog("TRACER: The memory trace dump is laid out \"CreationKitPlatformExtendedTracerMemory.log\"");
+					fprintf(Steam, "%s -> normal block at %p, %llu bytes, where from %p\n",
+						(It->Name ? It->Name : "UNKNOWN"), It->MemAddress, It->Size, It->RetAddress);
+
+					fprintf(Steam, "  Data <");
+					char* Data = (char*)It->MemAddress;
+					for (size_t i = 0; i < It->Size; i++)
+						fputc((isprint(Data[i]) ? Data[i] : ' '), Steam);
+					fputs("> ", Steam);
+					for (size_t i = 0; i < It->Size; i++)
+						fprintf(Steam, "%02X ", (unsigned char)(Data[i]));
+					fputc('\n', Steam);
+
+					TotalMemAllocSize += It->Size;
 				}
+				if (TotalMemAllocSize >= (1024 * 1024))
+					fprintf(Steam, "Total memory allocated size %.3f Mb.\n", ((double)TotalMemAllocSize / (1024 * 1024)));
+				else
+					fprintf(Steam, "Total memory allocated size %llu bytes.\n", TotalMemAllocSize);
+				fprintf(Steam, "Object dump complete.\n");
+
+				_LastSnapshot = std::move(Sites);
+
+				GlobalConsoleWindowPtr->InputLog("TRACER: The memory trace dump is laid out \"CreationKitPlatformExtendedTracerMemory.log\"");
 			}
-			lock.unlock();
 		}
 
 		void TracerManager::Clear()
 		{
-			if (_Rec)
+			if (IsRecording())
 				return;
 
-			lock.lock();
+			for (uint32_t i = 0; i < SHARD_COUNT; i++)
 			{
-				_Items.clear();
-				GlobalConsoleWindowPtr->InputLog("TRACER: Erasing records");
+				auto& Shard = _Shards[i];
+
+				AcquireSRWLockExclusive(&Shard.Lock);
+				Shard.Table.clear();
+				Shard.Count = 0;
+				ReleaseSRWLockExclusive(&Shard.Lock);
 			}
-			lock.unlock();
+
+			_LastSnapshot.clear();
+			GlobalConsoleWindowPtr->InputLog("TRACER: Erasing records");
 		}
 	}
 }
\ No newline at end of file
@@ -4,12 +4,17 @@
 
 #pragma once
 
-#define CKPE_USES_TRACER 0
+#define CKPE_USES_TRACER 1
 
 namespace CreationKitPlatformExtended
 {
 	namespace Core
 	{
+		// Трассировка выделений памяти для поиска утечек.
+		// Живые блоки хранятся в SHARD_COUNT независимых таблицах с открытой адресацией,
+		// шард выбирается по хешу адреса, поэтому потоки почти не встречаются на одной блокировке.
+		// Пока запись выключена, Push/Pop стоят одну проверку флага.
+		// Сводка по местам вызова (адрес возврата) собирается по требованию, снимки можно сравнивать.
 		class TracerManager
 		{
 		public:
@@ -20,8 +25,23 @@ namespace CreationKitPlatformExtended
 				uintptr_t MemAddress;
 				size_t Size;
 			};
+
+			struct CallSite
+			{
+				const char* Name;
+				uintptr_t RetAddress;
+				int64_t Count;
+				int64_t Bytes;
+			};
+
+			// Упорядочен по убыванию живых байт
+			using Snapshot = Array<CallSite>;
+
+			constexpr static uint32_t SHARD_COUNT = 64;
+			constexpr static uint32_t SHARD_INITIAL_CAPACITY = 1024;
 		public:
 			TracerManager();
+			~TracerManager();
 
 			void Push(const char* _Name, uintptr_t _MemAddress, size_t _Size, uintptr_t _RetAddress = (uintptr_t)_ReturnAddress());
 			void Pop(uintptr_t _MemAddress);
@@ -31,13 +51,34 @@ namespace CreationKitPlatformExtended
 
 			void Dump();
 			void Clear();
+
+			Snapshot TakeSnapshot() const;
+			static Snapshot Diff(const Snapshot& _Older, const Snapshot& _Newer);
+
+			inline bool IsRecording() const { return _Rec.load(std::memory_order_relaxed); }
 		private:
 			TracerManager(const TracerManager&) = default;
 			TracerManager& operator=(const TracerManager&) = default;
 
-			std::vector<TracerInfo> _Items;
-			std::recursive_mutex lock;
-			bool _Rec;
+			struct Shard
+			{
+				SRWLOCK Lock;
+				Array<TracerInfo> Table;
+				uint32_t Count;
+			};
+
+			static uint64_t Hash(uintptr_t _MemAddress);
+			inline Shard& GetShard(uint64_t _Hash) const { return _Shards[_Hash >> 58]; }
+
+			static void Insert(Shard& _Shard, const TracerInfo& _Info, uint64_t _Hash);
+			static void Erase(Shard& _Shard, uintptr_t _MemAddress, uint64_t _Hash);
+			static void Grow(Shard& _Shard);
+
+			void CollectItems(Array<TracerInfo>& _Items) const;
+
+			Shard* _Shards;
+			Snapshot _LastSnapshot;
+			std::atomic<bool> _Rec;
 		};
 
 		extern TracerManager* GlobalTracerManagerPtr;
@@ -46,8 +87,8 @@ namespace CreationKitPlatformExtended
 
 #if CKPE_USES_TRACER
 #define _CKPE_Tracer CreationKitPlatformExtended::Core::GlobalTracerManagerPtr
-#define _CKPE_TracerPush(x, y, z) if (_CKPE_Tracer) _CKPE_Tracer->Push(x, (uintptr_t)y, (size_t)z)
-#define _CKPE_TracerPop(x) if (_CKPE_Tracer) _CKPE_Tracer->Pop((uintptr_t)x)
+#define _CKPE_TracerPush(x, y, z) if (_CKPE_Tracer && _CKPE_Tracer->IsRecording()) _CKPE_Tracer->Push(x, (uintptr_t)y, (size_t)z)
+#define _CKPE_TracerPop(x) if (_CKPE_Tracer && _CKPE_Tracer->IsRecording()) _CKPE_Tracer->Pop((uintptr_t)x)
 #else
 #define _CKPE_Tracer
 #define _CKPE_TracerPush(x, y, z) 
@@ -19,29 +19,68 @@ namespace CreationKitPlatformExtended
 		{
 			using namespace detail;
 
+			constexpr static uintptr_t SCAN_RANGE_SIZE = 64 * 1024;
+			constexpr static uint32_t CACHE_MAGIC = 'TTRC';
+			constexpr static uint32_t CACHE_VERSION = 1;
+			constexpr static char CACHE_FILE_NAME[] = "CreationKitPlatformExtended_RTTI.cache";
+
+#pragma pack(push, 1)
+			// The scan result depends only on the executable image, so it is keyed by the exe CRC32
+			// and the section layout. Everything is stored as RVAs, names are read from the image.
+			struct CacheHeader
+			{
+				uint32_t Magic;
+				uint32_t Version;
+				uint32_t ExecutableCRC32;
+				uint32_t RdataRVA, RdataSize;
+				uint32_t DataRVA, DataSize;
+				uint32_t CodeRVA, CodeSize;
+				uint32_t Count;
+				uint32_t EntriesCRC32;
+			};
+
+			struct CacheEntry
+			{
+				uint32_t VTableRVA;
+				uint32_t LocatorRVA;
+				uint32_t VTableOffset;
+				uint32_t VFunctionCount;
+			};
+#pragma pack(pop)
+
 			Array<Info> Tables;
 			uintptr_t g_RdataBase, g_RdataEnd, g_DataBase, g_DataEnd, g_CodeBase, g_CodeEnd;
 			uintptr_t g_ModuleBase;
 
-			void Initialize()
+			// Mangled name -> indices into Tables, built by Initialize()
+			UnorderedMap<std::string_view, Array<uint32_t>> RawNameIndex;
+			// Demangled name -> indices and lowercase trigram -> indices, built on the first query that needs them
+			UnorderedMap<std::string_view, Array<uint32_t>> NameIndex;
+			UnorderedMap<uint32_t, Array<uint32_t>> TrigramIndex;
+			std::once_flag NameIndexFlag;
+			std::once_flag TrigramIndexFlag;
+
+			const char* Info::GetName() const
 			{
-				auto Sec = GlobalEnginePtr->GetSection(SECTION_DATA_READONLY);
-				g_RdataBase = Sec.base;
-				g_RdataEnd = Sec.end;
-				g_ModuleBase = GlobalEnginePtr->GetModuleBase();
-				Sec = GlobalEnginePtr->GetSection(SECTION_DATA);
-				g_DataBase = Sec.base;
-				g_DataEnd = Sec.end;
-				Sec = GlobalEnginePtr->GetSection(SECTION_TEXT);
-				g_CodeBase = Sec.base;
-				g_CodeEnd = Sec.end;
+				std::atomic_ref<const char*> name(DemangledName);
+				auto result = name.load(std::memory_order_acquire);
+				if (result)
+					return result;
 
-				for (uintptr_t i = g_RdataBase; i < (g_RdataEnd - sizeof(uintptr_t) - sizeof(uintptr_t)); i++)
-				{
-					// Skip all non-2-aligned addresses. Not sure if this is OK or it skips tables.
-					if (i % 2 != 0)
-						continue;
+				// Another thread may demangle the same entry at the same time, the first result wins
+				const char* demangled = __unDNameEx(nullptr, RawName + 1, 0, malloc, free, nullptr, 0x2800);
+				if (name.compare_exchange_strong(result, demangled, std::memory_order_acq_rel))
+					return demangled;
+
+				free((void*)demangled);
+				return result;
+			}
 
+			static void ScanRange(uintptr_t Start, uintptr_t End, Array<Info>& Result)
+			{
+				// Skip all non-2-aligned addresses. Not sure if this is OK or it skips tables.
+				for (uintptr_t i = (Start + 1) & ~(uintptr_t)1; i < End; i += 2)
+				{
 					//
 					// This might be a valid RTTI entry, so check if:
 					// - The COL points to somewhere in .rdata
@@ -63,12 +102,10 @@ namespace CreationKitPlatformExtended
 					info.VTableAddress = i + sizeof(uintptr_t);
 					info.VTableOffset = locator->Offset;
 					info.VFunctionCount = 0;
+					info.DemangledName = nullptr;
 					info.RawName = locator->TypeDescriptor.Get()->name;
 					info.Locator = locator;
 
-					// Demangle
-					info.Name = __unDNameEx(nullptr, info.RawName + 1, 0, malloc, free, nullptr, 0x2800);
-
 					// Determine number of virtual functions
 					for (uintptr_t j = info.VTableAddress; j < (g_RdataEnd - sizeof(uintptr_t)); j += sizeof(uintptr_t))
 					{
@@ -79,14 +116,226 @@ namespace CreationKitPlatformExtended
 					}
 
 					// Done
-					Tables.push_back(info);
+					Result.push_back(info);
+				}
+			}
+
+			static uint32_t Trigram(const char* String)
+			{
+				return (uint32_t)(uint8_t)toupper(String[0]) | ((uint32_t)(uint8_t)toupper(String[1]) << 8) |
+					((uint32_t)(uint8_t)toupper(String[2]) << 16);
+			}
+
+			static void DemangleAll()
+			{
+				std::for_each(std::execution::par, Tables.begin(), Tables.end(), [](const Info& info) { info.GetName(); });
+			}
+
+			static void BuildNameIndex()
+			{
+				DemangleAll();
+
+				for (uint32_t i = 0; i < (uint32_t)Tables.size(); i++)
+					NameIndex[Tables[i].GetName()].push_back(i);
+			}
+
+			static void BuildTrigramIndex()
+			{
+				DemangleAll();
+
+				for (uint32_t i = 0; i < (uint32_t)Tables.size(); i++)
+				{
+					auto name = Tables[i].GetName();
+					for (size_t j = 0; name[j] && name[j + 1] && name[j + 2]; j++)
+					{
+						// Names are visited in order, so a duplicate trigram can only be the last entry
+						auto& list = TrigramIndex[Trigram(name + j)];
+						if (list.empty() || (list.back() != i))
+							list.push_back(i);
+					}
+				}
+			}
+
+			static void Scan()
+			{
+				// Split .rdata into ranges and scan them in parallel. Names are demangled later, on demand.
+				uintptr_t scanEnd = g_RdataEnd - sizeof(uintptr_t) - sizeof(uintptr_t);
+				uintptr_t rangeCount = (scanEnd > g_RdataBase) ? ((scanEnd - g_RdataBase + SCAN_RANGE_SIZE - 1) / SCAN_RANGE_SIZE) : 0;
+				Array<Array<Info>> ranges(rangeCount);
+				Array<uintptr_t> indices(rangeCount);
+				for (uintptr_t i = 0; i < rangeCount; i++)
+					indices[i] = i;
+
+				std::for_each(std::execution::par, indices.begin(), indices.end(), [&ranges, scanEnd](uintptr_t i)
+					{
+						auto start = g_RdataBase + i * SCAN_RANGE_SIZE;
+						ScanRange(start, std::min(start + SCAN_RANGE_SIZE, scanEnd), ranges[i]);
+					});
+
+				for (auto& range : ranges)
+					Tables.insert(Tables.end(), range.begin(), range.end());
+			}
+
+			static void FillCacheHeader(CacheHeader& Header, uint32_t Count)
+			{
+				Header.Magic = CACHE_MAGIC;
+				Header.Version = CACHE_VERSION;
+				Header.ExecutableCRC32 = GlobalEnginePtr->GetExecutableCRC32();
+				Header.RdataRVA = (uint32_t)(g_RdataBase - g_ModuleBase);
+				Header.RdataSize = (uint32_t)(g_RdataEnd - g_RdataBase);
+				Header.DataRVA = (uint32_t)(g_DataBase - g_ModuleBase);
+				Header.DataSize = (uint32_t)(g_DataEnd - g_DataBase);
+				Header.CodeRVA = (uint32_t)(g_CodeBase - g_ModuleBase);
+				Header.CodeSize = (uint32_t)(g_CodeEnd - g_CodeBase);
+				Header.Count = Count;
+				Header.EntriesCRC32 = 0;
+			}
+
+			static bool LoadCache(const char* FileName)
+			{
+				if (!GlobalEnginePtr->GetExecutableCRC32())
+					return false;
+
+				FILE* file = _fsopen(FileName, "rb", _SH_DENYWR);
+				if (!file)
+					return false;
+
+				CacheHeader expected, header;
+				Array<CacheEntry> entries;
+				FillCacheHeader(expected, 0);
+
+				bool valid = (fread(&header, 1, sizeof(CacheHeader), file) == sizeof(CacheHeader)) &&
+					!memcmp(&header, &expected, offsetof(CacheHeader, Count)) &&
+					(header.Count <= (header.RdataSize / sizeof(CacheEntry)));
+
+				if (valid)
+				{
+					entries.resize(header.Count);
+					valid = (fread(entries.data(), sizeof(CacheEntry), entries.size(), file) == entries.size()) &&
+						(::Utils::CRC32Buffer(entries.data(), (uint32_t)(entries.size() * sizeof(CacheEntry))) == header.EntriesCRC32);
+				}
+
+				fclose(file);
+
+				if (!valid)
+					return false;
+
+				Array<Info> tables;
+				tables.reserve(entries.size());
+
+				for (auto& entry : entries)
+				{
+					Info info;
+					info.VTableAddress = g_ModuleBase + entry.VTableRVA;
+					info.VTableOffset = entry.VTableOffset;
+					info.VFunctionCount = entry.VFunctionCount;
+					info.DemangledName = nullptr;
+					info.Locator = reinterpret_cast<CompleteObjectLocator*>(g_ModuleBase + entry.LocatorRVA);
+
+					// Cheap sanity check of every entry against the image before trusting it
+					if (!IsWithinRDATA(info.VTableAddress) || !IsWithinRDATA((uintptr_t)info.Locator) ||
+						(*(uintptr_t*)(info.VTableAddress - sizeof(uintptr_t)) != (uintptr_t)info.Locator) ||
+						!IsValidCOL(info.Locator) || (info.VTableOffset != info.Locator->Offset))
+						return false;
+
+					info.RawName = info.Locator->TypeDescriptor.Get()->name;
+					tables.push_back(info);
 				}
+
+				Tables = std::move(tables);
+				return true;
+			}
+
+			static bool SaveCache(const char* FileName)
+			{
+				if (!GlobalEnginePtr->GetExecutableCRC32())
+					return false;
+
+				Array<CacheEntry> entries;
+				entries.reserve(Tables.size());
+
+				for (const Info& info : Tables)
+				{
+					CacheEntry entry;
+					entry.VTableRVA = (uint32_t)(info.VTableAddress - g_ModuleBase);
+					entry.LocatorRVA = (uint32_t)((uintptr_t)info.Locator - g_ModuleBase);
+					entry.VTableOffset = (uint32_t)info.VTableOffset;
+					entry.VFunctionCount = (uint32_t)info.VFunctionCount;
+					entries.push_back(entry);
+				}
+
+				CacheHeader header;
+				FillCacheHeader(header, (uint32_t)entries.size());
+				header.EntriesCRC32 = ::Utils::CRC32Buffer(entries.data(), (uint32_t)(entries.size() * sizeof(CacheEntry)));
+
+				// Write a temporary file and swap it in, so an interrupted write never leaves a truncated cache
+				auto tempFileName = String(FileName) + ".tmp";
+				FILE* file = _fsopen(tempFileName.c_str(), "wb", _SH_DENYWR);
+				if (!file)
+					return false;
+
+				bool written = (fwrite(&header, 1, sizeof(CacheHeader), file) == sizeof(CacheHeader)) &&
+					(fwrite(entries.data(), sizeof(CacheEntry), entries.size(), file) == entries.size());
+				written = !fclose(file) && written;
+
+				if (!written || !MoveFileExA(tempFileName.c_str(), FileName, MOVEFILE_REPLACE_EXISTING))
+				{
+					DeleteFileA(tempFileName.c_str());
+					return false;
+				}
+
+				return true;
+			}
+
+			void Initialize()
+			{
+				auto Sec = GlobalEnginePtr->GetSection(SECTION_DATA_READONLY);
+				g_RdataBase = Sec.base;
+				g_RdataEnd = Sec.end;
+				g_ModuleBase = GlobalEnginePtr->GetModuleBase();
+				Sec = GlobalEnginePtr->GetSection(SECTION_DATA);
+				g_DataBase = Sec.base;
+				g_DataEnd = Sec.end;
+				Sec = GlobalEnginePtr->GetSection(SECTION_TEXT);
+				g_CodeBase = Sec.base;
+				g_CodeEnd = Sec.end;
+
+				auto cacheFileName = Utils::GetApplicationPath() + CACHE_FILE_NAME;
+				if (!LoadCache(cacheFileName.c_str()))
+				{
+					Scan();
+
+					if (!SaveCache(cacheFileName.c_str()))
+						_WARNING("Failed to write the RTTI cache \"%s\"", cacheFileName.c_str());
+				}
+
+				for (uint32_t i = 0; i < (uint32_t)Tables.size(); i++)
+					RawNameIndex[Tables[i].RawName].push_back(i);
+			}
+
+			void Release()
+			{
+				// Not thread-safe, nothing may query the catalog while it is released
+				for (const Info& info : Tables)
+					free((void*)info.DemangledName);
+
+				Tables.clear();
+				RawNameIndex.clear();
+				NameIndex.clear();
+				TrigramIndex.clear();
+
+				std::destroy_at(&NameIndexFlag);
+				std::construct_at(&NameIndexFlag);
+				std::destroy_at(&TrigramIndexFlag);
+				std::construct_at(&TrigramIndexFlag);
 			}
 
 			void Dump(FILE* File)
 			{
+				DemangleAll();
+
 				for (const Info& info : Tables)
-					fprintf(File, "`%s`: VTable [0x%p, 0x%p offset, %lld functions] `%s`\n", info.Name, 
+					fprintf(File, "`%s`: VTable [0x%p, 0x%p offset, %lld functions] `%s`\n", info.GetName(), 
 						info.VTableAddress - g_ModuleBase, info.VTableOffset, info.VFunctionCount, info.RawName);
 			}
 
@@ -104,17 +353,67 @@ namespace CreationKitPlatformExtended
 				// so return all that match
 				Array<const Info*> results;
 
-				for (const Info& info : Tables)
+				if (Exact)
 				{
-					if (Exact)
+					// Simple class names can be mangled back and found without demangling anything
+					String rawName;
+					if (MangleTypeName(Name, rawName))
 					{
-						if (!strcmp(info.Name, Name))
-							results.push_back(&info);
+						auto it = RawNameIndex.find(rawName.c_str());
+						if (it != RawNameIndex.end())
+						{
+							for (auto i : it->second)
+							{
+								if (!strcmp(Tables[i].GetName(), Name))
+									results.push_back(&Tables[i]);
+							}
+
+							if (!results.empty())
+								return results;
+						}
 					}
-					else
+
+					std::call_once(NameIndexFlag, BuildNameIndex);
+
+					auto it = NameIndex.find(Name);
+					if (it != NameIndex.end())
 					{
-						if (strcasestr(info.Name, Name))
-							results.push_back(&info);
+						for (auto i : it->second)
+							results.push_back(&Tables[i]);
+					}
+				}
+				else
+				{
+					auto length = strlen(Name);
+					if (length < 3)
+					{
+						for (const Info& info : Tables)
+						{
+							if (strcasestr(info.GetName(), Name))
+								results.push_back(&info);
+						}
+
+						return results;
+					}
+
+					std::call_once(TrigramIndexFlag, BuildTrigramIndex);
+
+					// Every match must contain all trigrams of the substring, so verify the shortest list only
+					const Array<uint32_t>* candidates = nullptr;
+					for (size_t j = 0; (j + 2) < length; j++)
+					{
+						auto it = TrigramIndex.find(Trigram(Name + j));
+						if (it == TrigramIndex.end())
+							return results;
+
+						if (!candidates || (it->second.size() < candidates->size()))
+							candidates = &it->second;
+					}
+
+					for (auto i : *candidates)
+					{
+						if (strcasestr(Tables[i].GetName(), Name))
+							results.push_back(&Tables[i]);
 					}
 				}
 
@@ -155,6 +454,46 @@ namespace CreationKitPlatformExtended
 
 					return nullptr;
 				}
+
+				bool MangleTypeName(const char* Name, String& Result)
+				{
+					// "class A::B" -> ".?AVB@A@@", "struct A::B" -> ".?AUB@A@@". Templates and other complex
+					// names are not handled, the caller falls back to the demangled name index.
+					const char* type = nullptr;
+					if (!strncmp(Name, "class ", 6))
+						type = ".?AV";
+					else if (!strncmp(Name, "struct ", 7))
+						type = ".?AU";
+					else
+						return false;
+
+					Array<std::string_view> parts;
+					for (auto s = strchr(Name, ' ') + 1;;)
+					{
+						auto e = s;
+						while (isalnum((uint8_t)*e) || (*e == '_'))
+							e++;
+
+						if (e == s)
+							return false;
+
+						parts.emplace_back(s, e - s);
+
+						if (!*e)
+							break;
+						if ((e[0] != ':') || (e[1] != ':'))
+							return false;
+
+						s = e + 2;
+					}
+
+					Result = type;
+					for (auto it = parts.rbegin(); it != parts.rend(); it++)
+						Result.append(it->data(), it->size()).append("@");
+					Result.append("@");
+
+					return true;
+				}
 			}
 		}
 	}
@@ -16,12 +16,15 @@ namespace CreationKitPlatformExtended
 				uintptr_t VTableAddress;				// Address in .rdata section
 				uintptr_t VTableOffset;					// Offset of this vtable in complete class (from top)
 				uint64_t VFunctionCount;				// Number of contiguous functions
-				const char* Name;						// Demangled
+				mutable const char* DemangledName;		// Demangled on first use, see GetName()
 				const char* RawName;					// Mangled
 				detail::CompleteObjectLocator* Locator;	//
+
+				const char* GetName() const;
 			};
 
 			void Initialize();
+			void Release();
 			void Dump(FILE* File);
 			const Info* Find(const char* Name, bool Exact = true);
 			Array<const Info*> FindAll(const char* Name, bool Exact = true);
@@ -97,13 +100,10 @@ namespace CreationKitPlatformExtended
 					RVA<BaseClassArray*> BaseClassArray;	// BaseClassArray
 				};
 
-#pragma warning(push)
-#pragma warning(disable: 4200) // nonstandard extension used: zero-sized array in struct/union
 				struct BaseClassArray
 				{
-					uint32_t ArrayOfBaseClassDescriptors[]; // BaseClassDescriptor *
+					uint32_t ArrayOfBaseClassDescriptors[1]; // BaseClassDescriptor *, NumBaseClasses entries
 				};
-#pragma warning(pop)
 
 				struct BaseClassDescriptor
 				{
@@ -128,6 +128,7 @@ namespace CreationKitPlatformExtended
 				bool IsWithinCODE(uintptr_t Address);
 				bool IsValidCOL(CompleteObjectLocator* Locator);
 				const char* strcasestr(const char* String, const char* Substring);
+				bool MangleTypeName(const char* Name, String& Result);
 			}
 		}
 	}
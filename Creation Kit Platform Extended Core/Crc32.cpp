@@ -24,6 +24,10 @@
 #include "Crc32.h"
 
 static constexpr size_t BUFFER_SIZE = 16 * 1024;
+// Размер части файла для одного потока и минимальный размер файла для параллельного подсчёта
+static constexpr size_t PARALLEL_CHUNK_SIZE = 8 * 1024 * 1024;
+static constexpr size_t PARALLEL_MIN_SIZE = 2 * PARALLEL_CHUNK_SIZE;
+static constexpr uint32_t CRC_POLY = 0xedb88320ul;
 
 static constexpr uint32_t crc_table[256] = {
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -71,6 +75,219 @@ static constexpr uint32_t crc_table[256] = {
 	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+// Умножение многочленов по модулю CRC_POLY (в отражённом представлении), как в zlib
+static constexpr uint32_t crc_multmodp(uint32_t a, uint32_t b)
+{
+	uint32_t m = 1ul << 31, p = 0;
+	for (;;)
+	{
+		if (a & m)
+		{
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ CRC_POLY : b >> 1;
+	}
+	return p;
+}
+
+struct crc_x2n_table_t
+{
+	uint32_t data[32];
+
+	constexpr crc_x2n_table_t() : data()
+	{
+		// x^(2^n) mod p
+		uint32_t p = 1ul << 30;
+		data[0] = p;
+		for (int n = 1; n < 32; n++)
+			data[n] = p = crc_multmodp(p, p);
+	}
+};
+
+static constexpr crc_x2n_table_t crc_x2n_table;
+
+// x^(n * 2^k) mod p
+static uint32_t crc_x2nmodp(uint64_t n, uint32_t k)
+{
+	uint32_t p = 1ul << 31;
+	while (n)
+	{
+		if (n & 1)
+			p = crc_multmodp(crc_x2n_table.data[k & 31], p);
+		n >>= 1;
+		k++;
+	}
+	return p;
+}
+
+static bool crc_has_pclmul()
+{
+	static const bool result = []() {
+		int info[4];
+		__cpuid(info, 1);
+		// PCLMULQDQ и SSE 4.1 (pextrd)
+		return ((info[2] & (1 << 1)) != 0) && ((info[2] & (1 << 19)) != 0);
+	}();
+	return result;
+}
+
+// Свёртка через умножение без переноса, константы для полинома 0x04C11DB7 в отражённом виде из
+// Intel "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+// Принимает и возвращает промежуточное значение crc (без финальной инверсии), size >= 64 и кратен 16.
+static uint32_t crc_update_pclmul(const uint8_t* buf, size_t size, uint32_t crc)
+{
+	alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4ull, 0x01c6e41596ull };
+	alignas(16) static const uint64_t k3k4[] = { 0x01751997d0ull, 0x00ccaa009eull };
+	alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124ull, 0x0000000000ull };
+	alignas(16) static const uint64_t poly[] = { 0x01db710641ull, 0x01f7011641ull };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+	x0 = _mm_load_si128((const __m128i*)k1k2);
+
+	buf += 64;
+	size -= 64;
+
+	// Параллельная свёртка блоков по 64 байта
+	while (size >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+		y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+		y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+		y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+		buf += 64;
+		size -= 64;
+	}
+
+	// Свёртка в 128 бит
+	x0 = _mm_load_si128((const __m128i*)k3k4);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Оставшиеся блоки по 16 байт
+	while (size >= 16)
+	{
+		x2 = _mm_loadu_si128((const __m128i*)buf);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		buf += 16;
+		size -= 16;
+	}
+
+	// Свёртка 128 бит в 64 бита
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Редукция Барретта до 32 бит
+	x0 = _mm_load_si128((const __m128i*)poly);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc_update(const uint8_t* buf, size_t size, uint32_t crc)
+{
+	if ((size >= 64) && crc_has_pclmul())
+	{
+		auto aligned = size & ~(size_t)15;
+		crc = crc_update_pclmul(buf, aligned, crc);
+		buf += aligned;
+		size -= aligned;
+	}
+
+	for (size_t i = 0; i < size; ++i)
+		crc = crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+
+	return crc;
+}
+
+static uint32_t crc_file_stream(const char* filename)
+{
+	FILE* f = _fsopen(filename, "rb", _SH_DENYWR);
+	if (!f) return 0xFFFFFFFFul;
+
+	fseek(f, 0, SEEK_END);
+	uint32_t size = ftell(f);
+
+	if (!size)
+	{
+		fclose(f);
+		return 0xFFFFFFFFul;
+	}
+
+	fseek(f, 0, SEEK_SET);
+
+	uint32_t pos = 0;
+	uint32_t rlen = 0;
+	uint32_t crc = 0xFFFFFFFFul;
+
+	std::unique_ptr<char[]> buffer = std::make_unique<char[]>(BUFFER_SIZE);
+
+	do
+	{
+		rlen = (uint32_t)fread((void*)buffer.get(), 1, BUFFER_SIZE, f);
+		if (rlen > 0)
+			crc = crc_update((const uint8_t*)buffer.get(), rlen, crc);
+		else
+			break;
+		pos += rlen;
+	} while (pos < size);
+
+	fclose(f);
+	return ~crc;
+}
+
 namespace Utils
 {
 	uint32_t CRC32(const char* in) 
@@ -85,24 +302,12 @@ namespace Utils
 
 	uint32_t CRC32Buffer(const void* in, const uint32_t size)
 	{
-		uint32_t crc = 0xFFFFFFFFul;
-		const uint8_t* buf = (const uint8_t*)in;
-
-		for (uint32_t i = 0; i < size; ++i)
-			crc = crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
-
-		return ~crc;
+		return ~crc_update((const uint8_t*)in, size, 0xFFFFFFFFul);
 	}
 
 	uint32_t CRC32Update(const void* in, const uint32_t size, uint32_t prev_crc)
 	{
-		uint32_t crc = prev_crc;
-		const uint8_t* buf = (const uint8_t*)in;
-
-		for (uint32_t i = 0; i < size; ++i)
-			crc = crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
-
-		return crc;
+		return crc_update((const uint8_t*)in, size, prev_crc);
 	}
 
 	uint32_t CRC32Final(uint32_t crc)
@@ -110,39 +315,63 @@ namespace Utils
 		return ~crc;
 	}
 
-	uint32_t CRC32File(const char* filename)
+	uint32_t CRC32Combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
 	{
-		FILE* f = _fsopen(filename, "rb", _SH_DENYWR);
-		if (!f) return 0xFFFFFFFFul;
+		return crc_multmodp(crc_x2nmodp(len2, 3), crc1) ^ crc2;
+	}
 
-		fseek(f, 0, SEEK_END);
-		uint32_t size = ftell(f);
+	uint32_t CRC32File(const char* filename)
+	{
+		HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return crc_file_stream(filename);
 
-		if (!size)
+		LARGE_INTEGER liSize;
+		if (!GetFileSizeEx(hFile, &liSize) || !liSize.QuadPart)
 		{
-			fclose(f);
+			CloseHandle(hFile);
 			return 0xFFFFFFFFul;
 		}
 
-		fseek(f, 0, SEEK_SET);
-
-		uint32_t pos = 0;
-		uint32_t rlen = 0;
-		uint32_t crc = 0xFFFFFFFFul;
+		HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const uint8_t* view = hMapping ? (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!view)
+		{
+			if (hMapping) CloseHandle(hMapping);
+			CloseHandle(hFile);
+			return crc_file_stream(filename);
+		}
 
-		std::unique_ptr<char[]> buffer = std::make_unique<char[]>(BUFFER_SIZE);
+		// Прежняя версия читала не более 4 Гб
+		size_t size = (size_t)liSize.LowPart;
+		uint32_t crc = 0;
 
-		do
+		if (size < PARALLEL_MIN_SIZE)
+			crc = ~crc_update(view, size, 0xFFFFFFFFul);
+		else
 		{
-			rlen = (uint32_t)fread((void*)buffer.get(), 1, BUFFER_SIZE, f);
-			if (rlen > 0)
-				crc = CRC32Update((void*)buffer.get(), rlen, crc);
-			else
-				break;
-			pos += rlen;
-		} while (pos < size);
+			// Каждая часть считается в своём потоке, затем значения объединяются по порядку
+			size_t count = (size + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+			std::vector<uint32_t> chunks(count);
+			std::vector<size_t> indices(count);
+			for (size_t i = 0; i < count; i++)
+				indices[i] = i;
 
-		fclose(f);
-		return CRC32Final(crc);
+			std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i) {
+				auto offset = i * PARALLEL_CHUNK_SIZE;
+				chunks[i] = ~crc_update(view + offset, std::min(PARALLEL_CHUNK_SIZE, size - offset), 0xFFFFFFFFul);
+			});
+
+			crc = chunks[0];
+			for (size_t i = 1; i < count; i++)
+				crc = CRC32Combine(crc, chunks[i], std::min(PARALLEL_CHUNK_SIZE, size - i * PARALLEL_CHUNK_SIZE));
+		}
+
+		UnmapViewOfFile(view);
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+
+		return crc;
 	}
 }
\ No newline at end of file
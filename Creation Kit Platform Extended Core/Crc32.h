@@ -33,5 +33,6 @@ namespace Utils
 	uint32_t CRC32Buffer(const void* in, const uint32_t size);
 	uint32_t CRC32Update(const void* in, const uint32_t size, uint32_t prev_crc);
 	uint32_t CRC32Final(uint32_t crc);
+	uint32_t CRC32Combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
 	uint32_t CRC32File(const char* filename);
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include "BSLockWait.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace EditorAPI
+	{
+		std::atomic<uint32_t> BSLockWait::_spinCount = 0;
+		std::atomic<uint64_t> BSLockWait::_ticksPerMs = 0;
+		std::atomic<uint32_t> BSLockWait::_parked[PARKED_SLOT_COUNT];
+
+		void BSLockWait::Calibrate()
+		{
+			constexpr uint32_t CALIBRATION_PAUSES = 2000;
+
+			LARGE_INTEGER frequency, start, end;
+			QueryPerformanceFrequency(&frequency);
+
+			QueryPerformanceCounter(&start);
+			auto ticksStart = __rdtsc();
+
+			for (uint32_t i = 0; i < CALIBRATION_PAUSES; i++)
+				_mm_pause();
+
+			auto ticks = __rdtsc() - ticksStart;
+			QueryPerformanceCounter(&end);
+
+			// The latency of PAUSE differs a lot between CPUs (from ~10 to ~140 cycles)
+			double ns = (double)(end.QuadPart - start.QuadPart) * 1000000000.0 / (double)frequency.QuadPart;
+			double pauseNs = std::max(ns / CALIBRATION_PAUSES, 1.0);
+
+			_spinCount.store((uint32_t)std::clamp(SPIN_TIME_NS / pauseNs, 16.0, 100000.0), std::memory_order_relaxed);
+			_ticksPerMs.store(std::max((uint64_t)(ticks * 1000000.0 / std::max(ns, 1.0)), (uint64_t)1), std::memory_order_relaxed);
+		}
+
+		uint32_t BSLockWait::GetSpinCount()
+		{
+			auto count = _spinCount.load(std::memory_order_relaxed);
+			if (!count)
+			{
+				// A race here only repeats the measurement
+				Calibrate();
+				count = _spinCount.load(std::memory_order_relaxed);
+			}
+
+			return count;
+		}
+
+		uint64_t BSLockWait::GetTicksPerMs()
+		{
+			return _ticksPerMs.load(std::memory_order_relaxed);
+		}
+
+		void BSLockWait::Park(volatile void* Address, void* CompareAddress, size_t Size)
+		{
+			auto& parked = GetParkedSlot(Address);
+
+			// Counted before the value is compared inside WaitOnAddress, so the owner
+			// either sees us in the slot or we see its change of the lock word
+			parked.fetch_add(1, std::memory_order_seq_cst);
+			WaitOnAddress(Address, CompareAddress, Size, PARK_TIMEOUT_MS);
+			parked.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void BSLockWait::Wake(volatile void* Address, bool All)
+		{
+			if (!GetParkedSlot(Address).load(std::memory_order_seq_cst))
+				return;
+
+			if (All)
+				WakeByAddressAll((void*)Address);
+			else
+				WakeByAddressSingle((void*)Address);
+		}
+
+#if CKPE_LOCK_STATS
+		BSLockStats::Slot BSLockStats::_slots[SLOT_COUNT];
+
+		void BSLockStats::Acquired(const void* Lock, bool Contended, uint64_t WaitTicks)
+		{
+			auto key = (uintptr_t)Lock;
+			auto index = (uint32_t)((key >> 3) * 0x9E3779B97F4A7C15ull >> 54) & (SLOT_COUNT - 1);
+
+			// Open addressing, when the table is full the lock is not counted
+			for (uint32_t probe = 0; probe < SLOT_COUNT; probe++, index = (index + 1) & (SLOT_COUNT - 1))
+			{
+				auto& slot = _slots[index];
+				auto owner = slot.lock.load(std::memory_order_relaxed);
+
+				if (!owner && slot.lock.compare_exchange_strong(owner, key, std::memory_order_relaxed))
+					owner = key;
+
+				if (owner != key)
+					continue;
+
+				slot.acquisitions.fetch_add(1, std::memory_order_relaxed);
+				if (Contended)
+				{
+					slot.contended.fetch_add(1, std::memory_order_relaxed);
+					slot.waitTicks.fetch_add(WaitTicks, std::memory_order_relaxed);
+				}
+
+				return;
+			}
+		}
+
+		void BSLockStats::Dump(uint32_t Count)
+		{
+			Array<const Slot*> slots;
+
+			for (auto& slot : _slots)
+			{
+				if (slot.lock.load(std::memory_order_relaxed))
+					slots.push_back(&slot);
+			}
+
+			std::sort(slots.begin(), slots.end(), [](const Slot* lhs, const Slot* rhs) {
+				return lhs->waitTicks.load(std::memory_order_relaxed) > rhs->waitTicks.load(std::memory_order_relaxed);
+			});
+
+			auto ticksPerMs = (double)std::max(BSLockWait::GetTicksPerMs(), (uint64_t)1);
+
+			_CONSOLE("LOCKS: %llu locks seen, spin of %u pauses before parking",
+				(uint64_t)slots.size(), BSLockWait::GetSpinCount());
+
+			for (size_t i = 0; i < std::min((size_t)Count, slots.size()); i++)
+			{
+				auto slot = slots[i];
+				_CONSOLE("\t%p: %llu acquisitions, %llu contended, %.3f ms waiting",
+					(void*)slot->lock.load(std::memory_order_relaxed),
+					slot->acquisitions.load(std::memory_order_relaxed),
+					slot->contended.load(std::memory_order_relaxed),
+					(double)slot->waitTicks.load(std::memory_order_relaxed) / ticksPerMs);
+			}
+		}
+
+		void BSLockStats::Clear()
+		{
+			for (auto& slot : _slots)
+			{
+				slot.lock.store(0, std::memory_order_relaxed);
+				slot.acquisitions.store(0, std::memory_order_relaxed);
+				slot.contended.store(0, std::memory_order_relaxed);
+				slot.waitTicks.store(0, std::memory_order_relaxed);
+			}
+		}
+#endif
+	}
+}
\ No newline at end of file
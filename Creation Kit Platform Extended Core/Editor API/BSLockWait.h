@@ -0,0 +1,72 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Per-lock counters of acquisitions, contended acquisitions and wait time (debug only)
+#define CKPE_LOCK_STATS 0
+
+namespace CreationKitPlatformExtended
+{
+	namespace EditorAPI
+	{
+		// Shared slow path of BSSpinLock and BSReadWriteLock.
+		// A contended lock spins for a bounded time (calibrated once against the PAUSE latency of this CPU),
+		// then parks the thread on the lock word with WaitOnAddress. The lock layouts must match the game
+		// structures, so the parked threads are counted outside of them, in slots hashed by the lock address.
+		// The same lock words are also taken by the game code, which does not wake anybody, so parking is bounded.
+		class BSLockWait
+		{
+		public:
+			constexpr static uint32_t SPIN_TIME_NS = 4000;
+			constexpr static uint32_t PARKED_SLOT_COUNT = 64;
+			constexpr static uint32_t PARK_TIMEOUT_MS = 1;
+
+			// Number of PAUSE instructions that fit in SPIN_TIME_NS
+			static uint32_t GetSpinCount();
+			// Rdtsc ticks per millisecond, known after the first GetSpinCount()
+			static uint64_t GetTicksPerMs();
+
+			// Sleeps while *Address equals *CompareAddress, until woken or PARK_TIMEOUT_MS
+			static void Park(volatile void* Address, void* CompareAddress, size_t Size);
+			// Wakes the threads parked on Address, does nothing if nobody is parked on its slot
+			static void Wake(volatile void* Address, bool All);
+		private:
+			inline static std::atomic<uint32_t>& GetParkedSlot(volatile void* Address)
+			{
+				auto key = (uintptr_t)Address >> 3;
+				return _parked[(key ^ (key >> 6)) & (PARKED_SLOT_COUNT - 1)];
+			}
+
+			static void Calibrate();
+
+			static std::atomic<uint32_t> _spinCount;
+			static std::atomic<uint64_t> _ticksPerMs;
+			static std::atomic<uint32_t> _parked[PARKED_SLOT_COUNT];
+		};
+
+#if CKPE_LOCK_STATS
+		class BSLockStats
+		{
+		public:
+			constexpr static uint32_t SLOT_COUNT = 1024;
+
+			static void Acquired(const void* Lock, bool Contended, uint64_t WaitTicks);
+			// Writes the most contended locks to the console
+			static void Dump(uint32_t Count = 32);
+			static void Clear();
+		private:
+			struct Slot
+			{
+				std::atomic<uintptr_t> lock;
+				std::atomic<uint64_t> acquisitions;
+				std::atomic<uint64_t> contended;
+				std::atomic<uint64_t> waitTicks;
+			};
+
+			static Slot _slots[SLOT_COUNT];
+		};
+#endif
+	}
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 // Special thanks to Nukem: https://github.com/Nukem9/SkyrimSETest/blob/master/skyrim64_test/src/patches/TES/BSReadWriteLock.cpp
 
 #include "BSReadWriteLock.h"
+#include "BSLockWait.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -13,11 +14,42 @@ namespace CreationKitPlatformExtended
 
 		void BSReadWriteLock::LockForRead()
 		{
-			for (uint32_t count = 0; !TryLockForRead();)
+			if (TryLockForRead())
 			{
-				if (++count > 1000)
+#if CKPE_LOCK_STATS
+				BSLockStats::Acquired(this, false, 0);
+#endif
+				return;
+			}
+
+#if CKPE_LOCK_STATS
+			auto waitStart = __rdtsc();
+#endif
+			auto spinCount = BSLockWait::GetSpinCount();
+
+			for (bool locked = false; !locked;)
+			{
+				// Spin for a bounded time, the writer is usually quick
+				for (uint32_t counter = 0; !locked && counter < spinCount; counter++)
+				{
 					YieldProcessor();
+					locked = !(m_Bits.load(std::memory_order_relaxed) & WRITER) && TryLockForRead();
+				}
+
+				// Then park until the writer leaves
+				if (!locked)
+				{
+					int16_t value = m_Bits.load(std::memory_order_relaxed);
+					if (value & WRITER)
+						BSLockWait::Park(&m_Bits, &value, sizeof(value));
+
+					locked = TryLockForRead();
+				}
 			}
+
+#if CKPE_LOCK_STATS
+			BSLockStats::Acquired(this, true, __rdtsc() - waitStart);
+#endif
 		}
 
 		void BSReadWriteLock::UnlockRead()
@@ -25,7 +57,9 @@ namespace CreationKitPlatformExtended
 			if (IsWritingThread())
 				return;
 
-			m_Bits.fetch_add(-READER, std::memory_order_release);
+			// The last reader lets the parked writers in
+			if (m_Bits.fetch_add(-READER, std::memory_order_seq_cst) == READER)
+				BSLockWait::Wake(&m_Bits, true);
 		}
 
 		bool BSReadWriteLock::TryLockForRead()
@@ -39,7 +73,10 @@ namespace CreationKitPlatformExtended
 
 			if (value & WRITER)
 			{
-				m_Bits.fetch_add(-READER, std::memory_order_release);
+				// The writer may have left in the meantime, then this is the last reader
+				if (m_Bits.fetch_add(-READER, std::memory_order_seq_cst) == READER)
+					BSLockWait::Wake(&m_Bits, true);
+
 				return false;
 			}
 
@@ -48,11 +85,41 @@ namespace CreationKitPlatformExtended
 
 		void BSReadWriteLock::LockForWrite()
 		{
-			for (uint32_t count = 0; !TryLockForWrite();)
+			if (TryLockForWrite())
 			{
-				if (++count > 1000)
+#if CKPE_LOCK_STATS
+				BSLockStats::Acquired(this, false, 0);
+#endif
+				return;
+			}
+
+#if CKPE_LOCK_STATS
+			auto waitStart = __rdtsc();
+#endif
+			auto spinCount = BSLockWait::GetSpinCount();
+
+			for (bool locked = false; !locked;)
+			{
+				for (uint32_t counter = 0; !locked && counter < spinCount; counter++)
+				{
 					YieldProcessor();
+					locked = !m_Bits.load(std::memory_order_relaxed) && TryLockForWrite();
+				}
+
+				// Park until the readers and the other writer leave
+				if (!locked)
+				{
+					int16_t value = m_Bits.load(std::memory_order_relaxed);
+					if (value)
+						BSLockWait::Park(&m_Bits, &value, sizeof(value));
+
+					locked = TryLockForWrite();
+				}
 			}
+
+#if CKPE_LOCK_STATS
+			BSLockStats::Acquired(this, true, __rdtsc() - waitStart);
+#endif
 		}
 
 		void BSReadWriteLock::UnlockWrite()
@@ -61,7 +128,9 @@ namespace CreationKitPlatformExtended
 				return;
 
 			m_ThreadId.store(0, std::memory_order_release);
-			m_Bits.fetch_and(~WRITER, std::memory_order_release);
+			m_Bits.fetch_and(~WRITER, std::memory_order_seq_cst);
+
+			BSLockWait::Wake(&m_Bits, true);
 		}
 
 		bool BSReadWriteLock::TryLockForWrite()
@@ -1,6 +1,7 @@
 // Special thanks to Nukem: https://github.com/Nukem9/SkyrimSETest/blob/master/skyrim64_test/src/patches/TES/BSSpinLock.cpp
 
 #include "BSSpinLock.h"
+#include "BSLockWait.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -23,36 +24,41 @@ namespace CreationKitPlatformExtended
 			// First test (no waits/pauses, fast path)
 			if (InterlockedCompareExchange(&m_LockCount, 1, 0) != 0)
 			{
-				uint32_t counter = 0;
+#if CKPE_LOCK_STATS
+				auto waitStart = __rdtsc();
+#endif
+				auto spinCount = std::max((uint32_t)InitialAttempts, BSLockWait::GetSpinCount());
 				bool locked = false;
 
-				// Slow path #1 (PAUSE instruction)
-				do
+				while (!locked)
 				{
-					counter++;
-					_mm_pause();
-
-					locked = InterlockedCompareExchange(&m_LockCount, 1, 0) == 0;
-				} while (!locked && counter < (uint32_t)InitialAttempts);
-
-				// Slower path #2 (Sleep(X))
-				for (counter = 0; !locked;)
-				{
-					if (counter < SLOW_PATH_BACKOFF_COUNT)
+					// Slow path #1 (PAUSE instruction, bounded by time)
+					for (uint32_t counter = 0; !locked && counter < spinCount; counter++)
 					{
-						Sleep(0);
-						counter++;
+						_mm_pause();
+						locked = (m_LockCount == 0) && (InterlockedCompareExchange(&m_LockCount, 1, 0) == 0);
 					}
-					else
+
+					// Slower path #2 (park until the owner releases)
+					if (!locked)
 					{
-						Sleep(1);
-					}
+						uint32_t value = m_LockCount;
+						if (value)
+							BSLockWait::Park(&m_LockCount, &value, sizeof(value));
 
-					locked = InterlockedCompareExchange(&m_LockCount, 1, 0) == 0;
+						locked = InterlockedCompareExchange(&m_LockCount, 1, 0) == 0;
+					}
 				}
 
 				_mm_lfence();
+#if CKPE_LOCK_STATS
+				BSLockStats::Acquired(this, true, __rdtsc() - waitStart);
+#endif
 			}
+#if CKPE_LOCK_STATS
+			else
+				BSLockStats::Acquired(this, false, 0);
+#endif
 
 			m_OwningThread = GetCurrentThreadId();
 			_mm_sfence();
@@ -74,6 +80,8 @@ namespace CreationKitPlatformExtended
 
 				uint32_t oldCount = InterlockedCompareExchange(&m_LockCount, 0, 1);
 				AssertMsg(oldCount == 1, "The spinlock wasn't correctly released");
+
+				BSLockWait::Wake(&m_LockCount, false);
 			}
 			else
 			{
@@ -9,8 +9,6 @@ namespace CreationKitPlatformExtended
 		class BSSpinLock
 		{
 		private:
-			const static uint32_t SLOW_PATH_BACKOFF_COUNT = 10000;
-
 			uint32_t m_OwningThread = 0;
 			volatile uint32_t m_LockCount = 0;
 
@@ -4,6 +4,7 @@
 
 #include "BSFile.h"
 #include "NiAPI\NiMemoryManager.h"
+#include "Core\RecordPrefetcher.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -49,7 +50,26 @@ namespace CreationKitPlatformExtended
 				if (mode == FileModes::kFileMode_ReadOnly && bufferSize < 0x40000)
 					bufferSize = 0x40000;
 
-				return ICreateInstance(This, fileName, mode, bufferSize, isTextFile);
+				// A plugin about to be written must not stay mapped by the prefetcher
+				if ((mode != FileModes::kFileMode_ReadOnly) && fileName)
+				{
+					auto ext = PathFindExtensionA(fileName);
+					if (!_stricmp(ext, ".esm") || !_stricmp(ext, ".esp") || !_stricmp(ext, ".esl"))
+						RecordPrefetcher::Close();
+				}
+
+				if (!ICreateInstance(This, fileName, mode, bufferSize, isTextFile))
+					return false;
+
+				// Plugins opened for reading get their compressed records inflated ahead of the loader
+				if ((mode == FileModes::kFileMode_ReadOnly) && fileName && This->IsGood())
+				{
+					auto ext = PathFindExtensionA(fileName);
+					if (!_stricmp(ext, ".esm") || !_stricmp(ext, ".esp") || !_stricmp(ext, ".esl"))
+						RecordPrefetcher::Open(fileName);
+				}
+
+				return true;
 			}
 		}
 	}
@@ -155,80 +155,334 @@ namespace CreationKitPlatformExtended
 			static_assert(sizeof(BSPointerHandleManagerEntry_Extended_NG) == 0x10);
 			static_assert(sizeof(BSPointerHandleManagerEntry_Extended) == 0x10);
 
-			template<typename _Ty, typename HandleType, typename HandleRef>
+			// NOTE: The table is only reserved up front (for 26 bits that is about 1 GB), entries are
+			// committed in chunks when they are handed out for the first time, so untouched entries cost nothing.
+			// Free entries of a table owned by us are kept in two places: untouched ones are handed out by the
+			// NextUnused counter, released ones go to a lock-free stack linked through the entry index bits.
+			// Each thread takes and returns entries in batches of CACHE_ENTRIES, the stack top is tagged against ABA.
+			// LazyCommit = false is for tables whose free list is walked by the game code itself (NG),
+			// such a table is committed and threaded entirely in InitSDM.
+
+			template<typename _Ty, typename HandleType, typename HandleRef, bool LazyCommit = true>
 			class IBSPointerHandleManager
 			{
 			protected:
+				typedef IBSPointerHandleManagerEntry<_Ty, HandleType, HandleRef> EntryType;
+
+				constexpr static _Ty ENTRY_COUNT = (_Ty)HandleType::MAX_HANDLE_COUNT + 1;
+				constexpr static _Ty CHUNK_ENTRIES = 0x10000;	// 1 MB
+				constexpr static _Ty CHUNK_COUNT = (ENTRY_COUNT + CHUNK_ENTRIES - 1) / CHUNK_ENTRIES;
+				constexpr static uint32_t CACHE_ENTRIES = 64;	// CHUNK_ENTRIES must be a multiple
+				constexpr static uint32_t STACK_EMPTY = 0xFFFFFFFF;
+				constexpr static uint32_t REFR_LOCK_COUNT = 64;
+
+				struct ThreadCache
+				{
+					uint32_t Free[CACHE_ENTRIES];
+					uint32_t FreeCount = 0;
+					uint32_t Released[CACHE_ENTRIES];
+					uint32_t ReleasedCount = 0;
+
+					~ThreadCache()
+					{
+						// Entries of a finished thread go back to everyone
+						if (HandleEntries)
+						{
+							PushChain(Free, FreeCount);
+							PushChain(Released, ReleasedCount);
+						}
+					}
+				};
+
 				inline static _Ty FreeListHead;
 				inline static _Ty FreeListTail;
 				inline static BSReadWriteLock HandleManagerLock;
-				inline static Array<IBSPointerHandleManagerEntry<_Ty, HandleType, HandleRef>> HandleEntries;
+				inline static EntryType* HandleEntries = nullptr;
+				inline static std::atomic<uint64_t> CommittedChunks[(CHUNK_COUNT + 63) / 64];
+				inline static std::atomic<uint64_t> FreeStack = STACK_EMPTY;	// tag << 32 | index
+				inline static std::atomic<_Ty> NextUnused = 0;
+				inline static SimpleLock CommitLock;
+				inline static SimpleLock RefrLocks[REFR_LOCK_COUNT];
+				inline static thread_local ThreadCache Cache;
 				inline const static HandleType NullHandle;
 			public:
 				constexpr static _Ty INVALID_INDEX = (_Ty)-1;
 			public:
-				inline static _Ty GetHead() { return FreeListHead; }
-				inline static _Ty GetTail() { return FreeListTail; }
+				inline static _Ty GetHead()
+				{
+					if constexpr (LazyCommit)
+						return std::min(NextUnused.load(std::memory_order_relaxed), (_Ty)HandleType::MAX_HANDLE_COUNT);
+					else
+						return FreeListHead;
+				}
 
-				static IBSPointerHandleManagerEntry<_Ty, HandleType, HandleRef>* InitSDM()
+				inline static _Ty GetTail()
 				{
-					// Alloc
-					HandleEntries.resize(HandleType::MAX_HANDLE_COUNT + 1);
+					if constexpr (LazyCommit)
+						return (uint32_t)FreeStack.load(std::memory_order_relaxed);
+					else
+						return FreeListTail;
+				}
+
+				static EntryType* InitSDM()
+				{
+					// Reserve
+					if (!HandleEntries)
+					{
+						HandleEntries = (EntryType*)VirtualAlloc(nullptr, ENTRY_COUNT * sizeof(EntryType),
+							MEM_RESERVE, PAGE_READWRITE);
+						AssertMsg(HandleEntries, "IBSPointerHandleManager::InitSDM - failed to reserve the handle table");
+					}
 					// Reset
 					CleanSDM();
 					// Return address
-					return HandleEntries.data();
+					return HandleEntries;
 				}
 
 				static void CleanSDM()
 				{
-					FreeListHead = 0;
-					
-					for (_Ty i = 0; i < HandleType::MAX_HANDLE_COUNT; i++)
+					if constexpr (LazyCommit)
+					{
+						// Entries are linked only when they are released
+						NextUnused = 0;
+						FreeStack = STACK_EMPTY;
+					}
+					else
+					{
+						FreeListHead = 0;
+
+						for (_Ty chunk = 0; chunk < CHUNK_COUNT; chunk++)
+						{
+							if (IsChunkCommitted(chunk))
+								ThreadChunk(chunk);
+							else
+								CommitChunk(chunk);
+						}
+
+						FreeListTail = HandleType::MAX_HANDLE_COUNT - 1;
+					}
+				}
+
+				static void KillSDM()
+				{
+					HandleManagerLock.TryLockForWrite();
+
+					for (_Ty chunk = 0; chunk < CHUNK_COUNT; chunk++)
+					{
+						if (!IsChunkCommitted(chunk))
+							continue;
+
+						for (_Ty i = chunk * CHUNK_ENTRIES; i < GetChunkEnd(chunk); i++)
+						{
+							auto& arrayHandle = HandleEntries[i];
+
+							if (!arrayHandle.IsInUse())
+								continue;
+
+							if (arrayHandle.GetPointer())
+								arrayHandle.GetPointer()->ClearHandleEntryIndex();
+
+							arrayHandle.SetPointer(nullptr);
+							arrayHandle.SetNotInUse();
+
+							if constexpr (LazyCommit)
+							{
+								uint32_t index = (uint32_t)i;
+								PushChain(&index, 1);
+								continue;
+							}
+
+							if (FreeListTail == INVALID_INDEX)
+								FreeListHead = i;
+							else
+								HandleEntries[FreeListTail].SetNextFreeEntry(i);
+
+							arrayHandle.SetNextFreeEntry(i);
+							FreeListTail = i;
+						}
+					}
+
+					HandleManagerLock.Unlock();
+				}
+			protected:
+				inline static bool IsChunkCommitted(_Ty Chunk)
+				{
+					return (CommittedChunks[Chunk >> 6].load(std::memory_order_acquire) & (1ull << (Chunk & 63))) != 0;
+				}
+
+				// Whether the entry may be read, handles from outside are not trusted
+				inline static bool IsCommitted(_Ty Index)
+				{
+					return IsChunkCommitted(Index / CHUNK_ENTRIES);
+				}
+
+				inline static _Ty GetChunkEnd(_Ty Chunk)
+				{
+					return std::min((Chunk + 1) * CHUNK_ENTRIES, (_Ty)HandleType::MAX_HANDLE_COUNT);
+				}
+
+				static void ThreadChunk(_Ty Chunk)
+				{
+					for (_Ty i = Chunk * CHUNK_ENTRIES; i < GetChunkEnd(Chunk); i++)
 					{
 						if ((i + 1) >= HandleType::MAX_HANDLE_COUNT)
 							HandleEntries[i].SetNextFreeEntry(i);
 						else
 							HandleEntries[i].SetNextFreeEntry(i + 1);
 					}
+				}
+
+				static bool CommitChunk(_Ty Chunk)
+				{
+					auto begin = Chunk * CHUNK_ENTRIES;
+					auto end = std::min(begin + CHUNK_ENTRIES, ENTRY_COUNT);
+
+					// The pages come zeroed, as the entries of the former array did
+					if (!VirtualAlloc(HandleEntries + begin, (end - begin) * sizeof(EntryType), MEM_COMMIT, PAGE_READWRITE))
+					{
+						AssertMsgVa(false, "IBSPointerHandleManager - failed to commit the handle table chunk %llu",
+							(uint64_t)Chunk);
+						return false;
+					}
 
-					FreeListTail = HandleType::MAX_HANDLE_COUNT - 1;
+					if constexpr (!LazyCommit)
+						ThreadChunk(Chunk);
+
+					CommittedChunks[Chunk >> 6].fetch_or(1ull << (Chunk & 63), std::memory_order_release);
+
+					return true;
 				}
 
-				static void KillSDM()
+				inline static bool EnsureCommitted(_Ty Index)
 				{
-					HandleManagerLock.TryLockForWrite();
+					if (IsCommitted(Index))
+						return true;
+
+					SimpleLocker locker(&CommitLock);
+					return IsCommitted(Index) || CommitChunk(Index / CHUNK_ENTRIES);
+				}
+
+				// Guards creation and destruction of the handle of one reference
+				inline static SimpleLock& GetRefrLock(const void* Refr)
+				{
+					auto key = (uintptr_t)Refr >> 4;
+					return RefrLocks[(key ^ (key >> 8)) & (REFR_LOCK_COUNT - 1)];
+				}
+
+				// Links the entries in the given order and puts them on the stack with a single CAS
+				static void PushChain(const uint32_t* Indices, uint32_t Count)
+				{
+					if (!Count)
+						return;
 
-					for (_Ty i = 0; i < HandleType::MAX_HANDLE_COUNT; i++)
+					for (uint32_t i = 0; (i + 1) < Count; i++)
+						HandleEntries[Indices[i]].SetNextFreeEntry(Indices[i + 1]);
+
+					auto last = Indices[Count - 1];
+					auto top = FreeStack.load(std::memory_order_relaxed);
+					uint64_t newTop;
+
+					do
 					{
-						auto& arrayHandle = HandleEntries[i];
+						// The bottom of the stack points to itself
+						HandleEntries[last].SetNextFreeEntry(((uint32_t)top == STACK_EMPTY) ? last : (uint32_t)top);
+						newTop = (((top >> 32) + 1) << 32) | Indices[0];
+					} while (!FreeStack.compare_exchange_weak(top, newTop,
+						std::memory_order_release, std::memory_order_relaxed));
+				}
 
-						if (!arrayHandle.IsInUse())
-							continue;
+				static uint32_t PopEntry()
+				{
+					auto top = FreeStack.load(std::memory_order_acquire);
 
-						if (arrayHandle.GetPointer())
-							arrayHandle.GetPointer()->ClearHandleEntryIndex();
+					while ((uint32_t)top != STACK_EMPTY)
+					{
+						auto index = (uint32_t)top;
+						// The link is stale if the entry was taken in the meantime, then the tag no longer matches
+						auto next = (uint32_t)HandleEntries[index].GetNextFreeEntry();
+						auto newTop = (((top >> 32) + 1) << 32) | ((next == index) ? STACK_EMPTY : next);
+
+						if (FreeStack.compare_exchange_weak(top, newTop,
+							std::memory_order_acquire, std::memory_order_acquire))
+							return index;
+					}
 
-						arrayHandle.SetPointer(nullptr);
-						arrayHandle.SetNotInUse();
+					return STACK_EMPTY;
+				}
 
-						if (FreeListTail == INVALID_INDEX)
-							FreeListHead = i;
-						else
-							HandleEntries[FreeListTail].SetNextFreeEntry(i);
+				static bool Refill(ThreadCache& ThisCache)
+				{
+					// Untouched entries go first, as they did in the former free list
+					if (NextUnused.load(std::memory_order_relaxed) < HandleType::MAX_HANDLE_COUNT)
+					{
+						auto first = NextUnused.fetch_add(CACHE_ENTRIES);
+						if (first < HandleType::MAX_HANDLE_COUNT)
+						{
+							// The batch never crosses a chunk
+							if (!EnsureCommitted(first))
+								return false;
+
+							auto count = (uint32_t)std::min((_Ty)CACHE_ENTRIES, (_Ty)HandleType::MAX_HANDLE_COUNT - first);
+							// Linked as the former free list had them, the cache is taken from the end
+							for (uint32_t i = 0; i < count; i++)
+							{
+								auto index = first + count - 1 - i;
+								HandleEntries[index].SetNextFreeEntry(((index + 1) >= HandleType::MAX_HANDLE_COUNT) ? index : index + 1);
+								ThisCache.Free[i] = (uint32_t)index;
+							}
 
-						arrayHandle.SetNextFreeEntry(i);
-						FreeListTail = i;
+							ThisCache.FreeCount = count;
+							return true;
+						}
 					}
 
-					HandleManagerLock.Unlock();
+					while (ThisCache.FreeCount < CACHE_ENTRIES)
+					{
+						auto index = PopEntry();
+						if (index == STACK_EMPTY)
+							break;
+
+						ThisCache.Free[ThisCache.FreeCount++] = index;
+					}
+
+					return ThisCache.FreeCount > 0;
+				}
+
+				static uint32_t AcquireEntry()
+				{
+					auto& cache = Cache;
+
+					if (!cache.FreeCount && !Refill(cache))
+					{
+						// The last resort is what this thread has released itself
+						if (!cache.ReleasedCount)
+							return STACK_EMPTY;
+
+						memcpy(cache.Free, cache.Released, cache.ReleasedCount * sizeof(uint32_t));
+						cache.FreeCount = cache.ReleasedCount;
+						cache.ReleasedCount = 0;
+					}
+
+					return cache.Free[--cache.FreeCount];
+				}
+
+				static void ReleaseEntry(uint32_t Index)
+				{
+					auto& cache = Cache;
+
+					cache.Released[cache.ReleasedCount++] = Index;
+					if (cache.ReleasedCount == CACHE_ENTRIES)
+					{
+						PushChain(cache.Released, cache.ReleasedCount);
+						cache.ReleasedCount = 0;
+					}
 				}
 			};
 
 			typedef IBSPointerHandleManager<uint32_t, BSUntypedPointerHandle_Original,
 				BSHandleRefObject_Original> BSPointerHandleManager_Original;
 			typedef IBSPointerHandleManager<uint64_t, BSUntypedPointerHandle_Extended_NG,
-				BSHandleRefObject_Extremly> BSPointerHandleManager_Extended_NG;
+				BSHandleRefObject_Extremly, false> BSPointerHandleManager_Extended_NG;
 			typedef IBSPointerHandleManager<uint64_t, BSUntypedPointerHandle_Extended,
 				BSHandleRefObject_64_Extremly> BSPointerHandleManager_Extended;
 
@@ -284,47 +538,34 @@ namespace CreationKitPlatformExtended
 					if (untypedHandle != Manager::NullHandle)
 						return untypedHandle;
 
-					// Wasn't present. Acquire lock and add it (unless someone else inserted it in the meantime)
-					Manager::HandleManagerLock.TryLockForWrite();
+					// Wasn't present. Lock this reference only and add it (unless someone else inserted it in the meantime)
+					SimpleLocker locker(&Manager::GetRefrLock(Refr));
+
+					untypedHandle = GetCurrentHandle(Refr);
+
+					if (untypedHandle == Manager::NullHandle)
 					{
-						untypedHandle = GetCurrentHandle(Refr);
+						auto handleIndex = Manager::AcquireEntry();
 
-						if (untypedHandle == Manager::NullHandle)
+						if (handleIndex == Manager::STACK_EMPTY)
 						{
-							if (Manager::FreeListHead == Manager::INVALID_INDEX)
-							{
-								untypedHandle.SetBitwiseNull();
-								AssertMsgVa(false, "OUT OF HANDLE ARRAY ENTRIES. Null handle created for pointer 0x%p.", Refr);
-							}
-							else
-							{
-								auto& newHandle = Manager::HandleEntries[Manager::FreeListHead];
-								newHandle.IncrementAge();
-								newHandle.SetInUse();
-
-								untypedHandle.Set(newHandle.GetNextFreeEntry(), newHandle.GetAge());
-								newHandle.SetPointer(Refr);
-
-								Refr->SetHandleEntryIndex(Manager::FreeListHead);
-								Assert(Refr->GetHandleEntryIndex() == Manager::FreeListHead);
-
-								if (newHandle.GetNextFreeEntry() == Manager::FreeListHead)
-								{
-									// Table reached the maximum count
-									Assert(Manager::FreeListHead == Manager::FreeListTail);
-
-									Manager::FreeListHead = Manager::INVALID_INDEX;
-									Manager::FreeListTail = Manager::INVALID_INDEX;
-								}
-								else
-								{
-									Assert(Manager::FreeListHead != Manager::FreeListTail);
-									Manager::FreeListHead = newHandle.GetNextFreeEntry();
-								}
-							}
+							untypedHandle.SetBitwiseNull();
+							AssertMsgVa(false, "OUT OF HANDLE ARRAY ENTRIES. Null handle created for pointer 0x%p.", Refr);
+						}
+						else
+						{
+							auto& newHandle = Manager::HandleEntries[handleIndex];
+							newHandle.IncrementAge();
+							// The pointer goes first, readers do not take the lock
+							newHandle.SetPointer(Refr);
+							newHandle.SetInUse();
+
+							untypedHandle.Set(handleIndex, newHandle.GetAge());
+
+							Refr->SetHandleEntryIndex(handleIndex);
+							Assert(Refr->GetHandleEntryIndex() == handleIndex);
 						}
 					}
-					Manager::HandleManagerLock.Unlock();
 
 					return untypedHandle;
 				}
@@ -334,27 +575,7 @@ namespace CreationKitPlatformExtended
 					if (Handle.IsBitwiseNull())
 						return;
 
-					Manager::HandleManagerLock.TryLockForWrite();
-					{
-						const auto handleIndex = Handle.GetIndex();
-						auto& arrayHandle = Manager::HandleEntries[handleIndex];
-
-						if (arrayHandle.IsValid(Handle.GetAge()))
-						{
-							arrayHandle.GetPointer()->ClearHandleEntryIndex();
-							arrayHandle.SetPointer(nullptr);
-							arrayHandle.SetNotInUse();
-
-							if (Manager::FreeListTail == Manager::INVALID_INDEX)
-								Manager::FreeListHead = handleIndex;
-							else
-								Manager::HandleEntries[Manager::FreeListTail].SetNextFreeEntry(handleIndex);
-
-							arrayHandle.SetNextFreeEntry(handleIndex);
-							Manager::FreeListTail = handleIndex;
-						}
-					}
-					Manager::HandleManagerLock.Unlock();
+					DestroyEntry(Handle);
 				}
 
 				static void Destroy2(HandleType& Handle)
@@ -362,30 +583,10 @@ namespace CreationKitPlatformExtended
 					if (Handle.IsBitwiseNull())
 						return;
 
-					Manager::HandleManagerLock.TryLockForWrite();
-					{
-						const auto handleIndex = Handle.GetIndex();
-						auto& arrayHandle = Manager::HandleEntries[handleIndex];
-
-						if (arrayHandle.IsValid(Handle.GetAge()))
-						{
-							arrayHandle.GetPointer()->ClearHandleEntryIndex();
-							arrayHandle.SetPointer(nullptr);
-							arrayHandle.SetNotInUse();
-
-							if (Manager::FreeListTail == Manager::INVALID_INDEX)
-								Manager::FreeListHead = handleIndex;
-							else
-								Manager::HandleEntries[Manager::FreeListTail].SetNextFreeEntry(handleIndex);
-
-							arrayHandle.SetNextFreeEntry(handleIndex);
-							Manager::FreeListTail = handleIndex;
-						}
+					DestroyEntry(Handle);
 
-						// Identical to Destroy1 except for this Handle.SetBitwiseNull();
-						Handle.SetBitwiseNull();
-					}
-					Manager::HandleManagerLock.Unlock();
+					// Identical to Destroy1 except for this Handle.SetBitwiseNull();
+					Handle.SetBitwiseNull();
 				}
 
 				static bool GetSmartPointer1(const HandleType& Handle, NiPointer<ObjectType>& Out)
@@ -397,8 +598,13 @@ namespace CreationKitPlatformExtended
 					}
 
 					const auto handleIndex = Handle.GetIndex();
-					auto& arrayHandle = Manager::HandleEntries[handleIndex];
+					if (!Manager::IsCommitted(handleIndex))
+					{
+						Out = nullptr;
+						return false;
+					}
 
+					auto& arrayHandle = Manager::HandleEntries[handleIndex];
 					Out = static_cast<ObjectType*>(arrayHandle.GetPointer());
 
 					if (!arrayHandle.IsValid(Handle.GetAge()) || Out->GetHandleEntryIndex() != handleIndex)
@@ -416,8 +622,14 @@ namespace CreationKitPlatformExtended
 					}
 
 					const auto handleIndex = Handle.GetIndex();
-					auto& arrayHandle = Manager::HandleEntries[handleIndex];
+					if (!Manager::IsCommitted(handleIndex))
+					{
+						Handle.SetBitwiseNull();
+						Out = nullptr;
+						return false;
+					}
 
+					auto& arrayHandle = Manager::HandleEntries[handleIndex];
 					Out = static_cast<ObjectType*>(arrayHandle.GetPointer());
 
 					if (!arrayHandle.IsValid(Handle.GetAge()) || Out->GetHandleEntryIndex() != handleIndex)
@@ -433,6 +645,9 @@ namespace CreationKitPlatformExtended
 				static ObjectType* GetPointer(uint32_t UniqueId)
 				{
 					const auto handleIndex = UniqueId & HandleType::MASK_INDEX_BIT;
+					if (!Manager::IsCommitted(handleIndex))
+						return nullptr;
+
 					auto& arrayHandle = Manager::HandleEntries[handleIndex];
 					auto Out = static_cast<ObjectType*>(arrayHandle.GetPointer());
 
@@ -445,6 +660,9 @@ namespace CreationKitPlatformExtended
 				static bool IsValid(const HandleType& Handle)
 				{
 					const auto handleIndex = Handle.GetIndex();
+					if (!Manager::IsCommitted(handleIndex))
+						return false;
+
 					auto& arrayHandle = Manager::HandleEntries[handleIndex];
 
 					// Handle.IsBitwiseNull(); -- This if() is optimized away because the result is irrelevant
@@ -454,6 +672,32 @@ namespace CreationKitPlatformExtended
 
 					return arrayHandle.GetPointer()->GetHandleEntryIndex() == handleIndex;
 				}
+			private:
+				static void DestroyEntry(const HandleType& Handle)
+				{
+					const auto handleIndex = Handle.GetIndex();
+					if (!Manager::IsCommitted(handleIndex))
+						return;
+
+					auto& arrayHandle = Manager::HandleEntries[handleIndex];
+					auto refr = arrayHandle.GetPointer();
+
+					if (!refr || !arrayHandle.IsValid(Handle.GetAge()))
+						return;
+
+					// The same lock CreateHandle takes for this reference, the entry is checked again under it
+					SimpleLocker locker(&Manager::GetRefrLock(refr));
+
+					if ((arrayHandle.GetPointer() == refr) && arrayHandle.IsValid(Handle.GetAge()))
+					{
+						refr->ClearHandleEntryIndex();
+						arrayHandle.SetNotInUse();
+						arrayHandle.SetNextFreeEntry(handleIndex);
+						arrayHandle.SetPointer(nullptr);
+
+						Manager::ReleaseEntry((uint32_t)handleIndex);
+					}
+				}
 			};
 
 			typedef IBSPointerHandleManagerInterface<TESObjectREFR_Original,
@@ -1,9 +1,11 @@
-// Copyright © 2023-2024 aka perchik71. All rights reserved.
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
 // Contacts: <email:timencevaleksej@gmail.com>
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
 #include "BSResourceArchive2.h"
 #include "NiAPI\NiMemoryManager.h"
+#include "Core\ArchiveNameSet.h"
+#include "Core\ArchiveDirectoryCache.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -17,73 +19,13 @@ namespace CreationKitPlatformExtended
 			{
 				uintptr_t pointer_Archive2_sub1 = 0;
 				uintptr_t pointer_Archive2_sub2 = 0;
-				Array<BSString*> g_arrayArchivesAvailable;
+				ArchiveNameSet g_archivesAvailable;
 				bool g_initCKPEPrimary = false;
 				std::mutex g_CKPEPrimary;
 
 				void Archive2::Initialize()
 				{
-					auto pathData = BSString::Utils::GetDataPath();
-
-					WIN32_FIND_DATA	FileFindData;
-					ZeroMemory(&FileFindData, sizeof(WIN32_FIND_DATA));
-					HANDLE hFindFile = FindFirstFileExA(*(pathData + "*.ba2"), FindExInfoStandard, &FileFindData,
-						FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
-					if (hFindFile != INVALID_HANDLE_VALUE)
-					{
-						do
-						{
-							g_arrayArchivesAvailable.push_back(new BSString(FileFindData.cFileName));
-						} while (FindNextFile(hFindFile, &FileFindData));
-					}
-
-					auto func = [](const String& svalue) {
-						BSString strName;
-
-						if (svalue.length() > 0) {
-							LPSTR s_c = new CHAR[svalue.length() + 1];
-							strcpy(s_c, svalue.c_str());
-
-							LPSTR stoken = strtok(s_c, ",");
-							if (stoken) {
-								do {
-									auto index = g_arrayArchivesAvailable.begin();
-									auto fname = Utils::Trim(stoken);
-
-									for (; index != g_arrayArchivesAvailable.end(); index++)
-									{
-										if (!_stricmp(fname.c_str(), (*index)->c_str()))
-											break;
-									}
-
-									if (index != g_arrayArchivesAvailable.end()) {
-										delete* index;
-										g_arrayArchivesAvailable.erase(index);
-									}
-
-									stoken = strtok(NULL, ",");
-								} while (stoken);
-							}
-
-							delete[] s_c;
-						}
-					};
-
-					static const char* SC_NONE = "<NONE>";
-
-					INIConfig _conf("CreationKit.ini");
-					INIConfig _User_conf("CreationKitCustom.ini");
-
-					auto s = _User_conf.ReadString("Archive", "sResourceArchiveList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceArchiveList2", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveList2", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceArchiveMemoryCacheList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveMemoryCacheList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceStartUpArchiveList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceStartUpArchiveList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceIndexFileList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceIndexFileList", "") : s);
+					g_archivesAvailable.Initialize(*BSString::Utils::GetDataPath(), "*.ba2");
 				}
 
 				void Archive2::GetFileSizeStr(uint64_t fileSize, BSString& fileSizeStr)
@@ -106,13 +48,11 @@ namespace CreationKitPlatformExtended
 
 					BSString filePath, fileSizeStr;
 					filePath.Format("%s%s%s", resFile->AppPath->Get<CHAR>(true), resFile->DataPath->Get<CHAR>(true), fileName);
-					AssertMsgVa(BSString::Utils::FileExists(filePath), "Can't found file %s", *filePath);
 
+					// Waits only for a read-ahead that is already running, the archive itself is not read here
 					uint64_t fileSize = 0;
-					WIN32_FILE_ATTRIBUTE_DATA fileData;
-					ZeroMemory(&fileData, sizeof(WIN32_FILE_ATTRIBUTE_DATA));
-					if (GetFileAttributesExA(*filePath, GetFileExInfoStandard, &fileData))
-						fileSize = (uint64_t)fileData.nFileSizeLow | ((uint64_t)fileData.nFileSizeHigh << 32);
+					bool fileFound = ArchiveDirectoryCache::Attach(*filePath, fileSize);
+					AssertMsgVa(fileFound, "Can't found file %s", *filePath);
 
 					auto resultNo = EC_NONE;
 
@@ -139,13 +79,11 @@ namespace CreationKitPlatformExtended
 
 					BSString filePath, fileSizeStr;
 					filePath.Format("%s%s%s", BSString::Utils::GetApplicationPath().c_str(), "Data\\", fileName2);
-					AssertMsgVa(BSString::Utils::FileExists(filePath), "Can't found file %s", *filePath);
 
+					// Waits only for a read-ahead that is already running, the archive itself is not read here
 					uint64_t fileSize = 0;
-					WIN32_FILE_ATTRIBUTE_DATA fileData;
-					ZeroMemory(&fileData, sizeof(WIN32_FILE_ATTRIBUTE_DATA));
-					if (GetFileAttributesExA(*filePath, GetFileExInfoStandard, &fileData))
-						fileSize = (uint64_t)fileData.nFileSizeLow | ((uint64_t)fileData.nFileSizeHigh << 32);
+					bool fileFound = ArchiveDirectoryCache::Attach(*filePath, fileSize);
+					AssertMsgVa(fileFound, "Can't found file %s", *filePath);
 
 					auto resultNo = EC_NONE;
 
@@ -172,14 +110,7 @@ namespace CreationKitPlatformExtended
 
 				bool Archive2::IsAvailableForLoad(const char* fileName)
 				{
-					for (auto it = g_arrayArchivesAvailable.begin();
-						 it != g_arrayArchivesAvailable.end(); it++)
-					{
-						if (!(*it)->Compare(fileName))
-							return true;
-					}
-
-					return false;
+					return g_archivesAvailable.Contains(fileName);
 				}
 
 				void Archive2::LoadPrimaryArchive()
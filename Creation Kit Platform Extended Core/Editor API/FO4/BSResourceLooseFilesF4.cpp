@@ -4,6 +4,7 @@
 
 #include "..\BSString.h"
 #include "BSResourceLooseFilesF4.h"
+#include "Core\DataDirectoryIndex.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -28,10 +29,24 @@ namespace CreationKitPlatformExtended
 					dw64Position = 0;
 
 					auto path = BSString::Utils::GetApplicationPath() + FileName;
-					if (BSString::Utils::FileExists(path))
-						dw64FileSize = std::filesystem::file_size(*path);
-					else
+
+					// Loose files under Data are answered by the index without touching the disk
+					Core::DataDirectoryIndex::FileInfo info;
+					switch (Core::DataDirectoryIndex::Query(*path, info))
+					{
+					case Core::DataDirectoryIndex::kFound:
+						dw64FileSize = (info.attributes & FILE_ATTRIBUTE_DIRECTORY) ? dwFileSize : info.size;
+						break;
+					case Core::DataDirectoryIndex::kMissing:
 						dw64FileSize = dwFileSize;
+						break;
+					default:
+						if (BSString::Utils::FileExists(path))
+							dw64FileSize = std::filesystem::file_size(*path);
+						else
+							dw64FileSize = dwFileSize;
+						break;
+					}
 				}
 			}
 		}
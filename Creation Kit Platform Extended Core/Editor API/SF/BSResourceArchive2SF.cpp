@@ -4,6 +4,7 @@
 
 #include "BSResourceArchive2SF.h"
 #include "NiAPI\NiMemoryManager.h"
+#include "Core\ArchiveNameSet.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -20,73 +21,13 @@ namespace CreationKitPlatformExtended
 				LocationTree* lpArchiveTree = nullptr;
 				uintptr_t pointer_Archive2_sub1 = 0;
 				uintptr_t pointer_Archive2_sub2 = 0;
-				Array<BSString*> g_arrayArchivesAvailable;
+				ArchiveNameSet g_archivesAvailable;
 				bool g_initCKPEPrimary = false;
 				std::mutex g_CKPEPrimary;
 
 				void Archive2::Initialize()
 				{
-					auto pathData = BSString::Utils::GetDataPath();
-
-					WIN32_FIND_DATA	FileFindData;
-					ZeroMemory(&FileFindData, sizeof(WIN32_FIND_DATA));
-					HANDLE hFindFile = FindFirstFileExA(*(pathData + "*.ba2"), FindExInfoStandard, &FileFindData,
-						FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
-					if (hFindFile != INVALID_HANDLE_VALUE)
-					{
-						do
-						{
-							g_arrayArchivesAvailable.push_back(new BSString(FileFindData.cFileName));
-						} while (FindNextFile(hFindFile, &FileFindData));
-					}
-
-					auto func = [](const String& svalue) {
-						BSString strName;
-
-						if (svalue.length() > 0) {
-							LPSTR s_c = new CHAR[svalue.length() + 1];
-							strcpy(s_c, svalue.c_str());
-
-							LPSTR stoken = strtok(s_c, ",");
-							if (stoken) {
-								do {
-									auto index = g_arrayArchivesAvailable.begin();
-									auto fname = Utils::Trim(stoken);
-
-									for (; index != g_arrayArchivesAvailable.end(); index++)
-									{
-										if (!_stricmp(fname.c_str(), (*index)->c_str()))
-											break;
-									}
-
-									if (index != g_arrayArchivesAvailable.end()) {
-										delete* index;
-										g_arrayArchivesAvailable.erase(index);
-									}
-
-									stoken = strtok(NULL, ",");
-								} while (stoken);
-							}
-
-							delete[] s_c;
-						}
-					};
-
-					static const char* SC_NONE = "<NONE>";
-
-					INIConfig _conf("CreationKit.ini");
-					INIConfig _User_conf("CreationKitCustom.ini");
-
-					auto s = _User_conf.ReadString("Archive", "sResourceArchiveList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceArchiveList2", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveList2", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceArchiveMemoryCacheList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveMemoryCacheList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceStartUpArchiveList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceStartUpArchiveList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceIndexFileList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceIndexFileList", "") : s);
+					g_archivesAvailable.Initialize(*BSString::Utils::GetDataPath(), "*.ba2");
 				}
 
 				void Archive2::GetFileSizeStr(uint64_t fileSize, BSString& fileSizeStr)
@@ -140,14 +81,7 @@ namespace CreationKitPlatformExtended
 
 				bool Archive2::IsAvailableForLoad(const char* fileName)
 				{
-					for (auto it = g_arrayArchivesAvailable.begin();
-						 it != g_arrayArchivesAvailable.end(); it++)
-					{
-						if (!(*it)->Compare(fileName))
-							return true;
-					}
-
-					return false;
+					return g_archivesAvailable.Contains(fileName);
 				}
 			}
 		}
@@ -33,7 +33,10 @@ namespace CreationKitPlatformExtended
 
 			const char* TESForm::GetFullName() const
 			{
-				TESFullName* fullname = (TESFullName*)_DYNAMIC_CAST(this, 0, "class TESForm", "class TESFullName");
+				static auto FromType = _RTTI_TYPE("class TESForm");
+				static auto TargetType = _RTTI_TYPE("class TESFullName");
+
+				TESFullName* fullname = (TESFullName*)_DYNAMIC_CAST(this, 0, FromType, TargetType);
 				return fullname ? fullname->Name : "";
 			}
 
@@ -104,7 +104,7 @@ namespace CreationKitPlatformExtended
 					if (f)
 					{
 						Utils::ScopeFileStream Stream(f);
-						fwrite(_Layers, 1, voltek::scalable_msize(_Layers), f);
+						fwrite(_Layers, 1, Core::GlobalMemoryManagerPtr->MemSize(_Layers), f);
 					}
 				}
 			private:
@@ -4,6 +4,7 @@
 #include <Zydis/Zydis.h>
 #include "Core/Engine.h"
 #include "Core/Relocator.h"
+#include "Core/PatternScanner.h"
 #include "RuntimeOptimization.h"
 #include "Editor API/EditorUI.h"
 
@@ -11,6 +12,14 @@ namespace CreationKitPlatformExtended
 {
 	namespace Experimental
 	{
+		static const char* PatternMemInit = "83 3D ? ? ? ? 02 74 13 48 8D 15 ? ? ? ? 48 8D 0D ? ? ? ? E8";
+		static const char* PatternLinkedList = "48 89 4C 24 08 48 83 EC 18 48 8B 44 24 20 48 83 78 08 00 75 14"
+			" 48 8B 44 24 20 48 83 38 00 75 09 C7 04 24 01 00 00 00 EB 07 C7 04 24 00 00 00 00"
+			" 0F B6 04 24 48 83 C4 18 C3";
+		static const char* PatternTemplatedFormIterator = "E8 ? ? ? ? 48 89 44 24 30 48 8B 44 24 30 48 89 44 24 38"
+			" 48 8B 54 24 38 48 8D 4C 24 28";
+		static const char* PatternHasPointer = "48 8B 11 0F B6 C2 F6 D0 A8 01 74 ? 48 85 D2 74 ? 32 C0 C3 B0 01 C3";
+
 		void RunOptimizations()
 		{
 			auto Patch = Core::GlobalRelocationDatabasePtr->GetByName("Runtime Optimization");
@@ -31,13 +40,23 @@ namespace CreationKitPlatformExtended
 			using namespace std::chrono;
 			auto timerStart = high_resolution_clock::now();
 
-			if (Patch->Version() == 1)
+			// Все сигнатуры ищутся за один проход по .text, патчи ниже не затрагивают байты чужих сигнатур
+			Core::PatternScanner Scanner;
+			auto Version = Patch->Version();
+			auto IdMemInit = Scanner.Add(PatternMemInit);
+			auto IdLinkedList = (Version == 1) ? Scanner.Add(PatternLinkedList) : Core::PatternScanner::INVALID_ID;
+			auto IdTemplatedFormIterator = (Version == 1) ? Scanner.Add(PatternTemplatedFormIterator) : 
+				Core::PatternScanner::INVALID_ID;
+			auto IdHasPointer = (Version == 3) ? Scanner.Add(PatternHasPointer) : Core::PatternScanner::INVALID_ID;
+			Scanner.Scan(textSection.base, textSection.end - textSection.base, "RuntimeOptimization");
+
+			if (Version == 1)
 			{
 				std::array<uint64_t, 4> counts
 				{
-					PatchMemInit(),
-					PatchLinkedList(),
-					PatchTemplatedFormIterator(Patch),
+					PatchMemInit(Scanner.Get(IdMemInit)),
+					PatchLinkedList(Scanner.Get(IdLinkedList)),
+					PatchTemplatedFormIterator(Patch, Scanner.Get(IdTemplatedFormIterator)),
 					PatchEditAndContinue(Patch),
 				};
 
@@ -45,11 +64,11 @@ namespace CreationKitPlatformExtended
 				_CONSOLE("%s: (%llu + %llu + %llu + %llu) = %llu patches applied in %llums.\n", __FUNCTION__,
 					counts[0], counts[1], counts[2], counts[3], counts[0] + counts[1] + counts[2] + counts[3], duration);
 			}
-			else if (Patch->Version() == 2)
+			else if (Version == 2)
 			{
 				std::array<uint64_t, 2> counts
 				{
-					PatchMemInit(),
+					PatchMemInit(Scanner.Get(IdMemInit)),
 					PatchEditAndContinue(Patch),
 				};
 
@@ -57,12 +76,12 @@ namespace CreationKitPlatformExtended
 				_CONSOLE("%s: (%llu + %llu) = %llu patches applied in %llums.\n", __FUNCTION__,
 					counts[0], counts[1], counts[0] + counts[1], duration);
 			}
-			else if (Patch->Version() == 3)
+			else if (Version == 3)
 			{
 				std::array<uint64_t, 3> counts
 				{
-					PatchMemInit(),
-					Starfield::PatchHasPointer(),
+					PatchMemInit(Scanner.Get(IdMemInit)),
+					Starfield::PatchHasPointer(Scanner.Get(IdHasPointer)),
 					PatchEditAndContinue(Patch),
 				};
 
@@ -167,7 +186,7 @@ namespace CreationKitPlatformExtended
 			return patchCount;
 		}
 
-		uint64_t PatchMemInit()
+		uint64_t PatchMemInit(const Core::PatternScanner::Matches& matches)
 		{
 			//
 			// Remove the thousands of [code below] since they're useless checks:
@@ -175,17 +194,13 @@ namespace CreationKitPlatformExtended
 			// if ( dword_141ED6C88 != 2 ) // MemoryManager initialized flag
 			//     sub_140C00D30((__int64)&unk_141ED6800, &dword_141ED6C88);
 			//
-			auto Sec = Core::GlobalEnginePtr->GetSection(Core::SECTION_TEXT);
-			auto matches = voltek::find_patterns(Sec.base, Sec.end - Sec.base,
-				"83 3D ? ? ? ? 02 74 13 48 8D 15 ? ? ? ? 48 8D 0D ? ? ? ? E8");
-
 			for (uintptr_t match : matches)
 				memcpy((void*)match, "\xEB\x1A", 2);
 
 			return matches.size();
 		}
 
-		uint64_t PatchLinkedList()
+		uint64_t PatchLinkedList(const Core::PatternScanner::Matches& matches)
 		{
 			//
 			// Optimize a linked list HasValue<T>() hot-code-path function. Checks if the 16-byte structure
@@ -195,12 +210,6 @@ namespace CreationKitPlatformExtended
 			__cpuid(cpuinfo, 1);
 
 			const bool hasSSE41 = Core::GlobalEnginePtr->HasSSE41();
-			const char* pattern = "48 89 4C 24 08 48 83 EC 18 48 8B 44 24 20 48 83 78 08 00 75 14"
-				" 48 8B 44 24 20 48 83 38 00 75 09 C7 04 24 01 00 00 00 EB 07 C7 04 24 00 00 00 00"
-				" 0F B6 04 24 48 83 C4 18 C3";
-
-			auto Sec = Core::GlobalEnginePtr->GetSection(Core::SECTION_TEXT);
-			auto matches = voltek::find_patterns(Sec.base, Sec.end - Sec.base, pattern);
 
 			for (uintptr_t match : matches)
 			{
@@ -213,7 +222,8 @@ namespace CreationKitPlatformExtended
 			return matches.size();
 		}
 
-		uint64_t PatchTemplatedFormIterator(SmartPointer<Core::RelocationDatabaseItem> patch)
+		uint64_t PatchTemplatedFormIterator(SmartPointer<Core::RelocationDatabaseItem> patch,
+			const Core::PatternScanner::Matches& matches)
 		{
 			//
 			// Add a callback that sets a global variable indicating UI dropdown menu entries can be
@@ -224,10 +234,7 @@ namespace CreationKitPlatformExtended
 			// a non-issue as long as ctor/dtor calls are balanced.
 			//
 			uint64_t patchCount = 0;
-			const char* pattern = "E8 ? ? ? ? 48 89 44 24 30 48 8B 44 24 30 48 89 44 24 38 48 8B 54 24 38 48 8D 4C 24 28";
-
 			auto Sec = Core::GlobalEnginePtr->GetSection(Core::SECTION_TEXT);
-			auto matches = voltek::find_patterns(Sec.base, Sec.end - Sec.base, pattern);
 
 			for (uintptr_t addr : matches)
 			{
@@ -376,13 +383,8 @@ namespace CreationKitPlatformExtended
 
 		namespace Starfield
 		{
-			uint64_t PatchHasPointer()
+			uint64_t PatchHasPointer(const Core::PatternScanner::Matches& matches)
 			{
-				const char* pattern = "48 8B 11 0F B6 C2 F6 D0 A8 01 74 ? 48 85 D2 74 ? 32 C0 C3 B0 01 C3";
-
-				auto Sec = Core::GlobalEnginePtr->GetSection(Core::SECTION_TEXT);
-				auto matches = voltek::find_patterns(Sec.base, Sec.end - Sec.base, pattern);
-
 				for (uintptr_t match : matches)
 					memcpy((void*)match, "\x48\x8B\x11\x48\xD1\xEA\x74\x04\x0F\x92\xC0\xC3\xB0\x01\xC3\xCC", 16);
 					//memcpy((void*)match, "\xB0\x01\x48\x83\x39\x00\x74\x02\x22\x01\xC3\xCC", 12);
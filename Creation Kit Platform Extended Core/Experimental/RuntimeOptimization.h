@@ -6,6 +6,7 @@
 #include "Core/Engine.h"
 #include "Core/Relocator.h"
 #include "Core/RelocationDatabase.h"
+#include "Core/PatternScanner.h"
 
 namespace CreationKitPlatformExtended
 {
@@ -21,16 +22,17 @@ namespace CreationKitPlatformExtended
 		void RunOptimizations();
 
 		uint64_t PatchEditAndContinue(SmartPointer<Core::RelocationDatabaseItem> patch);
-		uint64_t PatchMemInit();
-		uint64_t PatchLinkedList();
-		uint64_t PatchTemplatedFormIterator(SmartPointer<Core::RelocationDatabaseItem> patch);
+		uint64_t PatchMemInit(const Core::PatternScanner::Matches& matches);
+		uint64_t PatchLinkedList(const Core::PatternScanner::Matches& matches);
+		uint64_t PatchTemplatedFormIterator(SmartPointer<Core::RelocationDatabaseItem> patch,
+			const Core::PatternScanner::Matches& matches);
 
 		const NullsubPatch* FindNullsubPatch(uintptr_t SourceAddress, uintptr_t TargetFunction);
 		bool PatchNullsub(uintptr_t SourceAddress, uintptr_t TargetFunction, const NullsubPatch* Patch = nullptr);
 
 		namespace Starfield
 		{
-			uint64_t PatchHasPointer();
+			uint64_t PatchHasPointer(const Core::PatternScanner::Matches& matches);
 		}
 	}
 }
\ No newline at end of file
@@ -78,10 +78,10 @@ namespace CreationKitPlatformExtended
 				return m_pObject == nullptr;
 			}
 
-			template<typename T>
-			inline T* GetPtr() const
+			template<typename _Ty>
+			inline _Ty* GetPtr() const
 			{
-				return (T*)m_pObject;
+				return (_Ty*)m_pObject;
 			}
 		};
 		static_assert(sizeof(NiPointer<NiRefObject>) == 0x8);
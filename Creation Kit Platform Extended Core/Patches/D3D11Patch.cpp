@@ -4,6 +4,7 @@
 
 #include "Core/Engine.h"
 #include "Core/D3D11Proxy.h"
+#include "Core/PatternScanner.h"
 #include "D3D11Patch.h"
 
 namespace CreationKitPlatformExtended
@@ -69,7 +70,11 @@ namespace CreationKitPlatformExtended
 			if (lpRelocationDatabaseItem->Version() == 1)
 			{
 				auto Section = GlobalEnginePtr->GetSection(SECTION_TEXT);
-				auto Patterns = voltek::find_patterns(Section.base, Section.end - Section.base, "81 ? ? ? ? ? 00 B0 00 00");
+
+				PatternScanner Scanner;
+				auto IdLevelCheck = Scanner.Add("81 ? ? ? ? ? 00 B0 00 00");
+				Scanner.Scan(Section.base, Section.end - Section.base);
+				auto& Patterns = Scanner.Get(IdLevelCheck);
 
 				if (Patterns.size() != 1)
 				{
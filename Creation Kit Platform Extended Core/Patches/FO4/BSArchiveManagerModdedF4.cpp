@@ -3,8 +3,11 @@
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
 #include "Core/Engine.h"
+#include "Core/ArchiveDirectoryCache.h"
+#include "Core/RecordPrefetcher.h"
 #include "Editor API/EditorUI.h"
 #include "Editor API/FO4/TESFileF4.h"
+#include "Editor API/FO4/TESDataHandler.h"
 #include "Editor API/FO4/BSResourceArchive2.h"
 #include "BSArchiveManagerModdedF4.h"
 
@@ -31,6 +34,7 @@ namespace CreationKitPlatformExtended
 			Array<const TESFile*> g_SelectedFilesArray;
 			uintptr_t pointer_BSArchiveManagerModded_sub = 0;
 			bool IsLoaded;
+			bool g_archivesPrefetched = false;
 			uint8_t supportedBA2Version = 8;
 
 			static constexpr char szArchiveList[] = "Fallout4 - Voices1.ba2, Fallout4 - Voices2.ba2, Fallout4 - Meshes.ba2, Fallout4 - Animations.ba2, Fallout4 - Interface.ba2, Fallout4 - Misc.ba2, Fallout4 - Sounds.ba2";
@@ -140,9 +144,48 @@ namespace CreationKitPlatformExtended
 				EditorAPI::Fallout4::BSResource::Archive2::LoadArchive(_filename);
 			}
 
+			void BSArchiveManagerModdedPatch::PrefetchArchives()
+			{
+				// Список отмеченных файлов уже известен, архивы всех файлов читаются заранее рабочими потоками,
+				// а подключение ждёт только архив, за который поток уже взялся
+				if (!TESDataHandler::Singleton.HasSingleton())
+					return;
+
+				auto dataHandler = TESDataHandler::Singleton.Singleton;
+
+				auto dataPath = BSString::Utils::GetDataPath();
+				Array<String> fileNames;
+
+				for (auto it = dataHandler->GetMods()->Begin(); !it.End(); ++it)
+				{
+					auto file = it.Get();
+					if (!file || !file->IsSelected())
+						continue;
+
+					auto sname = file->GetFileName();
+					sname.Copy(0, sname.FindLastOf('.'));
+
+					for (auto suffix : { " - Main.ba2", " - Textures.ba2" })
+					{
+						auto archiveName = sname + suffix;
+						if (EditorAPI::Fallout4::BSResource::Archive2::IsAvailableForLoad(*archiveName))
+							fileNames.push_back(*(dataPath + archiveName));
+					}
+				}
+
+				ArchiveDirectoryCache::Prefetch(fileNames);
+			}
+
 			void BSArchiveManagerModdedPatch::LoadTesFile(const TESFile* load_file)
 			{
 				IsLoaded = false;
+
+				if (!g_archivesPrefetched)
+				{
+					g_archivesPrefetched = true;
+					PrefetchArchives();
+				}
+
 				// Sometimes duplicated
 				if (std::find(g_SelectedFilesArray.begin(), g_SelectedFilesArray.end(), load_file) ==
 					g_SelectedFilesArray.end()) 
@@ -170,6 +213,11 @@ namespace CreationKitPlatformExtended
 			{
 				EditorUI::HKSendMessageA(hWnd, uMsg, lParam, wParam);
 				g_SelectedFilesArray.clear();
+				// Загрузка закончена, последний плагин больше не читается
+				RecordPrefetcher::Close();
+				g_archivesPrefetched = false;
+				ArchiveDirectoryCache::CancelPrefetch();
+				ArchiveDirectoryCache::Save();
 				IsLoaded = true;
 			}
 		}
@@ -35,6 +35,7 @@ namespace CreationKitPlatformExtended
 				static void LoadTesFile(const TESFile* load_file);
 				static void LoadTesFileFinal(HWND hWnd, UINT uMsg, LPARAM lParam, WPARAM wParam);
 				static bool HasLoaded();
+				static void PrefetchArchives();
 			protected:
 				virtual bool QueryFromPlatform(EDITOR_EXECUTABLE_TYPE eEditorCurrentVersion,
 					const char* lpcstrPlatformRuntimeVersion) const;
@@ -3,6 +3,7 @@
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
 #include "Core/Engine.h"
+#include "Core/DataDirectoryIndex.h"
 #include "BSResourceLooseFilesPatch.h"
 #include "Editor API/FO4/BSResourceLooseFilesF4.h"
 
@@ -154,6 +155,19 @@ namespace CreationKitPlatformExtended
 
 			bool BSResourceLooseFilesPatch::sub(const char* fileName, uint64_t& fileSize)
 			{
+				DataDirectoryIndex::FileInfo info;
+				switch (DataDirectoryIndex::Query(fileName, info))
+				{
+				case DataDirectoryIndex::kMissing:
+					return false;
+				case DataDirectoryIndex::kFound:
+					if ((info.attributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
+						return false;
+
+					fileSize = info.size;
+					return fileSize > 0;
+				}
+
 				WIN32_FILE_ATTRIBUTE_DATA fileData = { 0 };
 
 				if (GetFileAttributesExA(fileName, GetFileExInfoStandard, &fileData)) {
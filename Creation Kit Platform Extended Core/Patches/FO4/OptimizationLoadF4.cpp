@@ -3,6 +3,9 @@
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
 #include "Core/Engine.h"
+#include "Core/PatternScanner.h"
+#include "Core/RecordPrefetcher.h"
+#include "Core/ArraySearch.h"
 #include "OptimizationLoadF4.h"
 #include "Editor API/FO4/BSFile.h"
 
@@ -75,6 +78,7 @@ namespace CreationKitPlatformExtended
 					//
 					// - Eliminate millions of calls to update the statusbar, instead only updating to 250ms 
 					// - Replace old zlib decompression code with optimized libdeflate
+					// - Inflate compressed records of the plugin being loaded ahead of the loader
 					// - Skip remove failed forms (This function is more likely to result in CTD)
 					// - Increasing the read memory buffer to reduce disk access
 					// - (Optional) Removing animation export when loading the mod, it will cause CTD if animation is needed
@@ -124,92 +128,42 @@ namespace CreationKitPlatformExtended
 						}
 					}
 
-					// Without SIMD support, there is no pointand
-					if (_engine->HasSSE41())
+					// The widest SIMD variant available was chosen at startup
+					if (verPatch == 1)
 					{
-						if (verPatch == 1)
-						{
-							std::size_t count = 0;
-
-								auto Sec = _engine->GetSection(Core::SECTION_TEXT);
-
-								std::vector<uintptr_t>::iterator match;
-								std::vector<uintptr_t> matches = voltek::find_patterns(Sec.base, Sec.end - Sec.base,
-									"48 83 C5 08 41 3B FE 72 9F 48 8B 6C 24 50 8B C3 48 8B 5C 24 58 48 8B 74"
-									" 24 60 48 83 C4 30 41 5F 41 5E 5F C3 8B C3 EB E8");
-
-								std::for_each(match = matches.begin(), matches.end(), [&count](auto it)
-									{ voltek::detours_jump(it - 0x8A, (uintptr_t)&HKSearchIndex64); count++; });
-
-							matches = voltek::find_patterns(Sec.base, Sec.end - Sec.base,
-								"48 83 C5 08 41 3B FE 72 9F 48 8B 6C 24 58 48 8B 74 24 60 8B C3 48 8B 5C"
-								" 24 50 48 83 C4 30 41 5F 41 5E 5F C3");
-
-							std::for_each(match = matches.begin(), matches.end(), [&count](auto it)
-								{ voltek::detours_jump(it - 0x8D, (uintptr_t)&HKSearchIndexOffset64); count++; });
-
-							lpRelocator->DetourJump(lpRelocationDatabaseItem->At(5), (uintptr_t)&HKSearchIndex32);
-							lpRelocator->DetourJump(lpRelocationDatabaseItem->At(6), (uintptr_t)&HKSearchIndex32);
-							lpRelocator->DetourJump(lpRelocationDatabaseItem->At(7), (uintptr_t)&HKSearchIndex32);
-
-							class Search_IA128 : public Xbyak::CodeGenerator {
-							public:
-								Search_IA128(VOID) : Xbyak::CodeGenerator() {
-									mov(ptr[rsp + 0x10], rbx);
-									mov(ptr[rsp + 0x18], rsi);
-									push(rdi);
-									push(r14);
-									push(r15);
-									sub(rsp, 0x30);
-									mov(r14d, dword[rcx + 0x10]);
-									or_(ebx, 0xFFFFFFFF);
-									xor_(edi, edi);
-									mov(r15, rdx);
-									mov(rsi, rcx);
-									test(r14d, r14d);
-									je(".quit_no");
-									push(rbp);
-									mov(ebp, edi);
-									mov(rcx, qword[r15]);
-									mov(rdx, qword[rsi]);
-									L(".c1");
-									cmp(ebx, -1);
-									jne(".quit_yes");
-									cmp(qword[rdx + rbp], rcx);
-									cmove(ebx, edi);
-									inc(edi);
-									lea(rbp, qword[rbp + 0x10]);
-									cmp(edi, r14d);
-									jb(".c1");
-									L(".quit_yes");
-									pop(rbp);
-									L(".quit_no");
-									mov(eax, ebx);
-									mov(rbx, qword[rsp + 0x58]);
-									mov(rsi, qword[rsp + 0x60]);
-									add(rsp, 0x30);
-									pop(r15);
-									pop(r14);
-									pop(rdi);
-									ret();
-								}
-
-								static VOID Generate(uintptr_t Target) {
-									auto hook = new Search_IA128();
-									GlobalRelocatorPtr->DetourJump(Target, (uintptr_t)hook->getCode());
-								}
-
-							};
-
-							Search_IA128::Generate(_RELDATA_RAV(8));
-							Search_IA128::Generate(_RELDATA_RAV(9));
-							Search_IA128::Generate(_RELDATA_RAV(10));
-							Search_IA128::Generate(_RELDATA_RAV(11));
-
-							count += 3;
-
-							_MESSAGE("Replaced function with SIMD function: %d.", count);
-						}
+						std::size_t count = 0;
+
+						auto Sec = _engine->GetSection(Core::SECTION_TEXT);
+
+						// Обе сигнатуры за один проход по .text
+						Core::PatternScanner Scanner;
+						auto IdSearchIndex = Scanner.Add("48 83 C5 08 41 3B FE 72 9F 48 8B 6C 24 50 8B C3 48 8B 5C 24 58 48 8B 74"
+							" 24 60 48 83 C4 30 41 5F 41 5E 5F C3 8B C3 EB E8");
+						auto IdSearchIndexOffset = Scanner.Add("48 83 C5 08 41 3B FE 72 9F 48 8B 6C 24 58 48 8B 74 24 60 8B C3 48 8B 5C"
+							" 24 50 48 83 C4 30 41 5F 41 5E 5F C3");
+						Scanner.Scan(Sec.base, Sec.end - Sec.base, "OptimizationLoad");
+
+						auto& matches = Scanner.Get(IdSearchIndex);
+						std::for_each(matches.begin(), matches.end(), [&count](auto it)
+							{ voltek::detours_jump(it - 0x8A, (uintptr_t)&HKSearchIndex64); count++; });
+
+						auto& matchesOffset = Scanner.Get(IdSearchIndexOffset);
+						std::for_each(matchesOffset.begin(), matchesOffset.end(), [&count](auto it)
+							{ voltek::detours_jump(it - 0x8D, (uintptr_t)&HKSearchIndexOffset64); count++; });
+
+						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(5), (uintptr_t)&HKSearchIndex32);
+						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(6), (uintptr_t)&HKSearchIndex32);
+						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(7), (uintptr_t)&HKSearchIndex32);
+
+						// Поиск по первому слову 16-байтовых элементов
+						lpRelocator->DetourJump(_RELDATA_RAV(8), (uintptr_t)&HKSearchKey128);
+						lpRelocator->DetourJump(_RELDATA_RAV(9), (uintptr_t)&HKSearchKey128);
+						lpRelocator->DetourJump(_RELDATA_RAV(10), (uintptr_t)&HKSearchKey128);
+						lpRelocator->DetourJump(_RELDATA_RAV(11), (uintptr_t)&HKSearchKey128);
+
+						count += 3;
+
+						_MESSAGE("Replaced function with SIMD function (%s): %d.", ArraySearch::GetVariantName(), count);
 					}
 
 					return true;
@@ -249,11 +203,14 @@ namespace CreationKitPlatformExtended
 
 			int OptimizationLoadPatch::HKInflate(z_stream_s* Stream, int Flush)
 			{
-				size_t outBytes = 0;
-				libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+				size_t inBytes = 0, outBytes = 0;
+				libdeflate_result result = LIBDEFLATE_BAD_DATA;
 
-				libdeflate_result result = libdeflate_zlib_decompress(decompressor, Stream->next_in, Stream->avail_in, Stream->next_out, Stream->avail_out, &outBytes);
-				libdeflate_free_decompressor(decompressor);
+				// Запись могла быть распакована заранее
+				if (!RecordPrefetcher::Inflate(Stream->next_in, Stream->avail_in,
+						Stream->next_out, Stream->avail_out, result, outBytes))
+					result = Decompressor::Zlib(Stream->next_in, Stream->avail_in,
+						Stream->next_out, Stream->avail_out, &inBytes, &outBytes);
 
 				if (result == LIBDEFLATE_SUCCESS)
 				{
@@ -280,134 +237,32 @@ namespace CreationKitPlatformExtended
 			uint32_t OptimizationLoadPatch::HKSearchIndexOffset32(EditorAPI::BSTArray<uint32_t>& _array,
 				uint32_t& _target, uint32_t _start_index)
 			{
-				uint32_t index = _start_index;
 				const uint32_t size_array = _array.QSize();
-
 				if (size_array <= _start_index)
 					return INVALID_INDEX;
 
-				uint32_t* data = (uint32_t*)_array.QBuffer() + index;
-
-				if ((size_array - _start_index) < 50) 
-				{
-					for (; index < size_array; index++) 
-					{
-						if (data[index] == _target)
-							return index;
-					}
-
-					return INVALID_INDEX;
-				}
-
-				uint32_t res = INVALID_INDEX;
+				auto index = ArraySearch::Find32((const uint32_t*)_array.QBuffer() + _start_index,
+					size_array - _start_index, _target);
 
-				//
-				// Compare 16 indexes per iteration - use SIMD instructions to generate a bit mask. Set
-				// bit 0 if 'array[i + 0]'=='target', set bit 1 if 'array[i + 1]'=='target', set bit X...
-				const uint32_t comparesPerIter = 16;
-				const uint32_t vectorizedIterations = (size_array - index) / comparesPerIter;
-
-				uint32_t bsr_v;
-				uint32_t mask;
-				std::size_t iter = 0;
-				uint32_t* array_p = (uint32_t*)(data + index);
-
-				__m128i* ebp = (__m128i*)array_p;
-				const auto target = _mm_set_epi32(_target, _target, _target, _target);
-
-				for (; iter < vectorizedIterations; ebp += 4, iter++) {
-					if ((mask = (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(target, _mm_loadu_si128(ebp))))) |
-						((_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(target, _mm_loadu_si128(ebp + 1))))) << 4) |
-						((_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(target, _mm_loadu_si128(ebp + 2))))) << 8) |
-						((_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(target, _mm_loadu_si128(ebp + 3))))) << 12))) {
-						_BitScanForward((unsigned long*)&bsr_v, mask);
-
-						index += comparesPerIter * (uint32_t)iter;
-
-						return index + bsr_v;
-					}
-				}
-
-				index += comparesPerIter * (uint32_t)iter;
-
-				// Scan the rest 1-by-1
-				for (; index < size_array; index++) 
-				{
-					if (data[index] == _target) 
-					{
-						res = index;
-						break;
-					}
-				}
-
-				return res;
+				return (index == INVALID_INDEX) ? index : index + _start_index;
 			}
 
 			uint32_t OptimizationLoadPatch::HKSearchIndexOffset64(EditorAPI::BSTArray<uint64_t>& _array,
 				uint64_t& _target, uint32_t _start_index)
 			{
-				uint32_t index = _start_index;
 				const uint32_t size_array = _array.QSize();
-
 				if (size_array <= _start_index)
 					return INVALID_INDEX;
 
-				uint64_t* data = (uint64_t*)_array.QBuffer() + index;
-				if ((size_array - _start_index) < 50) 
-				{
-					for (; index < size_array; index++) 
-					{
-						if (data[index] == _target)
-							return index;
-					}
+				auto index = ArraySearch::Find64((const uint64_t*)_array.QBuffer() + _start_index,
+					size_array - _start_index, _target);
 
-					return INVALID_INDEX;
-				}
-
-				uint32_t res = INVALID_INDEX;
-
-				//
-				// Compare 16 pointers per iteration - use SIMD instructions to generate a bit mask. Set
-				// bit 0 if 'array[i + 0]'=='target', set bit 1 if 'array[i + 1]'=='target', set bit X...
-				const uint32_t comparesPerIter = 16;
-				const uint32_t vectorizedIterations = (size_array - index) / comparesPerIter;
-				uint64_t* array_p = (uint64_t*)(data + index);
-				uint32_t bsr_v;
-				uint64_t mask;
-				std::size_t iter = 0;
-
-				__m128i* ebp = (__m128i*)array_p;
-				const __m128i target = _mm_set_epi64x(_target, _target);
-
-				for (; iter < vectorizedIterations; ebp += 8, iter++) {
-					if ((mask = ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp))))) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 1))))) << 2) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 2))))) << 4) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 3))))) << 6) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 4))))) << 8) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 5))))) << 10) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 6))))) << 12) |
-						(((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(target, _mm_loadu_si128(ebp + 7))))) << 14))) {
-						_BitScanForward64((unsigned long*)&bsr_v, mask);
-						index += comparesPerIter * (uint32_t)iter;
-
-						return index + bsr_v;
-					}
-				}
-
-				index += comparesPerIter * (uint32_t)iter;
-
-				// Scan the rest 1-by-1
-				for (; index < size_array; index++) 
-				{
-					if (data[index] == _target) 
-					{
-						res = index;
-						break;
-					}
-				}
+				return (index == INVALID_INDEX) ? index : index + _start_index;
+			}
 
-				return res;
+			uint32_t OptimizationLoadPatch::HKSearchKey128(EditorAPI::BSTArray<Entry128>& _array, uint64_t& _target)
+			{
+				return ArraySearch::FindKey128(_array.QBuffer(), _array.QSize(), _target);
 			}
 		}
 	}
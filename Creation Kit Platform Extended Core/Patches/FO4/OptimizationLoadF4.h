@@ -60,6 +60,13 @@ namespace CreationKitPlatformExtended
 				{
 					return HKSearchIndexOffset64(_array, _target, 0);
 				}
+				// Элемент из ключа и значения, ищется по ключу
+				struct Entry128
+				{
+					uint64_t key;
+					uint64_t value;
+				};
+				static uint32_t HKSearchKey128(EditorAPI::BSTArray<Entry128>& _array, uint64_t& _target);
 			protected:
 				virtual bool QueryFromPlatform(EDITOR_EXECUTABLE_TYPE eEditorCurrentVersion,
 					const char* lpcstrPlatformRuntimeVersion) const;
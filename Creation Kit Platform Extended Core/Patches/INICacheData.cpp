@@ -18,10 +18,398 @@ namespace CreationKitPlatformExtended
 			}
 		};
 
+		// Неизменяемый индекс ini файла для чтения.
+		// Все имена и значения лежат в одном буфере, поиск по (секция, ключ) идёт по плоской хеш-таблице
+		// без учёта регистра и ничего не копирует. Значения уже очищены так, как их отдаёт GetPrivateProfileString,
+		// а целочисленная форма разобрана заранее. Секции целиком (для запросов без ключа) тоже собраны заранее.
+		class INIIndex
+		{
+		public:
+			struct Value
+			{
+				std::string_view text;		// Без пробелов и кавычек по краям
+				std::string_view raw;		// Как лежит в файле
+				UINT number;				// Как отдаёт GetPrivateProfileInt
+			};
+
+			INIIndex(const mINI::INIStructure& data);
+
+			const Value* Find(const char* section, const char* key) const;
+			// "ключ=значение\n" для всех ключей секции
+			std::string_view FindSection(const char* section) const;
+			// "[секция]\nключ=значение\n" для всего файла
+			inline std::string_view GetAll() const { return _all; }
+
+			static std::string_view Clean(std::string_view s);
+			static UINT ParseNumber(std::string_view s);
+		private:
+			INIIndex(const INIIndex&) = delete;
+			INIIndex& operator=(const INIIndex&) = delete;
+
+			struct Span
+			{
+				size_t offset;
+				size_t length;
+			};
+
+			struct Entry
+			{
+				uint64_t hash;
+				Span section;
+				Span key;
+				Span text;
+				Span raw;
+				UINT number;
+			};
+
+			constexpr static uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+			static uint64_t Hash(uint64_t hash, const char* s, size_t length);
+			static uint64_t Hash(const char* section, const char* key);
+			inline std::string_view View(const Span& span) const { return { _buffer.data() + span.offset, span.length }; }
+			Span Intern(std::string_view s);
+
+			String _buffer;
+			Array<Entry> _entries;
+			Array<Value> _values;
+			Array<uint32_t> _slots;
+			Array<std::pair<Span, Span>> _sections;	// имя и текст секции
+			std::string_view _all;
+		};
+
+		INIIndex::INIIndex(const mINI::INIStructure& data)
+		{
+			// Один проход, чтобы знать размер буфера, виды строк берутся только после заполнения
+			size_t size = 0, count = 0;
+			for (auto& section : data)
+			{
+				size += (section.first.length() + 3) * 2;
+				for (auto& value : section.second)
+				{
+					size += (value.first.length() + value.second.length() + 2) * 3;
+					count++;
+				}
+			}
+
+			_buffer.reserve(size);
+			_entries.reserve(count);
+
+			Array<Span> sectionTexts;
+			sectionTexts.reserve(data.size());
+
+			for (auto& section : data)
+			{
+				auto sectionName = Intern(section.first);
+				auto begin = _buffer.length();
+
+				for (auto& value : section.second)
+				{
+					auto key = Intern(value.first);
+					_buffer.append("=");
+					auto raw = Intern(value.second);
+					_buffer.append("\n");
+
+					Entry entry = {};
+					entry.section = sectionName;
+					entry.key = key;
+					entry.raw = raw;
+					entry.hash = Hash(section.first.c_str(), value.first.c_str());
+					_entries.push_back(entry);
+				}
+
+				sectionTexts.push_back({ begin, _buffer.length() - begin });
+				_sections.push_back({ sectionName, {} });
+			}
+
+			// Весь файл, длина считается до последнего ключа, как это делал прежний код
+			auto allBegin = _buffer.length(), allEnd = allBegin;
+			for (size_t i = 0; i < _sections.size(); i++)
+			{
+				_buffer.append("[").append(View(_sections[i].first)).append("]\n");
+				if (sectionTexts[i].length)
+				{
+					_buffer.append(View(sectionTexts[i]));
+					allEnd = _buffer.length();
+				}
+			}
+
+			// Очищенные значения лежат внутри сырых, отдельно хранить не нужно
+			for (auto& entry : _entries)
+			{
+				auto raw = View(entry.raw);
+				auto text = Clean(raw);
+				entry.text = { entry.raw.offset + (size_t)(text.data() - raw.data()), text.length() };
+				entry.number = ParseNumber(text);
+			}
+
+			for (size_t i = 0; i < _sections.size(); i++)
+				_sections[i].second = sectionTexts[i];
+			_all = { _buffer.data() + allBegin, allEnd - allBegin };
+
+			_values.resize(_entries.size());
+			for (size_t i = 0; i < _entries.size(); i++)
+				_values[i] = { View(_entries[i].text), View(_entries[i].raw), _entries[i].number };
+
+			// Заполнение не больше половины
+			_slots.assign(std::bit_ceil(std::max(_entries.size() * 2, (size_t)16)), EMPTY_SLOT);
+			auto mask = _slots.size() - 1;
+			for (uint32_t i = 0; i < (uint32_t)_entries.size(); i++)
+			{
+				auto slot = _entries[i].hash & mask;
+				while (_slots[slot] != EMPTY_SLOT)
+					slot = (slot + 1) & mask;
+				_slots[slot] = i;
+			}
+		}
+
+		INIIndex::Span INIIndex::Intern(std::string_view s)
+		{
+			Span span = { _buffer.length(), s.length() };
+			_buffer.append(s);
+			return span;
+		}
+
+		uint64_t INIIndex::Hash(uint64_t hash, const char* s, size_t length)
+		{
+			// FNV-1a без учёта регистра
+			for (size_t i = 0; i < length; i++)
+				hash = (hash ^ (uint8_t)tolower((uint8_t)s[i])) * 0x100000001B3ull;
+			return hash;
+		}
+
+		uint64_t INIIndex::Hash(const char* section, const char* key)
+		{
+			auto hash = Hash(0xCBF29CE484222325ull, section, strlen(section));
+			hash = (hash ^ 0xFF) * 0x100000001B3ull;
+			return Hash(hash, key, strlen(key));
+		}
+
+		const INIIndex::Value* INIIndex::Find(const char* section, const char* key) const
+		{
+			auto hash = Hash(section, key);
+			auto mask = _slots.size() - 1;
+
+			for (auto slot = hash & mask; _slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask)
+			{
+				auto& entry = _entries[_slots[slot]];
+				if ((entry.hash == hash) &&
+					(entry.section.length == strlen(section)) && !_strnicmp(View(entry.section).data(), section, entry.section.length) &&
+					(entry.key.length == strlen(key)) && !_strnicmp(View(entry.key).data(), key, entry.key.length))
+					return &_values[_slots[slot]];
+			}
+
+			return nullptr;
+		}
+
+		std::string_view INIIndex::FindSection(const char* section) const
+		{
+			auto length = strlen(section);
+			for (auto& it : _sections)
+			{
+				if ((it.first.length == length) && !_strnicmp(View(it.first).data(), section, length))
+					return View(it.second);
+			}
+
+			return {};
+		}
+
+		std::string_view INIIndex::Clean(std::string_view s)
+		{
+			static const char* whitespace_delimiters = " \t\n\r\f\v";
+
+			auto begin = s.find_first_not_of(whitespace_delimiters);
+			if (begin == std::string_view::npos)
+				return {};
+
+			s = s.substr(begin, s.find_last_not_of(whitespace_delimiters) - begin + 1);
+
+			if (!s.empty() && (s.front() == '"')) s.remove_prefix(1);
+			if (!s.empty() && (s.back() == '"')) s.remove_suffix(1);
+
+			return s;
+		}
+
+		UINT INIIndex::ParseNumber(std::string_view s)
+		{
+			// Строка с '0' или 'x' в начале считается шестнадцатеричной после двух символов
+			char buffer[64];
+			auto length = std::min(s.length(), sizeof(buffer) - 1);
+			memcpy(buffer, s.data(), length);
+			buffer[length] = '\0';
+
+			char* end_ptr = nullptr;
+
+			if (length && ((buffer[0] == '0') || (buffer[0] == 'x')))
+				// hex
+				return (length >= 2) ? strtoul(buffer + 2, &end_ptr, 16) : 0;
+			else
+				// dec
+				return strtoul(buffer, &end_ptr, 10);
+		}
+
+		// Кеш одного файла: структура mINI для записи и индекс для чтения, который строится заново после записи
+		struct INICacheFile
+		{
+			mINI::INIStructure data;
+			SRWLOCK lock = SRWLOCK_INIT;
+			std::shared_ptr<const INIIndex> index;
+			std::atomic<bool> dirty = false;
+
+			std::shared_ptr<const INIIndex> GetIndex()
+			{
+				AcquireSRWLockShared(&lock);
+				auto result = index;
+				ReleaseSRWLockShared(&lock);
+
+				if (!result)
+				{
+					AcquireSRWLockExclusive(&lock);
+					if (!index)
+						index = std::make_shared<const INIIndex>(data);
+					result = index;
+					ReleaseSRWLockExclusive(&lock);
+				}
+
+				return result;
+			}
+		};
+
+		// Захватывает файл на запись и сбрасывает индекс, читатели со старым индексом дочитают его спокойно
+		class INICacheFileWriter
+		{
+		public:
+			INICacheFileWriter(INICacheFile* file) : _file(file)
+			{
+				AcquireSRWLockExclusive(&_file->lock);
+				_file->index.reset();
+			}
+
+			~INICacheFileWriter()
+			{
+				ReleaseSRWLockExclusive(&_file->lock);
+			}
+		private:
+			INICacheFileWriter(const INICacheFileWriter&) = delete;
+			INICacheFileWriter& operator=(const INICacheFileWriter&) = delete;
+
+			INICacheFile* _file;
+		};
+
 #if 0
 		HANDLE GlobalINICacheTriggerEvent = NULL;
 #endif
-		ConcurrencyMap<String, std::shared_ptr<mINI::INIStructure>, std::hash<String>, string_equal_to> GlobalINICache;
+		ConcurrencyMap<String, std::shared_ptr<INICacheFile>, std::hash<String>, string_equal_to> GlobalINICache;
+
+#ifdef _CKPE_WITH_QT5
+		// Отложенная запись на диск.
+		// Запись в ini только помечает файл, поток сбрасывает изменения, когда записи затихнут на FLUSH_DELAY_MS,
+		// но не позже FLUSH_MAX_DELAY_MS после первой из них. Файл пишется во временный рядом и подменяется целиком,
+		// так что на диске всегда лежит либо старая, либо новая версия. Flush() сбрасывает всё немедленно.
+		class INICacheFlusher
+		{
+		public:
+			constexpr static DWORD FLUSH_DELAY_MS = 250;
+			constexpr static DWORD FLUSH_MAX_DELAY_MS = 2000;
+
+			INICacheFlusher() = default;
+
+			void Notify();
+			void Flush();
+		private:
+			INICacheFlusher(const INICacheFlusher&) = delete;
+			INICacheFlusher& operator=(const INICacheFlusher&) = delete;
+
+			static DWORD WINAPI Worker(LPVOID lpArg);
+			static bool WriteToDisk(const String& sFileName, const mINI::INIStructure& data);
+
+			INIT_ONCE _started = INIT_ONCE_STATIC_INIT;
+			HANDLE _event = NULL;
+			SRWLOCK _flushLock = SRWLOCK_INIT;
+		};
+
+		void INICacheFlusher::Notify()
+		{
+			// Поток запускается при первой записи, а не при загрузке dll
+			InitOnceExecuteOnce(&_started, [](PINIT_ONCE, PVOID lpArg, PVOID*) -> BOOL
+				{
+					auto flusher = (INICacheFlusher*)lpArg;
+					flusher->_event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+					if (flusher->_event)
+						CloseHandle(CreateThread(nullptr, 0, Worker, flusher, 0, nullptr));
+					return TRUE;
+				}, this, nullptr);
+
+			if (_event)
+				SetEvent(_event);
+			else
+				Flush();
+		}
+
+		void INICacheFlusher::Flush()
+		{
+			// Один сброс за раз, поэтому версии одного файла ложатся на диск по порядку
+			AcquireSRWLockExclusive(&_flushLock);
+
+			for (auto it = GlobalINICache.begin(); it != GlobalINICache.end(); it++)
+			{
+				auto file = it->second;
+				if (!file || !file->dirty)
+					continue;
+
+				// Пометка снимается под замком, запись после снимка пометит файл снова
+				AcquireSRWLockShared(&file->lock);
+				file->dirty = false;
+				auto data = file->data;
+				ReleaseSRWLockShared(&file->lock);
+
+				if ((data.size() > 0) && !WriteToDisk(it->first, data))
+				{
+					_CONSOLE("INI Cache: Failed to write \"%s\"", it->first.c_str());
+					file->dirty = true;
+				}
+			}
+
+			ReleaseSRWLockExclusive(&_flushLock);
+		}
+
+		DWORD WINAPI INICacheFlusher::Worker(LPVOID lpArg)
+		{
+			auto flusher = (INICacheFlusher*)lpArg;
+
+			while (WaitForSingleObject(flusher->_event, INFINITE) == WAIT_OBJECT_0)
+			{
+				auto start = GetTickCount64();
+				while ((WaitForSingleObject(flusher->_event, FLUSH_DELAY_MS) == WAIT_OBJECT_0) &&
+					((GetTickCount64() - start) < FLUSH_MAX_DELAY_MS));
+
+				flusher->Flush();
+			}
+
+			return 0;
+		}
+
+		bool INICacheFlusher::WriteToDisk(const String& sFileName, const mINI::INIStructure& data)
+		{
+			// mINI сохраняет комментарии и порядок строк того файла, в который пишет,
+			// поэтому временный файл начинается с копии текущего
+			auto tempFileName = sFileName + ".ckpe.tmp";
+			auto exists = GetFileAttributesA(sFileName.c_str()) != INVALID_FILE_ATTRIBUTES;
+			if (exists && !CopyFileA(sFileName.c_str(), tempFileName.c_str(), FALSE))
+				return false;
+
+			mINI::INIFile file(tempFileName);
+			if (!file.write(data, false) ||
+				!MoveFileExA(tempFileName.c_str(), sFileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+			{
+				DeleteFileA(tempFileName.c_str());
+				return false;
+			}
+
+			return true;
+		}
+
+		INICacheFlusher GlobalINICacheFlusher;
+#endif // _CKPE_WITH_QT5
 
 		INICacheDataPatch::INICacheDataPatch() : Module(GlobalEnginePtr)
 		{
@@ -74,16 +462,22 @@ namespace CreationKitPlatformExtended
 			else
 			{
 #endif
+#ifdef _CKPE_WITH_QT5
+				// Изменения и так уходят на диск, осталось дописать то, что ещё ждёт.
+				// Кеш не очищается, поток записи может ходить по нему в этот момент
+				GlobalINICacheFlusher.Flush();
+#else
 				for (auto it = GlobalINICache.begin(); it != GlobalINICache.end(); it++)
 				{
-					if (it->second && (it->second->size() > 0))
+					if (it->second && (it->second->data.size() > 0))
 					{
 						mINI::INIFile file(it->first.c_str());
-						file.write(*(it->second), false);
+						file.write(it->second->data, false);
 					}
 				}
 
 				GlobalINICache.clear();
+#endif // _CKPE_WITH_QT5
 #if 0
 			}
 #endif
@@ -97,32 +491,12 @@ namespace CreationKitPlatformExtended
 				return (UINT)nDefault;
 
 			auto fileName = GetAbsoluteFileName(lpFileName);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(fileName);
-			if (!ini_data)
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(fileName);
+			if (!ini_file)
 				return GetPrivateProfileIntA(lpAppName, lpKeyName, nDefault, lpFileName);
 
-			String s;
-			auto ip = ini_data->get(lpAppName);
-			if (!ip.has(lpKeyName))
-				return (UINT)nDefault;
-			else
-				s = ip.get(lpKeyName);
-
-			static const char* whitespace_delimiters = " \t\n\r\f\v";
-			s.erase(s.find_last_not_of(whitespace_delimiters) + 1);
-			s.erase(0, s.find_first_not_of(whitespace_delimiters));
-
-			if (s[0] == '"') s.erase(0, 1);
-			if (s[s.length() - 1] == '"') s.resize(s.length() - 1);
-
-			char* end_ptr = nullptr;
-
-			if (s.find_first_of("0x") == 0)
-				// hex
-				return strtoul(s.c_str() + 2, &end_ptr, 16);
-			else
-				// dec
-				return strtoul(s.c_str(), &end_ptr, 10);
+			auto value = ini_file->GetIndex()->Find(lpAppName, lpKeyName);
+			return value ? value->number : (UINT)nDefault;
 		}
 
 		DWORD INICacheDataPatch::HKGetPrivateProfileStringA(LPCSTR lpAppName, LPCSTR lpKeyName, LPCSTR lpDefault,
@@ -134,61 +508,26 @@ namespace CreationKitPlatformExtended
 				return 0;
 
 			auto fileName = GetAbsoluteFileName(lpFileName);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(fileName);
-			if (!ini_data)
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(fileName);
+			if (!ini_file)
 				return GetPrivateProfileStringA(lpAppName, lpKeyName, lpKeyName, lpReturnedString, nSize, lpFileName);
 
-			String s;
-			size_t l = 0;
+			auto index = ini_file->GetIndex();
+			std::string_view s;
 
 			if (lpAppName && !lpKeyName)
-			{
-				auto ip = ini_data->get(lpAppName);
-
-				for (auto i = ip.begin(); i != ip.end(); i++)
-				{
-					s.append(i->first).append("=").append(i->second).append("\n");
-					l = std::min((size_t)nSize, s.length());
-					if (l == nSize) break;
-				}
-
-				memcpy(lpReturnedString, (const void*)s.c_str(), l);
-			}
+				s = index->FindSection(lpAppName);
 			else if (!lpAppName)
-			{
-				for (auto j = ini_data->begin(); j != ini_data->end(); j++)
-				{
-					s.append("[").append(j->first).append("]\n");
-
-					for (auto i = j->second.begin(); i != j->second.end(); i++)
-					{
-						s.append(i->first).append("=").append(i->second).append("\n");
-						l = std::min((size_t)nSize, s.length());
-						if (l == nSize) break;
-					}
-				}
-
-				memcpy(lpReturnedString, (const void*)s.c_str(), l);
-			}
+				s = index->GetAll();
 			else
 			{
-				auto ip = ini_data->get(lpAppName);
-				if (!ip.has(lpKeyName))
-					s = lpDefault ? lpDefault : "";
-				else
-					s = ip.get(lpKeyName);
-
-				static const char* whitespace_delimiters = " \t\n\r\f\v";
-				s.erase(s.find_last_not_of(whitespace_delimiters) + 1);
-				s.erase(0, s.find_first_not_of(whitespace_delimiters));
-
-				if (s[0] == '"') s.erase(0, 1);
-				if (s[s.length() - 1] == '"') s.resize(s.length() - 1);
-
-				l = std::min((size_t)nSize, s.length());
-				memcpy(lpReturnedString, (const void*)s.c_str(), l);
+				auto value = index->Find(lpAppName, lpKeyName);
+				s = value ? value->text : INIIndex::Clean(lpDefault ? lpDefault : "");
 			}
 
+			size_t l = std::min((size_t)nSize, s.length());
+			memcpy(lpReturnedString, (const void*)s.data(), l);
+
 			lpReturnedString[(l == nSize) ? l - 1 : l] = '\0';
 			return (DWORD)l;
 		}
@@ -201,16 +540,19 @@ namespace CreationKitPlatformExtended
 			if (!lpszSection || !szFile || (uSizeStruct >= (UINT)0x7FFFFFFA)) return false;
 
 			auto fileName = GetAbsoluteFileName(szFile);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(fileName);
-			if (!ini_data)
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(fileName);
+			if (!ini_file)
 				return GetPrivateProfileStructA(lpszSection, lpszKey, lpStruct, uSizeStruct, szFile);
 
-			if (!(*ini_data).has(lpszSection))
+			if (!lpszKey)
 				return false;
-			if (!(*ini_data)[lpszSection].has(lpszKey))
+
+			auto index = ini_file->GetIndex();
+			auto value = index->Find(lpszSection, lpszKey);
+			if (!value)
 				return false;
 
-			std::string& value_str = (*ini_data)[lpszSection][lpszKey];
+			auto& value_str = value->raw;
 			UINT count = (uSizeStruct << 1) + 2;
 
 			if (value_str.length() != count)
@@ -219,7 +561,7 @@ namespace CreationKitPlatformExtended
 			{
 				DWORD dec_val[2] = { 0 }, temp = 0;
 				count = uSizeStruct;
-				auto data = value_str.c_str();
+				auto data = value_str.data();
 
 				do
 				{
@@ -250,10 +592,13 @@ namespace CreationKitPlatformExtended
 			if (!lpAppName || !lpFileName) return false;
 
 			auto fileName = GetAbsoluteFileName(lpFileName);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(fileName);
-			if (!ini_data || (ini_data == INVALID_HANDLE_VALUE))
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(fileName);
+			if (!ini_file || (ini_file == INVALID_HANDLE_VALUE))
 				return WritePrivateProfileStringA(lpAppName, lpKeyName, lpString, lpFileName);
 
+			INICacheFileWriter writer(ini_file);
+			auto ini_data = &ini_file->data;
+
 			if (!lpKeyName)
 				// The name of the key to be associated with a string.
 				// If the key does not exist in the specified section, it is created.
@@ -266,17 +611,11 @@ namespace CreationKitPlatformExtended
 			else
 				(*ini_data)[lpAppName][lpKeyName] = lpString;
 
+			ini_file->dirty = true;
 #ifdef _CKPE_WITH_QT5
-			if (ini_data->size() > 0)
-			{
-				mINI::INIFile file(fileName);
-				return file.write(*ini_data);
-			}
-			else
-				return false;
-#else
-			return true;
+			GlobalINICacheFlusher.Notify();
 #endif
+			return true;
 		}
 
 		BOOL INICacheDataPatch::HKWritePrivateProfileStructA(LPCSTR lpszSection, LPCSTR lpszKey, LPVOID lpStruct,
@@ -290,8 +629,8 @@ namespace CreationKitPlatformExtended
 			if (!lpszSection || !szFile || (uSizeStruct >= (UINT)0x7FFFFFFA)) return false;
 
 			auto fileName = GetAbsoluteFileName(szFile);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(fileName);
-			if (!ini_data || (ini_data == INVALID_HANDLE_VALUE)) 
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(fileName);
+			if (!ini_file || (ini_file == INVALID_HANDLE_VALUE)) 
 				return WritePrivateProfileStructA(lpszSection, lpszKey, lpStruct, uSizeStruct, szFile);
 
 			static const char* ffmt_value = "0123456789ABCDEF\\";
@@ -325,19 +664,16 @@ namespace CreationKitPlatformExtended
 			data[0] = ffmt_value[dec_val[0]];
 			data[1] = ffmt_value[dec_val[1]];
 
+			INICacheFileWriter writer(ini_file);
+			auto ini_data = &ini_file->data;
+
 			(*ini_data)[lpszSection][lpszKey] = value_str;
 
+			ini_file->dirty = true;
 #ifdef _CKPE_WITH_QT5
-			if (ini_data->size() > 0)
-			{
-				mINI::INIFile file(fileName);
-				return file.write(*ini_data);
-			}
-			else
-				return false;
-#else
-			return true;
+			GlobalINICacheFlusher.Notify();
 #endif
+			return true;
 		}
 
 		UINT INICacheDataPatch::HKGetPrivateProfileIntW(LPCWSTR lpAppName, LPCWSTR lpKeyName, INT nDefault, LPCWSTR lpFileName)
@@ -348,32 +684,13 @@ namespace CreationKitPlatformExtended
 				return (UINT)nDefault;
 
 			auto fileName = GetAbsoluteFileNameUnicode(lpFileName);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(Conversion::WideToAnsi(fileName.c_str()).c_str());
-			if (!ini_data || (ini_data == INVALID_HANDLE_VALUE))
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(Conversion::WideToAnsi(fileName.c_str()).c_str());
+			if (!ini_file || (ini_file == INVALID_HANDLE_VALUE))
 				return GetPrivateProfileIntW(lpAppName, lpKeyName, nDefault, lpFileName);
 
-			String s;
-			auto ip = ini_data->get(Conversion::WideToAnsi(lpAppName).c_str());
-			if (!ip.has(Conversion::WideToAnsi(lpKeyName).c_str()))
-				return (UINT)nDefault;
-			else
-				s = ip.get(Conversion::WideToAnsi(lpKeyName).c_str());
-
-			static const char* whitespace_delimiters = " \t\n\r\f\v";
-			s.erase(s.find_last_not_of(whitespace_delimiters) + 1);
-			s.erase(0, s.find_first_not_of(whitespace_delimiters));
-
-			if (s[0] == '"') s.erase(0, 1);
-			if (s[s.length() - 1] == '"') s.resize(s.length() - 1);
-
-			char* end_ptr = nullptr;
-
-			if (s.find_first_of("0x") == 0)
-				// hex
-				return strtoul(s.c_str() + 2, &end_ptr, 16);
-			else
-				// dec
-				return strtoul(s.c_str(), &end_ptr, 10);
+			auto value = ini_file->GetIndex()->Find(Conversion::WideToAnsi(lpAppName).c_str(),
+				Conversion::WideToAnsi(lpKeyName).c_str());
+			return value ? value->number : (UINT)nDefault;
 		}
 
 		DWORD INICacheDataPatch::HKGetPrivateProfileStringW(LPCWSTR lpAppName, LPCWSTR lpKeyName, LPCWSTR lpDefault,
@@ -385,61 +702,33 @@ namespace CreationKitPlatformExtended
 				return 0;
 
 			auto fileName = GetAbsoluteFileNameUnicode(lpFileName);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(Conversion::WideToAnsi(fileName.c_str()).c_str());
-			if (!ini_data || (ini_data == INVALID_HANDLE_VALUE))
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(Conversion::WideToAnsi(fileName.c_str()).c_str());
+			if (!ini_file || (ini_file == INVALID_HANDLE_VALUE))
 				return GetPrivateProfileStringW(lpAppName, lpKeyName, lpDefault, lpReturnedString, nSize, lpFileName);
 
-			String s;
-			size_t l = 0;
+			auto index = ini_file->GetIndex();
+			std::string_view s;
+			String defaultValue;
 
 			if (lpAppName && !lpKeyName)
-			{
-				auto ip = ini_data->get(Conversion::WideToAnsi(lpAppName).c_str());
-
-				for (auto i = ip.begin(); i != ip.end(); i++)
-				{
-					s.append(i->first).append("=").append(i->second).append("\n");
-					l = std::min((size_t)nSize, s.length());
-					if (l == nSize) break;
-				}
-
-				memcpy(lpReturnedString, (const void*)Conversion::AnsiToWide(s.c_str()).c_str(), l << 1);
-			}
+				s = index->FindSection(Conversion::WideToAnsi(lpAppName).c_str());
 			else if (!lpAppName)
+				s = index->GetAll();
+			else
 			{
-				for (auto j = ini_data->begin(); j != ini_data->end(); j++)
+				auto value = index->Find(Conversion::WideToAnsi(lpAppName).c_str(), Conversion::WideToAnsi(lpKeyName).c_str());
+				if (!value)
 				{
-					s.append("[").append(j->first).append("]\n");
-
-					for (auto i = j->second.begin(); i != j->second.end(); i++)
-					{
-						s.append(i->first).append("=").append(i->second).append("\n");
-						l = std::min((size_t)nSize, s.length());
-						if (l == nSize) break;
-					}
+					defaultValue = lpDefault ? Conversion::WideToAnsi(lpDefault) : "";
+					s = INIIndex::Clean(defaultValue);
 				}
-
-				memcpy(lpReturnedString, (const void*)Conversion::AnsiToWide(s.c_str()).c_str(), l << 1);
-			}
-			else
-			{
-				auto ip = ini_data->get(Conversion::WideToAnsi(lpAppName).c_str());
-				if (!ip.has(Conversion::WideToAnsi(lpKeyName).c_str()))
-					s = lpDefault ? Conversion::WideToAnsi(lpDefault) : "";
 				else
-					s = ip.get(Conversion::WideToAnsi(lpKeyName).c_str());
-
-				static const char* whitespace_delimiters = " \t\n\r\f\v";
-				s.erase(s.find_last_not_of(whitespace_delimiters) + 1);
-				s.erase(0, s.find_first_not_of(whitespace_delimiters));
-
-				if (s[0] == '"') s.erase(0, 1);
-				if (s[s.length() - 1] == '"') s.resize(s.length() - 1);
-
-				l = std::min((size_t)nSize, s.length());
-				memcpy(lpReturnedString, (const void*)Conversion::AnsiToWide(s.c_str()).c_str(), l << 1);
+					s = value->text;
 			}
 
+			size_t l = std::min((size_t)nSize, s.length());
+			memcpy(lpReturnedString, (const void*)Conversion::AnsiToWide(String(s).c_str()).c_str(), l << 1);
+
 			lpReturnedString[(l == nSize) ? l - 1 : l] = L'\0';
 			return (DWORD)l;
 		}
@@ -451,10 +740,13 @@ namespace CreationKitPlatformExtended
 			if (!lpAppName || !lpFileName) return false;
 
 			auto fileName = GetAbsoluteFileNameUnicode(lpFileName);
-			auto ini_data = (mINI::INIStructure*)GetFileFromCacheOrOpen(Conversion::WideToAnsi(fileName.c_str()).c_str());
-			if (!ini_data || (ini_data == INVALID_HANDLE_VALUE))
+			auto ini_file = (INICacheFile*)GetFileFromCacheOrOpen(Conversion::WideToAnsi(fileName.c_str()).c_str());
+			if (!ini_file || (ini_file == INVALID_HANDLE_VALUE))
 				return WritePrivateProfileStringW(lpAppName, lpKeyName, lpString, lpFileName);
 
+			INICacheFileWriter writer(ini_file);
+			auto ini_data = &ini_file->data;
+
 			if (!lpKeyName)
 				// The name of the key to be associated with a string.
 				// If the key does not exist in the specified section, it is created.
@@ -468,17 +760,11 @@ namespace CreationKitPlatformExtended
 				(*ini_data)[Conversion::WideToAnsi(lpAppName).c_str()][Conversion::WideToAnsi(lpKeyName).c_str()] =
 					Conversion::WideToAnsi(lpString).c_str();
 
+			ini_file->dirty = true;
 #ifdef _CKPE_WITH_QT5
-			if (ini_data->size() > 0)
-			{
-				mINI::INIFile file(Conversion::WideToAnsi(fileName.c_str()).c_str());
-				return file.write(*ini_data);
-			}
-			else
-				return false;
-#else
-			return true;
+			GlobalINICacheFlusher.Notify();
 #endif
+			return true;
 		}
 
 		std::string INICacheDataPatch::GetAbsoluteFileName(LPCSTR lpFileName)
@@ -530,27 +816,27 @@ namespace CreationKitPlatformExtended
 			if (!EditorAPI::BSString::Utils::ExtractFileName(sFileName.c_str()).Compare("ConstructionSetNetwork.ini")) 
 				return nullptr;
 
-			std::shared_ptr<mINI::INIStructure> ini_data;
+			std::shared_ptr<INICacheFile> ini_file;
 
 			auto iterator_find = GlobalINICache.find(sFileName.c_str());
 			if (iterator_find != GlobalINICache.end())
-				ini_data = iterator_find->second;
+				ini_file = iterator_find->second;
 
-			if (!ini_data)
+			if (!ini_file)
 			{
-				mINI::INIFile* file = new mINI::INIFile(sFileName);
-				if (!file) return nullptr;
+				mINI::INIFile file(sFileName);
 
-				ini_data = std::make_shared<mINI::INIStructure>();
-				if (!ini_data) return nullptr;
-				file->read(*ini_data, false);
+				ini_file = std::make_shared<INICacheFile>();
+				if (!ini_file) return nullptr;
+				file.read(ini_file->data, false);
 
 				//_MESSAGE("Debug INI: %s", sFileName.c_str());
 
-				GlobalINICache.insert(std::make_pair(sFileName.c_str(), ini_data));
+				// If another thread was faster, its copy is the one everyone uses
+				ini_file = GlobalINICache.insert(std::make_pair(sFileName.c_str(), ini_file)).first->second;
 			}
 
-			return (HANDLE)(ini_data.get());
+			return (HANDLE)(ini_file.get());
 		}
 
 		bool INICacheDataPatch::QueryFromPlatform(EDITOR_EXECUTABLE_TYPE eEditorCurrentVersion,
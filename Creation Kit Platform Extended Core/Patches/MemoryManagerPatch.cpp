@@ -31,14 +31,64 @@ namespace CreationKitPlatformExtended
 
 			static void Deallocate(MemoryManager* manager, void* memory, bool aligned)
 			{
-				Core::GlobalMemoryManagerPtr->MemFree(memory);
+				// Сначала трассировка, иначе другой поток может получить этот адрес раньше
 				_CKPE_TracerPop(memory);
+				Core::GlobalMemoryManagerPtr->MemFree(memory);
 			}
 
 			static size_t Size(MemoryManager* manager, void* memory)
 			{
 				return Core::GlobalMemoryManagerPtr->MemSize(memory);
 			}
+
+			static void* Reallocate(MemoryManager* manager, void* memory, size_t oldSize, size_t size,
+				uint32_t alignment, bool aligned)
+			{
+				if (!memory || !size)
+				{
+					_CKPE_TracerPop(memory);
+					auto ptr = Core::GlobalMemoryManagerPtr->MemRealloc(memory, oldSize, size, alignment, aligned, true);
+					if (ptr) _CKPE_TracerPush("MemoryManager", ptr, size);
+					return ptr;
+				}
+
+				if (Core::GlobalMemoryManagerPtr->MemResize(memory, oldSize, size, true))
+				{
+					_CKPE_TracerPop(memory);
+					_CKPE_TracerPush("MemoryManager", memory, size);
+					return memory;
+				}
+
+				// Перенос делаем сами: при неудаче старый блок и его запись остаются,
+				// а запись снимается до освобождения, иначе другой поток может получить этот адрес раньше
+				auto ptr = Core::GlobalMemoryManagerPtr->MemAlloc(size, alignment, aligned, true);
+				if (!ptr)
+					return nullptr;
+
+				memcpy(ptr, memory, std::min(oldSize, size));
+				_CKPE_TracerPop(memory);
+				Core::GlobalMemoryManagerPtr->MemFree(memory);
+				_CKPE_TracerPush("MemoryManager", ptr, size);
+				return ptr;
+			}
+
+			static void AllocateBatch(void** memory, size_t count, size_t size, uint32_t alignment)
+			{
+				Core::GlobalMemoryManagerPtr->MemAllocBatch(memory, count, size, alignment, true, true);
+#if CKPE_USES_TRACER
+				for (size_t i = 0; i < count; i++)
+					_CKPE_TracerPush("MemoryManager", memory[i], size);
+#endif
+			}
+
+			static void DeallocateBatch(void** memory, size_t count)
+			{
+#if CKPE_USES_TRACER
+				for (size_t i = 0; i < count; i++)
+					_CKPE_TracerPop(memory[i]);
+#endif
+				Core::GlobalMemoryManagerPtr->MemFreeBatch(memory, count);
+			}
 		};
 
 		class ScrapHeap
@@ -55,8 +105,9 @@ namespace CreationKitPlatformExtended
 
 			static void Deallocate(ScrapHeap* manager, void* memory)
 			{
-				Core::GlobalMemoryManagerPtr->MemFree(memory);
+				// Сначала трассировка, иначе другой поток может получить этот адрес раньше
 				_CKPE_TracerPop(memory);
+				Core::GlobalMemoryManagerPtr->MemFree(memory);
 			}
 		};
 
@@ -116,23 +167,17 @@ namespace CreationKitPlatformExtended
 
 			void* bhkThreadMemorySource::bufRealloc(void* pold, size_t oldNumBytes, size_t& reqNumBytesInOut)
 			{
-				void* p = blockAlloc(reqNumBytesInOut);
-				memcpy(p, pold, oldNumBytes);
-				blockFree(pold, oldNumBytes);
-
-				return p;
+				return MemoryManager::Reallocate(nullptr, pold, oldNumBytes, reqNumBytesInOut, 16, true);
 			}
 
 			void bhkThreadMemorySource::blockAllocBatch(void** ptrsOut, size_t numPtrs, size_t blockSize)
 			{
-				for (long i = 0; i < numPtrs; i++)
-					ptrsOut[i] = blockAlloc(blockSize);
+				MemoryManager::AllocateBatch(ptrsOut, numPtrs, blockSize, 16);
 			}
 
 			void bhkThreadMemorySource::blockFreeBatch(void** ptrsIn, size_t numPtrs, size_t blockSize)
 			{
-				for (long i = 0; i < numPtrs; i++)
-					blockFree(ptrsIn[i], blockSize);
+				MemoryManager::DeallocateBatch(ptrsIn, numPtrs);
 			}
 
 			void bhkThreadMemorySource::getMemoryStatistics(class MemoryStatistics& u)
@@ -212,8 +257,8 @@ namespace CreationKitPlatformExtended
 
 				static void Deallocate(ScrapHeap* manager, void* memory)
 				{
-					Core::GlobalMemoryManagerPtr->MemFree(memory);
 					_CKPE_TracerPop(memory);
+					Core::GlobalMemoryManagerPtr->MemFree(memory);
 				}
 
 				static size_t Size(ScrapHeap* manager, void* memory)
@@ -276,23 +321,19 @@ namespace CreationKitPlatformExtended
 
 			void* bhkThreadMemorySource::blockRealloc(void* pold, size_t oldNumBytes, size_t& reqNumBytesInOut)
 			{
-				void* p = blockAlloc(reqNumBytesInOut);
-				memcpy(p, pold, oldNumBytes);
-				blockFree(pold, oldNumBytes);
-
-				return p;
+				return CreationKitPlatformExtended::Patches::MemoryManager::Reallocate(nullptr, pold, oldNumBytes,
+					MemoryManager::GetAlignSize(reqNumBytesInOut, 16), 16, true);
 			}
 
 			void bhkThreadMemorySource::blockAllocBatch(void** ptrsOut, size_t numPtrs, size_t blockSize)
 			{
-				for (long i = 0; i < numPtrs; i++)
-					ptrsOut[i] = blockAlloc(blockSize);
+				CreationKitPlatformExtended::Patches::MemoryManager::AllocateBatch(ptrsOut, numPtrs,
+					MemoryManager::GetAlignSize(blockSize, 16), 16);
 			}
 
 			void bhkThreadMemorySource::blockFreeBatch(void** ptrsIn, size_t numPtrs, size_t blockSize)
 			{
-				for (long i = 0; i < numPtrs; i++)
-					blockFree(ptrsIn[i], blockSize);
+				CreationKitPlatformExtended::Patches::MemoryManager::DeallocateBatch(ptrsIn, numPtrs);
 			}
 
 			void bhkThreadMemorySource::getMemoryStatistics(class MemoryStatistics& u)
@@ -387,19 +428,10 @@ namespace CreationKitPlatformExtended
 
 		void* MemoryManagerPatch::HkRealloc(void* memory, size_t size)
 		{
-			void* newMemory = nullptr;
-
-			if (size > 0)
-			{
-				// Recalloc behaves like calloc if there's no existing allocation. Realloc doesn't. Zero it either way.
-				newMemory = MemoryManager::Allocate(nullptr, size, 0, false);
-
-				if (memory)
-					memcpy(newMemory, memory, std::min(size, voltek::scalable_msize(memory)));
-			}
-
-			MemoryManager::Deallocate(nullptr, memory, false);
-			return newMemory;
+			// Recalloc behaves like calloc if there's no existing allocation. Realloc doesn't. Zero it either way.
+			// The block grows in place when the allocator allows it, otherwise it is moved.
+			return MemoryManager::Reallocate(nullptr, memory, memory ? Core::GlobalMemoryManagerPtr->MemSize(memory) : 0,
+				size, 0, false);
 		}
 
 		void* MemoryManagerPatch::HkRecalloc(void* memory, size_t count, size_t size)
@@ -447,6 +479,15 @@ namespace CreationKitPlatformExtended
 			_MESSAGE("Physical Memory (Total: %.1f Gb, Available: %.1f Gb)", TotalGB, AvailableTotalGB);
 			_MESSAGE("Memory (Total: %.1f Gb, Available: %.1f Gb)", TotalPageFileGB, AvailableTotalPageFileGB);
 
+			// Собственный распределитель с честным выравниванием вместо vmm
+			if (_READ_OPTION_BOOL("CreationKit", "bNativeAllocator", false))
+			{
+				if (Core::GlobalMemoryManagerPtr->EnableArena())
+					_MESSAGE("The native memory allocator is enabled");
+				else
+					_WARNING("Failed to enable the native memory allocator");
+			}
+
 			// Программа очень любит думать, а винде это не нравиться, скажем винде, чтоб не обращала внимание.
 			DisableProcessWindowsGhosting();
 
@@ -3,7 +3,10 @@
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
 #include "Core/Engine.h"
+#include "Core/ArchiveNameSet.h"
+#include "Core/ArchiveDirectoryCache.h"
 #include "Editor API/BSString.h"
+#include "Editor API/SSE/TESDataHandler.h"
 #include "BSArchiveManagerModded.h"
 
 namespace CreationKitPlatformExtended
@@ -15,7 +18,8 @@ namespace CreationKitPlatformExtended
 			using namespace CreationKitPlatformExtended::EditorAPI;
 
 			Array<const TESFile*> g_SelectedFilesArray;
-			Array<BSString*> g_arrayArchivesAvailable;
+			bool g_archivesPrefetched = false;
+			ArchiveNameSet g_archivesAvailable;
 
 			uintptr_t pointer_BSArchiveManagerModded_sub = 0;
 
@@ -43,14 +47,12 @@ namespace CreationKitPlatformExtended
 					AssertMsg(file_name, "There is no name of the load archive");
 
 					BSString filePath = BSString::Utils::GetDataPath() + file_name, fileSizeStr;
-					if (BSString::Utils::FileExists(filePath))
-					{
-						unsigned int fileSize = 0;
-						WIN32_FILE_ATTRIBUTE_DATA fileData;
-						if (GetFileAttributesExA(*filePath, GetFileExInfoStandard, &fileData))
-							fileSize = (uint64_t)fileData.nFileSizeLow | ((uint64_t)fileData.nFileSizeHigh << 32);
 
-						GetFileSizeStr(fileSize, fileSizeStr);
+					// Здесь архив не читается, только ожидание подготовки, если рабочий поток уже взялся за него
+					uint64_t fileSize = 0;
+					if (ArchiveDirectoryCache::Attach(*filePath, fileSize))
+					{
+						GetFileSizeStr((unsigned int)fileSize, fileSizeStr);
 						_CONSOLE("Load an archive file \"%s\" (%s)...", file_name, *fileSizeStr);
 					}
 
@@ -65,78 +67,12 @@ namespace CreationKitPlatformExtended
 
 				static void Initialize()
 				{
-					auto pathData = BSString::Utils::GetDataPath();
-
-					WIN32_FIND_DATA	FileFindData;
-					HANDLE hFindFile = FindFirstFileExA(*(pathData + "*.bsa"), FindExInfoStandard, &FileFindData,
-						FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
-					if (hFindFile != INVALID_HANDLE_VALUE) {
-						do {
-							g_arrayArchivesAvailable.push_back(new BSString(FileFindData.cFileName));
-						} while (FindNextFile(hFindFile, &FileFindData));
-					}
-
-					auto func = [](const String& svalue) {
-						BSString strName;
-
-						if (svalue.length() > 0) {
-							LPSTR s_c = new CHAR[svalue.length() + 1];
-							strcpy(s_c, svalue.c_str());
-
-							LPSTR stoken = strtok(s_c, ",");
-							if (stoken) {
-								do {
-									auto index = g_arrayArchivesAvailable.begin();
-									auto fname = Utils::Trim(stoken);
-
-									for (; index != g_arrayArchivesAvailable.end(); index++)
-									{
-										if (!_stricmp(fname.c_str(), (*index)->c_str()))
-											break;
-									}
-
-									if (index != g_arrayArchivesAvailable.end()) {
-										delete* index;
-										g_arrayArchivesAvailable.erase(index);
-									}
-
-									stoken = strtok(NULL, ",");
-								} while (stoken);
-							}
-
-							delete[] s_c;
-						}
-					};
-
-					static const char* SC_NONE = "<NONE>";
-
-					INIConfig _conf("CreationKit.ini");
-					INIConfig _User_conf("CreationKitCustom.ini");
-
-					auto s = _User_conf.ReadString("Archive", "sResourceArchiveList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceArchiveList2", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveList2", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceArchiveMemoryCacheList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceArchiveMemoryCacheList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceStartUpArchiveList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceStartUpArchiveList", "") : s);
-					s = _User_conf.ReadString("Archive", "sResourceIndexFileList", SC_NONE);
-					func((s == SC_NONE) ? _conf.ReadString("Archive", "sResourceIndexFileList", "") : s);
+					g_archivesAvailable.Initialize(*BSString::Utils::GetDataPath(), "*.bsa");
 				}
 
 				static bool IsAvailableForLoad(LPCSTR ArchiveName)
 				{
-					auto index = g_arrayArchivesAvailable.begin();
-					auto fname = Utils::Trim(ArchiveName);
-
-					for (; index != g_arrayArchivesAvailable.end(); index++)
-					{
-						if (!_stricmp(fname.c_str(), (*index)->c_str()))
-							break;
-					}
-
-					return index != g_arrayArchivesAvailable.end();
+					return g_archivesAvailable.Contains(ArchiveName);
 				}
 			};
 
@@ -220,8 +156,46 @@ namespace CreationKitPlatformExtended
 				BSResourceArchive::LoadArchive(_filename);
 			}
 
+			void BSArchiveManagerModdedPatch::PrefetchArchives()
+			{
+				// Список отмеченных файлов уже известен, архивы всех файлов читаются заранее рабочими потоками,
+				// а подключение ждёт только архив, за который поток уже взялся
+				if (!TESDataHandler::Singleton.HasSingleton())
+					return;
+
+				auto dataHandler = TESDataHandler::Singleton.Singleton;
+
+				auto dataPath = BSString::Utils::GetDataPath();
+				Array<String> fileNames;
+
+				for (auto it = dataHandler->GetMods()->Begin(); !it.End(); ++it)
+				{
+					auto file = it.Get();
+					if (!file || !file->IsSelected())
+						continue;
+
+					auto sname = file->GetFileName();
+					sname.Copy(0, sname.FindLastOf('.'));
+
+					for (auto suffix : { ".bsa", " - Textures.bsa" })
+					{
+						auto archiveName = sname + suffix;
+						if (BSResourceArchive::IsAvailableForLoad(*archiveName))
+							fileNames.push_back(*(dataPath + archiveName));
+					}
+				}
+
+				ArchiveDirectoryCache::Prefetch(fileNames);
+			}
+
 			void BSArchiveManagerModdedPatch::LoadTesFile(const TESFile* load_file)
 			{
+				if (!g_archivesPrefetched)
+				{
+					g_archivesPrefetched = true;
+					PrefetchArchives();
+				}
+
 				// Sometimes duplicated
 				if (std::find(g_SelectedFilesArray.begin(), g_SelectedFilesArray.end(), load_file) ==
 					g_SelectedFilesArray.end()) 
@@ -248,6 +222,9 @@ namespace CreationKitPlatformExtended
 			void BSArchiveManagerModdedPatch::LoadTesFileFinal()
 			{
 				g_SelectedFilesArray.clear();
+				g_archivesPrefetched = false;
+				ArchiveDirectoryCache::CancelPrefetch();
+				ArchiveDirectoryCache::Save();
 			}
 		}
 	}
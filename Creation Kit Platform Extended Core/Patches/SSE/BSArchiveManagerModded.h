@@ -34,6 +34,7 @@ namespace CreationKitPlatformExtended
 				static void AttachBSAFile(LPCSTR _filename);
 				static void LoadTesFile(const TESFile* load_file);
 				static void LoadTesFileFinal();
+				static void PrefetchArchives();
 			protected:
 				virtual bool QueryFromPlatform(EDITOR_EXECUTABLE_TYPE eEditorCurrentVersion,
 					const char* lpcstrPlatformRuntimeVersion) const;
@@ -3,6 +3,9 @@
 // License: https://www.gnu.org/licenses/gpl-3.0.html
 
 #include "Core/Engine.h"
+#include "Core/Decompressor.h"
+#include "Core/ArraySearch.h"
+#include "Core/DataDirectoryIndex.h"
 #include "LoadOptimization.h"
 #include "../Windows/SSE/ProgressWindow.h"
 
@@ -74,13 +77,11 @@ namespace CreationKitPlatformExtended
 					// - Replace old zlib decompression code with optimized libdeflate
 					// - Cache results from FindFirstFile when GetFileAttributesExA is called immediately after 
 					// (BSSystemDir__NextEntry, BSResource__LooseFileLocation__FileExists)
+					// - Answer the remaining loose file queries from the Data directory index
 					//
 
-					// Utilize SSE4.1 instructions if available
-					if (GlobalEnginePtr->HasSSE41())
-						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(10), (uintptr_t)&SearchArrayItem_SSE41);
-					else
-						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(10), (uintptr_t)&SearchArrayItem);
+					// The widest SIMD variant available was chosen at startup
+					lpRelocator->DetourJump(lpRelocationDatabaseItem->At(10), (uintptr_t)&SearchArrayItem);
 
 					pProgress1 = (float*)lpRelocator->Rav2Off(lpRelocationDatabaseItem->At(0));
 					pProgress2 = (float*)lpRelocator->Rav2Off(lpRelocationDatabaseItem->At(1));
@@ -107,13 +108,11 @@ namespace CreationKitPlatformExtended
 					// - Replace old zlib decompression code with optimized libdeflate
 					// - Cache results from FindFirstFile when GetFileAttributesExA is called immediately after 
 					// (BSSystemDir__NextEntry, BSResource__LooseFileLocation__FileExistsEx)
+					// - Answer the remaining loose file queries from the Data directory index
 					//
 
-					// Utilize SSE4.1 instructions if available
-					if (GlobalEnginePtr->HasSSE41())
-						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(10), (uintptr_t)&SearchArrayItem_SSE41);
-					else
-						lpRelocator->DetourJump(lpRelocationDatabaseItem->At(10), (uintptr_t)&SearchArrayItem);
+					// The widest SIMD variant available was chosen at startup
+					lpRelocator->DetourJump(lpRelocationDatabaseItem->At(10), (uintptr_t)&SearchArrayItem);
 
 					pProgress1 = (float*)lpRelocator->Rav2Off(lpRelocationDatabaseItem->At(0));
 					pProgress2 = (float*)lpRelocator->Rav2Off(lpRelocationDatabaseItem->At(1));
@@ -156,12 +155,9 @@ namespace CreationKitPlatformExtended
 
 			int LoadOptimizationPatch::HKInflate(z_stream_s* Stream, int Flush)
 			{
-				size_t outBytes = 0;
-				libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
-
-				libdeflate_result result = libdeflate_zlib_decompress(decompressor, Stream->next_in, 
-					Stream->avail_in, Stream->next_out, Stream->avail_out, &outBytes);
-				libdeflate_free_decompressor(decompressor);
+				size_t inBytes = 0, outBytes = 0;
+				libdeflate_result result = Decompressor::Zlib(Stream->next_in, Stream->avail_in,
+					Stream->next_out, Stream->avail_out, &inBytes, &outBytes);
 
 				if (result == LIBDEFLATE_SUCCESS)
 				{
@@ -265,9 +261,22 @@ namespace CreationKitPlatformExtended
 
 				if (fileInfo.dwFileAttributes == INVALID_FILE_ATTRIBUTES)
 				{
-					// Cache miss
-					if (!GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo))
+					// Cache miss, ask the Data directory index before the file system
+					DataDirectoryIndex::FileInfo indexInfo;
+					switch (DataDirectoryIndex::Query(CanonicalFullPath, indexInfo))
+					{
+					case DataDirectoryIndex::kMissing:
 						return false;
+					case DataDirectoryIndex::kFound:
+						fileInfo.dwFileAttributes = indexInfo.attributes;
+						fileInfo.nFileSizeLow = (DWORD)indexInfo.size;
+						fileInfo.nFileSizeHigh = (DWORD)(indexInfo.size >> 32);
+						break;
+					default:
+						if (!GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo))
+							return false;
+						break;
+					}
 				}
 
 				if (fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
@@ -316,9 +325,22 @@ namespace CreationKitPlatformExtended
 
 				if (fileInfo.dwFileAttributes == INVALID_FILE_ATTRIBUTES)
 				{
-					// Cache miss
-					if (!GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo))
+					// Cache miss, ask the Data directory index before the file system
+					DataDirectoryIndex::FileInfo indexInfo;
+					switch (DataDirectoryIndex::Query(CanonicalFullPath, indexInfo))
+					{
+					case DataDirectoryIndex::kMissing:
 						return false;
+					case DataDirectoryIndex::kFound:
+						fileInfo.dwFileAttributes = indexInfo.attributes;
+						fileInfo.nFileSizeLow = (DWORD)indexInfo.size;
+						fileInfo.nFileSizeHigh = (DWORD)(indexInfo.size >> 32);
+						break;
+					default:
+						if (!GetFileAttributesExA(CanonicalFullPath, GetFileExInfoStandard, &fileInfo))
+							return false;
+						break;
+					}
 				}
 
 				if (fileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
@@ -328,57 +350,16 @@ namespace CreationKitPlatformExtended
 				return true;
 			}
 
-			DWORD LoadOptimizationPatch::SearchArrayItem_SSE41(EditorAPI::BSTArray<void*>& _array,
-				void* &_target, DWORD _start_index, __int64 Unused)
-			{
-				uint32_t index = _start_index;
-				__int64* data = (__int64*)_array.QBuffer();
-
-				const uint32_t comparesPerIter = 4;
-				const uint32_t vectorizedIterations = (_array.QSize() - index) / comparesPerIter;
-
-				//
-				// Compare 4 pointers per iteration - use SIMD instructions to generate a bit mask. Set
-				// bit 0 if 'array[i + 0]'=='target', set bit 1 if 'array[i + 1]'=='target', set bit X...
-				//
-				// AVX: mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(targets, _mm256_loadu_si256((__m256i *)&data[i]))));
-				//
-				const __m128i targets = _mm_set1_epi64x((__int64)_target);
-
-				for (uint32_t iter = 0; iter < vectorizedIterations; iter++)
-				{
-					__m128i test1 = _mm_cmpeq_epi64(targets, _mm_loadu_si128((__m128i*)&data[index + 0]));
-					__m128i test2 = _mm_cmpeq_epi64(targets, _mm_loadu_si128((__m128i*)&data[index + 2]));
-
-					int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(test1, test2)));
-
-					// if (target pointer found) { break into the remainder loop to get the index }
-					if (mask != 0)
-						break;
-
-					index += comparesPerIter;
-				}
-
-				// Scan the rest 1-by-1
-				for (; index < _array.QSize(); index++)
-				{
-					if (data[index] == (__int64)_target)
-						return index;
-				}
-
-				return 0xFFFFFFFF;
-			}
-
 			DWORD LoadOptimizationPatch::SearchArrayItem(EditorAPI::BSTArray<void*> &_array,
 				void* &_target, DWORD _start_index, __int64 Unused)
 			{
-				for (uint32_t i = _start_index; i < _array.QSize(); i++)
-				{
-					if (_array[i] == _target)
-						return i;
-				}
+				if (_start_index >= _array.QSize())
+					return ArraySearch::INVALID_INDEX;
+
+				auto index = ArraySearch::FindPointer((const void* const*)_array.QBuffer() + _start_index,
+					_array.QSize() - _start_index, _target);
 
-				return 0xFFFFFFFF;
+				return (index == ArraySearch::INVALID_INDEX) ? index : index + _start_index;
 			}
 		}
 	}
@@ -50,8 +50,6 @@ namespace CreationKitPlatformExtended
 				static uint32_t BSSystemDir_NextEntry(__int64 a1, bool* IsComplete);
 				static bool BSResource_LooseFileLocation_FileExists(const char* CanonicalFullPath, uint32_t* TotalSize);
 				static bool BSResource_LooseFileLocation_FileExistsEx(const char* CanonicalFullPath, uint64_t* TotalSize);
-				static DWORD SearchArrayItem_SSE41(EditorAPI::BSTArray<void*>& _array, void* &_target,
-					DWORD _start_index, __int64 Unused);
 				static DWORD SearchArrayItem(EditorAPI::BSTArray<void*>& _array, void* &_target,
 					DWORD _start_index, __int64 Unused);
 
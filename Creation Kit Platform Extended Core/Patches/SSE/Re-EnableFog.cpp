@@ -87,7 +87,7 @@ namespace CreationKitPlatformExtended
 					//
 					// And send this code to the abyss of hell
 					//
-					ScopeRelocator text;												// To speed up, a lot of patches
+					RelocatorTransaction transaction;									// To speed up, a lot of patches
 
 					lpRelocator->PatchNop(lpRelocationDatabaseItem->At(0), 4);			// Pointer always null
 					lpRelocator->PatchNop(lpRelocationDatabaseItem->At(1), 0x63);		// Pointer always null
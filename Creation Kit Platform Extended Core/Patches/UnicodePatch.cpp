@@ -118,7 +118,7 @@ namespace CreationKitPlatformExtended
 				// Cut check spelling window
 				//
 
-				ScopeRelocator text;
+				RelocatorTransaction transaction;
 
 				for (uint32_t i = 13; i < lpRelocationDatabaseItem->Count(); i++)
 					lpRelocator->PatchNop(_RELDATA_RAV(i), 5);
@@ -148,7 +148,7 @@ namespace CreationKitPlatformExtended
 				// Cut check spelling window
 				//
 
-				ScopeRelocator text;
+				RelocatorTransaction transaction;
 
 				for (uint32_t i = 8; i < lpRelocationDatabaseItem->Count(); i++)
 					lpRelocator->PatchNop(_RELDATA_RAV(i), 5);
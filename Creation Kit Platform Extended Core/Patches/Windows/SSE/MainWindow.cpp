@@ -11,6 +11,7 @@
 #include "Core/RegistratorWindow.h"
 #include "Editor API/EditorUI.h"
 #include "Editor API/BSString.h"
+#include "Editor API/BSLockWait.h"
 #include "Editor API/SSE/TESForm.h"
 #include "Editor API/SSE/BSPointerHandleManager.h"
 #include "Editor API/SSE/TESDataHandler.h"
@@ -253,6 +254,9 @@ namespace CreationKitPlatformExtended
 				TracerMenu.Append("Dump", UI_EXTMENU_TRACER_DUMP);
 				ExtMenu.Append("Tracer Memory", UI_EXTMENU_TRACER, TracerMenu);
 #endif
+#if CKPE_LOCK_STATS
+				ExtMenu.Append("Dump Locks", UI_EXTMENU_LOCKS_DUMP);
+#endif
 
 				ExtMenu.AppendSeparator();
 				ExtMenu.Append("Save Hardcoded Forms", UI_EXTMENU_HARDCODEDFORMS);
@@ -445,6 +449,13 @@ namespace CreationKitPlatformExtended
 								Core::GlobalTracerManagerPtr->Dump();
 							}
 							return 0;
+#endif
+#if CKPE_LOCK_STATS
+							case UI_EXTMENU_LOCKS_DUMP:
+							{
+								EditorAPI::BSLockStats::Dump();
+							}
+							return 0;
 #endif
 							case EditorAPI::EditorUI::UI_EDITOR_TOGGLEOBJECTWND:
 							{
@@ -42,6 +42,7 @@ namespace CreationKitPlatformExtended
 				constexpr static auto UI_EXTMENU_TRACER_CLEAR = 51012;
 				constexpr static auto UI_EXTMENU_TRACER_DUMP = 51013;
 				constexpr static auto UI_EXTMENU_TRACER_RECORD = 51014;
+				constexpr static auto UI_EXTMENU_LOCKS_DUMP = 51015;
 
 				virtual bool HasOption() const;
 				virtual bool HasCanRuntimeDisabled() const;
@@ -0,0 +1,143 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Подключение range(0) архивов текстур плагинов (DX10, 10000 текстур, таблица имён в конце, данные - дыра
+// разреженного файла) так, как это делает редактор: Attach и чтение таблиц движком (EngineTableReader) архив за
+// архивом. Serial - без подготовки, Prefetch - как в LoadTesFile, сначала Prefetch всех архивов. Cold - страницы
+// архивов перед каждым проходом выброшены из кеша (posix_fadvise, вне замера), Warm - всё уже в памяти.
+// Файл кеша границ DX10 заполняется первым проходом, дальше разбор не нужен, как при втором запуске редактора.
+// Latency - холодный диск с задержкой range(1) мкс на запрос (Tests::SetReadLatency): столько стоит первое чтение
+// каждого блока, и только здесь видно, сколько ожидания Prefetch прячет за работой загрузчика
+
+#include <fcntl.h>
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ArchiveDirectoryCache.h"
+#include "ArchiveTableSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	struct ArchiveSource
+	{
+		Tests::TempDirectory Temp;
+		Array<String> FileNames;
+
+		ArchiveSource(uint32_t archiveCount)
+		{
+			for (uint32_t i = 0; i < archiveCount; i++)
+			{
+				FileNames.push_back(Temp.File(("ccBGSFO4" + std::to_string(1000 + i) + " - Textures.ba2").c_str()));
+				Tests::WriteBA2(FileNames.back(), 1, true, 10000, 6, true, 256 << 20, 1000 + i);
+			}
+		}
+	};
+
+	ArchiveSource& GetSource(int64_t archiveCount)
+	{
+		static std::map<int64_t, std::unique_ptr<ArchiveSource>> Sources;
+		auto& Source = Sources[archiveCount];
+		if (!Source)
+			Source = std::make_unique<ArchiveSource>((uint32_t)archiveCount);
+		return *Source;
+	}
+
+	void DropCache(const ArchiveSource& source)
+	{
+		for (auto& FileName : source.FileNames)
+		{
+			auto Descriptor = open(FileName.c_str(), O_RDONLY | O_CLOEXEC);
+			if (Descriptor < 0)
+				continue;
+			posix_fadvise(Descriptor, 0, 0, POSIX_FADV_DONTNEED);
+			close(Descriptor);
+		}
+	}
+
+	uint64_t AttachAll(const ArchiveSource& source)
+	{
+		uint64_t Bytes = 0;
+		for (auto& FileName : source.FileNames)
+		{
+			uint64_t FileSize = 0;
+			if (ArchiveDirectoryCache::Attach(FileName.c_str(), FileSize))
+				Bytes += Tests::EngineTableReader(FileName.c_str()).ReadTables();
+		}
+		return Bytes;
+	}
+
+	void Run(benchmark::State& state, bool cold, bool prefetch)
+	{
+		auto& Source = GetSource(state.range(0));
+		auto Latency = (state.range(1) > 0) ? (uint32_t)state.range(1) : 0;
+		uint64_t Bytes = 0;
+
+		Tests::SetReadLatency(Latency);
+		for (auto _ : state)
+		{
+			if (cold)
+			{
+				state.PauseTiming();
+				DropCache(Source);
+				Tests::DropReadCache();
+				state.ResumeTiming();
+			}
+
+			if (prefetch)
+				ArchiveDirectoryCache::Prefetch(Source.FileNames);
+			Bytes += AttachAll(Source);
+			ArchiveDirectoryCache::CancelPrefetch();
+		}
+
+		Tests::SetReadLatency(0);
+
+		state.SetBytesProcessed((int64_t)Bytes);
+		state.SetItemsProcessed(state.iterations() * Source.FileNames.size());
+	}
+
+	// Кеш границ лежит в папке приложения, его файл читается при первом Prefetch
+	Tests::TempDirectory* ApplicationPath = nullptr;
+
+	void Setup(const benchmark::State&)
+	{
+		if (!ApplicationPath)
+		{
+			ApplicationPath = new Tests::TempDirectory();
+			Tests::SetApplicationPath(ApplicationPath->Path().c_str());
+		}
+		Tests::CreateEngine();
+	}
+
+	void Teardown(const benchmark::State&)
+	{
+		Tests::DestroyEngine();
+	}
+}
+
+static void BM_AttachColdSerial(benchmark::State& state) { Run(state, true, false); }
+BENCHMARK(BM_AttachColdSerial)->ArgName("archives")->Arg(8)->Arg(32)->Setup(Setup)->Teardown(Teardown)->
+	UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_AttachColdPrefetch(benchmark::State& state) { Run(state, true, true); }
+BENCHMARK(BM_AttachColdPrefetch)->ArgName("archives")->Arg(8)->Arg(32)->Setup(Setup)->Teardown(Teardown)->
+	UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_AttachWarmSerial(benchmark::State& state) { Run(state, false, false); }
+BENCHMARK(BM_AttachWarmSerial)->ArgName("archives")->Arg(8)->Arg(32)->Setup(Setup)->Teardown(Teardown)->
+	UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_AttachWarmPrefetch(benchmark::State& state) { Run(state, false, true); }
+BENCHMARK(BM_AttachWarmPrefetch)->ArgName("archives")->Arg(8)->Arg(32)->Setup(Setup)->Teardown(Teardown)->
+	UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_AttachLatencySerial(benchmark::State& state) { Run(state, true, false); }
+BENCHMARK(BM_AttachLatencySerial)->ArgNames({ "archives", "latency_us" })->Args({ 32, 200 })->Args({ 32, 2000 })->
+	Setup(Setup)->Teardown(Teardown)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_AttachLatencyPrefetch(benchmark::State& state) { Run(state, true, true); }
+BENCHMARK(BM_AttachLatencyPrefetch)->ArgNames({ "archives", "latency_us" })->Args({ 32, 200 })->Args({ 32, 2000 })->
+	Setup(Setup)->Teardown(Teardown)->UseRealTime()->Unit(benchmark::kMillisecond);
\ No newline at end of file
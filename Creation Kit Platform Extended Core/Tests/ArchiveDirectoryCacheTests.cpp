@@ -0,0 +1,310 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ArchiveDirectoryCache.h"
+#include "ArchiveTableSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	using Region = ArchiveDirectoryCache::Region;
+
+	// Время, за которое рабочие потоки заведомо успевают подготовить архивы
+	constexpr auto WorkersDelay = std::chrono::milliseconds(500);
+
+	// Файл кеша один на процесс и читается при первом Prefetch, поэтому папка приложения задаётся заранее
+	class ArchiveDirectoryCacheTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			Temp = new Tests::TempDirectory();
+			Tests::SetApplicationPath(Temp->Path().c_str());
+			Tests::CreateEngine();
+		}
+
+		static void TearDownTestSuite()
+		{
+			Tests::DestroyEngine();
+			Tests::SetApplicationPath("./");
+			delete Temp;
+		}
+
+		static bool Parse(const String& fileName, Array<Region>& regions, bool& persist)
+		{
+			HANDLE File = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (File == INVALID_HANDLE_VALUE)
+				return false;
+
+			persist = false;
+			auto Result = ArchiveDirectoryCache::Parse(File, std::filesystem::file_size(fileName.c_str()), regions, persist);
+			CloseHandle(File);
+			return Result;
+		}
+
+		static Array<Region> Expected(const Tests::ArchiveTable& table)
+		{
+			Array<Region> Regions = { { 0, table.TableSize } };
+			if (table.NameTableOffset)
+				Regions.push_back({ table.NameTableOffset, table.FileSize - table.NameTableOffset });
+			return Regions;
+		}
+
+		static void Patch(const String& fileName, uint64_t offset, const void* data, size_t size)
+		{
+			std::fstream File(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			File.seekp((std::streamoff)offset);
+			File.write((const char*)data, (std::streamsize)size);
+		}
+
+		static Tests::TempDirectory* Temp;
+	};
+
+	Tests::TempDirectory* ArchiveDirectoryCacheTest::Temp = nullptr;
+}
+
+// Сравнение и вывод для EXPECT_EQ, ищутся по пространству имён Region
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		static bool operator==(const ArchiveDirectoryCache::Region& lhs, const ArchiveDirectoryCache::Region& rhs)
+		{
+			return (lhs.offset == rhs.offset) && (lhs.size == rhs.size);
+		}
+
+		static void PrintTo(const ArchiveDirectoryCache::Region& region, std::ostream* os)
+		{
+			*os << "{ " << region.offset << ", " << region.size << " }";
+		}
+	}
+}
+
+TEST_F(ArchiveDirectoryCacheTest, ParsesBSA)
+{
+	for (uint32_t Version : { 104u, 105u })
+	{
+		for (uint32_t Flags = 0; Flags < 4; Flags++)
+		{
+			auto FileName = Temp->File("Skyrim.bsa");
+			auto Table = Tests::WriteBSA(FileName, Version, 40, 25, Flags, 1 << 20, Version + Flags);
+			ASSERT_NE(Table.FileSize, 0u);
+
+			Array<Region> Regions;
+			bool Persist = true;
+			ASSERT_TRUE(Parse(FileName, Regions, Persist)) << "version " << Version << " flags " << Flags;
+			EXPECT_EQ(Regions, Expected(Table)) << "version " << Version << " flags " << Flags;
+			// Граница BSA считается по заголовку, хранить её незачем
+			EXPECT_FALSE(Persist);
+		}
+	}
+}
+
+TEST_F(ArchiveDirectoryCacheTest, ParsesBA2)
+{
+	for (uint32_t Version : { 1u, 2u, 3u })
+	{
+		for (bool Textures : { false, true })
+		{
+			for (bool Names : { false, true })
+			{
+				auto FileName = Temp->File("Fallout4 - Main.ba2");
+				auto Table = Tests::WriteBA2(FileName, Version, Textures, 3000, 6, Names, 1 << 20, Version);
+				ASSERT_NE(Table.FileSize, 0u);
+
+				Array<Region> Regions;
+				bool Persist = false;
+				ASSERT_TRUE(Parse(FileName, Regions, Persist)) << "version " << Version << " textures " << Textures;
+				EXPECT_EQ(Regions, Expected(Table)) << "version " << Version << " textures " << Textures;
+				// Таблицу DX10 без прохода по записям не измерить, её стоит сохранить
+				EXPECT_EQ(Persist, Textures);
+			}
+		}
+	}
+}
+
+TEST_F(ArchiveDirectoryCacheTest, RejectsDamagedArchives)
+{
+	auto FileName = Temp->File("Damaged.ba2");
+	Array<Region> Regions;
+	bool Persist = false;
+
+	auto Table = Tests::WriteBA2(FileName, 1, true, 2000, 4, true, 4096, 5);
+	ASSERT_TRUE(Parse(FileName, Regions, Persist));
+
+	// Записи DX10 обрываются раньше конца файла
+	std::filesystem::resize_file(FileName.c_str(), Table.TableSize / 2);
+	EXPECT_FALSE(Parse(FileName, Regions, Persist));
+
+	// Таблица имён внутри записей
+	Table = Tests::WriteBA2(FileName, 1, false, 500, 1, true, 4096, 6);
+	uint64_t Inside = Table.TableSize / 2;
+	Patch(FileName, 16, &Inside, sizeof(Inside));
+	EXPECT_FALSE(Parse(FileName, Regions, Persist));
+
+	// Неизвестные версия и тип
+	Tests::WriteBA2(FileName, 1, false, 500, 1, false, 4096, 7);
+	uint32_t Version = 9;
+	Patch(FileName, 4, &Version, sizeof(Version));
+	EXPECT_FALSE(Parse(FileName, Regions, Persist));
+	Tests::WriteBA2(FileName, 1, false, 500, 1, false, 4096, 7);
+	Patch(FileName, 8, "GNMF", 4);
+	EXPECT_FALSE(Parse(FileName, Regions, Persist));
+
+	// Записи GNRL длиннее файла
+	Tests::WriteBA2(FileName, 1, false, 500, 1, false, 0, 8);
+	uint32_t Count = 1000000;
+	Patch(FileName, 12, &Count, sizeof(Count));
+	EXPECT_FALSE(Parse(FileName, Regions, Persist));
+
+	auto BSAName = Temp->File("Damaged.bsa");
+	Tests::WriteBSA(BSAName, 103, 10, 10, 3, 4096, 9);
+	EXPECT_FALSE(Parse(BSAName, Regions, Persist));
+	Tests::WriteBSA(BSAName, 105, 10, 10, 3, 4096, 9);
+	uint32_t Offset = 40;
+	Patch(BSAName, 8, &Offset, sizeof(Offset));
+	EXPECT_FALSE(Parse(BSAName, Regions, Persist));
+	Tests::WriteBSA(BSAName, 105, 10, 10, 3, 0, 9);
+	Count = 1000000;
+	Patch(BSAName, 20, &Count, sizeof(Count));
+	EXPECT_FALSE(Parse(BSAName, Regions, Persist));
+
+	Patch(BSAName, 0, "ZIP\0", 4);
+	EXPECT_FALSE(Parse(BSAName, Regions, Persist));
+	std::filesystem::resize_file(BSAName.c_str(), 2);
+	EXPECT_FALSE(Parse(BSAName, Regions, Persist));
+}
+
+TEST_F(ArchiveDirectoryCacheTest, AttachReportsSize)
+{
+	auto FileName = Temp->File("Attach.bsa");
+	auto Table = Tests::WriteBSA(FileName, 105, 10, 10, 3, 12345, 10);
+
+	uint64_t FileSize = 0;
+	ASSERT_TRUE(ArchiveDirectoryCache::Attach(FileName.c_str(), FileSize));
+	EXPECT_EQ(FileSize, Table.FileSize);
+
+	EXPECT_FALSE(ArchiveDirectoryCache::Attach(Temp->File("Missing.bsa").c_str(), FileSize));
+	EXPECT_FALSE(ArchiveDirectoryCache::Attach(Temp->Path().c_str(), FileSize));
+}
+
+TEST_F(ArchiveDirectoryCacheTest, AttachesPrefetchedArchives)
+{
+	// Подключение идёт вперемешку с подготовкой: одни архивы уже готовы, другие ещё в очереди
+	Array<String> FileNames;
+	Array<uint64_t> Sizes;
+	for (uint32_t i = 0; i < 24; i++)
+	{
+		FileNames.push_back(Temp->File(("Plugin" + std::to_string(i) + " - Textures.ba2").c_str()));
+		Sizes.push_back(Tests::WriteBA2(FileNames.back(), 1, true, 1000, 4, true, 1 << 20, 100 + i).FileSize);
+	}
+	FileNames.push_back(Temp->File("Missing - Main.ba2"));
+
+	for (int Pass = 0; Pass < 3; Pass++)
+	{
+		ArchiveDirectoryCache::Prefetch(FileNames);
+		for (size_t i = 0; i < Sizes.size(); i++)
+		{
+			uint64_t FileSize = 0;
+			ASSERT_TRUE(ArchiveDirectoryCache::Attach(FileNames[i].c_str(), FileSize)) << FileNames[i];
+			EXPECT_EQ(FileSize, Sizes[i]);
+		}
+
+		uint64_t FileSize = 0;
+		EXPECT_FALSE(ArchiveDirectoryCache::Attach(FileNames.back().c_str(), FileSize));
+		ArchiveDirectoryCache::CancelPrefetch();
+	}
+}
+
+TEST_F(ArchiveDirectoryCacheTest, AttachWaitsOnlyForRunningJobs)
+{
+	// Каждое чтение с диска ждёт Latency, поэтому рабочие потоки надолго заняты первыми MAX_WORKERS архивами
+	constexpr auto Latency = std::chrono::milliseconds(200);
+	Array<String> FileNames;
+	for (uint32_t i = 0; i < ArchiveDirectoryCache::MAX_WORKERS * 2; i++)
+	{
+		FileNames.push_back(Temp->File(("Latency" + std::to_string(i) + " - Textures.ba2").c_str()));
+		Tests::WriteBA2(FileNames.back(), 1, true, 200, 4, true, 1 << 20, 500 + i);
+	}
+
+	Tests::DropReadCache();
+	Tests::SetReadLatency((uint32_t)std::chrono::microseconds(Latency).count());
+
+	ArchiveDirectoryCache::Prefetch(FileNames);
+	std::this_thread::sleep_for(Latency / 4);
+
+	// Архив в очереди снимается с неё и не читается, подключение не ждёт занятых потоков
+	uint64_t FileSize = 0;
+	auto Start = std::chrono::steady_clock::now();
+	ASSERT_TRUE(ArchiveDirectoryCache::Attach(FileNames.back().c_str(), FileSize));
+	EXPECT_LT(std::chrono::steady_clock::now() - Start, Latency / 2);
+
+	// Архив, который уже готовит рабочий поток, подключается после подготовки: таблицы движок берёт из кеша
+	ASSERT_TRUE(ArchiveDirectoryCache::Attach(FileNames.front().c_str(), FileSize));
+	auto Misses = Tests::GetReadMissCount();
+	EXPECT_GT(Tests::EngineTableReader(FileNames.front().c_str()).ReadTables(), 0u);
+	EXPECT_EQ(Tests::GetReadMissCount(), Misses);
+
+	// Снятый с очереди архив движок читает сам
+	EXPECT_GT(Tests::EngineTableReader(FileNames.back().c_str()).ReadTables(), 0u);
+	EXPECT_GT(Tests::GetReadMissCount(), Misses);
+
+	for (size_t i = 1; i < FileNames.size() - 1; i++)
+		EXPECT_TRUE(ArchiveDirectoryCache::Attach(FileNames[i].c_str(), FileSize));
+	ArchiveDirectoryCache::CancelPrefetch();
+	Tests::SetReadLatency(0);
+}
+
+TEST_F(ArchiveDirectoryCacheTest, SavesOnlyDX10Extents)
+{
+	Array<String> FileNames;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		FileNames.push_back(Temp->File(("Saved" + std::to_string(i) + " - Textures.ba2").c_str()));
+		Tests::WriteBA2(FileNames.back(), 1, true, 500, 4, true, 4096, 200 + i);
+		FileNames.push_back(Temp->File(("Saved" + std::to_string(i) + " - Main.ba2").c_str()));
+		Tests::WriteBA2(FileNames.back(), 1, false, 500, 1, true, 4096, 300 + i);
+		FileNames.push_back(Temp->File(("Saved" + std::to_string(i) + ".bsa").c_str()));
+		Tests::WriteBSA(FileNames.back(), 105, 10, 10, 3, 4096, 400 + i);
+	}
+
+	ArchiveDirectoryCache::Prefetch(FileNames);
+	std::this_thread::sleep_for(WorkersDelay);
+	ArchiveDirectoryCache::CancelPrefetch();
+	ArchiveDirectoryCache::Save();
+
+	std::ifstream File(Temp->File("CreationKitPlatformExtended_Archives.cache").c_str(), std::ios::binary);
+	ASSERT_TRUE(File.is_open());
+	uint32_t Header[5] = {};
+	File.read((char*)Header, sizeof(Header));
+	ASSERT_EQ(Header[0], 'CRAC');
+
+	// В файл попадают только DX10, в том числе подготовленные предыдущим тестом, GNRL и BSA считаются по заголовку
+	uint32_t Saved = 0;
+	for (uint32_t i = 0; i < Header[2]; i++)
+	{
+		uint16_t Length = 0;
+		uint32_t RegionCount = 0;
+		String Key;
+		File.read((char*)&Length, sizeof(Length));
+		Key.resize(Length);
+		File.read(Key.data(), Length);
+		File.seekg(16, std::ios::cur);
+		File.read((char*)&RegionCount, sizeof(RegionCount));
+		File.seekg((std::streamoff)RegionCount * 16, std::ios::cur);
+		ASSERT_TRUE(File.good());
+
+		EXPECT_EQ(Key.substr(Key.length() - 15), " - textures.ba2") << Key;
+		Saved += Key.find("saved") != String::npos;
+	}
+	EXPECT_EQ(Saved, 4u);
+	EXPECT_FALSE(std::filesystem::exists(Temp->File("CreationKitPlatformExtended_Archives.cache.tmp").c_str()));
+}
\ No newline at end of file
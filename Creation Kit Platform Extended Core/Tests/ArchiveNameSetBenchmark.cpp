@@ -0,0 +1,185 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Архивы большой сборки с Creation Club и модами (ArchiveNameSource.h): range(0) плагинов, у большинства
+// " - Main.ba2" и " - Textures.ba2". Сборка набора из папки Data и списков CreationKit.ini и проверка обоих
+// архивов каждого плагина, как в LoadTesFile, против прежнего пути: массив BSString* всех архивов, вычеркивание
+// списков вложенным перебором с _stricmp и линейный поиск в IsAvailableForLoad. Обход папки одинаков у обоих
+// и входит в замер сборки.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ArchiveNameSet.h"
+#include "ArchiveNameSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	struct ArchiveSource
+	{
+		Tests::TempDirectory Temp;
+		String DataPath;
+		Array<String> Queries;
+
+		ArchiveSource(uint32_t pluginCount)
+		{
+			auto Tree = Tests::MakeArchiveTree(Temp.Path(), pluginCount, 29);
+			DataPath = Temp.Path() + "/Data/";
+			for (auto& Plugin : Tree.Plugins)
+			{
+				Queries.push_back(Plugin + " - Main.ba2");
+				Queries.push_back(Plugin + " - Textures.ba2");
+			}
+		}
+	};
+
+	// Папка на каждое число плагинов, CreationKit.ini читается из текущей папки
+	ArchiveSource& GetSource(int64_t pluginCount)
+	{
+		static std::map<int64_t, std::unique_ptr<ArchiveSource>> Sources;
+		auto& Source = Sources[pluginCount];
+		if (!Source)
+			Source = std::make_unique<ArchiveSource>((uint32_t)pluginCount);
+		chdir(Source->Temp.Path().c_str());
+		return *Source;
+	}
+
+	// Прежний путь (до ArchiveNameSet), BSString заменён на String
+	struct LegacyArchiveList
+	{
+		Array<String*> Available;
+
+		~LegacyArchiveList()
+		{
+			for (auto Name : Available)
+				delete Name;
+		}
+
+		void Initialize(const String& pathData, const char* mask)
+		{
+			WIN32_FIND_DATAA FileFindData;
+			HANDLE hFindFile = FindFirstFileExA((pathData + mask).c_str(), FindExInfoStandard, &FileFindData,
+				FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+			if (hFindFile != INVALID_HANDLE_VALUE) {
+				do {
+					Available.push_back(new String(FileFindData.cFileName));
+				} while (FindNextFileA(hFindFile, &FileFindData));
+				FindClose(hFindFile);
+			}
+
+			auto func = [this](const String& svalue) {
+				if (svalue.length() > 0) {
+					LPSTR s_c = new CHAR[svalue.length() + 1];
+					strcpy(s_c, svalue.c_str());
+
+					LPSTR stoken = strtok(s_c, ",");
+					if (stoken) {
+						do {
+							auto index = Available.begin();
+							auto fname = CreationKitPlatformExtended::Utils::Trim(stoken);
+
+							for (; index != Available.end(); index++)
+							{
+								if (!_stricmp(fname.c_str(), (*index)->c_str()))
+									break;
+							}
+
+							if (index != Available.end()) {
+								delete* index;
+								Available.erase(index);
+							}
+
+							stoken = strtok(NULL, ",");
+						} while (stoken);
+					}
+
+					delete[] s_c;
+				}
+			};
+
+			static const char* SC_NONE = "<NONE>";
+
+			INIConfig _conf("CreationKit.ini");
+			INIConfig _User_conf("CreationKitCustom.ini");
+
+			for (auto list : { "sResourceArchiveList", "sResourceArchiveList2", "sResourceArchiveMemoryCacheList",
+				"sResourceStartUpArchiveList", "sResourceIndexFileList" })
+			{
+				auto s = _User_conf.ReadString("Archive", list, SC_NONE);
+				func((s == SC_NONE) ? _conf.ReadString("Archive", list, "") : s);
+			}
+		}
+
+		bool IsAvailableForLoad(LPCSTR ArchiveName) const
+		{
+			auto index = Available.begin();
+			auto fname = CreationKitPlatformExtended::Utils::Trim(ArchiveName);
+
+			for (; index != Available.end(); index++)
+			{
+				if (!_stricmp(fname.c_str(), (*index)->c_str()))
+					break;
+			}
+
+			return index != Available.end();
+		}
+	};
+}
+
+static void BM_ArchiveListLegacy(benchmark::State& state)
+{
+	auto& Source = GetSource(state.range(0));
+	for (auto _ : state)
+	{
+		LegacyArchiveList List;
+		List.Initialize(Source.DataPath, "*.ba2");
+		benchmark::DoNotOptimize(List.Available.size());
+	}
+}
+BENCHMARK(BM_ArchiveListLegacy)->ArgName("plugins")->Arg(250)->Arg(1000)->Arg(4000)->Unit(benchmark::kMillisecond);
+
+static void BM_ArchiveNameSet(benchmark::State& state)
+{
+	auto& Source = GetSource(state.range(0));
+	for (auto _ : state)
+	{
+		ArchiveNameSet Names;
+		Names.Initialize(Source.DataPath.c_str(), "*.ba2");
+		benchmark::DoNotOptimize(Names.Size());
+	}
+}
+BENCHMARK(BM_ArchiveNameSet)->ArgName("plugins")->Arg(250)->Arg(1000)->Arg(4000)->Unit(benchmark::kMillisecond);
+
+static void BM_AvailableForLoadLegacy(benchmark::State& state)
+{
+	auto& Source = GetSource(state.range(0));
+	LegacyArchiveList List;
+	List.Initialize(Source.DataPath, "*.ba2");
+
+	for (auto _ : state)
+	{
+		for (auto& Query : Source.Queries)
+			benchmark::DoNotOptimize(List.IsAvailableForLoad(Query.c_str()));
+	}
+	state.SetItemsProcessed(state.iterations() * Source.Queries.size());
+}
+BENCHMARK(BM_AvailableForLoadLegacy)->ArgName("plugins")->Arg(250)->Arg(1000)->Arg(4000)->Unit(benchmark::kMillisecond);
+
+static void BM_AvailableForLoad(benchmark::State& state)
+{
+	auto& Source = GetSource(state.range(0));
+	ArchiveNameSet Names;
+	Names.Initialize(Source.DataPath.c_str(), "*.ba2");
+
+	for (auto _ : state)
+	{
+		for (auto& Query : Source.Queries)
+			benchmark::DoNotOptimize(Names.Contains(Query.c_str()));
+	}
+	state.SetItemsProcessed(state.iterations() * Source.Queries.size());
+}
+BENCHMARK(BM_AvailableForLoad)->ArgName("plugins")->Arg(250)->Arg(1000)->Arg(4000)->Unit(benchmark::kMillisecond);
\ No newline at end of file
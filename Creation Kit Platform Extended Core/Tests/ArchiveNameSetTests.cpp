@@ -0,0 +1,88 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ArchiveNameSet.h"
+#include "ArchiveNameSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// CreationKit.ini читается из текущей папки, как у редактора из папки игры
+	class ArchiveNameSetTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			Tree = Tests::MakeArchiveTree(Temp.Path(), 300, 23);
+			chdir(Temp.Path().c_str());
+			Names.Initialize((Temp.Path() + "/Data/").c_str(), "*.ba2");
+		}
+
+		void TearDown() override
+		{
+			chdir("/");
+		}
+
+		Tests::TempDirectory Temp;
+		Tests::ArchiveTree Tree;
+		ArchiveNameSet Names;
+	};
+}
+
+TEST_F(ArchiveNameSetTest, KeepsPluginArchives)
+{
+	EXPECT_EQ(Names.Size(), Tree.Archives.size() - Tree.Listed.size());
+
+	size_t Found = 0;
+	for (auto& Plugin : Tree.Plugins)
+	{
+		for (auto Suffix : { " - Main.ba2", " - Textures.ba2" })
+		{
+			auto Name = Plugin + Suffix;
+			auto Exists = std::find(Tree.Archives.begin(), Tree.Archives.end(), Name) != Tree.Archives.end();
+			EXPECT_EQ(Names.Contains(Name.c_str()), Exists) << Name;
+			Found += Exists;
+		}
+	}
+	EXPECT_GT(Found, Tree.Plugins.size());
+}
+
+TEST_F(ArchiveNameSetTest, RemovesArchivesListedInINI)
+{
+	for (auto& Name : Tree.Listed)
+		EXPECT_FALSE(Names.Contains(Name.c_str())) << Name;
+
+	// Значение из CreationKitCustom.ini заменяет значение CreationKit.ini, а не дополняет его
+	EXPECT_TRUE(Names.Contains("Fallout4 - HighRes.ba2"));
+}
+
+TEST_F(ArchiveNameSetTest, IgnoresCaseAndSpaces)
+{
+	auto Name = Tree.Plugins[0] + " - Main.ba2";
+	ASSERT_TRUE(Names.Contains(Name.c_str()));
+
+	auto Upper = Name;
+	std::transform(Upper.begin(), Upper.end(), Upper.begin(), [](char c) { return (char)toupper((unsigned char)c); });
+	EXPECT_TRUE(Names.Contains(Upper.c_str()));
+	EXPECT_TRUE(Names.Contains((" \t" + Name + " ").c_str()));
+
+	EXPECT_FALSE(Names.Contains(nullptr));
+	EXPECT_FALSE(Names.Contains(""));
+	EXPECT_FALSE(Names.Contains("   "));
+	EXPECT_FALSE(Names.Contains(String(MAX_PATH, 'a').c_str()));
+	EXPECT_FALSE(Names.Contains((Tree.Plugins[0] + " - Main.bsa").c_str()));
+}
+
+TEST_F(ArchiveNameSetTest, ReinitializesFromScratch)
+{
+	// Повторный Initialize (другая игра или маска) не оставляет прежних имён
+	Names.Initialize((Temp.Path() + "/Data/").c_str(), "*.bsa");
+	EXPECT_EQ(Names.Size(), 0u);
+	EXPECT_FALSE(Names.Contains((Tree.Plugins[0] + " - Main.ba2").c_str()));
+}
\ No newline at end of file
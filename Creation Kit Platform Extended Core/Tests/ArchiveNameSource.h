@@ -0,0 +1,88 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <random>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		struct ArchiveTree
+		{
+			Array<String> Plugins;		// Имена плагинов без расширения, как их отрезает LoadTesFile
+			Array<String> Archives;		// Все архивы в Data
+			Array<String> Listed;		// Архивы из списков CreationKit.ini, их грузит сам редактор
+		};
+
+		// Папка игры в root: Data с архивами Fallout4 и архивами плагинов (Creation Club и моды, " - Main.ba2" и
+		// " - Textures.ba2", не у всех плагинов оба), CreationKit.ini со списками [Archive] и CreationKitCustom.ini,
+		// который переопределяет один из них. Регистр имён на диске и в списках расходится, как у настоящих сборок.
+		// Архивы пустые, набору нужны только имена
+		inline ArchiveTree MakeArchiveTree(const String& root, uint32_t pluginCount, uint32_t seed)
+		{
+			static const char* Vanilla[] = { "Fallout4 - Animations.ba2", "Fallout4 - Interface.ba2", "Fallout4 - Materials.ba2",
+				"Fallout4 - Meshes.ba2", "Fallout4 - MeshesExtra.ba2", "Fallout4 - Misc.ba2", "Fallout4 - Shaders.ba2",
+				"Fallout4 - Sounds.ba2", "Fallout4 - Startup.ba2", "Fallout4 - Textures1.ba2", "Fallout4 - Textures2.ba2",
+				"Fallout4 - Textures3.ba2", "Fallout4 - Textures4.ba2", "Fallout4 - Textures5.ba2", "Fallout4 - Textures6.ba2",
+				"Fallout4 - Textures7.ba2", "Fallout4 - Textures8.ba2", "Fallout4 - Textures9.ba2", "Fallout4 - Voices.ba2",
+				"DLCRobot - Main.ba2", "DLCRobot - Textures.ba2", "DLCCoast - Main.ba2", "DLCCoast - Textures.ba2" };
+			static const char* Words[] = { "Pipboy", "Settlement", "Armor", "Weapons", "Vault", "Paint", "Workshop",
+				"Power", "Companion", "Quest" };
+
+			std::mt19937 Random(seed);
+			ArchiveTree Tree;
+			std::filesystem::create_directories((root + "/Data").c_str());
+
+			auto Touch = [&](String name)
+				{
+					Tree.Archives.push_back(name);
+					if (!(Random() % 5))
+						std::transform(name.begin(), name.end(), name.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+					std::ofstream File((root + "/Data/" + name).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+				};
+
+			for (auto Name : Vanilla)
+				Touch(Name);
+			// Есть только в списке CreationKit.ini, который переопределён, поэтому остаётся в наборе
+			Touch("Fallout4 - HighRes.ba2");
+
+			for (uint32_t i = 0; i < pluginCount; i++)
+			{
+				auto Plugin = (i & 1) ? "ccBGSFO4" + std::to_string(1000 + i) + "-" + Words[Random() % std::size(Words)] :
+					String(Words[Random() % std::size(Words)]) + "Mod" + std::to_string(i);
+				Tree.Plugins.push_back(Plugin);
+
+				auto Kind = Random() % 10;
+				if (Kind < 8)
+					Touch(Plugin + " - Main.ba2");
+				if ((Kind < 6) || (Kind == 9))
+					Touch(Plugin + " - Textures.ba2");
+			}
+
+			// Списки редактора: все архивы игры, имена через запятую с пробелами и в другом регистре
+			String Lists[2];
+			for (size_t i = 0; i < std::size(Vanilla); i++)
+			{
+				String Name = Vanilla[i];
+				Tree.Listed.push_back(Name);
+				if (i & 1)
+					std::transform(Name.begin(), Name.end(), Name.begin(), [](char c) { return (char)toupper((unsigned char)c); });
+				auto& List = Lists[(i < 12) ? 0 : 1];
+				List += (List.empty() ? "" : ", ") + Name;
+			}
+
+			std::ofstream INI((root + "/CreationKit.ini").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			INI << "[Archive]\nsResourceArchiveList=" << Lists[0] << "\nsResourceArchiveList2=Fallout4 - HighRes.ba2\n"
+				"sResourceIndexFileList=Fallout4 - Textures1.ba2\nbInvalidateOlderFiles=1\n";
+
+			// Пользовательский CreationKitCustom.ini заменяет sResourceArchiveList2 целиком
+			std::ofstream Custom((root + "/CreationKitCustom.ini").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			Custom << "[Archive]\nsResourceArchiveList2=" << Lists[1] << "\n";
+
+			return Tree;
+		}
+	}
+}
\ No newline at end of file
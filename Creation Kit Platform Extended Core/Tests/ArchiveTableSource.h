@@ -0,0 +1,335 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Ожидаемые границы таблиц архива, как их должен найти ArchiveDirectoryCache::Parse
+		struct ArchiveTable
+		{
+			uint64_t TableSize;			// Заголовок и записи (у BSA вместе с именами)
+			uint64_t NameTableOffset;	// 0, если таблицы имён нет
+			uint64_t FileSize;
+		};
+
+		namespace Detail
+		{
+			inline void Put(Array<uint8_t>& out, const void* data, size_t size)
+			{
+				out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+			}
+
+			template<typename T>
+			inline void Put(Array<uint8_t>& out, T value)
+			{
+				Put(out, &value, sizeof(T));
+			}
+
+			// Таблицы в начале файла, данные - дыра разреженного файла, хвост (таблица имён BA2) в самом конце
+			inline bool WriteSparse(const String& fileName, const Array<uint8_t>& head, const Array<uint8_t>& tail,
+				uint64_t fileSize)
+			{
+				auto Descriptor = open(fileName.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+				if (Descriptor < 0)
+					return false;
+
+				bool Written = (pwrite(Descriptor, head.data(), head.size(), 0) == (ssize_t)head.size()) &&
+					!ftruncate(Descriptor, (off_t)fileSize) &&
+					(tail.empty() || (pwrite(Descriptor, tail.data(), tail.size(), (off_t)(fileSize - tail.size())) ==
+						(ssize_t)tail.size()));
+				// Страницы чистые, их можно выбросить из кеша (posix_fadvise) для холодного замера
+				Written = !fsync(Descriptor) && Written;
+				close(Descriptor);
+				return Written;
+			}
+		}
+
+		// BSA версии 104 (Skyrim LE, 16 байт на папку) или 105 (SSE, 24 байта). flags - флаги архива:
+		// 1 - имена папок перед записями файлов, 2 - блок имён файлов после всех записей
+		inline ArchiveTable WriteBSA(const String& fileName, uint32_t version, uint32_t folderCount, uint32_t filesPerFolder,
+			uint32_t flags, uint64_t dataSize, uint32_t seed)
+		{
+			std::mt19937 Random(seed);
+			Array<String> Folders, Files;
+			uint32_t FolderNamesLength = 0, FileNamesLength = 0;
+
+			for (uint32_t i = 0; i < folderCount; i++)
+			{
+				Folders.push_back("meshes\\architecture\\folder" + std::to_string(i) + String(Random() % 16, 'x'));
+				FolderNamesLength += (uint32_t)Folders.back().length() + 1;
+				for (uint32_t j = 0; j < filesPerFolder; j++)
+				{
+					Files.push_back("file" + std::to_string(j) + String(Random() % 24, 'y') + ".nif");
+					FileNamesLength += (uint32_t)Files.back().length() + 1;
+				}
+			}
+
+			Array<uint8_t> Head;
+			Head.insert(Head.end(), { 'B', 'S', 'A', 0 });
+			for (uint32_t Value : { version, 36u, flags, folderCount, (uint32_t)Files.size(), FolderNamesLength, FileNamesLength })
+				Detail::Put(Head, Value);
+			Detail::Put<uint16_t>(Head, 1);
+			Detail::Put<uint16_t>(Head, 0);
+
+			for (uint32_t i = 0; i < folderCount; i++)
+			{
+				Detail::Put<uint64_t>(Head, Random());
+				Detail::Put<uint32_t>(Head, filesPerFolder);
+				if (version == 105)
+				{
+					Detail::Put<uint32_t>(Head, 0);
+					Detail::Put<uint64_t>(Head, 0);
+				}
+				else
+					Detail::Put<uint32_t>(Head, 0);
+			}
+
+			for (uint32_t i = 0; i < folderCount; i++)
+			{
+				if (flags & 1)
+				{
+					Detail::Put<uint8_t>(Head, (uint8_t)(Folders[i].length() + 1));
+					Detail::Put(Head, Folders[i].c_str(), Folders[i].length() + 1);
+				}
+
+				for (uint32_t j = 0; j < filesPerFolder; j++)
+				{
+					Detail::Put<uint64_t>(Head, Random());
+					Detail::Put<uint32_t>(Head, 1024);
+					Detail::Put<uint32_t>(Head, 0);
+				}
+			}
+
+			if (flags & 2)
+			{
+				for (auto& Name : Files)
+					Detail::Put(Head, Name.c_str(), Name.length() + 1);
+			}
+
+			ArchiveTable Table = { Head.size(), 0, Head.size() + dataSize };
+			if (!Detail::WriteSparse(fileName, Head, {}, Table.FileSize))
+				Table.FileSize = 0;
+			return Table;
+		}
+
+		// BA2 версии 1 (FO4), 2 или 3 (Starfield, заголовок 32 и 36 байт). DX10 - у каждой текстуры от одной
+		// до maxChunks частей, поэтому длина таблицы зависит от всех записей
+		inline ArchiveTable WriteBA2(const String& fileName, uint32_t version, bool textures, uint32_t fileCount,
+			uint32_t maxChunks, bool names, uint64_t dataSize, uint32_t seed)
+		{
+			std::mt19937 Random(seed);
+			Array<uint8_t> Head, Tail;
+
+			if (names)
+			{
+				for (uint32_t i = 0; i < fileCount; i++)
+				{
+					auto Name = (textures ? "textures\\architecture\\file" : "meshes\\architecture\\file") + std::to_string(i) +
+						String(Random() % 40, 'z') + (textures ? ".dds" : ".nif");
+					Detail::Put<uint16_t>(Tail, (uint16_t)Name.length());
+					Detail::Put(Tail, Name.data(), Name.length());
+				}
+			}
+
+			Head.insert(Head.end(), { 'B', 'T', 'D', 'X' });
+			Detail::Put<uint32_t>(Head, version);
+			Detail::Put(Head, textures ? "DX10" : "GNRL", 4);
+			Detail::Put<uint32_t>(Head, fileCount);
+			// Смещение таблицы имён известно, только когда записаны все записи
+			Detail::Put<uint64_t>(Head, 0);
+			if (version >= 2)
+				Detail::Put<uint64_t>(Head, 1);
+			if (version == 3)
+				Detail::Put<uint32_t>(Head, 0);
+
+			for (uint32_t i = 0; i < fileCount; i++)
+			{
+				Detail::Put<uint32_t>(Head, Random());
+				Detail::Put(Head, textures ? "dds" : "nif", 4);
+				Detail::Put<uint32_t>(Head, Random());
+
+				if (!textures)
+				{
+					Detail::Put<uint32_t>(Head, 0);
+					Detail::Put<uint64_t>(Head, 0);
+					Detail::Put<uint32_t>(Head, 0);
+					Detail::Put<uint32_t>(Head, 4096);
+					Detail::Put<uint32_t>(Head, 0xBAADF00D);
+					continue;
+				}
+
+				auto Chunks = (uint8_t)(1 + Random() % maxChunks);
+				Detail::Put<uint8_t>(Head, 0);
+				Detail::Put<uint8_t>(Head, Chunks);
+				Detail::Put<uint16_t>(Head, 24);
+				Detail::Put<uint16_t>(Head, 512);
+				Detail::Put<uint16_t>(Head, 512);
+				Detail::Put<uint8_t>(Head, 10);
+				Detail::Put<uint8_t>(Head, 98);
+				Detail::Put<uint8_t>(Head, 0);
+				Detail::Put<uint8_t>(Head, 8);
+				for (uint8_t j = 0; j < Chunks; j++)
+				{
+					Detail::Put<uint64_t>(Head, 0);
+					Detail::Put<uint32_t>(Head, 0);
+					Detail::Put<uint32_t>(Head, 65536);
+					Detail::Put<uint16_t>(Head, j);
+					Detail::Put<uint16_t>(Head, j);
+					Detail::Put<uint32_t>(Head, 0xBAADF00D);
+				}
+			}
+
+			ArchiveTable Table = { Head.size(), 0, Head.size() + dataSize + Tail.size() };
+			if (names)
+			{
+				Table.NameTableOffset = Table.FileSize - Tail.size();
+				memcpy(Head.data() + 16, &Table.NameTableOffset, sizeof(uint64_t));
+			}
+
+			if (!Detail::WriteSparse(fileName, Head, Tail, Table.FileSize))
+				Table.FileSize = 0;
+			return Table;
+		}
+
+		// Модель чтения таблиц движком: заголовок, потом запись за записью и имя за именем через буферизованный
+		// поток с окном 4 КБ. Код движка здесь недоступен, важно лишь, что чтения мелкие и зависят друг от друга.
+		// Возвращает число прочитанных байт таблиц
+		class EngineTableReader
+		{
+		public:
+			EngineTableReader(const char* fileName) : _file(CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)) {}
+			~EngineTableReader() { if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file); }
+
+			uint64_t ReadTables()
+			{
+				if (_file == INVALID_HANDLE_VALUE)
+					return 0;
+
+				uint8_t Header[36];
+				if (!Read(0, Header, 24))
+					return 0;
+
+				uint32_t Count = 0;
+				uint64_t Offset = 0, NameTable = 0, Bytes = 0;
+				if (!memcmp(Header, "BSA\0", 4))
+				{
+					if (!Read(24, Header + 24, 12))
+						return 0;
+
+					uint32_t Version, Flags, Folders, Files, FolderNames, FileNames;
+					memcpy(&Version, Header + 4, 4);
+					memcpy(&Flags, Header + 12, 4);
+					memcpy(&Folders, Header + 16, 4);
+					memcpy(&Files, Header + 20, 4);
+					memcpy(&FolderNames, Header + 24, 4);
+					memcpy(&FileNames, Header + 28, 4);
+
+					// Записи папок, потом имена папок с записями файлов и блок имён файлов, всё мелкими чтениями
+					uint8_t Record[64];
+					Offset = 36;
+					auto FolderSize = (Version == 105) ? 24u : 16u;
+					for (uint32_t i = 0; i < Folders; i++, Offset += FolderSize)
+						Bytes += Read(Offset, Record, FolderSize) ? FolderSize : 0;
+					for (uint32_t i = 0; i < Folders; i++)
+					{
+						if (Flags & 1)
+						{
+							uint8_t Length = 0;
+							Read(Offset, &Length, 1);
+							Offset += 1 + Length;
+							Bytes += 1 + Length;
+						}
+						for (uint32_t j = 0; (j < Files / std::max(Folders, 1u)); j++, Offset += 16)
+							Bytes += Read(Offset, Record, 16) ? 16 : 0;
+					}
+					if (Flags & 2)
+					{
+						Array<uint8_t> Names(FileNames);
+						Bytes += Read(Offset, Names.data(), FileNames) ? FileNames : 0;
+					}
+					return Bytes;
+				}
+
+				uint32_t Version;
+				memcpy(&Version, Header + 4, 4);
+				memcpy(&Count, Header + 12, 4);
+				memcpy(&NameTable, Header + 16, 8);
+				Offset = (Version == 2) ? 32 : (Version == 3) ? 36 : 24;
+				bool Textures = !memcmp(Header + 8, "DX10", 4);
+
+				uint8_t Record[36];
+				for (uint32_t i = 0; i < Count; i++)
+				{
+					if (!Textures)
+					{
+						Bytes += Read(Offset, Record, 36) ? 36 : 0;
+						Offset += 36;
+						continue;
+					}
+
+					if (!Read(Offset, Record, 24))
+						return Bytes;
+					Offset += 24;
+					Bytes += 24;
+					for (uint8_t j = 0; j < Record[13]; j++, Offset += 24)
+						Bytes += Read(Offset, Record, 24) ? 24 : 0;
+				}
+
+				for (uint32_t i = 0; NameTable && (i < Count); i++)
+				{
+					uint16_t Length = 0;
+					char Name[MAX_PATH];
+					if (!Read(NameTable, &Length, 2) || (Length > sizeof(Name)) || !Read(NameTable + 2, Name, Length))
+						break;
+					NameTable += 2 + Length;
+					Bytes += 2 + Length;
+				}
+
+				return Bytes;
+			}
+		private:
+			bool Read(uint64_t offset, void* out, size_t size)
+			{
+				if ((offset < _start) || ((offset + size) > (_start + _length)))
+				{
+					if (size > sizeof(_buffer))
+					{
+						DWORD Read = 0;
+						OVERLAPPED Overlapped = {};
+						Overlapped.Offset = (DWORD)offset;
+						Overlapped.OffsetHigh = (DWORD)(offset >> 32);
+						return ReadFile(_file, out, (DWORD)size, &Read, &Overlapped) && (Read == size);
+					}
+
+					DWORD Read = 0;
+					OVERLAPPED Overlapped = {};
+					Overlapped.Offset = (DWORD)offset;
+					Overlapped.OffsetHigh = (DWORD)(offset >> 32);
+					if (!ReadFile(_file, _buffer, sizeof(_buffer), &Read, &Overlapped))
+						Read = 0;
+					_start = offset;
+					_length = Read;
+					if ((offset + size) > (_start + _length))
+						return false;
+				}
+
+				memcpy(out, _buffer + (offset - _start), size);
+				return true;
+			}
+
+			HANDLE _file;
+			uint8_t _buffer[4096];
+			uint64_t _start = 0;
+			size_t _length = 0;
+		};
+	}
+}
\ No newline at end of file
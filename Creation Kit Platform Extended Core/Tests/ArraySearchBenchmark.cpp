@@ -0,0 +1,112 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Поиск отсутствующего значения (полный проход массива) по длинам от 16 до 1M элементов: простой перебор
+// против каждого варианта ArraySearch. range(0) - вариант (0 - перебор, дальше ArraySearchVariants),
+// range(1) - длина в 64-битных словах для FindKey128 и в элементах для остальных. Массивы со сдвигом на один элемент от выровненного начала, как у массивов редактора.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ArraySearch.h"
+#include "ArraySearchSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	constexpr uint32_t MaxLength = 1024 * 1024;
+
+	template<typename T>
+	const T* GetArray()
+	{
+		static auto Storage = []
+			{
+				Array<T> Data(MaxLength + 64);
+				for (size_t i = 0; i < Data.size(); i++)
+					Data[i] = (T)(i * 2 + 1);
+				return Data;
+			}();
+		return (const T*)(((uintptr_t)Storage.data() + 63) & ~(uintptr_t)63) + 1;
+	}
+
+	// false, если вариант на этом процессоре недоступен
+	bool SelectVariant(benchmark::State& state)
+	{
+		if (!state.range(0))
+		{
+			state.SetLabel("scalar");
+			return true;
+		}
+
+		auto& Variant = Tests::ArraySearchVariants[state.range(0) - 1];
+		if (!Variant.Supported())
+		{
+			state.SkipWithError("not supported");
+			return false;
+		}
+
+		Variant.Select();
+		state.SetLabel(Variant.Name);
+		return true;
+	}
+
+	template<typename T, typename Find, typename Scalar>
+	void Search(benchmark::State& state, Find&& find, Scalar&& scalar)
+	{
+		if (!SelectVariant(state))
+			return;
+
+		auto Data = GetArray<T>();
+		auto Length = (uint32_t)state.range(1);
+		for (auto _ : state)
+		{
+			auto Index = state.range(0) ? find(Data, Length, (T)2) : scalar(Data, Length, (T)2);
+			benchmark::DoNotOptimize(Index);
+		}
+
+		state.SetItemsProcessed(state.iterations() * Length);
+		state.SetBytesProcessed(state.iterations() * Length * sizeof(T));
+		Tests::DestroyEngine();
+	}
+
+	void Lengths(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->ArgNames({ "variant", "length" });
+		for (int64_t Variant = 0; Variant <= (int64_t)std::size(Tests::ArraySearchVariants); Variant++)
+			for (int64_t Length = 16; Length <= MaxLength; Length *= 16)
+				benchmark->Args({ Variant, Length });
+	}
+}
+
+static void BM_Find32(benchmark::State& state)
+{
+	Search<uint32_t>(state, ArraySearch::Find32, [](const uint32_t* data, uint32_t count, uint32_t value)
+		{
+			return Tests::FindScalar(data, count, value);
+		});
+}
+BENCHMARK(BM_Find32)->Apply(Lengths);
+
+static void BM_Find64(benchmark::State& state)
+{
+	Search<uint64_t>(state, ArraySearch::Find64, [](const uint64_t* data, uint32_t count, uint64_t value)
+		{
+			return Tests::FindScalar(data, count, value);
+		});
+}
+BENCHMARK(BM_Find64)->Apply(Lengths);
+
+static void BM_FindKey128(benchmark::State& state)
+{
+	Search<uint64_t>(state, [](const uint64_t* data, uint32_t count, uint64_t key)
+		{
+			return ArraySearch::FindKey128(data, count / 2, key);
+		}, [](const uint64_t* data, uint32_t count, uint64_t key)
+		{
+			return Tests::FindScalar(data, count / 2, key, 2);
+		});
+}
+BENCHMARK(BM_FindKey128)->Apply(Lengths);
\ No newline at end of file
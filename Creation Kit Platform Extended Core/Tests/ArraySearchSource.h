@@ -0,0 +1,59 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Вариант ArraySearch и признаки процессора, по которым Initialize() его выбирает
+		struct ArraySearchVariant
+		{
+			const char* Name;
+			bool HasSSE41;
+			bool HasAVX2;
+			bool HasAVX512;
+
+			inline bool Supported() const
+			{
+				return (!HasSSE41 || __builtin_cpu_supports("sse4.1")) && (!HasAVX2 || __builtin_cpu_supports("avx2")) &&
+					(!HasAVX512 || __builtin_cpu_supports("avx512f"));
+			}
+
+			// Пересоздаёт Engine с признаками варианта и выбирает его
+			inline void Select() const
+			{
+				auto& Config = GetEngineConfig();
+				Config.HasSSE41 = HasSSE41;
+				Config.HasAVX2 = HasAVX2;
+				Config.HasAVX512 = HasAVX512;
+				CreateEngine();
+				Core::ArraySearch::Initialize();
+			}
+		};
+
+		inline void PrintTo(const ArraySearchVariant& variant, std::ostream* os)
+		{
+			*os << variant.Name;
+		}
+
+		constexpr ArraySearchVariant ArraySearchVariants[] =
+		{
+			{ "SSE2", false, false, false },
+			{ "SSE 4.1", true, false, false },
+			{ "AVX2", true, true, false },
+			{ "AVX-512", true, true, true },
+		};
+
+		// Эталон: простой перебор, как до векторных вариантов
+		template<typename T>
+		inline uint32_t FindScalar(const T* data, uint32_t count, T value, uint32_t stride = 1)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				if (data[(size_t)i * stride] == value) return i;
+			return Core::ArraySearch::INVALID_INDEX;
+		}
+	}
+}
\ No newline at end of file
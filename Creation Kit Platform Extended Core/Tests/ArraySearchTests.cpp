@@ -0,0 +1,241 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ArraySearch.h"
+#include "ArraySearchSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Длины вокруг размеров блоков всех вариантов и несколько больших
+	Array<uint32_t> GetLengths()
+	{
+		Array<uint32_t> Lengths;
+		for (uint32_t i = 0; i <= 200; i++)
+			Lengths.push_back(i);
+		for (uint32_t Length : { 255u, 256u, 257u, 1000u, 1023u, 1024u, 4099u })
+			Lengths.push_back(Length);
+		return Lengths;
+	}
+
+	// Места совпадения: начало, граница выравнивания, середина и конец
+	Array<uint32_t> GetPositions(uint32_t length)
+	{
+		Array<uint32_t> Positions;
+		for (uint32_t Position : { 0u, 1u, 7u, 8u, 15u, 16u, 31u, 32u, 63u, length / 2, length - 2, length - 1 })
+		{
+			if ((Position < length) && (std::find(Positions.begin(), Positions.end(), Position) == Positions.end()))
+				Positions.push_back(Position);
+		}
+		return Positions;
+	}
+
+	class ArraySearchTest : public ::testing::TestWithParam<Tests::ArraySearchVariant>
+	{
+	protected:
+		void SetUp() override
+		{
+			if (!GetParam().Supported())
+				GTEST_SKIP() << GetParam().Name << " is not supported";
+
+			GetParam().Select();
+			ASSERT_STREQ(ArraySearch::GetVariantName(), GetParam().Name);
+		}
+
+		void TearDown() override
+		{
+			auto& Config = Tests::GetEngineConfig();
+			Config.HasSSE41 = __builtin_cpu_supports("sse4.1");
+			Config.HasAVX2 = __builtin_cpu_supports("avx2");
+			Config.HasAVX512 = __builtin_cpu_supports("avx512bw");
+			Tests::DestroyEngine();
+		}
+
+		// Массив со сдвигом от выровненного на 64 байта начала на offset элементов, по элементу до и после него
+		template<typename T>
+		static T* Place(Array<T>& storage, uint32_t offset, uint32_t length)
+		{
+			storage.assign(length + offset + 64, T());
+			auto Aligned = (T*)(((uintptr_t)(storage.data() + 1) + 63) & ~(uintptr_t)63);
+			return Aligned + offset;
+		}
+
+		// Сравнение с эталоном: значения вне массива, одно совпадение, два совпадения, промах
+		template<typename T, typename Find>
+		static void ExpectSameAsScalar(Find&& find, T miss)
+		{
+			std::mt19937_64 Random(21);
+			Array<T> Storage;
+
+			for (uint32_t Offset = 0; Offset < (64 / sizeof(T)); Offset++)
+			{
+				for (auto Length : GetLengths())
+				{
+					auto Data = Place(Storage, Offset, Length);
+					for (uint32_t i = 0; i < Length; i++)
+						Data[i] = (T)(Random() | 1);
+
+					// Искомое значение вокруг массива не должно находиться
+					Data[-1] = miss;
+					Data[Length] = miss;
+					ASSERT_EQ(find(Data, Length, miss), Tests::FindScalar(Data, Length, miss))
+						<< "offset " << Offset << " length " << Length;
+
+					for (auto Position : GetPositions(Length))
+					{
+						auto Saved = Data[Position];
+						Data[Position] = miss;
+						ASSERT_EQ(find(Data, Length, miss), Position) << "offset " << Offset << " length " << Length;
+
+						// Первое из двух совпадений
+						if ((Position + 1) < Length)
+						{
+							auto Next = Data[Length - 1];
+							Data[Length - 1] = miss;
+							ASSERT_EQ(find(Data, Length, miss), Position) << "offset " << Offset << " length " << Length;
+							Data[Length - 1] = Next;
+						}
+
+						Data[Position] = Saved;
+					}
+				}
+			}
+		}
+	};
+}
+
+TEST_P(ArraySearchTest, Find32MatchesScalar)
+{
+	ExpectSameAsScalar<uint32_t>(ArraySearch::Find32, 0x12345678u & ~1u);
+}
+
+TEST_P(ArraySearchTest, Find64MatchesScalar)
+{
+	ExpectSameAsScalar<uint64_t>(ArraySearch::Find64, 0x0123456789ABCDEEull);
+}
+
+TEST_P(ArraySearchTest, Find64ComparesWholeWord)
+{
+	// Без SSE 4.1 слово сравнивается половинами, совпадение одной из них - не совпадение
+	const uint64_t Value = 0x0123456789ABCDEFull;
+	Array<uint64_t> Storage;
+
+	for (uint32_t Offset = 0; Offset < 8; Offset++)
+	{
+		for (uint32_t Length = 1; Length <= 80; Length++)
+		{
+			auto Data = Place(Storage, Offset, Length);
+			for (uint32_t i = 0; i < Length; i++)
+				Data[i] = (i & 1) ? (Value ^ 0xFFFFFFFF00000000ull) : (Value ^ 0x00000000FFFFFFFFull);
+
+			ASSERT_EQ(ArraySearch::Find64(Data, Length, Value), ArraySearch::INVALID_INDEX)
+				<< "offset " << Offset << " length " << Length;
+
+			Data[Length - 1] = Value;
+			ASSERT_EQ(ArraySearch::Find64(Data, Length, Value), Length - 1) << "offset " << Offset << " length " << Length;
+		}
+	}
+}
+
+TEST_P(ArraySearchTest, FindPointerMatchesScalar)
+{
+	ExpectSameAsScalar<const void*>([](const void** data, uint32_t count, const void* value)
+		{
+			return ArraySearch::FindPointer(data, count, value);
+		}, (const void*)0x00007FF6ABCD1230ull);
+}
+
+TEST_P(ArraySearchTest, FindKey128SkipsSecondWord)
+{
+	// Элементы по 16 байт: ключ во втором слове элемента - не совпадение, ищется только первое
+	std::mt19937_64 Random(128);
+	const uint64_t Key = 0x00000001000ABCDEull;
+	Array<uint64_t> Storage;
+
+	for (uint32_t Offset = 0; Offset < 8; Offset++)
+	{
+		for (auto Length : GetLengths())
+		{
+			auto Data = Place(Storage, Offset, Length * 2);
+			for (uint32_t i = 0; i < Length; i++)
+			{
+				Data[i * 2] = Random() | 1;
+				Data[i * 2 + 1] = Key;
+			}
+			Data[-1] = Key;
+			Data[Length * 2] = Key;
+
+			ASSERT_EQ(ArraySearch::FindKey128(Data, Length, Key), ArraySearch::INVALID_INDEX)
+				<< "offset " << Offset << " length " << Length;
+
+			for (auto Position : GetPositions(Length))
+			{
+				auto Saved = Data[Position * 2];
+				Data[Position * 2] = Key;
+				ASSERT_EQ(ArraySearch::FindKey128(Data, Length, Key), Tests::FindScalar<uint64_t>(Data, Length, Key, 2))
+					<< "offset " << Offset << " length " << Length;
+				ASSERT_EQ(ArraySearch::FindKey128(Data, Length, Key), Position);
+				Data[Position * 2] = Saved;
+			}
+		}
+	}
+}
+
+TEST_P(ArraySearchTest, StaysInsidePages)
+{
+	// Массив вплотную к недоступным страницам с обеих сторон: чтение за его пределами - падение теста
+	auto PageSize = (size_t)sysconf(_SC_PAGESIZE);
+	auto Pages = (uint8_t*)VirtualAlloc(nullptr, PageSize * 3, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	ASSERT_NE(Pages, nullptr);
+	DWORD OldProtect;
+	ASSERT_TRUE(VirtualProtect(Pages, PageSize, PAGE_NOACCESS, &OldProtect));
+	ASSERT_TRUE(VirtualProtect(Pages + PageSize * 2, PageSize, PAGE_NOACCESS, &OldProtect));
+
+	auto Begin = Pages + PageSize, End = Pages + PageSize * 2;
+	memset(Begin, 0x11, PageSize);
+
+	for (uint32_t Length = 0; Length <= 300; Length++)
+	{
+		for (uint32_t Shift = 0; Shift < 64; Shift += 4)
+		{
+			// От начала страницы со сдвигом и до самого её конца
+			auto Head32 = (const uint32_t*)(Begin + Shift);
+			auto Tail32 = (const uint32_t*)End - Length;
+			ASSERT_EQ(ArraySearch::Find32(Head32, Length, 7), ArraySearch::INVALID_INDEX);
+			ASSERT_EQ(ArraySearch::Find32((const uint32_t*)((const uint8_t*)Tail32 - Shift), Length, 7),
+				ArraySearch::INVALID_INDEX);
+
+			if (Shift & 4)
+				continue;
+
+			auto Head64 = (const uint64_t*)(Begin + Shift);
+			auto Tail64 = (const uint64_t*)End - Length;
+			ASSERT_EQ(ArraySearch::Find64(Head64, Length, 7), ArraySearch::INVALID_INDEX);
+			ASSERT_EQ(ArraySearch::Find64((const uint64_t*)((const uint8_t*)Tail64 - Shift), Length, 7),
+				ArraySearch::INVALID_INDEX);
+
+			if (Length <= 150)
+			{
+				ASSERT_EQ(ArraySearch::FindKey128(Head64, Length, 7), ArraySearch::INVALID_INDEX);
+				ASSERT_EQ(ArraySearch::FindKey128((const uint64_t*)End - Length * 2, Length, 7), ArraySearch::INVALID_INDEX);
+			}
+		}
+	}
+
+	VirtualFree(Pages, 0, MEM_RELEASE);
+}
+
+INSTANTIATE_TEST_SUITE_P(Simd, ArraySearchTest, ::testing::ValuesIn(Tests::ArraySearchVariants),
+	[](const ::testing::TestParamInfo<Tests::ArraySearchVariant>& info)
+	{
+		String Name = info.param.Name;
+		Name.erase(std::remove_if(Name.begin(), Name.end(), [](char c) { return !isalnum((unsigned char)c); }), Name.end());
+		return Name;
+	});
\ No newline at end of file
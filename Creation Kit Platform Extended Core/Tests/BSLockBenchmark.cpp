@@ -0,0 +1,247 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Потоки по очереди берут одну блокировку и держат её range(0) шагов пустого цикла (0 - пустой участок,
+// 100 - короткий, как у счётчиков, 10000 - около 10 мкс, дольше вращения перед сном). PAUSE для
+// удержания не годится: под виртуальной машиной его длительность сильно скачет. Новые BSSpinLock
+// и BSReadWriteLock (вращение по времени, затем сон на адресе) против прежних: Sleep(0)/Sleep(1)
+// у BSSpinLock и бесконечное вращение у BSReadWriteLock. У блокировки чтения-записи каждый
+// четвёртый захват на запись.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Editor API/BSSpinLock.h"
+#include "Editor API/BSReadWriteLock.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::EditorAPI;
+
+namespace
+{
+	// Прежний BSSpinLock::Acquire/Release
+	class LegacySpinLock
+	{
+	public:
+		void Acquire()
+		{
+			if (ThreadOwnsLock())
+			{
+				InterlockedIncrement(&m_LockCount);
+				return;
+			}
+
+			if (InterlockedCompareExchange(&m_LockCount, 1, 0) != 0)
+			{
+				bool locked = false;
+				_mm_pause();
+				locked = InterlockedCompareExchange(&m_LockCount, 1, 0) == 0;
+
+				for (uint32_t counter = 0; !locked;)
+				{
+					if (counter < 10000)
+					{
+						Sleep(0);
+						counter++;
+					}
+					else
+						Sleep(1);
+
+					locked = InterlockedCompareExchange(&m_LockCount, 1, 0) == 0;
+				}
+
+				_mm_lfence();
+			}
+
+			m_OwningThread = GetCurrentThreadId();
+			_mm_sfence();
+		}
+
+		void Release()
+		{
+			// Те же проверки, что и в BSSpinLock::Release
+			AssertMsg(m_LockCount != 0, "Invalid lock count");
+			AssertMsg(ThreadOwnsLock(), "Thread does not own spinlock");
+
+			if (!ThreadOwnsLock())
+				return;
+
+			if (m_LockCount == 1)
+			{
+				m_OwningThread = 0;
+				_mm_mfence();
+				InterlockedCompareExchange(&m_LockCount, 0, 1);
+			}
+			else
+				InterlockedDecrement(&m_LockCount);
+		}
+
+		bool ThreadOwnsLock() const
+		{
+			_mm_lfence();
+			return m_OwningThread == GetCurrentThreadId();
+		}
+	private:
+		uint32_t m_OwningThread = 0;
+		volatile uint32_t m_LockCount = 0;
+	};
+
+	// Прежний BSReadWriteLock без повторного захвата: вращение до успеха
+	class LegacyReadWriteLock
+	{
+	public:
+		void LockForRead()
+		{
+			for (uint32_t count = 0; !TryLockForRead();)
+			{
+				if (++count > 1000)
+					YieldProcessor();
+			}
+		}
+
+		void UnlockRead()
+		{
+			m_Bits.fetch_add(-READER, std::memory_order_release);
+		}
+
+		void LockForWrite()
+		{
+			for (uint32_t count = 0; !TryLockForWrite();)
+			{
+				if (++count > 1000)
+					YieldProcessor();
+			}
+		}
+
+		void UnlockWrite()
+		{
+			m_Bits.fetch_and(~WRITER, std::memory_order_release);
+		}
+	private:
+		bool TryLockForRead()
+		{
+			if (m_Bits.fetch_add(READER, std::memory_order_acquire) & WRITER)
+			{
+				m_Bits.fetch_add(-READER, std::memory_order_release);
+				return false;
+			}
+			return true;
+		}
+
+		bool TryLockForWrite()
+		{
+			int16_t expect = 0;
+			return m_Bits.compare_exchange_strong(expect, WRITER, std::memory_order_acq_rel);
+		}
+
+		enum : int16_t
+		{
+			READER = 2,
+			WRITER = 1
+		};
+
+		std::atomic<int16_t> m_Bits = 0;
+	};
+
+	inline void Hold(int64_t steps)
+	{
+		for (volatile int64_t i = 0; i < steps; i++);
+	}
+
+	// Одна итерация замера - range(1) потоков разом делают общую порцию захватов, время по часам
+	// до выхода последнего. Потоки Google Benchmark тут не годятся: у них время усредняется по
+	// потокам, и несправедливая блокировка, отдающая себя одному потоку подряд, выглядит быстрее.
+	template<typename Body>
+	void Contend(benchmark::State& state, Body&& body)
+	{
+		auto Threads = (uint32_t)state.range(1);
+		auto Total = (state.range(0) >= 10000) ? 4096u : 65536u;
+		auto PerThread = Total / Threads;
+
+		for (auto _ : state)
+		{
+			std::atomic<uint32_t> Ready = 0;
+			Array<std::thread> Workers;
+			for (uint32_t t = 0; t < Threads; t++)
+			{
+				Workers.emplace_back([&]
+					{
+						Ready++;
+						while (Ready.load() != Threads)
+							std::this_thread::yield();
+
+						for (uint32_t i = 0; i < PerThread; i++)
+							body(i);
+					});
+			}
+			for (auto& Worker : Workers)
+				Worker.join();
+		}
+		state.SetItemsProcessed(state.iterations() * PerThread * Threads);
+	}
+
+	template<typename Lock>
+	void SpinLockLoop(benchmark::State& state, Lock& lock)
+	{
+		Contend(state, [&](uint32_t)
+			{
+				lock.Acquire();
+				Hold(state.range(0));
+				lock.Release();
+			});
+	}
+
+	template<typename Lock>
+	void ReadWriteLockLoop(benchmark::State& state, Lock& lock)
+	{
+		Contend(state, [&](uint32_t i)
+			{
+				if ((i & 3) == 0)
+				{
+					lock.LockForWrite();
+					Hold(state.range(0));
+					lock.UnlockWrite();
+				}
+				else
+				{
+					lock.LockForRead();
+					Hold(state.range(0));
+					lock.UnlockRead();
+				}
+			});
+	}
+
+	LegacySpinLock GlobalLegacySpinLock;
+	BSSpinLock GlobalSpinLock;
+	LegacyReadWriteLock GlobalLegacyReadWriteLock;
+	BSReadWriteLock GlobalReadWriteLock;
+}
+
+static void BM_SpinLockLegacy(benchmark::State& state)
+{
+	SpinLockLoop(state, GlobalLegacySpinLock);
+}
+BENCHMARK(BM_SpinLockLegacy)->ArgsProduct({ { 0, 100, 10000 }, { 1, 4, 16 } })
+	->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_SpinLock(benchmark::State& state)
+{
+	SpinLockLoop(state, GlobalSpinLock);
+}
+BENCHMARK(BM_SpinLock)->ArgsProduct({ { 0, 100, 10000 }, { 1, 4, 16 } })
+	->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_ReadWriteLockLegacy(benchmark::State& state)
+{
+	ReadWriteLockLoop(state, GlobalLegacyReadWriteLock);
+}
+BENCHMARK(BM_ReadWriteLockLegacy)->ArgsProduct({ { 0, 100, 10000 }, { 1, 4, 16 } })
+	->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_ReadWriteLock(benchmark::State& state)
+{
+	ReadWriteLockLoop(state, GlobalReadWriteLock);
+}
+BENCHMARK(BM_ReadWriteLock)->ArgsProduct({ { 0, 100, 10000 }, { 1, 4, 16 } })
+	->Unit(benchmark::kMicrosecond)->UseRealTime();
\ No newline at end of file
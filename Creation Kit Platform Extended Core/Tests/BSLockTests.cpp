@@ -0,0 +1,209 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <time.h>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Editor API/BSSpinLock.h"
+#include "Editor API/BSReadWriteLock.h"
+#include "Editor API/BSLockWait.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::EditorAPI;
+
+namespace
+{
+	constexpr uint32_t THREADS = 8;
+
+	double GetThreadCpuMs()
+	{
+		struct timespec Time;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+		return Time.tv_sec * 1000.0 + Time.tv_nsec / 1000000.0;
+	}
+
+	// Поток ждёт блокировку, пока другой держит её HOLD_MS. Ожидание дольше отведённого на вращение
+	// должно уходить в сон, а не в вращение и Sleep(0): за всё время ожидания поток почти не тратит процессор.
+	constexpr uint32_t HOLD_MS = 100;
+
+	template<typename Acquire, typename Release, typename Wait, typename Leave>
+	void ExpectParkedWait(Acquire&& acquire, Release&& release, Wait&& wait, Leave&& leave)
+	{
+		std::atomic<bool> Held = false;
+		std::atomic<bool> Entered = false;
+		double Cpu = 0;
+
+		std::thread Holder([&]
+			{
+				acquire();
+				Held = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(HOLD_MS));
+				EXPECT_FALSE(Entered.load());
+				release();
+			});
+
+		while (!Held.load())
+			std::this_thread::yield();
+
+		std::thread Waiter([&]
+			{
+				auto Start = GetThreadCpuMs();
+				wait();
+				Cpu = GetThreadCpuMs() - Start;
+				Entered = true;
+				leave();
+			});
+
+		Holder.join();
+		Waiter.join();
+
+		EXPECT_TRUE(Entered.load());
+		EXPECT_LT(Cpu, HOLD_MS / 10.0) << "the waiter spun instead of parking";
+	}
+}
+
+TEST(BSLockWaitTest, CalibratesSpinCount)
+{
+	// Около SPIN_TIME_NS на вращение, в пределах зажима
+	auto Count = BSLockWait::GetSpinCount();
+	EXPECT_GE(Count, 16u);
+	EXPECT_LE(Count, 100000u);
+	EXPECT_EQ(BSLockWait::GetSpinCount(), Count);
+	EXPECT_GT(BSLockWait::GetTicksPerMs(), 0u);
+}
+
+TEST(BSSpinLockTest, ExcludesAndRecurses)
+{
+	BSSpinLock Lock;
+	uint64_t Counter = 0;
+
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < THREADS; t++)
+	{
+		Threads.emplace_back([&, t]
+			{
+				std::mt19937 Random(t);
+				for (uint32_t i = 0; i < 20000; i++)
+				{
+					Lock.Acquire();
+					EXPECT_TRUE(Lock.ThreadOwnsLock());
+
+					// Повторный захват тем же потоком
+					auto Nested = Random() % 4 == 0;
+					if (Nested)
+						Lock.Acquire();
+					Counter++;
+					if (Nested)
+						Lock.Release();
+
+					Lock.Release();
+				}
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	EXPECT_EQ(Counter, THREADS * 20000ull);
+	EXPECT_FALSE(Lock.IsLocked());
+}
+
+TEST(BSSpinLockTest, ParksContendedWaiters)
+{
+	BSSpinLock Lock;
+	ExpectParkedWait([&] { Lock.Acquire(); }, [&] { Lock.Release(); }, [&] { Lock.Acquire(); },
+		[&] { Lock.Release(); });
+	EXPECT_FALSE(Lock.IsLocked());
+}
+
+TEST(BSReadWriteLockTest, ReadersShareWritersExclude)
+{
+	BSReadWriteLock Lock;
+	std::atomic<int32_t> Readers = 0;
+	std::atomic<int32_t> Writers = 0;
+	std::atomic<int32_t> MaxReaders = 0;
+	std::atomic<uint64_t> Errors = 0;
+	uint64_t Counter = 0;
+
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < THREADS; t++)
+	{
+		Threads.emplace_back([&, t]
+			{
+				std::mt19937 Random(t);
+				for (uint32_t i = 0; i < 20000; i++)
+				{
+					if (Random() % 4 == 0)
+					{
+						Lock.LockForWrite();
+						if (Writers.fetch_add(1) || Readers.load())
+							Errors++;
+
+						// Повторный захват на запись и чтение под записью
+						Lock.LockForWrite();
+						Lock.LockForRead();
+						Counter++;
+						Lock.UnlockRead();
+						Lock.UnlockWrite();
+
+						Writers.fetch_sub(1);
+						Lock.UnlockWrite();
+					}
+					else
+					{
+						Lock.LockForRead();
+						auto Inside = Readers.fetch_add(1) + 1;
+						if (Writers.load())
+							Errors++;
+
+						auto Max = MaxReaders.load();
+						while ((Max < Inside) && !MaxReaders.compare_exchange_weak(Max, Inside));
+						std::this_thread::yield();
+
+						Readers.fetch_sub(1);
+						Lock.UnlockRead();
+					}
+				}
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	EXPECT_EQ(Errors.load(), 0u);
+	EXPECT_GT(MaxReaders.load(), 1);
+
+	// Все захваты на запись прошли: счётчик совпадает с числом выпавших записей
+	uint64_t Expected = 0;
+	for (uint32_t t = 0; t < THREADS; t++)
+	{
+		std::mt19937 Random(t);
+		for (uint32_t i = 0; i < 20000; i++)
+		{
+			if (Random() % 4 == 0)
+				Expected++;
+		}
+	}
+	EXPECT_EQ(Counter, Expected);
+	EXPECT_TRUE(Lock.TryLockForWrite());
+	Lock.UnlockWrite();
+}
+
+TEST(BSReadWriteLockTest, ParksWriterBehindReader)
+{
+	BSReadWriteLock Lock;
+	ExpectParkedWait([&] { Lock.LockForRead(); }, [&] { Lock.UnlockRead(); }, [&] { Lock.LockForWrite(); },
+		[&] { Lock.UnlockWrite(); });
+	EXPECT_TRUE(Lock.TryLockForWrite());
+	Lock.UnlockWrite();
+}
+
+TEST(BSReadWriteLockTest, ParksReaderBehindWriter)
+{
+	BSReadWriteLock Lock;
+	ExpectParkedWait([&] { Lock.LockForWrite(); }, [&] { Lock.UnlockWrite(); }, [&] { Lock.LockForRead(); },
+		[&] { Lock.UnlockRead(); });
+	EXPECT_TRUE(Lock.TryLockForWrite());
+	Lock.UnlockWrite();
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Создание и уничтожение дескрипторов, как при загрузке ячеек: у каждого потока свои ссылки,
+// дескриптор живёт, пока поток создаёт ещё range(0) других. Кеши потоков и стек без блокировок
+// против прежнего менеджера, где всё шло через одну блокировку и общий свободный список.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "HandleManagerSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::EditorAPI::Fallout4;
+using namespace CreationKitPlatformExtended::Tests;
+
+namespace
+{
+	// Прежний менеджер (до переработки): таблица целиком, свободный список через индексы записей,
+	// освобождённые в хвост. Прежде блокировка бралась через TryLockForWrite без проверки результата,
+	// здесь она настоящая, иначе сравнение с менеджером без блокировок нечестное.
+	template<typename EntryType, typename HandleType, typename ObjectType>
+	class LockedHandleManager
+	{
+	public:
+		LockedHandleManager() : Entries(HandleType::MAX_HANDLE_COUNT + 1)
+		{
+			for (uint32_t i = 0; i < HandleType::MAX_HANDLE_COUNT; i++)
+				Entries[i].SetNextFreeEntry(((i + 1) >= HandleType::MAX_HANDLE_COUNT) ? i : i + 1);
+			FreeListTail = HandleType::MAX_HANDLE_COUNT - 1;
+		}
+
+		HandleType CreateHandle(ObjectType* Refr)
+		{
+			HandleType untypedHandle;
+			SimpleLocker locker(&Lock);
+
+			if (Refr->IsHandleValid())
+			{
+				untypedHandle.Set(Refr->GetHandleEntryIndex(), Entries[Refr->GetHandleEntryIndex()].GetAge());
+				return untypedHandle;
+			}
+
+			if (FreeListHead == INVALID_INDEX)
+				return untypedHandle;
+
+			auto& newHandle = Entries[FreeListHead];
+			newHandle.IncrementAge();
+			newHandle.SetInUse();
+			newHandle.SetPointer(Refr);
+
+			untypedHandle.Set(FreeListHead, newHandle.GetAge());
+			Refr->SetHandleEntryIndex(FreeListHead);
+
+			if (newHandle.GetNextFreeEntry() == FreeListHead)
+				FreeListHead = FreeListTail = INVALID_INDEX;
+			else
+				FreeListHead = newHandle.GetNextFreeEntry();
+
+			return untypedHandle;
+		}
+
+		void Destroy(HandleType& Handle)
+		{
+			SimpleLocker locker(&Lock);
+
+			const auto handleIndex = Handle.GetIndex();
+			auto& arrayHandle = Entries[handleIndex];
+
+			if (arrayHandle.IsValid(Handle.GetAge()))
+			{
+				arrayHandle.GetPointer()->ClearHandleEntryIndex();
+				arrayHandle.SetPointer(nullptr);
+				arrayHandle.SetNotInUse();
+
+				if (FreeListTail == INVALID_INDEX)
+					FreeListHead = handleIndex;
+				else
+					Entries[FreeListTail].SetNextFreeEntry(handleIndex);
+
+				arrayHandle.SetNextFreeEntry(handleIndex);
+				FreeListTail = handleIndex;
+			}
+
+			Handle.SetBitwiseNull();
+		}
+	private:
+		constexpr static uint32_t INVALID_INDEX = (uint32_t)-1;
+
+		SimpleLock Lock;
+		uint32_t FreeListHead = 0;
+		uint32_t FreeListTail = 0;
+		Array<EntryType> Entries;
+	};
+
+	typedef LockedHandleManager<BSPointerHandleManagerEntry_Original, BSUntypedPointerHandle_Original,
+		TESObjectREFR_Original> LockedHandleManagerOriginal;
+
+	LockedHandleManagerOriginal* Locked = nullptr;
+
+	// Setup и Teardown вызываются один раз на все потоки замера
+	void SetUpHandleManagers(const benchmark::State&)
+	{
+		static bool Initialized = false;
+		if (!Initialized)
+		{
+			HandleManagerOriginal::InitSDM();
+			HandleManagerExtended::InitSDM();
+			Initialized = true;
+		}
+
+		Locked = new LockedHandleManagerOriginal();
+	}
+
+	void TearDownHandleManagers(const benchmark::State&)
+	{
+		delete Locked;
+		Locked = nullptr;
+	}
+
+	template<typename Object, typename Handle, typename Create, typename Destroy>
+	void Churn(benchmark::State& state, Create&& create, Destroy&& destroy)
+	{
+		auto Live = (size_t)state.range(0);
+		auto Objects = std::make_unique<Object[]>(Live);
+		Array<Handle> Handles(Live);
+		size_t Next = 0;
+
+		for (auto _ : state)
+		{
+			auto& Item = Handles[Next];
+			if (!Item.IsBitwiseNull())
+				destroy(Item);
+			Item = create(&Objects[Next]);
+			benchmark::DoNotOptimize(Item);
+
+			if (++Next == Live)
+				Next = 0;
+		}
+
+		for (auto& Item : Handles)
+		{
+			if (!Item.IsBitwiseNull())
+				destroy(Item);
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+}
+
+static void BM_HandleManagerLocked(benchmark::State& state)
+{
+	Churn<TESObjectREFR_Original, BSUntypedPointerHandle_Original>(state,
+		[](auto Refr) { return Locked->CreateHandle(Refr); },
+		[](auto& Handle) { Locked->Destroy(Handle); });
+}
+BENCHMARK(BM_HandleManagerLocked)->Arg(512)->Arg(16384)->ThreadRange(1, 8)->UseRealTime()
+	->Setup(SetUpHandleManagers)->Teardown(TearDownHandleManagers);
+
+static void BM_HandleManagerOriginal(benchmark::State& state)
+{
+	Churn<TESObjectREFR_Original, BSUntypedPointerHandle_Original>(state,
+		[](auto Refr) { return HandleManagerOriginal::CreateHandle(Refr); },
+		[](auto& Handle) { HandleManagerOriginal::Destroy2(Handle); });
+}
+BENCHMARK(BM_HandleManagerOriginal)->Arg(512)->Arg(16384)->ThreadRange(1, 8)->UseRealTime()
+	->Setup(SetUpHandleManagers)->Teardown(TearDownHandleManagers);
+
+static void BM_HandleManagerExtended(benchmark::State& state)
+{
+	Churn<TESObjectREFR_Extremly, BSUntypedPointerHandle_Extended>(state,
+		[](auto Refr) { return HandleManagerExtended::CreateHandle(Refr); },
+		[](auto& Handle) { HandleManagerExtended::Destroy2(Handle); });
+}
+BENCHMARK(BM_HandleManagerExtended)->Arg(512)->Arg(16384)->ThreadRange(1, 8)->UseRealTime()
+	->Setup(SetUpHandleManagers)->Teardown(TearDownHandleManagers);
\ No newline at end of file
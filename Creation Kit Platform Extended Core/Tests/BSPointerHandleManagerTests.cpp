@@ -0,0 +1,365 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "HandleManagerSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Tests;
+
+namespace
+{
+	// Таблица одна на вариант и на процесс, как и в редакторе: InitSDM один раз на набор тестов,
+	// тесты не рассчитывают на конкретные индексы и возвращают записи за собой
+	template<typename Manager>
+	class BSPointerHandleManagerTest : public ::testing::Test
+	{
+	protected:
+		typedef typename Manager::ObjectType Object;
+		typedef decltype(Manager::CreateHandle(nullptr)) Handle;
+
+		constexpr static bool LazyCommit = !std::is_same_v<Manager, HandleManagerExtendedNG>;
+
+		static void SetUpTestSuite()
+		{
+			auto Resident = GetResidentSize();
+			auto Start = std::chrono::steady_clock::now();
+			Manager::InitSDM();
+			InitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+			InitResident = (int64_t)GetResidentSize() - (int64_t)Resident;
+
+			printf("InitSDM: %.2f ms, %+lld KB resident\n", InitTime, (long long)(InitResident / 1024));
+		}
+
+		static bool Resolves(const Handle& handle, Object* object)
+		{
+			NiAPI::NiPointer<Object> Pointer;
+			return Manager::IsValid(handle) && Manager::GetSmartPointer1(handle, Pointer) && (Pointer == object) &&
+				(handle.GetIndex() == object->GetHandleEntryIndex());
+		}
+
+		inline static double InitTime = 0;
+		inline static int64_t InitResident = 0;
+	};
+
+	class ManagerNames
+	{
+	public:
+		template<typename T>
+		static std::string GetName(int)
+		{
+			if constexpr (std::is_same_v<T, HandleManagerOriginal>)
+				return "Original";
+			else if constexpr (std::is_same_v<T, HandleManagerExtendedNG>)
+				return "ExtendedNG";
+			else
+				return "Extended";
+		}
+	};
+
+	typedef ::testing::Types<HandleManagerOriginal, HandleManagerExtendedNG, HandleManagerExtended> Managers;
+}
+
+TYPED_TEST_SUITE(BSPointerHandleManagerTest, Managers, ManagerNames);
+
+TYPED_TEST(BSPointerHandleManagerTest, CreatesAndDestroysHandles)
+{
+	typedef TypeParam Manager;
+	typedef typename TestFixture::Object Object;
+	constexpr size_t COUNT = 1000;
+
+	auto Objects = std::make_unique<Object[]>(COUNT);
+	Array<typename TestFixture::Handle> Handles;
+	std::set<uint64_t> Indices;
+
+	EXPECT_TRUE(Manager::CreateHandle(nullptr).IsBitwiseNull());
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		EXPECT_TRUE(Manager::GetCurrentHandle(&Objects[i]).IsBitwiseNull());
+
+		auto Handle = Manager::CreateHandle(&Objects[i]);
+		ASSERT_FALSE(Handle.IsBitwiseNull());
+		ASSERT_TRUE(Objects[i].IsHandleValid());
+		EXPECT_TRUE(TestFixture::Resolves(Handle, &Objects[i])) << i;
+		EXPECT_EQ(Manager::GetPointer((uint32_t)Handle.GetIndex()), &Objects[i]);
+
+		// Повторный вызов отдаёт тот же дескриптор, новая запись не берётся
+		EXPECT_TRUE(Manager::CreateHandle(&Objects[i]) == Handle);
+		EXPECT_TRUE(Manager::GetCurrentHandle(&Objects[i]) == Handle);
+
+		Handles.push_back(Handle);
+		Indices.insert(Handle.GetIndex());
+	}
+	EXPECT_EQ(Indices.size(), COUNT);
+
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		auto Stale = Handles[i];
+		if (i & 1)
+		{
+			Manager::Destroy2(Handles[i]);
+			EXPECT_TRUE(Handles[i].IsBitwiseNull());
+		}
+		else
+			Manager::Destroy1(Handles[i]);
+
+		EXPECT_FALSE(Objects[i].IsHandleValid());
+		EXPECT_FALSE(Manager::IsValid(Stale));
+
+		NiAPI::NiPointer<Object> Pointer;
+		EXPECT_FALSE(Manager::GetSmartPointer1(Stale, Pointer));
+		EXPECT_FALSE(Manager::GetSmartPointer2(Stale, Pointer));
+		EXPECT_TRUE(Stale.IsBitwiseNull());
+
+		// Повторное уничтожение ничего не делает
+		Manager::Destroy1(Handles[i]);
+	}
+
+	// Индекс из незафиксированной части таблицы не читается
+	typename TestFixture::Handle Outside;
+	Outside.Set(TestFixture::Handle::MAX_HANDLE_COUNT - 1, 0);
+	if constexpr (TestFixture::LazyCommit)
+		EXPECT_FALSE(Manager::IsCommitted(TestFixture::Handle::MAX_HANDLE_COUNT - 1));
+	EXPECT_FALSE(Manager::IsValid(Outside));
+}
+
+TYPED_TEST(BSPointerHandleManagerTest, RecyclesEntries)
+{
+	// Ссылки получают дескриптор, теряют его и получают снова (как при выгрузке и повторной загрузке ячейки).
+	// Старый дескриптор не должен вести к прежней ссылке.
+	typedef TypeParam Manager;
+	typedef typename TestFixture::Object Object;
+	constexpr size_t COUNT = 256;
+
+	auto Objects = std::make_unique<Object[]>(COUNT);
+	Array<typename TestFixture::Handle> Handles(COUNT);
+	std::mt19937 Random(1);
+
+	auto Churn = [&](std::set<uint64_t>& Indices) -> size_t
+		{
+			size_t Created = 0;
+			for (size_t i = 0; i < 20000; i++)
+			{
+				auto Index = Random() % COUNT;
+				auto& Handle = Handles[Index];
+				if (Handle.IsBitwiseNull())
+				{
+					Handle = Manager::CreateHandle(&Objects[Index]);
+					EXPECT_TRUE(TestFixture::Resolves(Handle, &Objects[Index])) << i;
+					Indices.insert(Handle.GetIndex());
+					Created++;
+					continue;
+				}
+
+				auto Stale = Handle;
+				Manager::Destroy2(Handle);
+
+				// Запись могла уже уйти другой ссылке, но не этой
+				NiAPI::NiPointer<Object> Pointer;
+				if (Manager::GetSmartPointer1(Stale, Pointer))
+					EXPECT_NE((Object*)Pointer, &Objects[Index]) << i;
+			}
+			for (auto& Handle : Handles)
+				Manager::Destroy2(Handle);
+			return Created;
+		};
+
+	// Как и в прежнем списке (освобождённые дописывались в хвост), сначала выдаются нетронутые записи
+	std::set<uint64_t> Fresh;
+	auto Created = Churn(Fresh);
+	EXPECT_EQ(Fresh.size(), Created);
+
+	// Нетронутые кончились: дальше в оборот идут освобождённые, число разных записей ограничено
+	// живыми дескрипторами и кешами потока
+	auto Unused = Manager::NextUnused.load();
+	Manager::NextUnused = TestFixture::Handle::MAX_HANDLE_COUNT;
+	std::set<uint64_t> Recycled;
+	Churn(Recycled);
+	Manager::NextUnused = Unused;
+
+	EXPECT_LT(Recycled.size(), 1024u);
+}
+
+TYPED_TEST(BSPointerHandleManagerTest, CommitsTableOnDemand)
+{
+	typedef TypeParam Manager;
+	typedef typename TestFixture::Object Object;
+
+	if constexpr (!TestFixture::LazyCommit)
+	{
+		// Свободный список NG обходит код игры, таблица фиксируется целиком
+		EXPECT_TRUE(Manager::IsCommitted(TestFixture::Handle::MAX_HANDLE_COUNT - 1));
+		GTEST_SKIP() << "the NG table is committed in InitSDM";
+	}
+	else
+	{
+		// Прежде резерв таблицы сразу заполнялся целиком: 32 Мб для 21 бита и 1 Гб для 26
+		EXPECT_LT(TestFixture::InitResident, 4 * 1024 * 1024);
+
+		constexpr size_t COUNT = 200000;
+		auto Objects = std::make_unique<Object[]>(COUNT);
+		auto Resident = GetResidentSize();
+
+		Array<typename TestFixture::Handle> Handles;
+		for (size_t i = 0; i < COUNT; i++)
+			Handles.push_back(Manager::CreateHandle(&Objects[i]));
+
+		// Записи по 16 байт, фиксируются кусками по 1 Мб
+		auto Grown = (int64_t)GetResidentSize() - (int64_t)Resident;
+		printf("%zu handles: %+lld KB resident\n", COUNT, (long long)(Grown / 1024));
+		EXPECT_LT(Grown, (int64_t)(COUNT * 16 + 4 * 1024 * 1024));
+
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			ASSERT_TRUE(TestFixture::Resolves(Handles[i], &Objects[i])) << i;
+			Manager::Destroy2(Handles[i]);
+		}
+	}
+}
+
+TYPED_TEST(BSPointerHandleManagerTest, ConcurrentCreateDestroy)
+{
+	typedef TypeParam Manager;
+	typedef typename TestFixture::Object Object;
+	typedef typename TestFixture::Handle Handle;
+	constexpr uint32_t THREADS = 8;
+	constexpr uint32_t OBJECTS = 512;
+	constexpr uint32_t SHARED = 256;
+
+	// Свои ссылки у каждого потока и общие, на которые дескриптор создают и уничтожают все потоки сразу
+	Array<std::unique_ptr<Object[]>> Objects;
+	Array<Array<Handle>> Handles(THREADS, Array<Handle>(OBJECTS));
+	Array<Array<Handle>> SharedHandles(THREADS, Array<Handle>(SHARED));
+	auto Shared = std::make_unique<Object[]>(SHARED);
+	std::atomic<uint64_t> Errors = 0;
+	std::atomic<uint64_t> Highest = 0;
+
+	for (uint32_t t = 0; t < THREADS; t++)
+		Objects.push_back(std::make_unique<Object[]>(OBJECTS));
+
+	auto Check = [&](const Handle& handle, Object* object)
+		{
+			if (handle.IsBitwiseNull() || !TestFixture::Resolves(handle, object))
+				Errors++;
+
+			auto Index = (uint64_t)handle.GetIndex();
+			auto Current = Highest.load();
+			while ((Current < Index) && !Highest.compare_exchange_weak(Current, Index));
+		};
+
+	auto Run = [&](auto&& worker)
+		{
+			Array<std::thread> Threads;
+			for (uint32_t t = 0; t < THREADS; t++)
+				Threads.emplace_back(worker, t);
+			for (auto& Thread : Threads)
+				Thread.join();
+		};
+
+	// Все живые дескрипторы: разные записи, каждая ведёт к своей ссылке, и занято ровно столько записей
+	auto Verify = [&](bool shared)
+		{
+			std::set<uint64_t> Indices;
+			size_t Live = 0;
+			for (uint32_t t = 0; t < THREADS; t++)
+			{
+				for (uint32_t i = 0; i < OBJECTS; i++)
+				{
+					if (Handles[t][i].IsBitwiseNull())
+						continue;
+
+					EXPECT_TRUE(TestFixture::Resolves(Handles[t][i], &Objects[t][i]));
+					Indices.insert(Handles[t][i].GetIndex());
+					Live++;
+				}
+			}
+			if (shared)
+			{
+				for (uint32_t i = 0; i < SHARED; i++)
+				{
+					EXPECT_TRUE(TestFixture::Resolves(SharedHandles[0][i], &Shared[i]));
+					Indices.insert(SharedHandles[0][i].GetIndex());
+					Live++;
+				}
+			}
+
+			EXPECT_EQ(Indices.size(), Live);
+			EXPECT_EQ(Manager::CountInUse(Highest.load() + 1), Live);
+		};
+
+	// Создание, проверка и уничтожение вперемешку
+	Run([&](uint32_t t)
+		{
+			std::mt19937 Random(t);
+			for (uint32_t i = 0; i < 50000; i++)
+			{
+				auto Index = Random() % OBJECTS;
+				auto& Item = Handles[t][Index];
+				if (Item.IsBitwiseNull())
+				{
+					Item = Manager::CreateHandle(&Objects[t][Index]);
+					Check(Item, &Objects[t][Index]);
+				}
+				else if (Random() % 2)
+					Check(Item, &Objects[t][Index]);
+				else
+					Manager::Destroy2(Item);
+			}
+		});
+	EXPECT_EQ(Errors.load(), 0u);
+	Verify(false);
+
+	// Одна ссылка - одна запись, сколько бы потоков ни создавали дескриптор одновременно
+	Run([&](uint32_t t)
+		{
+			for (uint32_t i = 0; i < SHARED; i++)
+			{
+				auto Index = (i + t * 37) % SHARED;
+				SharedHandles[t][Index] = Manager::CreateHandle(&Shared[Index]);
+				Check(SharedHandles[t][Index], &Shared[Index]);
+			}
+		});
+	EXPECT_EQ(Errors.load(), 0u);
+	for (uint32_t t = 1; t < THREADS; t++)
+	{
+		for (uint32_t i = 0; i < SHARED; i++)
+			EXPECT_TRUE(SharedHandles[t][i] == SharedHandles[0][i]) << t << " / " << i;
+	}
+	Verify(true);
+
+	// Уничтожают все потоки сразу, запись должна вернуться в оборот один раз
+	Run([&](uint32_t t)
+		{
+			for (uint32_t i = 0; i < SHARED; i++)
+				Manager::Destroy1(SharedHandles[t][(i + t * 53) % SHARED]);
+		});
+	for (uint32_t i = 0; i < SHARED; i++)
+		EXPECT_FALSE(Shared[i].IsHandleValid());
+	Verify(false);
+
+	// Дважды возвращённая запись досталась бы двум ссылкам сразу
+	Run([&](uint32_t t)
+		{
+			for (uint32_t i = 0; i < OBJECTS; i++)
+			{
+				if (Handles[t][i].IsBitwiseNull())
+				{
+					Handles[t][i] = Manager::CreateHandle(&Objects[t][i]);
+					Check(Handles[t][i], &Objects[t][i]);
+				}
+			}
+		});
+	EXPECT_EQ(Errors.load(), 0u);
+	Verify(false);
+
+	Run([&](uint32_t t)
+		{
+			for (auto& Item : Handles[t])
+				Manager::Destroy2(Item);
+		});
+	EXPECT_EQ(Manager::CountInUse(Highest.load() + 1), 0u);
+}
\ No newline at end of file
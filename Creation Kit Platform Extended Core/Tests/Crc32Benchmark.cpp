@@ -0,0 +1,75 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// CRC32Buffer (PCLMULQDQ) против побайтовой таблицы, которой платформа считала CRC32 раньше, и zlib
+
+#include <random>
+#include <zlib.h>
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+
+using namespace CreationKitPlatformExtended;
+
+namespace
+{
+	const Array<uint8_t>& GetData()
+	{
+		static Array<uint8_t> Data = [] {
+			std::mt19937 Random(1);
+			Array<uint8_t> Result(64 * 1024 * 1024);
+			for (auto& Byte : Result)
+				Byte = (uint8_t)Random();
+			return Result;
+		}();
+		return Data;
+	}
+
+	uint32_t TableCRC32(const uint8_t* data, size_t size)
+	{
+		static auto Table = [] {
+			std::array<uint32_t, 256> Result;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t Crc = i;
+				for (int k = 0; k < 8; k++)
+					Crc = (Crc >> 1) ^ ((Crc & 1) ? 0xEDB88320ul : 0);
+				Result[i] = Crc;
+			}
+			return Result;
+		}();
+
+		uint32_t Crc = 0xFFFFFFFFul;
+		for (size_t i = 0; i < size; i++)
+			Crc = Table[(Crc ^ data[i]) & 0xFF] ^ (Crc >> 8);
+		return ~Crc;
+	}
+}
+
+static void BM_CRC32Buffer(benchmark::State& state)
+{
+	auto& Data = GetData();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(::Utils::CRC32Buffer(Data.data(), (uint32_t)state.range(0)));
+	state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CRC32Buffer)->Arg(64)->Arg(4096)->Arg(1 << 20)->Arg(64 << 20);
+
+static void BM_TableCRC32(benchmark::State& state)
+{
+	auto& Data = GetData();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(TableCRC32(Data.data(), (size_t)state.range(0)));
+	state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TableCRC32)->Arg(64)->Arg(4096)->Arg(1 << 20)->Arg(64 << 20);
+
+static void BM_ZlibCRC32(benchmark::State& state)
+{
+	auto& Data = GetData();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(crc32_z(0, Data.data(), (size_t)state.range(0)));
+	state.SetBytesProcessed((int64_t)state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ZlibCRC32)->Arg(64)->Arg(4096)->Arg(1 << 20)->Arg(64 << 20);
\ No newline at end of file
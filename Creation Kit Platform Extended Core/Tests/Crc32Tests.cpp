@@ -0,0 +1,105 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <zlib.h>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+
+using namespace CreationKitPlatformExtended;
+
+namespace
+{
+	Array<uint8_t> RandomBytes(size_t size, uint32_t seed)
+	{
+		std::mt19937 Random(seed);
+		Array<uint8_t> Data(size);
+		for (auto& Byte : Data)
+			Byte = (uint8_t)Random();
+		return Data;
+	}
+
+	uint32_t ZlibCRC32(const uint8_t* data, size_t size)
+	{
+		return (uint32_t)crc32_z(crc32(0, Z_NULL, 0), data, size);
+	}
+}
+
+// Короче 64 байт считает таблица, длиннее - свёртка PCLMULQDQ и таблица для хвоста
+TEST(Crc32, BufferMatchesZlib)
+{
+	auto Data = RandomBytes(256 * 1024 + 64, 1);
+	for (size_t Size = 0; Size <= 1024; Size++)
+	{
+		for (size_t Offset : { 0, 1, 7, 15 })
+			ASSERT_EQ(::Utils::CRC32Buffer(Data.data() + Offset, (uint32_t)Size),
+				ZlibCRC32(Data.data() + Offset, Size)) << "size " << Size << " offset " << Offset;
+	}
+
+	for (size_t Size : { 4095, 4096, 4097, 65536 + 13, 256 * 1024 })
+		EXPECT_EQ(::Utils::CRC32Buffer(Data.data() + 3, (uint32_t)Size), ZlibCRC32(Data.data() + 3, Size)) << Size;
+}
+
+TEST(Crc32, SpecialInputs)
+{
+	// Проверочное значение CRC-32/ISO-HDLC
+	EXPECT_EQ(::Utils::CRC32Buffer("123456789", 9), 0xCBF43926ul);
+	EXPECT_EQ(::Utils::CRC32("123456789"), 0xCBF43926ul);
+	EXPECT_EQ(::Utils::CRC32Buffer(nullptr, 0), 0u);
+
+	for (uint8_t Fill : { 0x00, 0xFF })
+	{
+		Array<uint8_t> Data(4096, Fill);
+		EXPECT_EQ(::Utils::CRC32Buffer(Data.data(), (uint32_t)Data.size()), ZlibCRC32(Data.data(), Data.size()));
+	}
+}
+
+TEST(Crc32, UpdateInPiecesMatchesWhole)
+{
+	auto Data = RandomBytes(100000, 2);
+	std::mt19937 Random(3);
+
+	for (int Round = 0; Round < 50; Round++)
+	{
+		uint32_t Crc = 0xFFFFFFFFul;
+		size_t Position = 0;
+		while (Position < Data.size())
+		{
+			auto Piece = std::min<size_t>(Random() % 3000, Data.size() - Position);
+			Crc = ::Utils::CRC32Update(Data.data() + Position, (uint32_t)Piece, Crc);
+			Position += Piece;
+		}
+		ASSERT_EQ(::Utils::CRC32Final(Crc), ZlibCRC32(Data.data(), Data.size()));
+	}
+}
+
+TEST(Crc32, CombineMatchesZlib)
+{
+	auto Data = RandomBytes(70000, 4);
+	for (size_t Split : { 0, 1, 63, 64, 1000, 65536, 70000 })
+	{
+		auto First = ::Utils::CRC32Buffer(Data.data(), (uint32_t)Split);
+		auto Second = ::Utils::CRC32Buffer(Data.data() + Split, (uint32_t)(Data.size() - Split));
+		auto Combined = ::Utils::CRC32Combine(First, Second, Data.size() - Split);
+		EXPECT_EQ(Combined, ZlibCRC32(Data.data(), Data.size())) << Split;
+		EXPECT_EQ(Combined, (uint32_t)crc32_combine(First, Second, (z_off_t)(Data.size() - Split))) << Split;
+	}
+}
+
+TEST(Crc32, FileMatchesZlib)
+{
+	Tests::TempDirectory Temp;
+	for (size_t Size : { 1, 100, 1024 * 1024 + 5 })
+	{
+		auto Data = RandomBytes(Size, (uint32_t)Size);
+		auto FileName = Temp.File("data.bin");
+		auto Stream = fopen(FileName.c_str(), "wb");
+		ASSERT_NE(Stream, nullptr);
+		fwrite(Data.data(), 1, Data.size(), Stream);
+		fclose(Stream);
+
+		EXPECT_EQ(::Utils::CRC32File(FileName.c_str()), ZlibCRC32(Data.data(), Data.size())) << Size;
+	}
+}
\ No newline at end of file
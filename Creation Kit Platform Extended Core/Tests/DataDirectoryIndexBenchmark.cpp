@@ -0,0 +1,137 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Проверка свободных файлов в папке Data на 200 тысяч файлов (DataDirectorySource.h), как у сборок с большим
+// числом модов. Первый запрос строит снимок, дальше запросы по снимку против GetFileAttributesEx на каждый
+// файл. range(0) - доля промахов в процентах: промах индекс подтверждает системой, поэтому при 100% он
+// не быстрее прямого вызова, выигрыш только на найденных файлах.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/DataDirectoryIndex.h"
+#include "DataDirectorySource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	constexpr uint32_t FileCount = 200000;
+	constexpr uint32_t QueryCount = 20000;
+
+	struct DataTree
+	{
+		String Root;
+		Array<String> Found;
+		Array<String> Missing;
+
+		DataTree()
+		{
+			// Корень в нижнем регистре, см. DataDirectoryIndexTests.cpp
+			Root = std::filesystem::temp_directory_path().string() + "/ckpe-index-bench-" + std::to_string(getpid());
+			auto Files = Tests::MakeDataTree(Root, FileCount, 23);
+			chdir(Root.c_str());
+
+			// Папки в регистре диска, иначе в Linux прямой вызов не найдёт файл
+			std::mt19937 Random(24);
+			for (uint32_t i = 0; i < QueryCount; i++)
+			{
+				auto Name = Files[Random() % Files.size()].Name;
+				auto Separator = Name.find_last_of('\\');
+				std::transform(Name.begin(), Name.begin() + Separator, Name.begin(),
+					[](char c) { return (char)tolower((unsigned char)c); });
+				Found.push_back(Name);
+				Missing.push_back(Name.substr(0, Separator) + "\\Missing" + Name.substr(Separator + 1));
+			}
+		}
+
+		~DataTree()
+		{
+			chdir("/");
+			std::error_code Error;
+			std::filesystem::remove_all(Root.c_str(), Error);
+		}
+	};
+
+	DataTree& GetTree()
+	{
+		static DataTree Tree;
+		return Tree;
+	}
+
+	template<typename Query>
+	void QueryTree(benchmark::State& state, Query&& query)
+	{
+		auto& Tree = GetTree();
+		uint64_t Errors = 0;
+
+		for (auto _ : state)
+		{
+			for (uint32_t i = 0; i < QueryCount; i++)
+			{
+				auto Miss = (uint32_t)(i % 100) < (uint32_t)state.range(0);
+				auto& Name = Miss ? Tree.Missing[i] : Tree.Found[i];
+				Errors += query(Name.c_str()) == Miss;
+			}
+		}
+
+		if (Errors)
+			state.SkipWithError("wrong answer");
+		state.SetItemsProcessed(state.iterations() * QueryCount);
+	}
+
+	void SetUpEngine(const benchmark::State&)
+	{
+		GetTree();
+		Tests::CreateEngine();
+	}
+
+	void TearDownEngine(const benchmark::State&)
+	{
+		Tests::DestroyEngine();
+	}
+}
+
+// Снимок строится один раз на процесс, поэтому замер один и идёт первым
+static void BM_IndexFirstQuery(benchmark::State& state)
+{
+	DataDirectoryIndex::FileInfo Info;
+	for (auto _ : state)
+	{
+		if (DataDirectoryIndex::Query(GetTree().Found[0].c_str(), Info) != DataDirectoryIndex::kFound)
+			state.SkipWithError("index is not built");
+	}
+}
+BENCHMARK(BM_IndexFirstQuery)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime()
+	->Setup(SetUpEngine)->Teardown(TearDownEngine);
+
+static void BM_GetFileAttributesEx(benchmark::State& state)
+{
+	QueryTree(state, [](const char* fileName)
+		{
+			WIN32_FILE_ATTRIBUTE_DATA Data;
+			return GetFileAttributesExA(fileName, GetFileExInfoStandard, &Data) != FALSE;
+		});
+}
+BENCHMARK(BM_GetFileAttributesEx)->ArgName("miss%")->Arg(0)->Arg(20)->Arg(100)->Unit(benchmark::kMillisecond)
+	->Setup(SetUpEngine)->Teardown(TearDownEngine);
+
+// Как хук: kUnknown уходит системе
+static void BM_IndexQuery(benchmark::State& state)
+{
+	QueryTree(state, [](const char* fileName)
+		{
+			DataDirectoryIndex::FileInfo Info;
+			auto Result = DataDirectoryIndex::Query(fileName, Info);
+			if (Result == DataDirectoryIndex::kUnknown)
+			{
+				WIN32_FILE_ATTRIBUTE_DATA Data;
+				return GetFileAttributesExA(fileName, GetFileExInfoStandard, &Data) != FALSE;
+			}
+			return Result == DataDirectoryIndex::kFound;
+		});
+}
+BENCHMARK(BM_IndexQuery)->ArgName("miss%")->Arg(0)->Arg(20)->Arg(100)->Unit(benchmark::kMillisecond)
+	->Setup(SetUpEngine)->Teardown(TearDownEngine);
\ No newline at end of file
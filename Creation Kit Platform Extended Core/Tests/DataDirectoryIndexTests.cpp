@@ -0,0 +1,184 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/DataDirectoryIndex.h"
+#include "DataDirectorySource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Снимок один на процесс и строится от текущей папки при первом запросе, поэтому тесты делят одно дерево.
+	// Индекс открывает папки в нижнем регистре, а в имени TempDirectory бывают заглавные, поэтому корень свой
+	class DataDirectoryIndexTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			Root = new String(std::filesystem::temp_directory_path().string() + "/ckpe-index-" + std::to_string(getpid()));
+			Files = new Array<Tests::LooseFile>(Tests::MakeDataTree(*Root, 2000, 22));
+			chdir(Root->c_str());
+
+			// Папка за ссылкой: обход внутрь не заходит, об изменениях в ней уведомлений нет
+			std::filesystem::create_directories("linked");
+			WriteFile("linked\\Inside.nif", 10);
+			std::filesystem::create_directory_symlink("../../linked", "data/meshes/linked");
+			Tests::CreateEngine();
+		}
+
+		static void TearDownTestSuite()
+		{
+			Tests::DestroyEngine();
+			chdir("/");
+			std::error_code Error;
+			std::filesystem::remove_all(Root->c_str(), Error);
+			delete Files;
+			delete Root;
+		}
+
+		// Путь на диске: папки в нижнем регистре. В Linux регистр важен, поэтому запросы, ответ на которые
+		// подтверждает система, задаются в этом же виде
+		static String DiskName(const String& name)
+		{
+			auto Native = name;
+			std::replace(Native.begin(), Native.end(), '\\', '/');
+			std::transform(Native.begin(), Native.begin() + Native.find_last_of('/'), Native.begin(),
+				[](char c) { return (char)tolower((unsigned char)c); });
+			return Native;
+		}
+
+		static void WriteFile(const String& name, size_t size)
+		{
+			std::ofstream File(DiskName(name).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			File << String(size, 'x');
+		}
+
+		// Ждёт, пока ответ индекса не станет ожидаемым (Watcher перестраивает снимок после затишья)
+		template<typename Predicate>
+		static bool WaitFor(Predicate&& predicate)
+		{
+			auto Deadline = std::chrono::steady_clock::now() +
+				std::chrono::milliseconds(DataDirectoryIndex::REBUILD_DELAY_MS * 4);
+			while (std::chrono::steady_clock::now() < Deadline)
+			{
+				if (predicate())
+					return true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			}
+			return predicate();
+		}
+
+		static String* Root;
+		static Array<Tests::LooseFile>* Files;
+	};
+
+	String* DataDirectoryIndexTest::Root = nullptr;
+	Array<Tests::LooseFile>* DataDirectoryIndexTest::Files = nullptr;
+}
+
+TEST_F(DataDirectoryIndexTest, FindsFilesIgnoringCase)
+{
+	DataDirectoryIndex::FileInfo Info;
+	for (size_t i = 0; i < Files->size(); i += 7)
+	{
+		auto& File = (*Files)[i];
+		ASSERT_EQ(DataDirectoryIndex::Query(File.Name.c_str(), Info), DataDirectoryIndex::kFound) << File.Name;
+		EXPECT_EQ(Info.size, File.Size) << File.Name;
+		EXPECT_FALSE(Info.attributes & FILE_ATTRIBUTE_DIRECTORY) << File.Name;
+
+		// Другой регистр, прямые косые и ".." дают тот же файл
+		auto Name = File.Name;
+		std::transform(Name.begin(), Name.end(), Name.begin(), [](char c) { return (char)toupper((unsigned char)c); });
+		std::replace(Name.begin(), Name.end(), '\\', '/');
+		ASSERT_EQ(DataDirectoryIndex::Query(("./" + Name).c_str(), Info), DataDirectoryIndex::kFound) << Name;
+		EXPECT_EQ(Info.size, File.Size) << Name;
+
+		auto Separator = File.Name.find('\\', 5);
+		auto Dotted = File.Name.substr(0, Separator) + "\\..\\" + File.Name.substr(5, Separator - 5) + File.Name.substr(Separator);
+		ASSERT_EQ(DataDirectoryIndex::Query(Dotted.c_str(), Info), DataDirectoryIndex::kFound) << Dotted;
+	}
+
+	ASSERT_EQ(DataDirectoryIndex::Query("Data\\Meshes", Info), DataDirectoryIndex::kFound);
+	EXPECT_TRUE(Info.attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+TEST_F(DataDirectoryIndexTest, LeavesOtherPathsToSystem)
+{
+	DataDirectoryIndex::FileInfo Info;
+	EXPECT_EQ(DataDirectoryIndex::Query(nullptr, Info), DataDirectoryIndex::kUnknown);
+	EXPECT_EQ(DataDirectoryIndex::Query("Data", Info), DataDirectoryIndex::kUnknown);
+	EXPECT_EQ(DataDirectoryIndex::Query("Data\\", Info), DataDirectoryIndex::kUnknown);
+	EXPECT_EQ(DataDirectoryIndex::Query("DataOther\\Meshes\\a.nif", Info), DataDirectoryIndex::kUnknown);
+	EXPECT_EQ(DataDirectoryIndex::Query("CreationKit.ini", Info), DataDirectoryIndex::kUnknown);
+	EXPECT_EQ(DataDirectoryIndex::Query("Data\\..\\Skyrim.ini", Info), DataDirectoryIndex::kUnknown);
+}
+
+TEST_F(DataDirectoryIndexTest, ConfirmsMissingWithSystem)
+{
+	DataDirectoryIndex::FileInfo Info;
+	EXPECT_EQ(DataDirectoryIndex::Query("Data\\Meshes\\NotThere.nif", Info), DataDirectoryIndex::kMissing);
+	EXPECT_EQ(DataDirectoryIndex::Query("Data\\NoSuchFolder\\NotThere.nif", Info), DataDirectoryIndex::kMissing);
+
+	// Редактор сам записал файл и сразу его ищет: снимок о нём ещё не знает, но промахом это быть не может
+	for (uint32_t i = 0; i < 50; i++)
+	{
+		auto Name = DiskName("Data\\Meshes\\Saved" + std::to_string(i) + ".nif");
+		WriteFile(Name, 100 + i);
+
+		auto Result = DataDirectoryIndex::Query(Name.c_str(), Info);
+		ASSERT_NE(Result, DataDirectoryIndex::kMissing) << Name;
+		if (Result == DataDirectoryIndex::kFound)
+			EXPECT_EQ(Info.size, 100 + i) << Name;
+	}
+}
+
+TEST_F(DataDirectoryIndexTest, RebuildsAfterChanges)
+{
+	DataDirectoryIndex::FileInfo Info;
+	auto Changed = DiskName((*Files)[10].Name);
+	auto Removed = DiskName((*Files)[20].Name);
+	auto Added = DiskName("Data\\Textures\\Added.dds");
+
+	WriteFile(Added, 4321);
+	WriteFile(Changed, 1234);
+	ASSERT_EQ(unlink(Removed.c_str()), 0);
+
+	EXPECT_TRUE(WaitFor([&]
+		{
+			return (DataDirectoryIndex::Query(Changed.c_str(), Info) == DataDirectoryIndex::kFound) && (Info.size == 1234);
+		}));
+	EXPECT_TRUE(WaitFor([&]
+		{
+			return DataDirectoryIndex::Query(Removed.c_str(), Info) == DataDirectoryIndex::kMissing;
+		}));
+
+	// После затишья снимок строится заново и знает о новом файле
+	std::this_thread::sleep_for(std::chrono::milliseconds(DataDirectoryIndex::REBUILD_DELAY_MS * 2));
+	ASSERT_EQ(DataDirectoryIndex::Query("Data\\Textures\\ADDED.DDS", Info), DataDirectoryIndex::kFound);
+	EXPECT_EQ(Info.size, 4321u);
+	ASSERT_EQ(DataDirectoryIndex::Query((*Files)[10].Name.c_str(), Info), DataDirectoryIndex::kFound);
+	EXPECT_EQ(Info.size, 1234u);
+}
+
+TEST_F(DataDirectoryIndexTest, ConfirmsFilesBehindLinks)
+{
+	DataDirectoryIndex::FileInfo Info;
+	ASSERT_EQ(DataDirectoryIndex::Query((*Files)[0].Name.c_str(), Info), DataDirectoryIndex::kFound);
+	ASSERT_EQ(DataDirectoryIndex::Query("data\\meshes\\linked", Info), DataDirectoryIndex::kFound);
+	EXPECT_TRUE(Info.attributes & FILE_ATTRIBUTE_REPARSE_POINT);
+
+	// В снимке этих файлов нет, и снимок об этом не узнает, отвечает система
+	ASSERT_EQ(DataDirectoryIndex::Query("data\\meshes\\linked\\Inside.nif", Info), DataDirectoryIndex::kFound);
+	EXPECT_EQ(Info.size, 10u);
+
+	WriteFile("linked\\Later.nif", 20);
+	ASSERT_EQ(DataDirectoryIndex::Query("data\\meshes\\linked\\Later.nif", Info), DataDirectoryIndex::kFound);
+	EXPECT_EQ(Info.size, 20u);
+	EXPECT_EQ(DataDirectoryIndex::Query("data\\meshes\\linked\\Never.nif", Info), DataDirectoryIndex::kMissing);
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		struct LooseFile
+		{
+			String Name;		// Путь как его спрашивает редактор: "Data\Meshes\...", регистр как в игре
+			uint64_t Size;
+		};
+
+		// Папка Data с count свободными файлами: meshes, textures, sound, scripts и прочее, по сотне файлов в папке
+		// на глубине 2-4. Индекс обходит папки в нижнем регистре, поэтому на диске они в нижнем регистре, а имена
+		// файлов и запросы в смешанном, как в Windows. Файлы разреженные, размер без записи данных
+		inline Array<LooseFile> MakeDataTree(const String& root, uint32_t count, uint32_t seed)
+		{
+			static const char* Roots[] = { "Meshes", "Textures", "Sound\\FX", "Scripts", "Interface", "Materials", "SEQ" };
+			static const char* Extensions[] = { ".nif", ".dds", ".wav", ".pex", ".swf", ".bgsm", ".seq" };
+			static const char* Words[] = { "Architecture", "Whiterun", "Clutter", "Dungeons", "Actors", "Weapons", "Landscape",
+				"Effects", "Furniture", "Markers" };
+
+			std::mt19937 Random(seed);
+			Array<LooseFile> Files;
+			Files.reserve(count);
+
+			String Directory;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!(i % 100))
+				{
+					auto Kind = Random() % std::size(Roots);
+					Directory = String("Data\\") + Roots[Kind];
+					for (auto Depth = 1 + Random() % 3; Depth; Depth--)
+						Directory += String("\\") + Words[Random() % std::size(Words)] + std::to_string(Random() % 40);
+
+					auto Native = Directory;
+					std::transform(Native.begin(), Native.end(), Native.begin(), [](char c)
+						{ return (c == '\\') ? '/' : (char)tolower((unsigned char)c); });
+					std::filesystem::create_directories((root + "/" + Native).c_str());
+				}
+
+				auto Kind = Random() % std::size(Extensions);
+				auto Name = Directory + "\\" + Words[Random() % std::size(Words)] + "Object" + std::to_string(i) + Extensions[Kind];
+				auto Size = (uint64_t)(Random() % 262144);
+
+				auto Native = Name;
+				auto Separator = Native.find_last_of('\\');
+				std::transform(Native.begin(), Native.begin() + Separator, Native.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+				std::replace(Native.begin(), Native.end(), '\\', '/');
+
+				auto Descriptor = open((root + "/" + Native).c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+				if (Descriptor >= 0)
+				{
+					if (!ftruncate(Descriptor, (off_t)Size))
+						Files.push_back({ Name, Size });
+					close(Descriptor);
+				}
+			}
+
+			return Files;
+		}
+	}
+}
\ No newline at end of file
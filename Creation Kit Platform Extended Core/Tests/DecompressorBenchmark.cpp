@@ -0,0 +1,82 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Распаковка корпуса сжатых записей ESM (RecordSource.h): распаковщик потока против прежнего HKInflate,
+// который создавал и освобождал распаковщик libdeflate на каждую запись, и против zlib, которым
+// распаковывает сам редактор.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/Decompressor.h"
+#include "RecordSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	const Array<Tests::CompressedRecord>& GetCorpus()
+	{
+		static auto Corpus = Tests::MakeRecordCorpus(4096, 19);
+		return Corpus;
+	}
+
+	template<typename Inflate>
+	void InflateCorpus(benchmark::State& state, Inflate&& inflate)
+	{
+		auto& Corpus = GetCorpus();
+		Array<uint8_t> Out(65536);
+		size_t Bytes = 0;
+
+		for (auto _ : state)
+		{
+			for (auto& Record : Corpus)
+			{
+				if (!inflate(Record, Out.data(), Record.Body.size()))
+					state.SkipWithError("inflate failed");
+			}
+		}
+
+		for (auto& Record : Corpus)
+			Bytes += Record.Body.size();
+		state.SetItemsProcessed(state.iterations() * Corpus.size());
+		state.SetBytesProcessed(state.iterations() * Bytes);
+	}
+}
+
+static void BM_InflateAllocPerRecord(benchmark::State& state)
+{
+	InflateCorpus(state, [](auto& Record, uint8_t* out, size_t outSize)
+		{
+			size_t outBytes = 0;
+			libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+			libdeflate_result result = libdeflate_zlib_decompress(decompressor, Record.Stream.data(),
+				Record.Stream.size(), out, outSize, &outBytes);
+			libdeflate_free_decompressor(decompressor);
+			return result == LIBDEFLATE_SUCCESS;
+		});
+}
+BENCHMARK(BM_InflateAllocPerRecord)->Unit(benchmark::kMillisecond)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_InflateThreadCache(benchmark::State& state)
+{
+	InflateCorpus(state, [](auto& Record, uint8_t* out, size_t outSize)
+		{
+			size_t inBytes = 0, outBytes = 0;
+			return Decompressor::Zlib(Record.Stream.data(), Record.Stream.size(), out, outSize,
+				&inBytes, &outBytes) == LIBDEFLATE_SUCCESS;
+		});
+}
+BENCHMARK(BM_InflateThreadCache)->Unit(benchmark::kMillisecond)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_InflateZlib(benchmark::State& state)
+{
+	InflateCorpus(state, [](auto& Record, uint8_t* out, size_t outSize)
+		{
+			uLongf outBytes = (uLongf)outSize;
+			return uncompress(out, &outBytes, Record.Stream.data(), (uLong)Record.Stream.size()) == Z_OK;
+		});
+}
+BENCHMARK(BM_InflateZlib)->Unit(benchmark::kMillisecond)->ThreadRange(1, 4)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,130 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/Decompressor.h"
+#include "RecordSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	libdeflate_result Inflate(const Array<uint8_t>& stream, Array<uint8_t>& out, size_t* inBytes = nullptr)
+	{
+		size_t InBytes = 0, OutBytes = 0;
+		auto Result = Decompressor::Zlib(stream.data(), stream.size(), out.data(), out.size(), &InBytes, &OutBytes);
+		if (Result == LIBDEFLATE_SUCCESS)
+			out.resize(OutBytes);
+		if (inBytes)
+			*inBytes = InBytes;
+		return Result;
+	}
+}
+
+TEST(DecompressorTest, InflatesRecords)
+{
+	for (auto& Record : Tests::MakeRecordCorpus(200, 1))
+	{
+		Array<uint8_t> Out(Record.Body.size());
+		size_t InBytes = 0;
+		ASSERT_EQ(Inflate(Record.Stream, Out, &InBytes), LIBDEFLATE_SUCCESS);
+		EXPECT_EQ(Out, Record.Body);
+		EXPECT_EQ(InBytes, Record.Stream.size());
+	}
+}
+
+TEST(DecompressorTest, AcceptsTruncatedTrailer)
+{
+	// Без контрольной суммы или с её частью поток разбирается как deflate, хвост считается прочитанным
+	std::mt19937 Random(2);
+	auto Body = Tests::MakeRecordBody(Random, 4096);
+	auto Stream = Tests::CompressZlib(Body);
+
+	for (size_t Cut = 1; Cut <= 4; Cut++)
+	{
+		auto Truncated = Stream;
+		Truncated.resize(Stream.size() - Cut);
+
+		Array<uint8_t> Out(Body.size());
+		size_t InBytes = 0;
+		ASSERT_EQ(Inflate(Truncated, Out, &InBytes), LIBDEFLATE_SUCCESS) << "cut " << Cut;
+		EXPECT_EQ(Out, Body);
+		EXPECT_EQ(InBytes, Truncated.size());
+	}
+}
+
+TEST(DecompressorTest, RejectsCorruptTrailer)
+{
+	std::mt19937 Random(3);
+	auto Body = Tests::MakeRecordBody(Random, 4096);
+	auto Stream = Tests::CompressZlib(Body);
+
+	// Любой испорченный байт целой суммы - ошибка, а не тихий успех
+	for (size_t i = 1; i <= 4; i++)
+	{
+		auto Corrupt = Stream;
+		Corrupt[Corrupt.size() - i] ^= 0x5A;
+
+		Array<uint8_t> Out(Body.size());
+		EXPECT_EQ(Inflate(Corrupt, Out), LIBDEFLATE_BAD_DATA) << "byte " << i;
+	}
+
+	// Сумма верная, но данные подменены после сжатия
+	auto Other = Body;
+	Other[100] ^= 1;
+	auto Mixed = Tests::CompressZlib(Other);
+	memcpy(Mixed.data() + Mixed.size() - 4, Stream.data() + Stream.size() - 4, 4);
+	Array<uint8_t> Out(Body.size());
+	EXPECT_EQ(Inflate(Mixed, Out), LIBDEFLATE_BAD_DATA);
+}
+
+TEST(DecompressorTest, ReportsErrors)
+{
+	std::mt19937 Random(4);
+	auto Body = Tests::MakeRecordBody(Random, 4096);
+	auto Stream = Tests::CompressZlib(Body);
+
+	Array<uint8_t> Small(Body.size() / 2);
+	EXPECT_EQ(Inflate(Stream, Small), LIBDEFLATE_INSUFFICIENT_SPACE);
+
+	// Без заголовка zlib запасного пути нет
+	auto NoHeader = Stream;
+	NoHeader[0] = 0x00;
+	Array<uint8_t> Out(Body.size());
+	EXPECT_EQ(Inflate(NoHeader, Out), LIBDEFLATE_BAD_DATA);
+
+	auto Garbage = Stream;
+	for (size_t i = 2; i < Garbage.size(); i++)
+		Garbage[i] = (uint8_t)Random();
+	Out.resize(Body.size());
+	EXPECT_NE(Inflate(Garbage, Out), LIBDEFLATE_SUCCESS);
+}
+
+TEST(DecompressorTest, InflatesOnManyThreads)
+{
+	// У каждого потока свой распаковщик
+	auto Corpus = Tests::MakeRecordCorpus(400, 5);
+	std::atomic<uint64_t> Errors = 0;
+
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < 8; t++)
+	{
+		Threads.emplace_back([&, t]
+			{
+				for (size_t i = t; i < Corpus.size(); i += 2)
+				{
+					Array<uint8_t> Out(Corpus[i].Body.size());
+					if ((Inflate(Corpus[i].Stream, Out) != LIBDEFLATE_SUCCESS) || (Out != Corpus[i].Body))
+						Errors++;
+				}
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	EXPECT_EQ(Errors.load(), 0u);
+}
\ No newline at end of file
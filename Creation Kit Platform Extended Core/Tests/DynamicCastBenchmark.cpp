@@ -0,0 +1,71 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Попадание в кеш приведений по именам типов и по готовым TypeDescriptor против приведения без кеша
+// (поиск типов в MSRTTI и __RTDynamicCast). Замена __RTDynamicCast из RttiImage.cpp проще настоящей,
+// которая сравнивает имена типов, так что выигрыш на редакторе больше.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/DynamicCast.h"
+#include "RttiImage.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	struct Fixture
+	{
+		Tests::RttiImage Image;
+		uintptr_t Object[8] = {};
+
+		Fixture() : Image(1024 * 1024, 8 * 1024 * 1024, 2 * 1024 * 1024)
+		{
+			Image.AddClass(".?AVTESForm@@", {}, 10);
+			Image.AddClass(".?AVTESFullName@@", {}, 4);
+			Object[0] = Image.AddClass(".?AVTESNPC@@", { { ".?AVTESForm@@", 0 }, { ".?AVTESFullName@@", 0x30 } }, 20);
+			Object[6] = Image.AddVTable(".?AVTESNPC@@", 0x30, 4);
+			Tests::AddGeneratedClasses(Image, 20000, 1);
+
+			Image.Install();
+			Tests::GetEngineConfig().ExecutableCRC32 = 0;
+			Tests::CreateEngine();
+			GlobalDynamicCastPtr = new DynamicCast();
+		}
+	};
+
+	Fixture& GetFixture()
+	{
+		static Fixture Data;
+		return Data;
+	}
+}
+
+static void BM_DynamicCastByName(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(_DYNAMIC_CAST(Data.Object, 0, "class TESForm", "class TESFullName"));
+}
+BENCHMARK(BM_DynamicCastByName)->ThreadRange(1, 4);
+
+static void BM_DynamicCastByDescriptor(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	auto From = _RTTI_TYPE("class TESForm");
+	auto Target = _RTTI_TYPE("class TESFullName");
+	for (auto _ : state)
+		benchmark::DoNotOptimize(_DYNAMIC_CAST(Data.Object, 0, From, Target));
+}
+BENCHMARK(BM_DynamicCastByDescriptor)->ThreadRange(1, 4);
+
+static void BM_DynamicCastNoCache(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(_DYNAMIC_CAST2(Data.Object, 0, "class TESForm", "class TESFullName"));
+}
+BENCHMARK(BM_DynamicCastNoCache);
\ No newline at end of file
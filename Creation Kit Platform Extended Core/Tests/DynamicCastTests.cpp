@@ -0,0 +1,231 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <typeinfo>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/DynamicCast.h"
+#include "RttiImage.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+extern "C" PVOID __RTDynamicCast(PVOID inptr, LONG VfDelta, PVOID SrcType, PVOID TargetType, BOOL isReference);
+
+namespace
+{
+	// Объект в памяти: указатели на vtable по смещениям, остальное не используется
+	struct alignas(16) Object
+	{
+		uintptr_t Data[32];
+	};
+
+	class DynamicCastTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			Image = new Tests::RttiImage(256 * 1024, 2 * 1024 * 1024, 512 * 1024);
+			Image->AddClass(".?AVTESForm@@", {}, 10);
+			Image->AddClass(".?AVTESObject@@", { { ".?AVTESForm@@", 0 } }, 12);
+			Image->AddClass(".?AVTESBoundObject@@", { { ".?AVTESObject@@", 0 }, { ".?AVTESForm@@", 0 } }, 14);
+			Image->AddClass(".?AVTESFullName@@", {}, 4);
+			Image->AddClass(".?AVTESNPC@@", { { ".?AVTESBoundObject@@", 0 }, { ".?AVTESObject@@", 0 },
+				{ ".?AVTESForm@@", 0 }, { ".?AVTESFullName@@", 0x30 } }, 20);
+			Image->AddVTable(".?AVTESNPC@@", 0x30, 4);
+			Image->AddClass(".?AVUnderConstruction@@", { { ".?AVTESForm@@", 0 } }, 3);
+			Image->GetLocator(".?AVUnderConstruction@@", 0)->CDOffset = 8;
+			Names = new Array<String>(Tests::AddGeneratedClasses(*Image, 2000, 11));
+
+			Objects = new UnorderedMap<String, Object>();
+			for (auto& VTable : Image->GetVTables())
+				(*Objects)[VTable.RawName].Data[VTable.Offset / sizeof(uintptr_t)] = VTable.Address;
+
+			Image->Install();
+			Tests::GetEngineConfig().ExecutableCRC32 = 0;
+			Tests::CreateEngine();
+			GlobalDynamicCastPtr = new DynamicCast();
+		}
+
+		static void TearDownTestSuite()
+		{
+			delete GlobalDynamicCastPtr;
+			GlobalDynamicCastPtr = nullptr;
+			MSRTTI::Release();
+			Tests::DestroyEngine();
+			Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+			delete Objects;
+			delete Names;
+			delete Image;
+		}
+
+		static const void* Type(const char* RawName)
+		{
+			return Image->GetTypeDescriptor(RawName);
+		}
+
+		static Object* Get(const char* RawName)
+		{
+			return &Objects->at(RawName);
+		}
+
+		static Tests::RttiImage* Image;
+		static Array<String>* Names;
+		static UnorderedMap<String, Object>* Objects;
+	};
+
+	Tests::RttiImage* DynamicCastTest::Image = nullptr;
+	Array<String>* DynamicCastTest::Names = nullptr;
+	UnorderedMap<String, Object>* DynamicCastTest::Objects = nullptr;
+}
+
+TEST_F(DynamicCastTest, CastsAlongHierarchy)
+{
+	auto NPC = Get(".?AVTESNPC@@");
+	auto FullName = (void*)((uintptr_t)NPC + 0x30);
+
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, "class TESNPC", "class TESForm"), NPC);
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, "class TESNPC", "class TESFullName"), FullName);
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, "class TESForm", "class TESNPC"), NPC);
+	EXPECT_EQ(_DYNAMIC_CAST(FullName, 0, "class TESFullName", "class TESNPC"), NPC);
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0x30, "class TESNPC", "class TESFullName"), FullName);
+
+	auto Form = Get(".?AVTESForm@@");
+	EXPECT_EQ(_DYNAMIC_CAST(Form, 0, "class TESForm", "class TESNPC"), nullptr);
+	EXPECT_EQ(_DYNAMIC_CAST(Form, 0, "class TESForm", "class TESForm"), Form);
+
+	EXPECT_EQ(_DYNAMIC_CAST(nullptr, 0, "class TESForm", "class TESNPC"), nullptr);
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, "class TESForm", "class Missing"), nullptr);
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, "class TESForm", nullptr), nullptr);
+
+	EXPECT_EQ(_DYNAMIC_CAST2(Form, 0, "class TESForm", "class TESObject"), nullptr);
+	EXPECT_EQ(_DYNAMIC_CAST2(Get(".?AVTESBoundObject@@"), 0, "class TESForm", "class TESObject"),
+		Get(".?AVTESBoundObject@@"));
+}
+
+TEST_F(DynamicCastTest, ResolvesTypeNamesOnce)
+{
+	EXPECT_EQ(_RTTI_TYPE("class TESNPC"), Type(".?AVTESNPC@@"));
+	EXPECT_EQ(_RTTI_TYPE("class TESNPC"), Type(".?AVTESNPC@@"));
+	EXPECT_EQ(_RTTI_TYPE("class Space3::Gen3Form"), Type(".?AVGen3Form@Space3@@"));
+	EXPECT_EQ(_RTTI_TYPE("class Missing"), nullptr);
+	EXPECT_EQ(_RTTI_TYPE(nullptr), nullptr);
+
+	auto NPC = Get(".?AVTESNPC@@");
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, _RTTI_TYPE("class TESForm"), _RTTI_TYPE("class TESFullName")),
+		(void*)((uintptr_t)NPC + 0x30));
+}
+
+TEST_F(DynamicCastTest, HitsSkipTheRuntime)
+{
+	auto Object = Get(".?AVTESBoundObject@@");
+	auto Form = Type(".?AVTESForm@@");
+	auto Calls = Tests::GetRTDynamicCastCalls();
+
+	EXPECT_EQ(_DYNAMIC_CAST(Object, 0, Form, Type(".?AVTESObject@@")), Object);
+	EXPECT_EQ(_DYNAMIC_CAST(Object, 0, Form, Type(".?AVTESObject@@")), Object);
+	EXPECT_EQ(Tests::GetRTDynamicCastCalls(), Calls + 1);
+
+	// Неудачное приведение тоже запоминается, но для ссылки каждый раз нужен bad_cast
+	EXPECT_EQ(_DYNAMIC_CAST(Object, 0, Form, Type(".?AVTESFullName@@")), nullptr);
+	EXPECT_EQ(_DYNAMIC_CAST(Object, 0, Form, Type(".?AVTESFullName@@")), nullptr);
+	EXPECT_EQ(Tests::GetRTDynamicCastCalls(), Calls + 2);
+	EXPECT_THROW(_DYNAMIC_CAST(Object, 0, Form, Type(".?AVTESFullName@@"), true), std::bad_cast);
+	EXPECT_THROW(_DYNAMIC_CAST(Object, 0, Form, Type(".?AVTESFullName@@"), true), std::bad_cast);
+	EXPECT_EQ(Tests::GetRTDynamicCastCalls(), Calls + 4);
+
+	// Тот же объект с другим VfDelta - другой ключ
+	auto NPC = Get(".?AVTESNPC@@");
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0x30, Form, Type(".?AVTESNPC@@")), NPC);
+	EXPECT_EQ(_DYNAMIC_CAST(NPC, 0, Type(".?AVTESObject@@"), Type(".?AVTESNPC@@")), NPC);
+	EXPECT_EQ(Tests::GetRTDynamicCastCalls(), Calls + 6);
+}
+
+TEST_F(DynamicCastTest, DoesNotCacheDuringConstruction)
+{
+	auto Object = Get(".?AVUnderConstruction@@");
+	auto Calls = Tests::GetRTDynamicCastCalls();
+
+	for (int i = 0; i < 3; i++)
+		EXPECT_EQ(_DYNAMIC_CAST(Object, 0, Type(".?AVUnderConstruction@@"), Type(".?AVTESForm@@")), Object);
+	EXPECT_EQ(Tests::GetRTDynamicCastCalls(), Calls + 3);
+}
+
+TEST_F(DynamicCastTest, ConcurrentCastsMatchRuntime)
+{
+	struct Case
+	{
+		void* Object;
+		long VfDelta;
+		const void* From;
+		const void* Target;
+		void* Expected;
+	};
+
+	// Пар больше, чем записей в кеше, поэтому записи постоянно вытесняют друг друга
+	std::mt19937 Random(5);
+	Array<Case> Cases;
+	for (auto& VTable : Image->GetVTables())
+	{
+		auto Object = Get(VTable.RawName.c_str());
+		for (int i = 0; i < 8; i++)
+		{
+			Case Item = { Object, (long)VTable.Offset, Type(VTable.RawName.c_str()),
+				Type((*Names)[Random() % Names->size()].c_str()), nullptr };
+			Item.Expected = __RTDynamicCast(Item.Object, Item.VfDelta, (PVOID)Item.From, (PVOID)Item.Target, FALSE);
+			Cases.push_back(Item);
+		}
+	}
+	ASSERT_GT(Cases.size(), DynamicCast::CACHE_SIZE * 4);
+
+	std::atomic<uint64_t> Errors = 0;
+	std::atomic<uint64_t> Successes = 0;
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < 8; t++)
+	{
+		Threads.emplace_back([&, t]
+			{
+				std::mt19937 Random(t);
+				for (int i = 0; i < 200000; i++)
+				{
+					// Половина обращений к небольшой горячей части, чтобы были попадания в кеш
+					auto& Item = Cases[(i & 1) ? (Random() % 64) : (Random() % Cases.size())];
+					auto Result = _DYNAMIC_CAST(Item.Object, Item.VfDelta, Item.From, Item.Target);
+					if (Result != Item.Expected)
+						Errors++;
+					else if (Result)
+						Successes++;
+				}
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	EXPECT_EQ(Errors.load(), 0u);
+	EXPECT_GT(Successes.load(), 0u);
+}
+
+TEST_F(DynamicCastTest, ConcurrentTypeNameLookups)
+{
+	std::atomic<uint64_t> Errors = 0;
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < 8; t++)
+	{
+		Threads.emplace_back([&]
+			{
+				for (size_t i = 0; i < Names->size(); i++)
+				{
+					auto& RawName = (*Names)[i];
+					if (_RTTI_TYPE(Tests::DemangleRawName(RawName.c_str()).c_str()) != Type(RawName.c_str()))
+						Errors++;
+				}
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	EXPECT_EQ(Errors.load(), 0u);
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Окружение для Editor API/FO4/BSPointerHandleManager.h. Заголовок и BSHandleRefObject.h подключаются
+// копиями без #include (их собирает CMakeLists.txt): пути там через обратную косую черту, а TESObjectREFR.h
+// тянет за собой половину Editor API. Менеджеру от ссылки нужны только база BSHandleRefObject и TESForm.
+
+#include "NiAPI/NiPointer.h"
+#include "BSHandleRefObject.h"
+#include "Editor API/FO4/NiClassesF4.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace EditorAPI
+	{
+		namespace Fallout4
+		{
+			using namespace NiAPI;
+
+			class TESForm
+			{
+			public:
+				virtual ~TESForm() = default;
+			};
+
+			template<typename _Ty>
+			class TESObjectREFR_base : public TESForm, public _Ty
+			{};
+
+			typedef TESObjectREFR_base<BSHandleRefObject_Original> TESObjectREFR_Original;
+			typedef TESObjectREFR_base<BSHandleRefObject_Extremly> TESObjectREFR_Extremly_NG;
+			typedef TESObjectREFR_base<BSHandleRefObject_64_Extremly> TESObjectREFR_Extremly;
+		}
+	}
+}
+
+#include "BSPointerHandleManagerF4.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Доступ к таблице менеджера: записи и счётчики у него защищённые
+		template<typename Interface, typename Object>
+		struct HandleManagerAccess : public Interface
+		{
+			typedef Object ObjectType;
+
+			using Interface::HandleEntries;
+			using Interface::IsCommitted;
+			using Interface::NextUnused;
+			using Interface::NullHandle;
+
+			// Число занятых записей среди первых count
+			static size_t CountInUse(size_t count)
+			{
+				size_t Result = 0;
+				for (size_t i = 0; i < count; i++)
+				{
+					if (IsCommitted(i) && HandleEntries[i].IsInUse())
+						Result++;
+				}
+				return Result;
+			}
+		};
+
+		typedef HandleManagerAccess<EditorAPI::Fallout4::BSPointerHandleManagerInterface_Original,
+			EditorAPI::Fallout4::TESObjectREFR_Original> HandleManagerOriginal;
+		typedef HandleManagerAccess<EditorAPI::Fallout4::BSPointerHandleManagerInterface_Extended_NG,
+			EditorAPI::Fallout4::TESObjectREFR_Extremly_NG> HandleManagerExtendedNG;
+		typedef HandleManagerAccess<EditorAPI::Fallout4::BSPointerHandleManagerInterface_Extended,
+			EditorAPI::Fallout4::TESObjectREFR_Extremly> HandleManagerExtended;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,312 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Прогон трассы запросов GetPrivateProfile* по CreationKit.ini и CreationKitPrefs.ini, как при запуске
+// редактора: сначала каждая настройка читается один раз (с промахами по ключам, которых в файле нет),
+// потом открытие диалогов раз за разом перечитывает [General], [Display] и настройки окон. Файлы и трасса
+// собраны по образцу настоящих, значения условные. Кеш с индексом против прежнего пути, где на каждый
+// запрос копировалась секция mINI, а значение чистилось и разбиралось заново.
+//
+// Пачки записей, как при нажатии OK в диалоге настроек: range(0) вызовов WritePrivateProfileString
+// в CreationKitPrefs.ini. Прежняя сборка Qt5 переписывала файл на каждый вызов, теперь записи только
+// помечают файл, а на диск он уходит один раз (здесь - сразу через ClearAndFlush в конце пачки).
+
+#include <random>
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Patches/INICacheData.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Patches;
+
+namespace
+{
+	struct INIQuery
+	{
+		enum Type { QueryString, QueryInt, QuerySection } type;
+		const char* fileName;
+		String section;
+		String key;
+	};
+
+	constexpr const char* CreationKitSections[] =
+	{
+		"General", "Display", "Grass", "Audio", "Archive", "Papyrus", "Landscape", "Camera", "Interface",
+		"MESSAGES", "LightingShader", "Trees", "Decals", "Havok", "Water", "MapMenu", "Pathfinding",
+		"Combat", "Animation", "Actor"
+	};
+
+	constexpr const char* PrefsSections[] =
+	{
+		"Display", "MAIN", "Interface", "Controls", "Audio", "Grass", "Launcher", "Imagespace", "Preview",
+		"ObjectWindow", "RenderWindow", "CellView"
+	};
+
+	constexpr const char* KeyPrefixes = "bifsu";
+
+	String MakeValue(char prefix, std::mt19937& random)
+	{
+		switch (prefix)
+		{
+		case 'b': return std::to_string(random() & 1);
+		case 'i': return std::to_string(random() % 4096);
+		case 'f': return std::to_string((random() % 10000) / 100.0);
+		case 'u': return "0x" + std::to_string(random() % 100000);
+		default: return "\"data\\\\textures\\\\value" + std::to_string(random() % 1000) + ".dds\"";
+		}
+	}
+
+	struct INITrace
+	{
+		Tests::TempDirectory Temp;
+		String CreationKit;
+		String Prefs;
+		Array<INIQuery> Queries;
+
+		INITrace()
+		{
+			CreationKit = Temp.File("CreationKit.ini");
+			Prefs = Temp.File("CreationKitPrefs.ini");
+
+			std::mt19937 Random(71);
+			Array<INIQuery> Settings;
+			auto Generate = [&](const String& fileName, const char* const* sections, size_t count, uint32_t keys)
+				{
+					std::ofstream File(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+					for (size_t i = 0; i < count; i++)
+					{
+						File << "[" << sections[i] << "]\n";
+						for (uint32_t j = 0; j < keys; j++)
+						{
+							auto Prefix = KeyPrefixes[Random() % 5];
+							auto Key = String(1, Prefix) + sections[i] + "Setting" + std::to_string(j);
+							File << Key << "=" << MakeValue(Prefix, Random) << "\n";
+							Settings.push_back({ (Prefix == 's') || (Prefix == 'f') ? INIQuery::QueryString : INIQuery::QueryInt,
+								fileName.c_str(), sections[i], Key });
+						}
+						File << "\n";
+					}
+				};
+
+			Generate(CreationKit, CreationKitSections, std::size(CreationKitSections), 32);
+			Generate(Prefs, PrefsSections, std::size(PrefsSections), 16);
+
+			// Запуск: все настройки по разу и каждая двенадцатая - промах
+			for (size_t i = 0; i < Settings.size(); i++)
+			{
+				Queries.push_back(Settings[i]);
+				if (!(i % 12))
+				{
+					auto Miss = Settings[i];
+					Miss.key += "Old";
+					Queries.push_back(Miss);
+				}
+			}
+
+			// Диалоги: настройки первых секций обоих файлов и изредка секция целиком
+			Array<INIQuery> Dialog;
+			for (auto& Setting : Settings)
+			{
+				if ((Setting.section == "General") || (Setting.section == "Display") ||
+					(Setting.section == "RenderWindow") || (Setting.section == "ObjectWindow"))
+					Dialog.push_back(Setting);
+			}
+
+			for (uint32_t i = 0; i < 4000; i++)
+			{
+				auto Query = Dialog[Random() % Dialog.size()];
+				if (!(i % 200))
+					Query.type = INIQuery::QuerySection;
+				Queries.push_back(Query);
+			}
+		}
+	};
+
+	INITrace& GetTrace()
+	{
+		static INITrace Trace;
+		return Trace;
+	}
+
+	// Прежний путь чтения (до индекса), кеш - структуры mINI
+	ConcurrencyMap<String, std::shared_ptr<mINI::INIStructure>> LegacyCache;
+
+	mINI::INIStructure* LegacyGetFile(LPCSTR lpFileName)
+	{
+		auto fileName = INICacheDataPatch::GetAbsoluteFileName(lpFileName);
+		auto it = LegacyCache.find(fileName);
+		if (it != LegacyCache.end())
+			return it->second.get();
+
+		auto data = std::make_shared<mINI::INIStructure>();
+		mINI::INIFile file(fileName);
+		file.read(*data, false);
+		return LegacyCache.insert(std::make_pair(fileName, data)).first->second.get();
+	}
+
+	UINT LegacyGetPrivateProfileIntA(LPCSTR lpAppName, LPCSTR lpKeyName, INT nDefault, LPCSTR lpFileName)
+	{
+		auto ini_data = LegacyGetFile(lpFileName);
+
+		String s;
+		auto ip = ini_data->get(lpAppName);
+		if (!ip.has(lpKeyName))
+			return (UINT)nDefault;
+		else
+			s = ip.get(lpKeyName);
+
+		static const char* whitespace_delimiters = " \t\n\r\f\v";
+		s.erase(s.find_last_not_of(whitespace_delimiters) + 1);
+		s.erase(0, s.find_first_not_of(whitespace_delimiters));
+
+		if (s[0] == '"') s.erase(0, 1);
+		if (s[s.length() - 1] == '"') s.resize(s.length() - 1);
+
+		char* end_ptr = nullptr;
+
+		if (s.find_first_of("0x") == 0)
+			return strtoul(s.c_str() + 2, &end_ptr, 16);
+		else
+			return strtoul(s.c_str(), &end_ptr, 10);
+	}
+
+	DWORD LegacyGetPrivateProfileStringA(LPCSTR lpAppName, LPCSTR lpKeyName, LPCSTR lpDefault,
+		LPSTR lpReturnedString, DWORD nSize, LPCSTR lpFileName)
+	{
+		auto ini_data = LegacyGetFile(lpFileName);
+
+		String s;
+		size_t l = 0;
+
+		if (lpAppName && !lpKeyName)
+		{
+			auto ip = ini_data->get(lpAppName);
+
+			for (auto i = ip.begin(); i != ip.end(); i++)
+			{
+				s.append(i->first).append("=").append(i->second).append("\n");
+				l = std::min((size_t)nSize, s.length());
+				if (l == nSize) break;
+			}
+
+			memcpy(lpReturnedString, (const void*)s.c_str(), l);
+		}
+		else
+		{
+			auto ip = ini_data->get(lpAppName);
+			if (!ip.has(lpKeyName))
+				s = lpDefault ? lpDefault : "";
+			else
+				s = ip.get(lpKeyName);
+
+			static const char* whitespace_delimiters = " \t\n\r\f\v";
+			s.erase(s.find_last_not_of(whitespace_delimiters) + 1);
+			s.erase(0, s.find_first_not_of(whitespace_delimiters));
+
+			if (s[0] == '"') s.erase(0, 1);
+			if (s[s.length() - 1] == '"') s.resize(s.length() - 1);
+
+			l = std::min((size_t)nSize, s.length());
+			memcpy(lpReturnedString, (const void*)s.c_str(), l);
+		}
+
+		lpReturnedString[(l == nSize) ? l - 1 : l] = '\0';
+		return (DWORD)l;
+	}
+
+	BOOL LegacyWritePrivateProfileStringA(LPCSTR lpAppName, LPCSTR lpKeyName, LPCSTR lpString, LPCSTR lpFileName)
+	{
+		auto fileName = INICacheDataPatch::GetAbsoluteFileName(lpFileName);
+		auto ini_data = LegacyGetFile(lpFileName);
+
+		(*ini_data)[lpAppName][lpKeyName] = lpString;
+
+		if (ini_data->size() > 0)
+		{
+			mINI::INIFile file(fileName);
+			return file.write(*ini_data);
+		}
+		else
+			return false;
+	}
+
+	template<typename Write, typename Flush>
+	void WriteBurst(benchmark::State& state, const char* name, Write&& write, Flush&& flush)
+	{
+		static Tests::TempDirectory Temp;
+		auto FileName = Temp.File(name);
+		CopyFileA(GetTrace().Prefs.c_str(), FileName.c_str(), FALSE);
+
+		uint32_t Round = 0;
+		for (auto _ : state)
+		{
+			for (int64_t i = 0; i < state.range(0); i++)
+			{
+				auto Key = "iBurstSetting" + std::to_string(i);
+				auto Value = std::to_string(Round + i);
+				write("RenderWindow", Key.c_str(), Value.c_str(), FileName.c_str());
+			}
+			flush();
+			Round++;
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+
+	template<typename GetInt, typename GetString>
+	void Replay(benchmark::State& state, GetInt&& getInt, GetString&& getString)
+	{
+		auto& Trace = GetTrace();
+		char Buffer[4096];
+
+		for (auto _ : state)
+		{
+			for (auto& Query : Trace.Queries)
+			{
+				switch (Query.type)
+				{
+				case INIQuery::QueryInt:
+					benchmark::DoNotOptimize(getInt(Query.section.c_str(), Query.key.c_str(), 0, Query.fileName));
+					break;
+				case INIQuery::QueryString:
+					benchmark::DoNotOptimize(getString(Query.section.c_str(), Query.key.c_str(), "", Buffer,
+						(DWORD)sizeof(Buffer), Query.fileName));
+					break;
+				default:
+					benchmark::DoNotOptimize(getString(Query.section.c_str(), nullptr, "", Buffer,
+						(DWORD)sizeof(Buffer), Query.fileName));
+					break;
+				}
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * Trace.Queries.size());
+	}
+}
+
+static void BM_INITraceLegacy(benchmark::State& state)
+{
+	Replay(state, LegacyGetPrivateProfileIntA, LegacyGetPrivateProfileStringA);
+}
+BENCHMARK(BM_INITraceLegacy)->Unit(benchmark::kMicrosecond);
+
+static void BM_INITrace(benchmark::State& state)
+{
+	Replay(state, INICacheDataPatch::HKGetPrivateProfileIntA, INICacheDataPatch::HKGetPrivateProfileStringA);
+}
+BENCHMARK(BM_INITrace)->Unit(benchmark::kMicrosecond);
+
+static void BM_INIWriteBurstLegacy(benchmark::State& state)
+{
+	WriteBurst(state, "LegacyPrefs.ini", LegacyWritePrivateProfileStringA, [] {});
+}
+BENCHMARK(BM_INIWriteBurstLegacy)->Arg(1)->Arg(16)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+static void BM_INIWriteBurst(benchmark::State& state)
+{
+	INICacheDataPatch Patch;
+	WriteBurst(state, "CreationKitPrefs.ini", INICacheDataPatch::HKWritePrivateProfileStringA,
+		[&] { Patch.ClearAndFlush(); });
+}
+BENCHMARK(BM_INIWriteBurst)->Arg(1)->Arg(16)->Arg(64)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
@@ -0,0 +1,38 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Окружение для Patches/INICacheData.cpp. Исходник собирается копией без #include (её делает CMakeLists.txt),
+// а этот заголовок подключается к ней принудительно: BSString.cpp тянет за собой менеджер памяти редактора,
+// а кешу от BSString нужно только имя файла из пути.
+
+#include "Core/Engine.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace EditorAPI
+	{
+		class BSString
+		{
+		public:
+			BSString(const char* string) : _string(string ? string : "") {}
+
+			inline int Compare(const char* string) const { return strcasecmp(_string.c_str(), string); }
+
+			struct Utils
+			{
+				static BSString ExtractFileName(const BSString& fname)
+				{
+					auto it = fname._string.find_last_of("/\\");
+					return (it != String::npos) ? BSString(fname._string.c_str() + it + 1) : fname;
+				}
+			};
+		private:
+			String _string;
+		};
+	}
+}
+
+#include "Patches/INICacheData.h"
\ No newline at end of file
@@ -0,0 +1,329 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <sys/inotify.h>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Patches/INICacheData.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Patches;
+
+namespace
+{
+	constexpr const char* INIText =
+		"; CreationKit.ini\n"
+		"[General]\n"
+		"sLanguage = \"ENGLISH\" \n"
+		"iSize W=1920\n"
+		"uHex=0x1F\n"
+		"bFlag=1\n"
+		"sEmpty=\n"
+		"\n"
+		"[Display]\n"
+		"fGamma=1.5\n";
+
+	void WriteText(const String& fileName, const char* text)
+	{
+		std::ofstream File(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		File << text;
+	}
+
+	String ReadString(const char* section, const char* key, const char* def, const String& fileName, DWORD size = 256)
+	{
+		Array<char> Buffer(size);
+		auto Length = INICacheDataPatch::HKGetPrivateProfileStringA(section, key, def, Buffer.data(), size,
+			fileName.c_str());
+		EXPECT_LE(Length, size);
+		return Buffer.data();
+	}
+
+	String ReadText(const String& fileName)
+	{
+		std::ifstream File(fileName.c_str(), std::ios::in | std::ios::binary);
+		return String(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+	}
+
+	// Кеш глобальный и живёт весь процесс, поэтому у каждого теста свой файл.
+	// Патч разрушается раньше каталога и дописывает на диск всё, что ещё ждёт записи.
+	class INICacheTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			FileName = Temp.File("CreationKit.ini");
+			WriteText(FileName, INIText);
+		}
+
+		Tests::TempDirectory Temp;
+		String FileName;
+		INICacheDataPatch Patch;
+	};
+
+	// Задержки потока записи из INICacheData.cpp
+	constexpr DWORD FLUSH_DELAY_MS = 250;
+	constexpr DWORD FLUSH_MAX_DELAY_MS = 2000;
+
+	// Считает подмены файла в каталоге: поток записи кладёт новую версию через rename
+	class ReplaceCounter
+	{
+	public:
+		ReplaceCounter(const String& directory, const char* name) : _name(name)
+		{
+			_fd = inotify_init1(IN_NONBLOCK);
+			inotify_add_watch(_fd, directory.c_str(), IN_MOVED_TO);
+		}
+
+		~ReplaceCounter()
+		{
+			close(_fd);
+		}
+
+		uint32_t Count()
+		{
+			alignas(inotify_event) char Buffer[4096];
+			ssize_t Length;
+			while ((Length = read(_fd, Buffer, sizeof(Buffer))) > 0)
+			{
+				for (auto Ptr = Buffer; Ptr < Buffer + Length;)
+				{
+					auto Event = (const inotify_event*)Ptr;
+					if (Event->len && (_name == Event->name))
+						_count++;
+					Ptr += sizeof(inotify_event) + Event->len;
+				}
+			}
+			return _count;
+		}
+	private:
+		int _fd;
+		uint32_t _count = 0;
+		String _name;
+	};
+}
+
+TEST_F(INICacheTest, ReadsValuesLikeGetPrivateProfile)
+{
+	// Регистр имён не важен, пробелы и кавычки по краям значения снимаются
+	EXPECT_EQ(ReadString("general", "SLANGUAGE", "", FileName), "ENGLISH");
+	EXPECT_EQ(ReadString("General", "sEmpty", "x", FileName), "");
+	EXPECT_EQ(ReadString("Display", "fGamma", "", FileName), "1.5");
+	EXPECT_EQ(ReadString("General", "fGamma", "  \"def\" ", FileName), "def");
+	EXPECT_EQ(ReadString("Missing", "sLanguage", nullptr, FileName), "");
+	EXPECT_EQ(ReadString("General", "sLanguage", "", FileName, 4), "ENG");
+
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", "iSize W", 7, FileName.c_str()), 1920u);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("GENERAL", "uHex", 7, FileName.c_str()), 0x1Fu);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", "bFlag", 7, FileName.c_str()), 1u);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", "iMissing", 7, FileName.c_str()), 7u);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", nullptr, 7, FileName.c_str()), 7u);
+
+	// Текст W-версии копируется по два байта на символ, как WCHAR в Windows, под Linux сверяется только длина
+	WCHAR Buffer[64];
+	auto WideFileName = Conversion::AnsiToWide(FileName);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileStringW(L"General", L"sLanguage", L"", Buffer, 64,
+		WideFileName.c_str()), 7u);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntW(L"General", L"iSize W", 7, WideFileName.c_str()), 1920u);
+}
+
+TEST_F(INICacheTest, ReadsSectionsAndWholeFile)
+{
+	// Без ключа - все ключи секции, без секции - весь файл, значения как в файле
+	EXPECT_EQ(ReadString("Display", nullptr, "", FileName), "fgamma=1.5\n");
+	EXPECT_EQ(ReadString("General", nullptr, "", FileName, 1024),
+		"slanguage=\"ENGLISH\"\nisize w=1920\nuhex=0x1F\nbflag=1\nsempty=\n");
+	EXPECT_EQ(ReadString(nullptr, nullptr, "", FileName, 1024),
+		"[general]\nslanguage=\"ENGLISH\"\nisize w=1920\nuhex=0x1F\nbflag=1\nsempty=\n[display]\nfgamma=1.5\n");
+	EXPECT_EQ(ReadString("Missing", nullptr, "", FileName), "");
+}
+
+TEST_F(INICacheTest, ReadsSeeWrites)
+{
+	EXPECT_EQ(ReadString("General", "sLanguage", "", FileName), "ENGLISH");
+
+	// Индекс строится заново после каждой записи
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("General", "sLanguage", "RUSSIAN", FileName.c_str()));
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("General", "iNew", "42", FileName.c_str()));
+	EXPECT_EQ(ReadString("General", "sLanguage", "", FileName), "RUSSIAN");
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", "iNew", 0, FileName.c_str()), 42u);
+
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("General", "iNew", nullptr, FileName.c_str()));
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", "iNew", 5, FileName.c_str()), 5u);
+
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("Display", nullptr, nullptr, FileName.c_str()));
+	EXPECT_EQ(ReadString("Display", "fGamma", "none", FileName), "none");
+	EXPECT_EQ(ReadString("Display", nullptr, "", FileName), "");
+
+	auto WideFileName = Conversion::AnsiToWide(FileName);
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringW(L"Audio", L"fVolume", L"0.5", WideFileName.c_str()));
+	EXPECT_EQ(ReadString("audio", "fvolume", "", FileName), "0.5");
+}
+
+TEST_F(INICacheTest, StructRoundTrip)
+{
+	uint8_t Data[6] = { 0x00, 0x7F, 0x80, 0xAB, 0xFF, 0x10 };
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStructA("Window", "Position", Data, sizeof(Data),
+		FileName.c_str()));
+
+	// Две шестнадцатеричные цифры на байт и контрольная сумма
+	EXPECT_EQ(ReadString("Window", "Position", "", FileName), "007F80ABFF10B9");
+
+	uint8_t Read[6] = {};
+	EXPECT_TRUE(INICacheDataPatch::HKGetPrivateProfileStructA("Window", "Position", Read, sizeof(Read),
+		FileName.c_str()));
+	EXPECT_EQ(memcmp(Data, Read, sizeof(Data)), 0);
+
+	// Размер не совпадает с записанным
+	EXPECT_FALSE(INICacheDataPatch::HKGetPrivateProfileStructA("Window", "Position", Read, 4, FileName.c_str()));
+	EXPECT_FALSE(INICacheDataPatch::HKGetPrivateProfileStructA("Window", "Missing", Read, sizeof(Read),
+		FileName.c_str()));
+}
+
+TEST_F(INICacheTest, ReadersRaceWriter)
+{
+	// Читатели держат старый индекс, пока писатель меняет файл, и видят только целые значения по порядку
+	constexpr uint32_t WRITES = 2000;
+	std::atomic<bool> Done = false;
+	std::atomic<uint64_t> Errors = 0;
+
+	Array<std::thread> Readers;
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		Readers.emplace_back([&]
+			{
+				UINT Last = 0;
+				while (!Done.load())
+				{
+					auto Value = INICacheDataPatch::HKGetPrivateProfileIntA("Counter", "iValue", 0, FileName.c_str());
+					auto Text = ReadString("Counter", "sValue", "0", FileName);
+					if ((Value < Last) || (Value > WRITES) || (strtoul(Text.c_str(), nullptr, 10) > WRITES))
+						Errors++;
+					Last = Value;
+				}
+			});
+	}
+
+	for (uint32_t i = 1; i <= WRITES; i++)
+	{
+		auto Value = std::to_string(i);
+		INICacheDataPatch::HKWritePrivateProfileStringA("Counter", "iValue", Value.c_str(), FileName.c_str());
+		INICacheDataPatch::HKWritePrivateProfileStringA("Counter", "sValue", Value.c_str(), FileName.c_str());
+	}
+
+	Done = true;
+	for (auto& Reader : Readers)
+		Reader.join();
+
+	EXPECT_EQ(Errors.load(), 0u);
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("Counter", "iValue", 0, FileName.c_str()), WRITES);
+}
+
+TEST_F(INICacheTest, FlushBarrierWritesPendingChanges)
+{
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("General", "sLanguage", "RUSSIAN", FileName.c_str()));
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("General", "bFlag", nullptr, FileName.c_str()));
+	EXPECT_TRUE(INICacheDataPatch::HKWritePrivateProfileStringA("Audio", "fVolume", "0.5", FileName.c_str()));
+
+	// Запись только помечает файл, на диск он уходит позже
+	EXPECT_EQ(ReadText(FileName), INIText);
+
+	// Комментарии и порядок строк остаются, новый ключ и секция дописываются в конец
+	Patch.ClearAndFlush();
+	EXPECT_EQ(ReadText(FileName),
+		"; CreationKit.ini\n"
+		"[General]\n"
+		"sLanguage =RUSSIAN\n"
+		"iSize W=1920\n"
+		"uHex=0x1F\n"
+		"sEmpty=\n"
+		"\n"
+		"[Display]\n"
+		"fGamma=1.5\n"
+		"[audio]\n"
+		"fvolume=0.5\n");
+	EXPECT_EQ(GetFileAttributesA((FileName + ".ckpe.tmp").c_str()), INVALID_FILE_ATTRIBUTES);
+
+	// Сброс без изменений файл не трогает
+	ReplaceCounter Counter(Temp.Path(), "CreationKit.ini");
+	Patch.ClearAndFlush();
+	EXPECT_EQ(Counter.Count(), 0u);
+}
+
+TEST_F(INICacheTest, CoalescesWriteBurst)
+{
+	EXPECT_EQ(INICacheDataPatch::HKGetPrivateProfileIntA("General", "iSize W", 0, FileName.c_str()), 1920u);
+
+	ReplaceCounter Counter(Temp.Path(), "CreationKit.ini");
+	for (uint32_t i = 1; i <= 100; i++)
+	{
+		auto Value = std::to_string(i);
+		INICacheDataPatch::HKWritePrivateProfileStringA("General", "iSize W", Value.c_str(), FileName.c_str());
+	}
+	EXPECT_EQ(Counter.Count(), 0u);
+
+	// Поток записи ждёт, пока записи затихнут, и кладёт файл один раз
+	auto Start = GetTickCount64();
+	while ((ReadText(FileName).find("iSize W=100\n") == String::npos) && ((GetTickCount64() - Start) < 5000))
+		Sleep(10);
+	Sleep(FLUSH_DELAY_MS * 2);
+
+	EXPECT_NE(ReadText(FileName).find("iSize W=100\n"), String::npos);
+	EXPECT_EQ(Counter.Count(), 1u);
+}
+
+TEST_F(INICacheTest, KeepsVersionsOnDiskInOrder)
+{
+	// Записи идут без перерыва дольше FLUSH_MAX_DELAY_MS, поэтому файл сбрасывается и посреди них.
+	// На диске всегда целый файл, и версии значения только растут.
+	constexpr uint32_t WRITES = 2500;
+	WriteText(FileName, "; CreationKit.ini\n[General]\niValue=0\n; tail\n");
+
+	std::atomic<bool> Done = false;
+	std::atomic<uint64_t> Errors = 0;
+	uint32_t Versions = 0;
+
+	std::thread Reader([&]
+		{
+			uint32_t Last = 0;
+			while (!Done.load())
+			{
+				auto Text = ReadText(FileName);
+				auto Pos = Text.find("\niValue=");
+				if ((Text.rfind("; CreationKit.ini\n[General]\n", 0) != 0) || (Pos == String::npos) ||
+					(Text.find("; tail\n") == String::npos))
+				{
+					Errors++;
+					continue;
+				}
+
+				auto Value = (uint32_t)strtoul(Text.c_str() + Pos + 8, nullptr, 10);
+				if (Value < Last)
+					Errors++;
+				else if (Value > Last)
+					Versions++;
+				Last = Value;
+				Sleep(1);
+			}
+		});
+
+	auto Start = GetTickCount64();
+	for (uint32_t i = 1; i <= WRITES; i++)
+	{
+		auto Value = std::to_string(i);
+		INICacheDataPatch::HKWritePrivateProfileStringA("General", "iValue", Value.c_str(), FileName.c_str());
+		Sleep(1);
+	}
+	auto Elapsed = GetTickCount64() - Start;
+
+	Patch.ClearAndFlush();
+	Sleep(10);
+	Done = true;
+	Reader.join();
+
+	EXPECT_EQ(Errors.load(), 0u);
+	if (Elapsed > FLUSH_MAX_DELAY_MS + FLUSH_DELAY_MS)
+		EXPECT_GE(Versions, 2u);
+	EXPECT_EQ(ReadText(FileName), "; CreationKit.ini\n[General]\niValue=" + std::to_string(WRITES) + "\n; tail\n");
+}
\ No newline at end of file
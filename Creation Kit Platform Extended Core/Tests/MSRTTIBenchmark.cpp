@@ -0,0 +1,217 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Разбор RTTI образа размером с .rdata редактора: параллельное сканирование с отложенным
+// разбором имён против прежнего последовательного прохода, первый запуск (сканирование и запись
+// кеша) против повторного (чтение кеша), поиск по индексам против перебора
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "RttiImage.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace CreationKitPlatformExtended::Core::MSRTTI
+{
+	extern Array<Info> Tables;
+}
+
+namespace
+{
+	struct Fixture
+	{
+		Tests::RttiImage Image;
+		Array<String> Names;
+
+		Fixture() : Image(16 * 1024 * 1024, 24 * 1024 * 1024, 4 * 1024 * 1024)
+		{
+			Names = Tests::AddGeneratedClasses(Image, 20000, 1);
+			Image.Install();
+			Tests::GetEngineConfig().ExecutableCRC32 = 0;
+			Tests::CreateEngine();
+		}
+	};
+
+	Fixture& GetFixture()
+	{
+		static Fixture Data;
+		return Data;
+	}
+
+	// Прежний Initialize: побайтовый проход по .rdata в одном потоке и разбор каждого имени сразу
+	size_t ScanSerial()
+	{
+		auto Rdata = GlobalEnginePtr->GetSection(SECTION_DATA_READONLY);
+		Array<MSRTTI::Info> Result;
+
+		for (uintptr_t i = Rdata.base; i < (Rdata.end - 2 * sizeof(uintptr_t)); i += 2)
+		{
+			uintptr_t Address = *(uintptr_t*)i;
+			uintptr_t FunctionAddress = *(uintptr_t*)(i + sizeof(uintptr_t));
+			if (!MSRTTI::detail::IsWithinRDATA(Address) || !MSRTTI::detail::IsWithinCODE(FunctionAddress))
+				continue;
+
+			auto Locator = (MSRTTI::detail::CompleteObjectLocator*)Address;
+			if (!MSRTTI::detail::IsValidCOL(Locator))
+				continue;
+
+			MSRTTI::Info Info = { i + sizeof(uintptr_t), Locator->Offset, 0, nullptr,
+				Locator->TypeDescriptor.Get()->name, Locator };
+			for (uintptr_t j = Info.VTableAddress; j < (Rdata.end - sizeof(uintptr_t)); j += sizeof(uintptr_t))
+			{
+				if (!MSRTTI::detail::IsWithinCODE(*(uintptr_t*)j))
+					break;
+				Info.VFunctionCount++;
+			}
+
+			Info.GetName();
+			Result.push_back(Info);
+		}
+
+		for (auto& Info : Result)
+			free((void*)Info.DemangledName);
+		return Result.size();
+	}
+}
+
+static void BM_MSRTTIInitialize(benchmark::State& state)
+{
+	GetFixture();
+	for (auto _ : state)
+	{
+		MSRTTI::Initialize();
+		benchmark::DoNotOptimize(MSRTTI::Tables.size());
+		MSRTTI::Release();
+	}
+}
+BENCHMARK(BM_MSRTTIInitialize)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_MSRTTIScanSerial(benchmark::State& state)
+{
+	GetFixture();
+	// IsWithinRDATA/IsWithinCODE берут границы секций из Initialize
+	MSRTTI::Initialize();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(ScanSerial());
+	MSRTTI::Release();
+}
+BENCHMARK(BM_MSRTTIScanSerial)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_MSRTTIColdStart(benchmark::State& state)
+{
+	GetFixture();
+	Tests::TempDirectory Temp;
+	Tests::SetApplicationPath(Temp.Path().c_str());
+	Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+	Tests::CreateEngine();
+	auto CacheFileName = Temp.File("CreationKitPlatformExtended_RTTI.cache");
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		remove(CacheFileName.c_str());
+		state.ResumeTiming();
+
+		MSRTTI::Initialize();
+		benchmark::DoNotOptimize(MSRTTI::Tables.size());
+		MSRTTI::Release();
+	}
+
+	Tests::GetEngineConfig().ExecutableCRC32 = 0;
+	Tests::CreateEngine();
+	Tests::SetApplicationPath("./");
+}
+BENCHMARK(BM_MSRTTIColdStart)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_MSRTTIWarmStart(benchmark::State& state)
+{
+	GetFixture();
+	Tests::TempDirectory Temp;
+	Tests::SetApplicationPath(Temp.Path().c_str());
+	Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+	Tests::CreateEngine();
+	MSRTTI::Initialize();
+	MSRTTI::Release();
+
+	for (auto _ : state)
+	{
+		MSRTTI::Initialize();
+		benchmark::DoNotOptimize(MSRTTI::Tables.size());
+		MSRTTI::Release();
+	}
+
+	Tests::GetEngineConfig().ExecutableCRC32 = 0;
+	Tests::CreateEngine();
+	Tests::SetApplicationPath("./");
+}
+BENCHMARK(BM_MSRTTIWarmStart)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_MSRTTIFindExact(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	MSRTTI::Initialize();
+	Array<String> Queries;
+	for (size_t i = 0; i < Data.Names.size(); i += 97)
+		Queries.push_back(Tests::DemangleRawName(Data.Names[i].c_str()));
+
+	size_t Index = 0;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(MSRTTI::FindAll(Queries[Index++ % Queries.size()].c_str()));
+	MSRTTI::Release();
+}
+BENCHMARK(BM_MSRTTIFindExact);
+
+static void BM_MSRTTIFindExactLinear(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	MSRTTI::Initialize();
+	Array<String> Queries;
+	for (size_t i = 0; i < Data.Names.size(); i += 97)
+		Queries.push_back(Tests::DemangleRawName(Data.Names[i].c_str()));
+
+	size_t Index = 0;
+	for (auto _ : state)
+	{
+		Array<const MSRTTI::Info*> Results;
+		auto Name = Queries[Index++ % Queries.size()].c_str();
+		for (auto& Info : MSRTTI::Tables)
+		{
+			if (!strcmp(Info.GetName(), Name))
+				Results.push_back(&Info);
+		}
+		benchmark::DoNotOptimize(Results);
+	}
+	MSRTTI::Release();
+}
+BENCHMARK(BM_MSRTTIFindExactLinear);
+
+static void BM_MSRTTIFindSubstring(benchmark::State& state)
+{
+	GetFixture();
+	MSRTTI::Initialize();
+	for (auto _ : state)
+		benchmark::DoNotOptimize(MSRTTI::FindAll("gen1234", false));
+	MSRTTI::Release();
+}
+BENCHMARK(BM_MSRTTIFindSubstring);
+
+static void BM_MSRTTIFindSubstringLinear(benchmark::State& state)
+{
+	GetFixture();
+	MSRTTI::Initialize();
+	for (auto _ : state)
+	{
+		Array<const MSRTTI::Info*> Results;
+		for (auto& Info : MSRTTI::Tables)
+		{
+			if (MSRTTI::detail::strcasestr(Info.GetName(), "gen1234"))
+				Results.push_back(&Info);
+		}
+		benchmark::DoNotOptimize(Results);
+	}
+	MSRTTI::Release();
+}
+BENCHMARK(BM_MSRTTIFindSubstringLinear);
\ No newline at end of file
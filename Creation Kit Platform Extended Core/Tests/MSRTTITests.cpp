@@ -0,0 +1,285 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "RttiImage.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace CreationKitPlatformExtended::Core::MSRTTI
+{
+	extern Array<Info> Tables;
+}
+
+namespace
+{
+	class MSRTTITest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			Image = new Tests::RttiImage(1024 * 1024, 4 * 1024 * 1024, 1024 * 1024);
+
+			// Таблица на стыке частей сканирования (по 64 КБ): COL в одной части, функции в другой,
+			// и таблица, выровненная только на 2 байта
+			Image->AddClass(".?AVBoundary@@", {}, 5, 0x10000);
+			Image->AddClass(".?AUUnaligned@Space@@", {}, 3, 0x2000A);
+			Image->AddDecoys();
+			Names = new Array<String>(Tests::AddGeneratedClasses(*Image, 5000, 7));
+			Image->AddDecoys();
+		}
+
+		static void TearDownTestSuite()
+		{
+			delete Names;
+			delete Image;
+		}
+
+		void SetUp() override
+		{
+			Image->Install();
+			// Без CRC исполняемого файла кеш каталога не используется
+			Tests::GetEngineConfig().ExecutableCRC32 = 0;
+			Tests::CreateEngine();
+			MSRTTI::Initialize();
+		}
+
+		void TearDown() override
+		{
+			MSRTTI::Release();
+			Tests::DestroyEngine();
+			Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+		}
+
+		static Array<const MSRTTI::Info*> FindAllNaive(const char* Name)
+		{
+			Array<const MSRTTI::Info*> Result;
+			for (auto& Info : MSRTTI::Tables)
+			{
+				if (MSRTTI::detail::strcasestr(Info.GetName(), Name))
+					Result.push_back(&Info);
+			}
+			return Result;
+		}
+
+		static Tests::RttiImage* Image;
+		static Array<String>* Names;
+	};
+
+	Tests::RttiImage* MSRTTITest::Image = nullptr;
+	Array<String>* MSRTTITest::Names = nullptr;
+}
+
+TEST_F(MSRTTITest, FindsEveryVTableInAddressOrder)
+{
+	auto Expected = Image->GetVTables();
+	std::sort(Expected.begin(), Expected.end(), [](auto& a, auto& b) { return a.Address < b.Address; });
+
+	ASSERT_EQ(MSRTTI::Tables.size(), Expected.size());
+	for (size_t i = 0; i < Expected.size(); i++)
+	{
+		auto& Info = MSRTTI::Tables[i];
+		ASSERT_EQ(Info.VTableAddress, Expected[i].Address) << Expected[i].RawName;
+		EXPECT_EQ(Info.VTableOffset, Expected[i].Offset);
+		EXPECT_EQ(Info.VFunctionCount, Expected[i].FunctionCount);
+		EXPECT_STREQ(Info.RawName, Expected[i].RawName.c_str());
+		EXPECT_EQ(Info.Locator, Image->GetLocator(Expected[i].RawName.c_str(), Expected[i].Offset));
+	}
+}
+
+TEST_F(MSRTTITest, DemanglesOnFirstUse)
+{
+	for (auto& Info : MSRTTI::Tables)
+		ASSERT_EQ(Info.DemangledName, nullptr);
+
+	auto& Info = MSRTTI::Tables[0];
+	auto Name = Info.GetName();
+	EXPECT_EQ(Tests::DemangleRawName(Info.RawName), Name);
+	EXPECT_EQ(Info.GetName(), Name);
+	EXPECT_EQ(MSRTTI::Tables[1].DemangledName, nullptr);
+}
+
+TEST_F(MSRTTITest, FindsExactNames)
+{
+	auto Boundary = MSRTTI::Find("class Boundary");
+	EXPECT_EQ(Boundary->VFunctionCount, 5u);
+	auto Unaligned = MSRTTI::Find("struct Space::Unaligned");
+	EXPECT_EQ(Unaligned->VFunctionCount, 3u);
+
+	// Все vtable класса, у классов с двумя базами их две
+	for (auto& RawName : *Names)
+	{
+		auto Results = MSRTTI::FindAll(Tests::DemangleRawName(RawName.c_str()).c_str());
+		size_t Expected = 0;
+		for (auto& VTable : Image->GetVTables())
+			Expected += VTable.RawName == RawName;
+
+		ASSERT_EQ(Results.size(), Expected) << RawName;
+		for (auto Info : Results)
+			EXPECT_STREQ(Info->RawName, RawName.c_str());
+	}
+
+	EXPECT_TRUE(MSRTTI::FindAll("class Gen3Form").empty());
+	EXPECT_TRUE(MSRTTI::FindAll("class Missing").empty());
+	EXPECT_TRUE(MSRTTI::FindAll("Boundary").empty());
+	EXPECT_TRUE(MSRTTI::FindAll("class Decoy").empty());
+}
+
+TEST_F(MSRTTITest, FindsSubstringsLikeLinearSearch)
+{
+	for (auto Name : { "Gen12", "gen12", "SPACE3::", "form", "Form@", "Space::Unaligned", "ss B", "::", "n", "zzz" })
+	{
+		auto Results = MSRTTI::FindAll(Name, false);
+		std::sort(Results.begin(), Results.end());
+		EXPECT_EQ(Results, FindAllNaive(Name)) << Name;
+	}
+}
+
+namespace
+{
+	class MSRTTICacheTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			Image = std::make_unique<Tests::RttiImage>(256 * 1024, 1024 * 1024, 256 * 1024, 3);
+			Tests::AddGeneratedClasses(*Image, 500, 3);
+			Image->Install();
+			Tests::SetApplicationPath(Temp.Path().c_str());
+			Tests::CreateEngine();
+			CacheFileName = Temp.File("CreationKitPlatformExtended_RTTI.cache");
+		}
+
+		void TearDown() override
+		{
+			MSRTTI::Release();
+			Tests::DestroyEngine();
+			Tests::SetApplicationPath("./");
+			Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+		}
+
+		// Перезапуск: каталог заново строится из кеша или сканированием
+		size_t Restart()
+		{
+			MSRTTI::Release();
+			Tests::CreateEngine();
+			MSRTTI::Initialize();
+			return MSRTTI::Tables.size();
+		}
+
+		void ExpectSameAsImage()
+		{
+			auto Expected = Image->GetVTables();
+			ASSERT_EQ(MSRTTI::Tables.size(), Expected.size());
+			std::sort(Expected.begin(), Expected.end(), [](auto& a, auto& b) { return a.Address < b.Address; });
+			for (size_t i = 0; i < Expected.size(); i++)
+			{
+				EXPECT_EQ(MSRTTI::Tables[i].VTableAddress, Expected[i].Address);
+				EXPECT_EQ(MSRTTI::Tables[i].VFunctionCount, Expected[i].FunctionCount);
+				EXPECT_STREQ(MSRTTI::Tables[i].RawName, Expected[i].RawName.c_str());
+			}
+		}
+
+		Tests::TempDirectory Temp;
+		std::unique_ptr<Tests::RttiImage> Image;
+		String CacheFileName;
+	};
+}
+
+TEST_F(MSRTTICacheTest, ServesRestartFromCache)
+{
+	MSRTTI::Initialize();
+	auto Count = MSRTTI::Tables.size();
+	struct stat Stat;
+	ASSERT_EQ(stat(CacheFileName.c_str(), &Stat), 0);
+	EXPECT_NE(stat((CacheFileName + ".tmp").c_str(), &Stat), 0);
+
+	// Класс, добавленный после записи кеша, виден только при новом сканировании
+	Image->AddClass(".?AVAddedLater@@", {}, 4);
+	EXPECT_EQ(Restart(), Count);
+	EXPECT_FALSE(MSRTTI::FindAll("class Gen11Form").empty());
+	EXPECT_FALSE(MSRTTI::FindAll("struct Gen10Form").empty());
+	EXPECT_TRUE(MSRTTI::FindAll("class AddedLater").empty());
+
+	// Другой исполняемый файл - кеш не подходит и перезаписывается
+	Tests::GetEngineConfig().ExecutableCRC32 = 0x5555AAAAul;
+	EXPECT_EQ(Restart(), Count + 1);
+	ExpectSameAsImage();
+	Image->AddClass(".?AVAddedLast@@", {}, 4);
+	EXPECT_EQ(Restart(), Count + 1);
+}
+
+TEST_F(MSRTTICacheTest, RescansDamagedCache)
+{
+	MSRTTI::Initialize();
+	auto Count = MSRTTI::Tables.size();
+	Image->AddClass(".?AVAddedLater@@", {}, 4);
+
+	// Испорченная запись
+	std::fstream Stream(CacheFileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	Stream.seekp(64);
+	Stream.put('\x5A');
+	Stream.close();
+	EXPECT_EQ(Restart(), Count + 1);
+	ExpectSameAsImage();
+
+	// Обрезанный файл
+	std::filesystem::resize_file(CacheFileName.c_str(), 40);
+	Image->AddClass(".?AVAddedLast@@", {}, 4);
+	EXPECT_EQ(Restart(), Count + 2);
+	ExpectSameAsImage();
+
+	// Пустой файл
+	std::filesystem::resize_file(CacheFileName.c_str(), 0);
+	EXPECT_EQ(Restart(), Count + 2);
+}
+
+TEST_F(MSRTTICacheTest, RejectsCacheOfAnotherImage)
+{
+	// Тот же CRC и те же секции, но таблицы лежат в другом месте
+	{
+		Tests::RttiImage Other(256 * 1024, 1024 * 1024, 256 * 1024, 4);
+		Tests::AddGeneratedClasses(Other, 300, 4);
+		Other.Install();
+		Tests::CreateEngine();
+		MSRTTI::Initialize();
+		ASSERT_EQ(MSRTTI::Tables.size(), Other.GetVTables().size());
+		MSRTTI::Release();
+	}
+
+	Image->Install();
+	Restart();
+	ExpectSameAsImage();
+}
+
+TEST_F(MSRTTICacheTest, NoCacheWithoutExecutableCRC)
+{
+	Tests::GetEngineConfig().ExecutableCRC32 = 0;
+	Restart();
+	ExpectSameAsImage();
+
+	struct stat Stat;
+	EXPECT_NE(stat(CacheFileName.c_str(), &Stat), 0);
+}
+
+TEST(MSRTTIEmptyTest, EmptyImage)
+{
+	Tests::RttiImage Image(64 * 1024, 256 * 1024, 64 * 1024);
+	Image.Install();
+	Tests::GetEngineConfig().ExecutableCRC32 = 0;
+	Tests::CreateEngine();
+	MSRTTI::Initialize();
+
+	EXPECT_TRUE(MSRTTI::Tables.empty());
+	EXPECT_TRUE(MSRTTI::FindAll("class Boundary").empty());
+	EXPECT_TRUE(MSRTTI::FindAll("Boundary", false).empty());
+
+	MSRTTI::Release();
+	Tests::DestroyEngine();
+	Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+}
\ No newline at end of file
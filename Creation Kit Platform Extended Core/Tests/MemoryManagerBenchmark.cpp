@@ -0,0 +1,230 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Воспроизведение журнала выделений с распределением размеров, как у редактора при загрузке плагинов:
+// большинство блоков мелкие (компоненты форм, узлы строк и массивов), немного буферов до 256 Кб
+// и редкие крупные (массивы записей, буферы архивов). Кучи редактора всегда просят обнуление.
+// Арена против прежнего пути (vmm, в тестах его заменяет malloc из glibc).
+// Пачки bhkThreadMemorySource: размеры блоков и пачек, как у Havok при генерации навмешей,
+// MemAllocBatch против прежнего цикла по одному блоку. Рост массива в полтора раза через MemRealloc.
+
+#include <random>
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/MemoryManager.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	struct TraceEvent
+	{
+		uint32_t Slot;
+		uint32_t Size;		// 0 - освобождение
+		uint32_t Alignment;
+	};
+
+	// Журнал на заданное число событий: 60% блоков до 64 байт, 25% до 512 байт, 10% до 16 Кб,
+	// 4.9% до 256 Кб, 0.1% до 8 Мб. Большая часть живёт недолго, треть доживает до конца журнала.
+	Array<TraceEvent> MakeTrace(uint32_t count, uint32_t seed)
+	{
+		std::mt19937 Random(seed);
+		Array<TraceEvent> Trace;
+		Array<uint32_t> Short, Free;
+		uint32_t Slots = 0;
+
+		auto Size = [&]() -> uint32_t
+			{
+				auto Roll = Random() % 1000;
+				if (Roll < 600) return 8 + Random() % 57;
+				if (Roll < 850) return 64 + Random() % 449;
+				if (Roll < 950) return 512 + Random() % (16 * 1024 - 511);
+				if (Roll < 999) return 16 * 1024 + Random() % (240 * 1024);
+				return 256 * 1024 + Random() % (8 * 1024 * 1024 - 256 * 1024);
+			};
+
+		while (Trace.size() < count)
+		{
+			if (!Short.empty() && (Short.size() > 256 || (Random() % 2)))
+			{
+				auto Index = Random() % Short.size();
+				auto Slot = Short[Index];
+				Short[Index] = Short.back();
+				Short.pop_back();
+				Trace.push_back({ Slot, 0, 0 });
+				Free.push_back(Slot);
+				continue;
+			}
+
+			uint32_t Slot;
+			if (Free.empty())
+				Slot = Slots++;
+			else
+			{
+				Slot = Free.back();
+				Free.pop_back();
+			}
+
+			Trace.push_back({ Slot, Size(), (Random() % 4) ? 16u : 8u });
+			if (Random() % 3)
+				Short.push_back(Slot);
+		}
+
+		return Trace;
+	}
+
+	struct Fixture
+	{
+		MemoryManager Vmm;
+		MemoryManager Arena;
+		Array<TraceEvent> Trace;
+		uint32_t Slots = 0;
+
+		Fixture()
+		{
+			Arena.EnableArena();
+			Trace = MakeTrace(200000, 1);
+			for (auto& Event : Trace)
+				Slots = std::max(Slots, Event.Slot + 1);
+		}
+	};
+
+	Fixture& GetFixture()
+	{
+		static Fixture Data;
+		return Data;
+	}
+
+	void Replay(benchmark::State& state, MemoryManager& manager)
+	{
+		auto& Data = GetFixture();
+		Array<void*> Blocks(Data.Slots);
+
+		for (auto _ : state)
+		{
+			for (auto& Event : Data.Trace)
+			{
+				if (Event.Size)
+					Blocks[Event.Slot] = manager.MemAlloc(Event.Size, Event.Alignment, true, true);
+				else
+				{
+					manager.MemFree(Blocks[Event.Slot]);
+					Blocks[Event.Slot] = nullptr;
+				}
+			}
+
+			for (auto& Block : Blocks)
+			{
+				if (Block)
+				{
+					manager.MemFree(Block);
+					Block = nullptr;
+				}
+			}
+		}
+
+		state.SetItemsProcessed(state.iterations() * Data.Trace.size());
+	}
+}
+
+static void BM_MemoryReplayVmm(benchmark::State& state)
+{
+	Replay(state, GetFixture().Vmm);
+}
+BENCHMARK(BM_MemoryReplayVmm)->Unit(benchmark::kMillisecond)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_MemoryReplayArena(benchmark::State& state)
+{
+	Replay(state, GetFixture().Arena);
+}
+BENCHMARK(BM_MemoryReplayArena)->Unit(benchmark::kMillisecond)->ThreadRange(1, 4)->UseRealTime();
+
+namespace
+{
+	// Пачки Havok: блоки 32-512 байт, по 8-128 штук, освобождаются той же пачкой
+	constexpr static uint32_t BATCH_SIZES[][2] = { { 32, 128 }, { 64, 64 }, { 128, 32 }, { 256, 16 },
+		{ 512, 8 }, { 48, 96 }, { 96, 48 }, { 192, 24 } };
+
+	template<bool Batch>
+	void ReplayBatches(benchmark::State& state, MemoryManager& manager)
+	{
+		void* Blocks[128];
+		size_t Count = 0;
+
+		for (auto _ : state)
+		{
+			for (auto& Item : BATCH_SIZES)
+			{
+				if constexpr (Batch)
+				{
+					manager.MemAllocBatch(Blocks, Item[1], Item[0], 16, true, true);
+					manager.MemFreeBatch(Blocks, Item[1]);
+				}
+				else
+				{
+					for (uint32_t i = 0; i < Item[1]; i++)
+						Blocks[i] = manager.MemAlloc(Item[0], 16, true, true);
+					for (uint32_t i = 0; i < Item[1]; i++)
+						manager.MemFree(Blocks[i]);
+				}
+
+				Count += Item[1];
+			}
+		}
+
+		state.SetItemsProcessed(Count);
+	}
+}
+
+static void BM_MemoryBatchVmmEach(benchmark::State& state)
+{
+	ReplayBatches<false>(state, GetFixture().Vmm);
+}
+BENCHMARK(BM_MemoryBatchVmmEach)->ThreadRange(1, 4);
+
+static void BM_MemoryBatchArenaEach(benchmark::State& state)
+{
+	ReplayBatches<false>(state, GetFixture().Arena);
+}
+BENCHMARK(BM_MemoryBatchArenaEach)->ThreadRange(1, 4);
+
+static void BM_MemoryBatchArena(benchmark::State& state)
+{
+	ReplayBatches<true>(state, GetFixture().Arena);
+}
+BENCHMARK(BM_MemoryBatchArena)->ThreadRange(1, 4);
+
+namespace
+{
+	// Рост BSTArray при загрузке: в полтора раза, каждый раз дописывается новая часть
+	void GrowArray(benchmark::State& state, MemoryManager& manager)
+	{
+		for (auto _ : state)
+		{
+			void* Block = nullptr;
+			size_t Size = 0;
+			for (size_t NewSize = 64; NewSize <= (size_t)state.range(0); NewSize += NewSize >> 1)
+			{
+				Block = manager.MemRealloc(Block, Size, NewSize, 16, true, true);
+				memset((uint8_t*)Block + Size, 1, NewSize - Size);
+				Size = NewSize;
+			}
+			manager.MemFree(Block);
+		}
+	}
+}
+
+static void BM_MemoryGrowVmm(benchmark::State& state)
+{
+	GrowArray(state, GetFixture().Vmm);
+}
+BENCHMARK(BM_MemoryGrowVmm)->Arg(256 * 1024)->Arg(1024 * 1024)->Arg(64 * 1024 * 1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_MemoryGrowArena(benchmark::State& state)
+{
+	GrowArray(state, GetFixture().Arena);
+}
+BENCHMARK(BM_MemoryGrowArena)->Arg(256 * 1024)->Arg(1024 * 1024)->Arg(64 * 1024 * 1024)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
@@ -0,0 +1,312 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/MemoryManager.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Кеш потока у MemoryArena общий для всех экземпляров, поэтому на процесс одна арена,
+	// как и в редакторе. Блоки vmm (в тестах malloc) выделяются до её включения.
+	class MemoryManagerTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			Manager = new MemoryManager();
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				VmmBlocks[i] = Manager->MemAlloc(24 + i * 1000, 16, true);
+				memset(VmmBlocks[i], 0x5A, 24 + i * 1000);
+			}
+			ASSERT_TRUE(Manager->EnableArena());
+		}
+
+		static bool IsFilled(const void* block, size_t size, uint8_t value)
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				if (((const uint8_t*)block)[i] != value)
+					return false;
+			}
+			return true;
+		}
+
+		static MemoryManager* Manager;
+		static void* VmmBlocks[16];
+	};
+
+	MemoryManager* MemoryManagerTest::Manager = nullptr;
+	void* MemoryManagerTest::VmmBlocks[16] = {};
+}
+
+TEST_F(MemoryManagerTest, HonorsAlignment)
+{
+	for (size_t Alignment = 4; Alignment <= 64 * 1024; Alignment <<= 1)
+	{
+		for (size_t Size : { 1, 24, 100, 1000, 5000, 70000, 300000 })
+		{
+			auto Block = Manager->MemAlloc(Size, Alignment, true);
+			ASSERT_NE(Block, nullptr);
+			EXPECT_EQ((uintptr_t)Block & (Alignment - 1), 0u) << Size << " / " << Alignment;
+			EXPECT_GE(Manager->MemSize(Block), Size);
+
+			memset(Block, 0xCC, Size);
+			Manager->MemFree(Block);
+		}
+	}
+}
+
+TEST_F(MemoryManagerTest, ReusesFreedBlocks)
+{
+	auto Block = Manager->MemAlloc(200, 8, true);
+	Manager->MemFree(Block);
+	EXPECT_EQ(Manager->MemAlloc(200, 8, true), Block);
+	EXPECT_EQ(Manager->MemSize(Block), 224u);
+	Manager->MemFree(Block);
+}
+
+TEST_F(MemoryManagerTest, ZeroesReusedSmallBlocks)
+{
+	auto Block = Manager->MemAlloc(1000, 16, true);
+	memset(Block, 0xAB, Manager->MemSize(Block));
+	Manager->MemFree(Block);
+
+	auto Zeroed = Manager->MemAlloc(1000, 16, true, true);
+	EXPECT_EQ(Zeroed, Block);
+	EXPECT_TRUE(IsFilled(Zeroed, 1000, 0));
+	Manager->MemFree(Zeroed);
+}
+
+TEST_F(MemoryManagerTest, LargeBlocksAreFreshPages)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		// Без zeroed: свежие страницы системы и так нулевые
+		auto Block = Manager->MemAlloc(1024 * 1024 + 1, 16, true);
+		ASSERT_NE(Block, nullptr);
+		EXPECT_EQ((uintptr_t)Block & 0xFFF, 0u);
+		EXPECT_EQ(Manager->MemSize(Block), 1024 * 1024 + 4096u);
+		EXPECT_TRUE(IsFilled(Block, 1024 * 1024 + 1, 0));
+
+		memset(Block, 0xFF, 1024 * 1024 + 1);
+		Manager->MemFree(Block);
+	}
+}
+
+TEST_F(MemoryManagerTest, FreesVmmBlocksAllocatedBeforeArena)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		EXPECT_GE(Manager->MemSize(VmmBlocks[i]), 24 + i * 1000);
+		EXPECT_TRUE(IsFilled(VmmBlocks[i], 24 + i * 1000, 0x5A));
+		Manager->MemFree(VmmBlocks[i]);
+	}
+
+	// Выравнивание больше, чем у арены, остаётся за vmm
+	auto Block = Manager->MemAlloc(100, 128 * 1024, true);
+	ASSERT_NE(Block, nullptr);
+	EXPECT_GE(Manager->MemSize(Block), 100u);
+	Manager->MemFree(Block);
+}
+
+TEST_F(MemoryManagerTest, ZeroesBatches)
+{
+	// Пачка больше кеша потока: часть блоков из кеша (грязные), часть из общего списка и нового спана
+	for (size_t Size : { 48, 256, 4000, 300000 })
+	{
+		void* Dirty[300];
+		ASSERT_EQ(Manager->MemAllocBatch(Dirty, 300, Size, 16, true), 300u);
+		for (auto Block : Dirty)
+			memset(Block, 0xAB, Size);
+		Manager->MemFreeBatch(Dirty, 300);
+
+		void* Blocks[500];
+		ASSERT_EQ(Manager->MemAllocBatch(Blocks, 500, Size, 16, true, true), 500u);
+
+		std::set<void*> Unique(std::begin(Blocks), std::end(Blocks));
+		EXPECT_EQ(Unique.size(), 500u);
+		for (auto Block : Blocks)
+		{
+			EXPECT_EQ((uintptr_t)Block & 15, 0u);
+			EXPECT_GE(Manager->MemSize(Block), Size);
+			ASSERT_TRUE(IsFilled(Block, Size, 0)) << Size;
+		}
+
+		// Блоки пачки независимы: освобождаются и по одному, и пачкой
+		for (size_t i = 0; i < 100; i++)
+			Manager->MemFree(Blocks[i]);
+		Manager->MemFreeBatch(Blocks + 100, 400);
+	}
+}
+
+TEST_F(MemoryManagerTest, ReallocPreservesContents)
+{
+	auto Fill = [](void* Block, size_t From, size_t To)
+		{
+			for (size_t i = From; i < To; i++)
+				((uint8_t*)Block)[i] = (uint8_t)(i * 7 + 1);
+		};
+	auto Check = [](const void* Block, size_t Size)
+		{
+			for (size_t i = 0; i < Size; i++)
+			{
+				if (((const uint8_t*)Block)[i] != (uint8_t)(i * 7 + 1))
+					return false;
+			}
+			return true;
+		};
+
+	struct Step
+	{
+		size_t Size;
+		bool InPlace;
+	};
+
+	// Мелкий блок: рост в классе на месте, за класс и сильное уменьшение с переносом.
+	// Крупный: рост в резерве (до степени двойки) и уменьшение вдвое на месте, рост за резерв с переносом.
+	for (auto Steps : { std::initializer_list<Step>{ { 200, false }, { 220, true }, { 150, true }, { 1000, false },
+		{ 100, false } }, std::initializer_list<Step>{ { 300000, false }, { 500000, true }, { 524288, true },
+		{ 600000, false }, { 200000, true }, { 1000, true } } })
+	{
+		void* Block = nullptr;
+		size_t Size = 0;
+		for (auto& Item : Steps)
+		{
+			auto Moved = Manager->MemRealloc(Block, Size, Item.Size, 16, true, true);
+			ASSERT_NE(Moved, nullptr);
+			if (Block)
+				EXPECT_EQ(Moved == Block, Item.InPlace) << Size << " -> " << Item.Size;
+			EXPECT_GE(Manager->MemSize(Moved), Item.Size);
+
+			// Старая часть на месте, новая обнулена
+			EXPECT_TRUE(Check(Moved, std::min(Size, Item.Size))) << Size << " -> " << Item.Size;
+			if (Item.Size > Size)
+			{
+				EXPECT_TRUE(IsFilled((uint8_t*)Moved + Size, Item.Size - Size, 0)) << Size << " -> " << Item.Size;
+				Fill(Moved, Size, Item.Size);
+			}
+
+			Block = Moved;
+			Size = Item.Size;
+		}
+		Manager->MemFree(Block);
+	}
+
+	// Рост массива в полтора раза до 16 Мб
+	void* Block = nullptr;
+	size_t Size = 0;
+	for (size_t NewSize = 16; NewSize <= 16 * 1024 * 1024; NewSize += NewSize >> 1)
+	{
+		Block = Manager->MemRealloc(Block, Size, NewSize, 16, true);
+		ASSERT_NE(Block, nullptr);
+		ASSERT_TRUE(Check(Block, Size)) << Size << " -> " << NewSize;
+		Fill(Block, Size, NewSize);
+		Size = NewSize;
+	}
+
+	// Уменьшение обратно
+	while (Size > 16)
+	{
+		auto NewSize = Size >> 1;
+		Block = Manager->MemRealloc(Block, Size, NewSize, 16, true);
+		ASSERT_NE(Block, nullptr);
+		ASSERT_TRUE(Check(Block, NewSize)) << Size << " -> " << NewSize;
+		Size = NewSize;
+	}
+	Manager->MemFree(Block);
+
+	EXPECT_EQ(Manager->MemRealloc(Manager->MemAlloc(100, 16, true), 100, 0), nullptr);
+}
+
+TEST_F(MemoryManagerTest, ConcurrentBlocksStayDisjoint)
+{
+	// Каждый поток метит свои блоки, половина блоков освобождается в другом потоке.
+	// Выданный дважды блок или блок, затёртый списком свободных, ломает метку.
+	constexpr uint32_t THREADS = 8;
+	std::mutex Lock;
+	Array<std::pair<void*, size_t>> Shared;
+	std::atomic<uint64_t> Errors = 0;
+
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < THREADS; t++)
+	{
+		Threads.emplace_back([&, t]
+			{
+				std::mt19937 Random(t);
+				Array<std::pair<void*, size_t>> Live;
+				auto Mark = (uint8_t)(t + 1);
+
+				auto Check = [&](void* Block, size_t Size, uint8_t Value)
+					{
+						if (!IsFilled(Block, Size, Value))
+							Errors++;
+					};
+
+				for (int i = 0; i < 50000; i++)
+				{
+					auto Action = Random() % 8;
+					if ((Action < 4) || Live.empty())
+					{
+						size_t Size = ((Random() % 100) < 95) ? (1 + Random() % 512) : (1 + Random() % 300000);
+						auto Block = Manager->MemAlloc(Size, (size_t)8 << (Random() % 4), true);
+						if (!Block)
+						{
+							Errors++;
+							continue;
+						}
+						memset(Block, Mark, Size);
+						Live.emplace_back(Block, Size);
+					}
+					else
+					{
+						auto Index = Random() % Live.size();
+						auto Item = Live[Index];
+						Live[Index] = Live.back();
+						Live.pop_back();
+
+						Check(Item.first, Item.second, Mark);
+						if (Action == 7)
+						{
+							// Чужой поток освободит, метка меняется на общую
+							memset(Item.first, 0xEE, Item.second);
+							std::lock_guard<std::mutex> Guard(Lock);
+							Shared.push_back(Item);
+						}
+						else
+							Manager->MemFree(Item.first);
+					}
+
+					if ((i & 255) == 0)
+					{
+						std::lock_guard<std::mutex> Guard(Lock);
+						for (auto& Item : Shared)
+						{
+							Check(Item.first, Item.second, 0xEE);
+							Manager->MemFree(Item.first);
+						}
+						Shared.clear();
+					}
+				}
+
+				for (auto& Item : Live)
+				{
+					Check(Item.first, Item.second, Mark);
+					Manager->MemFree(Item.first);
+				}
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	for (auto& Item : Shared)
+		Manager->MemFree(Item.first);
+	EXPECT_EQ(Errors.load(), 0u);
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Один проход PatternScanner по секции против отдельного побайтового поиска каждой сигнатуры,
+// и загрузка результатов из кеша против нового просмотра
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/PatternScanner.h"
+#include "PatternScannerSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Сигнатуры без коротких "? 48" и "CC CC", которые находят почти каждый байт
+	constexpr size_t PatternCount = 7;
+	constexpr size_t SectionSize = 32 * 1024 * 1024;
+
+	const Array<uint8_t>& GetSection()
+	{
+		static auto Section = Tests::MakeCodeSection(SectionSize, 1, 4000, Tests::ScannerPatterns, PatternCount);
+		return Section;
+	}
+}
+
+static void BM_PatternScanner(benchmark::State& state)
+{
+	auto& Section = GetSection();
+	Tests::GetEngineConfig().HasAVX2 = state.range(0) && __builtin_cpu_supports("avx2");
+	Tests::CreateEngine();
+	state.SetLabel(Tests::GetEngineConfig().HasAVX2 ? "AVX2" : "SSE2");
+
+	for (auto _ : state)
+	{
+		PatternScanner Scanner;
+		for (size_t i = 0; i < PatternCount; i++)
+			Scanner.Add(Tests::ScannerPatterns[i]);
+		Scanner.Scan((uintptr_t)Section.data(), Section.size());
+		benchmark::DoNotOptimize(Scanner.Get(0).size());
+	}
+
+	state.SetBytesProcessed((int64_t)state.iterations() * Section.size());
+	Tests::DestroyEngine();
+}
+BENCHMARK(BM_PatternScanner)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_NaivePerPattern(benchmark::State& state)
+{
+	auto& Section = GetSection();
+
+	for (auto _ : state)
+	{
+		size_t Total = 0;
+		for (size_t i = 0; i < PatternCount; i++)
+			Total += Tests::FindPatternNaive(Section.data(), Section.size(), Tests::ScannerPatterns[i]).size();
+		benchmark::DoNotOptimize(Total);
+	}
+
+	state.SetBytesProcessed((int64_t)state.iterations() * Section.size());
+}
+BENCHMARK(BM_NaivePerPattern)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_PatternScannerCache(benchmark::State& state)
+{
+	auto& Section = GetSection();
+	Tests::TempDirectory Temp;
+	Tests::SetApplicationPath(Temp.Path().c_str());
+	Tests::GetEngineConfig().HasAVX2 = __builtin_cpu_supports("avx2");
+	Tests::CreateEngine();
+
+	bool Warm = state.range(0);
+	state.SetLabel(Warm ? "warm" : "cold");
+
+	for (auto _ : state)
+	{
+		if (!Warm)
+		{
+			state.PauseTiming();
+			std::filesystem::remove(Temp.File("CreationKitPlatformExtended_Bench_Scan.cache").c_str());
+			state.ResumeTiming();
+		}
+
+		PatternScanner Scanner;
+		for (size_t i = 0; i < PatternCount; i++)
+			Scanner.Add(Tests::ScannerPatterns[i]);
+		Scanner.Scan((uintptr_t)Section.data(), Section.size(), "Bench");
+		benchmark::DoNotOptimize(Scanner.Get(0).size());
+	}
+
+	Tests::DestroyEngine();
+	Tests::SetApplicationPath("./");
+}
+BENCHMARK(BM_PatternScannerCache)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,92 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <random>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Сигнатуры из патчей платформы, разной длины и с пропусками в разных местах
+		constexpr const char* ScannerPatterns[] =
+		{
+			"83 3D ? ? ? ? 02 74 13 48 8D 15 ? ? ? ? 48 8D 0D ? ? ? ? E8",
+			"48 89 4C 24 08 48 83 EC 18 48 8B 44 24 20",
+			"E8 ? ? ? ? 48 89 44 24 30 48 8B 44 24 30 48 89 44 24 38 48 8B 54 24 38 48 8D 4C 24 28",
+			"48 8B 11 0F B6 C2 F6 D0 A8 01 74 ? 48 85 D2 74 ? 32 C0 C3 B0 01 C3",
+			"81 ? ? ? ? ? 00 B0 00 00",
+			"40 53 48 83 EC 20 48 8B D9 E8 ? ? ? ? 48 8B CB",
+			"0F 57 C0 F3 0F 11 ? ? ? 0F 28 ? F3 0F 59",
+			"? 48",
+			"CC CC",
+			"?? 8B ??",
+		};
+
+		// Разбор сигнатуры в байты, -1 означает любой байт
+		inline Array<int> ParsePattern(const char* pattern)
+		{
+			Array<int> Bytes;
+			for (auto s = pattern; *s;)
+			{
+				if (*s == ' ')
+					s++;
+				else if (*s == '?')
+				{
+					Bytes.push_back(-1);
+					while (*s == '?')
+						s++;
+				}
+				else
+				{
+					char szByte[3] = { s[0], s[1], 0 };
+					Bytes.push_back((int)strtoul(szByte, nullptr, 16));
+					s += 2;
+				}
+			}
+			return Bytes;
+		}
+
+		// Наивный побайтовый поиск одной сигнатуры, как у voltek::find_patterns
+		inline Array<uintptr_t> FindPatternNaive(const uint8_t* data, size_t size, const char* pattern)
+		{
+			auto Bytes = ParsePattern(pattern);
+			Array<uintptr_t> Result;
+			for (size_t i = 0; i + Bytes.size() <= size; i++)
+			{
+				size_t j = 0;
+				for (; j < Bytes.size(); j++)
+				{
+					if ((Bytes[j] >= 0) && (data[i + j] != (uint8_t)Bytes[j]))
+						break;
+				}
+				if (j == Bytes.size())
+					Result.push_back((uintptr_t)(data + i));
+			}
+			return Result;
+		}
+
+		// Похожий на код x64 буфер (много REX.W), в который вставлены копии сигнатур со случайными
+		// байтами вместо пропусков, в том числе в самом начале и в самом конце
+		inline Array<uint8_t> MakeCodeSection(size_t size, uint32_t seed, size_t insertions,
+			const char* const* patterns, size_t patternCount)
+		{
+			std::mt19937 Random(seed);
+			Array<uint8_t> Data(size);
+			for (auto& Byte : Data)
+				Byte = (Random() % 4) ? (uint8_t)Random() : 0x48;
+
+			for (size_t k = 0; k < insertions; k++)
+			{
+				auto Bytes = ParsePattern(patterns[Random() % patternCount]);
+				size_t Offset = (k == 0) ? 0 : ((k == 1) ? size - Bytes.size() : Random() % (size - Bytes.size()));
+				for (size_t j = 0; j < Bytes.size(); j++)
+					Data[Offset + j] = (Bytes[j] >= 0) ? (uint8_t)Bytes[j] : (uint8_t)Random();
+			}
+
+			return Data;
+		}
+	}
+}
\ No newline at end of file
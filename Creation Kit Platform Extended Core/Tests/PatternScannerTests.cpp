@@ -0,0 +1,276 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/PatternScanner.h"
+#include "PatternScannerSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	class PatternScannerTest : public ::testing::TestWithParam<bool>
+	{
+	protected:
+		void SetUp() override
+		{
+			if (GetParam() && !__builtin_cpu_supports("avx2"))
+				GTEST_SKIP() << "AVX2 is not supported";
+
+			Tests::GetEngineConfig().HasAVX2 = GetParam();
+			Tests::CreateEngine();
+		}
+
+		void TearDown() override
+		{
+			Tests::DestroyEngine();
+		}
+
+		void ExpectSameAsNaive(const Array<uint8_t>& data)
+		{
+			PatternScanner Scanner;
+			for (auto Pattern : Tests::ScannerPatterns)
+				ASSERT_NE(Scanner.Add(Pattern), PatternScanner::INVALID_ID) << Pattern;
+
+			Scanner.Scan((uintptr_t)data.data(), data.size());
+			for (uint32_t i = 0; i < std::size(Tests::ScannerPatterns); i++)
+			{
+				auto Expected = Tests::FindPatternNaive(data.data(), data.size(), Tests::ScannerPatterns[i]);
+				auto& Actual = Scanner.Get(i);
+				EXPECT_EQ(Array<uintptr_t>(Actual.begin(), Actual.end()), Expected) << Tests::ScannerPatterns[i];
+			}
+		}
+	};
+}
+
+TEST_P(PatternScannerTest, MatchesNaiveScan)
+{
+	// 8 МБ и ещё немного: несколько частей по 1 МБ и хвост короче блока SIMD
+	ExpectSameAsNaive(Tests::MakeCodeSection(8 * 1024 * 1024 + 37, 1, 2000, Tests::ScannerPatterns, 7));
+}
+
+TEST_P(PatternScannerTest, MatchesAcrossChunkBoundaries)
+{
+	auto Data = Tests::MakeCodeSection(6 * 1024 * 1024, 2, 0, Tests::ScannerPatterns, 7);
+	auto Bytes = Tests::ParsePattern(Tests::ScannerPatterns[2]);
+
+	// Сигнатуры, пересекающие границу частей по 1 МБ в разных местах, в том числе с якорем
+	// на последнем байте части
+	size_t Shifts[] = { 1, 2, 5, Bytes.size() / 2, Bytes.size() - 1 };
+	for (size_t i = 0; i < std::size(Shifts); i++)
+	{
+		auto Offset = (i + 1) * 1024 * 1024 - Shifts[i];
+		for (size_t j = 0; j < Bytes.size(); j++)
+			Data[Offset + j] = (Bytes[j] >= 0) ? (uint8_t)Bytes[j] : 0x90;
+	}
+
+	ExpectSameAsNaive(Data);
+}
+
+TEST_P(PatternScannerTest, SmallSections)
+{
+	for (size_t Size : { 1, 2, 15, 16, 17, 31, 32, 33, 100 })
+		ExpectSameAsNaive(Tests::MakeCodeSection(Size, (uint32_t)Size, 0, Tests::ScannerPatterns, 7));
+}
+
+INSTANTIATE_TEST_SUITE_P(Simd, PatternScannerTest, ::testing::Values(false, true),
+	[](const ::testing::TestParamInfo<bool>& info) { return info.param ? "AVX2" : "SSE2"; });
+
+TEST(PatternScanner, RejectsInvalidPatterns)
+{
+	PatternScanner Scanner;
+	EXPECT_EQ(Scanner.Add(nullptr), PatternScanner::INVALID_ID);
+	EXPECT_EQ(Scanner.Add(""), PatternScanner::INVALID_ID);
+	EXPECT_EQ(Scanner.Add("? ?? ?"), PatternScanner::INVALID_ID);
+	EXPECT_EQ(Scanner.Add("48 8G"), PatternScanner::INVALID_ID);
+	EXPECT_EQ(Scanner.Add("48 8"), PatternScanner::INVALID_ID);
+	EXPECT_EQ(Scanner.Count(), 0u);
+
+	EXPECT_EQ(Scanner.Add("48 8B"), 0u);
+	EXPECT_EQ(Scanner.Count(), 1u);
+	EXPECT_TRUE(Scanner.Get(1).empty());
+}
+
+TEST(PatternScanner, RescanClearsPreviousMatches)
+{
+	Tests::CreateEngine();
+
+	uint8_t Data[64] = { 0 };
+	Data[10] = 0x12;
+	Data[11] = 0x34;
+
+	PatternScanner Scanner;
+	auto Id = Scanner.Add("12 34");
+	Scanner.Scan((uintptr_t)Data, sizeof(Data));
+	ASSERT_EQ(Scanner.Get(Id).size(), 1u);
+	EXPECT_EQ(Scanner.Get(Id)[0], (uintptr_t)&Data[10]);
+
+	Data[10] = 0;
+	Scanner.Scan((uintptr_t)Data, sizeof(Data));
+	EXPECT_TRUE(Scanner.Get(Id).empty());
+
+	Tests::DestroyEngine();
+}
+
+namespace
+{
+	class PatternScannerCacheTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			Tests::SetApplicationPath(Temp.Path().c_str());
+			Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+			Tests::CreateEngine();
+			Section = Tests::MakeCodeSection(2 * 1024 * 1024, 3, 500, Tests::ScannerPatterns, 7);
+			FileName = Temp.File("CreationKitPlatformExtended_Test_Scan.cache");
+		}
+
+		void TearDown() override
+		{
+			Tests::DestroyEngine();
+			Tests::SetApplicationPath("./");
+		}
+
+		void Scan(PatternScanner& scanner, size_t patternCount = 7)
+		{
+			for (size_t i = 0; i < patternCount; i++)
+				scanner.Add(Tests::ScannerPatterns[i]);
+			scanner.Scan((uintptr_t)Section.data(), Section.size(), "Test");
+		}
+
+		void ExpectCorrect(const PatternScanner& scanner)
+		{
+			for (uint32_t i = 0; i < scanner.Count(); i++)
+			{
+				auto& Actual = scanner.Get(i);
+				EXPECT_EQ(Array<uintptr_t>(Actual.begin(), Actual.end()),
+					Tests::FindPatternNaive(Section.data(), Section.size(), Tests::ScannerPatterns[i]));
+			}
+		}
+
+		// Кеш перезаписывается через временный файл, поэтому новый inode означает, что кеш
+		// не подошёл и секция была просмотрена заново
+		ino_t CacheInode() const
+		{
+			struct stat st;
+			return stat(FileName.c_str(), &st) ? 0 : st.st_ino;
+		}
+
+		void Corrupt(long offset, uint8_t value)
+		{
+			auto Stream = fopen(FileName.c_str(), "r+b");
+			ASSERT_NE(Stream, nullptr);
+			fseek(Stream, offset, offset < 0 ? SEEK_END : SEEK_SET);
+			fwrite(&value, 1, 1, Stream);
+			fclose(Stream);
+		}
+
+		Tests::TempDirectory Temp;
+		Array<uint8_t> Section;
+		String FileName;
+	};
+}
+
+TEST_F(PatternScannerCacheTest, HitLoadsSavedMatches)
+{
+	PatternScanner First;
+	Scan(First);
+	auto Inode = CacheInode();
+	ASSERT_NE(Inode, 0u);
+	EXPECT_FALSE(std::filesystem::exists((FileName + ".tmp").c_str()));
+
+	PatternScanner Second;
+	Scan(Second);
+	EXPECT_EQ(CacheInode(), Inode);
+	ExpectCorrect(Second);
+}
+
+TEST_F(PatternScannerCacheTest, MissOnDifferentKey)
+{
+	PatternScanner First;
+	Scan(First);
+	auto Inode = CacheInode();
+
+	// Другой набор сигнатур
+	PatternScanner OtherSet;
+	Scan(OtherSet, 6);
+	EXPECT_NE(CacheInode(), Inode);
+	ExpectCorrect(OtherSet);
+	Inode = CacheInode();
+
+	// Другой исполняемый файл
+	Tests::GetEngineConfig().ExecutableCRC32 = 0x0BADF00Dul;
+	Tests::CreateEngine();
+	PatternScanner OtherEditor;
+	Scan(OtherEditor, 6);
+	EXPECT_NE(CacheInode(), Inode);
+	ExpectCorrect(OtherEditor);
+	Inode = CacheInode();
+
+	// Другой размер секции
+	Section.resize(Section.size() - 4096);
+	PatternScanner OtherSize;
+	Scan(OtherSize, 6);
+	EXPECT_NE(CacheInode(), Inode);
+	ExpectCorrect(OtherSize);
+}
+
+TEST_F(PatternScannerCacheTest, MissOnChangedSection)
+{
+	PatternScanner First;
+	Scan(First);
+	auto Inode = CacheInode();
+
+	// Совпадение из кеша больше не совпадает с сигнатурой: проверка на месте отклоняет кеш
+	ASSERT_FALSE(First.Get(1).empty());
+	auto Match = First.Get(1)[0] - (uintptr_t)Section.data();
+	Section[Match] ^= 0xFF;
+
+	PatternScanner Second;
+	Scan(Second);
+	EXPECT_NE(CacheInode(), Inode);
+	ExpectCorrect(Second);
+}
+
+TEST_F(PatternScannerCacheTest, RejectsCorruptFile)
+{
+	PatternScanner First;
+	Scan(First);
+
+	// Повреждённые данные (CRC32), заголовок и усечённый файл
+	for (long Offset : { -1l, (long)sizeof(PatternScanner::CacheHeader) + 2, 0l })
+	{
+		auto Inode = CacheInode();
+		Corrupt(Offset, 0x5A);
+
+		PatternScanner Scanner;
+		Scan(Scanner);
+		EXPECT_NE(CacheInode(), Inode) << Offset;
+		ExpectCorrect(Scanner);
+	}
+
+	auto Inode = CacheInode();
+	std::filesystem::resize_file(FileName.c_str(), std::filesystem::file_size(FileName.c_str()) - 3);
+	PatternScanner Truncated;
+	Scan(Truncated);
+	EXPECT_NE(CacheInode(), Inode);
+	ExpectCorrect(Truncated);
+}
+
+TEST_F(PatternScannerCacheTest, NoCacheWithoutExecutableCRC)
+{
+	Tests::GetEngineConfig().ExecutableCRC32 = 0;
+	Tests::CreateEngine();
+
+	PatternScanner Scanner;
+	Scan(Scanner);
+	EXPECT_EQ(CacheInode(), 0u);
+	ExpectCorrect(Scanner);
+	Tests::GetEngineConfig().ExecutableCRC32 = 0x1234ABCDul;
+}
\ No newline at end of file
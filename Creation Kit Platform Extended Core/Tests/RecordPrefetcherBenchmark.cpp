@@ -0,0 +1,89 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Загрузка синтетического плагина формата TES4 (RecordSource.h) целиком: заголовки и записи читаются из файла
+// по очереди, сжатые распаковываются, подзаписи разбираются. Последовательный путь (Decompressor::Zlib на
+// месте, как HKInflate без упреждения) против RecordPrefetcher. Файл после первого прохода в кеше ОС, поэтому
+// замер показывает только выигрыш от распаковки впереди загрузчика, а не от чтения диска.
+// Потоки конвейера нужны свободные ядра: на машине с одним-двумя ядрами упреждение лишь отнимает время.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/RecordPrefetcher.h"
+#include "RecordSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	struct PluginSource
+	{
+		Tests::TempDirectory Temp;
+		String FileName;
+		uint64_t Bytes = 0;
+
+		PluginSource()
+		{
+			FileName = Temp.File("Plugin.esm");
+			for (auto& Record : Tests::WritePluginFile(FileName, 24000, 500, 41))
+				Bytes += Record.Body.size();
+		}
+	};
+
+	PluginSource& GetPlugin()
+	{
+		static PluginSource Plugin;
+		return Plugin;
+	}
+
+	template<typename Inflate>
+	void LoadPlugin(benchmark::State& state, Inflate&& inflate)
+	{
+		auto& Plugin = GetPlugin();
+		int64_t Records = 0;
+
+		for (auto _ : state)
+		{
+			if (state.range(0))
+				RecordPrefetcher::Open(Plugin.FileName.c_str());
+
+			Records = Tests::LoadPluginFile(Plugin.FileName, inflate);
+			if (Records < 0)
+				state.SkipWithError("inflate failed");
+
+			RecordPrefetcher::Close();
+		}
+
+		state.SetItemsProcessed(state.iterations() * Records);
+		state.SetBytesProcessed(state.iterations() * Plugin.Bytes);
+	}
+
+	void SetUpEngine(const benchmark::State&)
+	{
+		Tests::GetEngineConfig().LogicalCores = 8;
+		Tests::CreateEngine();
+	}
+
+	void TearDownEngine(const benchmark::State&)
+	{
+		Tests::DestroyEngine();
+	}
+}
+
+// range(0): 0 - последовательно, 1 - с упреждающей распаковкой
+static void BM_LoadPlugin(benchmark::State& state)
+{
+	LoadPlugin(state, [](const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize)
+		{
+			size_t inBytes = 0, outBytes = 0;
+			libdeflate_result result;
+			if (!RecordPrefetcher::Inflate(in, inSize, out, outSize, result, outBytes))
+				result = Decompressor::Zlib(in, inSize, out, outSize, &inBytes, &outBytes);
+			return (result == LIBDEFLATE_SUCCESS) && (outBytes == outSize);
+		});
+}
+BENCHMARK(BM_LoadPlugin)->ArgName("prefetch")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime()
+	->Setup(SetUpEngine)->Teardown(TearDownEngine);
\ No newline at end of file
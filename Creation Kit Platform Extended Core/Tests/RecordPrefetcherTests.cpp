@@ -0,0 +1,260 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <chrono>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/RecordPrefetcher.h"
+#include "RecordSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Время, за которое потоки заведомо успевают заполнить кеш
+	constexpr auto WorkersDelay = std::chrono::milliseconds(500);
+
+	class RecordPrefetcherTest : public ::testing::Test
+	{
+	protected:
+		static void SetUpTestSuite()
+		{
+			Temp = new Tests::TempDirectory();
+			PluginName = new String(Temp->File("Plugin.esm"));
+			SmallPluginName = new String(Temp->File("Small.esp"));
+			// Файл около 26 МБ, распакованных записей около 40 МБ, больше CACHE_LIMIT
+			Plugin = new Array<Tests::CompressedRecord>(Tests::WritePluginFile(*PluginName, 12000, 500, 31));
+			SmallPlugin = new Array<Tests::CompressedRecord>(Tests::WritePluginFile(*SmallPluginName, 200, 100, 32));
+		}
+
+		static void TearDownTestSuite()
+		{
+			delete SmallPlugin;
+			delete Plugin;
+			delete SmallPluginName;
+			delete PluginName;
+			delete Temp;
+		}
+
+		void SetUp() override
+		{
+			Tests::GetEngineConfig().LogicalCores = 8;
+			Tests::CreateEngine();
+		}
+
+		void TearDown() override
+		{
+			RecordPrefetcher::Close();
+			Tests::DestroyEngine();
+			Tests::GetEngineConfig().LogicalCores = (unsigned char)std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		// Как HKInflate: из кеша, иначе на месте. true, если запись была в кеше
+		static bool Inflate(const Tests::CompressedRecord& record, Array<uint8_t>& out, libdeflate_result& result)
+		{
+			size_t inBytes = 0, outBytes = 0;
+			auto Hit = RecordPrefetcher::Inflate(record.Stream.data(), record.Stream.size(), out.data(), out.size(),
+				result, outBytes);
+			if (!Hit)
+				result = Decompressor::Zlib(record.Stream.data(), record.Stream.size(), out.data(), out.size(),
+					&inBytes, &outBytes);
+			if (result == LIBDEFLATE_SUCCESS)
+				out.resize(outBytes);
+			return Hit;
+		}
+
+		static Tests::TempDirectory* Temp;
+		static String* PluginName;
+		static String* SmallPluginName;
+		static Array<Tests::CompressedRecord>* Plugin;
+		static Array<Tests::CompressedRecord>* SmallPlugin;
+	};
+
+	Tests::TempDirectory* RecordPrefetcherTest::Temp = nullptr;
+	String* RecordPrefetcherTest::PluginName = nullptr;
+	String* RecordPrefetcherTest::SmallPluginName = nullptr;
+	Array<Tests::CompressedRecord>* RecordPrefetcherTest::Plugin = nullptr;
+	Array<Tests::CompressedRecord>* RecordPrefetcherTest::SmallPlugin = nullptr;
+}
+
+TEST_F(RecordPrefetcherTest, ServesRecordsAhead)
+{
+	ASSERT_GE(std::filesystem::file_size(PluginName->c_str()), RecordPrefetcher::MIN_FILE_SIZE);
+	RecordPrefetcher::Open(PluginName->c_str());
+
+	// Первая распаковка запускает потоки, дальше записи, уместившиеся в половину кеша, уже готовы
+	size_t Ahead = 1, Reserved = (*Plugin)[0].Body.size();
+	while ((Ahead < Plugin->size()) && ((Reserved + (*Plugin)[Ahead].Body.size()) <= (RecordPrefetcher::CACHE_LIMIT / 2)))
+		Reserved += (*Plugin)[Ahead++].Body.size();
+
+	size_t Hits = 0;
+	for (size_t i = 0; i < Plugin->size(); i++)
+	{
+		auto& Record = (*Plugin)[i];
+		Array<uint8_t> Out(Record.Body.size());
+		libdeflate_result Result;
+
+		auto Hit = Inflate(Record, Out, Result);
+		ASSERT_EQ(Result, LIBDEFLATE_SUCCESS) << "record " << i;
+		ASSERT_EQ(Out, Record.Body) << "record " << i;
+
+		if ((i > 0) && (i < Ahead))
+			EXPECT_TRUE(Hit) << "record " << i;
+		Hits += Hit;
+
+		if (!i)
+			std::this_thread::sleep_for(WorkersDelay);
+	}
+
+	EXPECT_GE(Hits, Ahead - 1);
+}
+
+TEST_F(RecordPrefetcherTest, LoadsPluginLikeSerialPath)
+{
+	uint64_t SerialFields = 0;
+	auto SerialRecords = Tests::LoadPluginFile(*PluginName, [](const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize)
+		{
+			size_t inBytes = 0, outBytes = 0;
+			auto Result = Decompressor::Zlib(in, inSize, out, outSize, &inBytes, &outBytes);
+			return (Result == LIBDEFLATE_SUCCESS) && (outBytes == outSize);
+		}, &SerialFields);
+	ASSERT_GT(SerialRecords, (int64_t)Plugin->size());
+
+	// Плагин грузится несколько раз подряд, как при повторном открытии в редакторе
+	for (int Pass = 0; Pass < 3; Pass++)
+	{
+		RecordPrefetcher::Open(PluginName->c_str());
+
+		uint64_t Fields = 0, Hits = 0;
+		auto Records = Tests::LoadPluginFile(*PluginName, [&](const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize)
+			{
+				size_t inBytes = 0, outBytes = 0;
+				libdeflate_result Result;
+				if (RecordPrefetcher::Inflate(in, inSize, out, outSize, Result, outBytes))
+					Hits++;
+				else
+					Result = Decompressor::Zlib(in, inSize, out, outSize, &inBytes, &outBytes);
+				return (Result == LIBDEFLATE_SUCCESS) && (outBytes == outSize);
+			}, &Fields);
+
+		RecordPrefetcher::Close();
+
+		EXPECT_EQ(Records, SerialRecords) << "pass " << Pass;
+		EXPECT_EQ(Fields, SerialFields) << "pass " << Pass;
+		EXPECT_LE(Hits, Plugin->size());
+	}
+}
+
+TEST_F(RecordPrefetcherTest, DropsSkippedRecords)
+{
+	// Загрузчик пропускает записи (удалённые или уже загруженные формы), их распакованные копии выбрасываются
+	RecordPrefetcher::Open(PluginName->c_str());
+
+	size_t Hits = 0;
+	for (size_t i = 0; i < Plugin->size(); i++)
+	{
+		if ((i % 5) == 2)
+			continue;
+
+		auto& Record = (*Plugin)[i];
+		Array<uint8_t> Out(Record.Body.size());
+		libdeflate_result Result;
+
+		Hits += Inflate(Record, Out, Result);
+		ASSERT_EQ(Result, LIBDEFLATE_SUCCESS) << "record " << i;
+		ASSERT_EQ(Out, Record.Body) << "record " << i;
+
+		if (!i)
+			std::this_thread::sleep_for(WorkersDelay);
+	}
+
+	EXPECT_GT(Hits, 0u);
+}
+
+TEST_F(RecordPrefetcherTest, ReportsErrorsLikeSerialPath)
+{
+	RecordPrefetcher::Open(PluginName->c_str());
+
+	Array<uint8_t> Out((*Plugin)[0].Body.size());
+	libdeflate_result Result;
+	Inflate((*Plugin)[0], Out, Result);
+	std::this_thread::sleep_for(WorkersDelay);
+
+	// Буфер меньше записи: как у Decompressor::Zlib, без копирования
+	auto& Record = (*Plugin)[1];
+	Array<uint8_t> Small(Record.Body.size() / 2, 0xCD);
+	size_t OutBytes = 1;
+	ASSERT_TRUE(RecordPrefetcher::Inflate(Record.Stream.data(), Record.Stream.size(), Small.data(), Small.size(),
+		Result, OutBytes));
+	EXPECT_EQ(Result, LIBDEFLATE_INSUFFICIENT_SPACE);
+	EXPECT_EQ(OutBytes, 0u);
+	EXPECT_EQ(Small, Array<uint8_t>(Record.Body.size() / 2, 0xCD));
+
+	// Чужой поток - промах, окно кеша при этом не сдвигается
+	auto Foreign = SmallPlugin->back();
+	EXPECT_FALSE(RecordPrefetcher::Inflate(Foreign.Stream.data(), Foreign.Stream.size(), Out.data(), Out.size(),
+		Result, OutBytes));
+
+	auto& Next = (*Plugin)[2];
+	Out.resize(Next.Body.size());
+	EXPECT_TRUE(Inflate(Next, Out, Result));
+	EXPECT_EQ(Result, LIBDEFLATE_SUCCESS);
+	EXPECT_EQ(Out, Next.Body);
+}
+
+TEST_F(RecordPrefetcherTest, IgnoresSmallFilesAndFewCores)
+{
+	auto Load = [](const Array<Tests::CompressedRecord>& records)
+		{
+			size_t Hits = 0;
+			for (size_t i = 0; i < records.size(); i++)
+			{
+				Array<uint8_t> Out(records[i].Body.size());
+				libdeflate_result Result;
+				Hits += Inflate(records[i], Out, Result);
+				EXPECT_EQ(Out, records[i].Body);
+
+				if (!i)
+					std::this_thread::sleep_for(WorkersDelay);
+			}
+			return Hits;
+		};
+
+	RecordPrefetcher::Open(SmallPluginName->c_str());
+	EXPECT_EQ(Load(*SmallPlugin), 0u);
+
+	Tests::GetEngineConfig().LogicalCores = RecordPrefetcher::MIN_LOGICAL_CORES - 1;
+	Tests::CreateEngine();
+	RecordPrefetcher::Open(PluginName->c_str());
+	EXPECT_EQ(Load(Array<Tests::CompressedRecord>(Plugin->begin(), Plugin->begin() + 2000)), 0u);
+}
+
+TEST_F(RecordPrefetcherTest, ReopensWhileWorkersRun)
+{
+	// Плагин закрывается и открывается снова, пока потоки распаковывают: конвейер останавливается без зависаний
+	for (int i = 0; i < 20; i++)
+	{
+		RecordPrefetcher::Open(PluginName->c_str());
+
+		Array<uint8_t> Out((*Plugin)[0].Body.size());
+		libdeflate_result Result;
+		Inflate((*Plugin)[0], Out, Result);
+		EXPECT_EQ(Out, (*Plugin)[0].Body);
+
+		if (i & 1)
+			RecordPrefetcher::Close();
+	}
+
+	RecordPrefetcher::Open(PluginName->c_str());
+	for (auto& Record : *Plugin)
+	{
+		Array<uint8_t> Out(Record.Body.size());
+		libdeflate_result Result;
+		Inflate(Record, Out, Result);
+		ASSERT_EQ(Result, LIBDEFLATE_SUCCESS);
+		ASSERT_EQ(Out, Record.Body);
+	}
+}
\ No newline at end of file
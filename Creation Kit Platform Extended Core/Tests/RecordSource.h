@@ -0,0 +1,216 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <random>
+#include <fstream>
+#include <zlib.h>
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Несжатое тело записи ESM: подзаписи (тип, размер, данные) с FormID, координатами и строками
+		inline Array<uint8_t> MakeRecordBody(std::mt19937& random, size_t size)
+		{
+			static const char* Types[] = { "EDID", "OBND", "MODL", "DATA", "XSCL", "NAME", "FULL", "VMAD" };
+			static const char* Words[] = { "Whiterun", "Dragon", "Iron", "Sword", "Door", "Marker", "Chest", "Cave" };
+
+			Array<uint8_t> Body;
+			while (Body.size() < size)
+			{
+				auto Type = Types[random() % std::size(Types)];
+				Body.insert(Body.end(), Type, Type + 4);
+
+				auto Size = (uint16_t)(4 + random() % 60);
+				Body.push_back((uint8_t)Size);
+				Body.push_back((uint8_t)(Size >> 8));
+
+				for (uint16_t i = 0; i < Size;)
+				{
+					switch (random() % 3)
+					{
+					case 0:
+					{
+						// FormID из того же плагина
+						uint32_t FormID = 0x01000000 | (random() % 0x4000);
+						for (int j = 0; (j < 4) && (i < Size); j++, i++)
+							Body.push_back((uint8_t)(FormID >> (j * 8)));
+						break;
+					}
+					case 1:
+					{
+						float Value = (float)(random() % 100000) / 16.0f;
+						uint32_t Bits;
+						memcpy(&Bits, &Value, sizeof(Bits));
+						for (int j = 0; (j < 4) && (i < Size); j++, i++)
+							Body.push_back((uint8_t)(Bits >> (j * 8)));
+						break;
+					}
+					default:
+						for (auto s = Words[random() % std::size(Words)]; *s && (i < Size); s++, i++)
+							Body.push_back((uint8_t)*s);
+						break;
+					}
+				}
+			}
+
+			Body.resize(size);
+			return Body;
+		}
+
+		// zlib поток, как в сжатых записях ESM
+		inline Array<uint8_t> CompressZlib(const Array<uint8_t>& data)
+		{
+			uLongf Size = compressBound((uLong)data.size());
+			Array<uint8_t> Result(Size);
+			compress2(Result.data(), &Size, data.data(), (uLong)data.size(), Z_DEFAULT_COMPRESSION);
+			Result.resize(Size);
+			return Result;
+		}
+
+		struct CompressedRecord
+		{
+			Array<uint8_t> Body;
+			Array<uint8_t> Stream;
+		};
+
+		// Записи по размерам как в мастер-файлах: в основном ссылки и мелкие формы, реже NPC и диалоги,
+		// изредка LAND и NAVM по десяткам килобайт
+		inline Array<CompressedRecord> MakeRecordCorpus(uint32_t count, uint32_t seed)
+		{
+			std::mt19937 Random(seed);
+			Array<CompressedRecord> Corpus(count);
+
+			for (auto& Record : Corpus)
+			{
+				auto Kind = Random() % 100;
+				auto Size = (Kind < 70) ? 64 + Random() % 448 : (Kind < 95) ? 1024 + Random() % 7168 :
+					16384 + Random() % 49152;
+
+				Record.Body = MakeRecordBody(Random, Size);
+				Record.Stream = CompressZlib(Record.Body);
+			}
+
+			return Corpus;
+		}
+
+		// Плагин формата TES4: запись TES4, затем группы GRUP по recordsPerGroup записей. Сжатые записи
+		// (флаг 0x40000) хранят размер распакованных данных и zlib поток, каждая четвёртая запись не сжата.
+		// Возвращает сжатые записи в порядке файла.
+		inline Array<CompressedRecord> WritePluginFile(const String& fileName, uint32_t count, uint32_t recordsPerGroup,
+			uint32_t seed)
+		{
+			auto Corpus = MakeRecordCorpus(count, seed);
+			std::mt19937 Random(seed + 1);
+			Array<uint8_t> File;
+
+			auto Put32 = [&](uint32_t value)
+				{
+					for (int i = 0; i < 4; i++)
+						File.push_back((uint8_t)(value >> (i * 8)));
+				};
+			auto PutHeader = [&](const char* type, uint32_t size, uint32_t flags, uint32_t formId)
+				{
+					File.insert(File.end(), type, type + 4);
+					Put32(size);
+					Put32(flags);
+					Put32(formId);
+					Put32(0);
+					Put32(0);
+				};
+
+			auto Header = MakeRecordBody(Random, 64);
+			PutHeader("TES4", (uint32_t)Header.size(), 0, 0);
+			File.insert(File.end(), Header.begin(), Header.end());
+
+			uint32_t FormId = 0x01000800;
+			for (size_t i = 0; i < Corpus.size();)
+			{
+				auto GroupStart = File.size();
+				PutHeader("GRUP", 0, 0, 0);
+
+				for (uint32_t j = 0; (j < recordsPerGroup) && (i < Corpus.size()); j++, FormId++)
+				{
+					if (!(FormId & 3))
+					{
+						auto Body = MakeRecordBody(Random, 64 + Random() % 448);
+						PutHeader("STAT", (uint32_t)Body.size(), 0, FormId);
+						File.insert(File.end(), Body.begin(), Body.end());
+						continue;
+					}
+
+					auto& Record = Corpus[i++];
+					PutHeader("REFR", (uint32_t)(Record.Stream.size() + 4), 0x00040000, FormId);
+					Put32((uint32_t)Record.Body.size());
+					File.insert(File.end(), Record.Stream.begin(), Record.Stream.end());
+				}
+
+				auto GroupSize = (uint32_t)(File.size() - GroupStart);
+				memcpy(File.data() + GroupStart + 4, &GroupSize, sizeof(GroupSize));
+			}
+
+			std::ofstream Stream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			Stream.write((const char*)File.data(), File.size());
+			return Corpus;
+		}
+
+		// Загрузчик плагина, как у редактора: заголовки и записи читаются из файла по очереди в свой буфер,
+		// сжатые распаковываются через inflate(in, inSize, out, outSize), который возвращает true, если получено
+		// ровно outSize байт, после чего разбираются подзаписи. Возвращает число прочитанных записей, -1 при ошибке.
+		template<typename Inflate>
+		int64_t LoadPluginFile(const String& fileName, Inflate&& inflate, uint64_t* fields = nullptr)
+		{
+			std::ifstream Stream(fileName.c_str(), std::ios::in | std::ios::binary);
+			Array<uint8_t> Data, Body;
+			uint8_t Header[24];
+			int64_t Records = 0;
+			uint64_t FieldCount = 0;
+
+			while (Stream.read((char*)Header, sizeof(Header)))
+			{
+				uint32_t Size, Flags;
+				memcpy(&Size, Header + 4, sizeof(Size));
+				memcpy(&Flags, Header + 8, sizeof(Flags));
+
+				if (!memcmp(Header, "GRUP", 4))
+					continue;
+
+				Data.resize(Size);
+				if (!Stream.read((char*)Data.data(), Size))
+					return -1;
+
+				auto Fields = Data.data();
+				auto FieldsSize = (size_t)Size;
+				if (Flags & 0x00040000)
+				{
+					uint32_t BodySize;
+					memcpy(&BodySize, Data.data(), sizeof(BodySize));
+					Body.resize(BodySize);
+					if (!inflate(Data.data() + 4, Size - 4, Body.data(), Body.size()))
+						return -1;
+
+					Fields = Body.data();
+					FieldsSize = Body.size();
+				}
+
+				// Подзаписи: тип, размер (16 бит), данные
+				for (size_t i = 0; (i + 6) <= FieldsSize;)
+				{
+					uint16_t FieldSize;
+					memcpy(&FieldSize, Fields + i + 4, sizeof(FieldSize));
+					i += 6 + FieldSize;
+					FieldCount++;
+				}
+
+				Records++;
+			}
+
+			if (fields)
+				*fields = FieldCount;
+			return Records;
+		}
+	}
+}
\ No newline at end of file
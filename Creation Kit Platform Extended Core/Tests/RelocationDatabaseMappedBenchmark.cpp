@@ -0,0 +1,100 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Открытие отображённой базы и поиск всех патчей по имени против разбора исходников (.relb)
+// и поиска в UnorderedMap, как это делала первая версия базы
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "RelocationDatabaseSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	const char* Editors[] = { "SSE/1_6_1130", "FO4/1_10_982_3", "SF/1_14_74_0" };
+
+	struct Fixture
+	{
+		Tests::TempDirectory Temp;
+		String FileName;
+		String SourceDirectory;
+		Array<RelocationMappedDatabase::SourcePatch> Patches;
+
+		Fixture(const char* editor)
+		{
+			SourceDirectory = String(CKPE_DATABASE_DIR "/") + editor;
+			Patches = Tests::LoadRelocationSource(SourceDirectory.c_str());
+			FileName = Temp.File("bench.mapdb");
+			RelocationMappedDatabase::Stamp Stamp = { 0 };
+			RelocationMappedDatabase::Build(FileName.c_str(), Patches, Stamp);
+		}
+	};
+
+	Fixture& GetFixture(int64_t index)
+	{
+		static std::unique_ptr<Fixture> Fixtures[std::size(Editors)];
+		if (!Fixtures[index])
+			Fixtures[index] = std::make_unique<Fixture>(Editors[index]);
+		return *Fixtures[index];
+	}
+}
+
+static void BM_MappedOpenAndLookupAll(benchmark::State& state)
+{
+	auto& Data = GetFixture(state.range(0));
+	RelocationMappedDatabase::Stamp Stamp = { 0 };
+	state.SetLabel(Editors[state.range(0)]);
+
+	for (auto _ : state)
+	{
+		RelocationMappedDatabase Database;
+		if (!Database.Open(Data.FileName.c_str(), Stamp))
+		{
+			state.SkipWithError("open failed");
+			break;
+		}
+
+		uint32_t Total = 0;
+		for (auto& Patch : Data.Patches)
+			Total += Database.CountAt(Database.IndexOf(Patch.Name.c_str()));
+		benchmark::DoNotOptimize(Total);
+	}
+}
+BENCHMARK(BM_MappedOpenAndLookupAll)->DenseRange(0, std::size(Editors) - 1);
+
+static void BM_ParseSourceAndLookupAll(benchmark::State& state)
+{
+	auto& Data = GetFixture(state.range(0));
+	state.SetLabel(Editors[state.range(0)]);
+
+	for (auto _ : state)
+	{
+		auto Patches = Tests::LoadRelocationSource(Data.SourceDirectory.c_str());
+		UnorderedMap<String, const RelocationMappedDatabase::SourcePatch*> Index;
+		for (auto& Patch : Patches)
+			Index.emplace(Patch.Name, &Patch);
+
+		size_t Total = 0;
+		for (auto& Patch : Data.Patches)
+			Total += Index[Patch.Name]->RVAs.size();
+		benchmark::DoNotOptimize(Total);
+	}
+}
+BENCHMARK(BM_ParseSourceAndLookupAll)->DenseRange(0, std::size(Editors) - 1);
+
+static void BM_MappedLookup(benchmark::State& state)
+{
+	auto& Data = GetFixture(0);
+	RelocationMappedDatabase::Stamp Stamp = { 0 };
+	RelocationMappedDatabase Database;
+	Database.Open(Data.FileName.c_str(), Stamp);
+
+	size_t i = 0;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(Database.IndexOf(Data.Patches[i++ % Data.Patches.size()].Name.c_str()));
+}
+BENCHMARK(BM_MappedLookup);
\ No newline at end of file
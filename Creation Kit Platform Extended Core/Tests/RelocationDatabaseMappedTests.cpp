@@ -0,0 +1,163 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "RelocationDatabaseSource.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	RelocationMappedDatabase::Stamp MakeStamp(uint64_t sourceSize, uint64_t sourceTime)
+	{
+		RelocationMappedDatabase::Stamp Stamp = { 0 };
+		Stamp.SourceSize = sourceSize;
+		Stamp.SourceTime = sourceTime;
+		Stamp.PlatformVersion = (0ull << 48) | (4ull << 32) | 912ull;
+		Stamp.EditorCRC32 = 0x1234ABCDul;
+		return Stamp;
+	}
+
+	class RelocationDatabaseMappedTest : public ::testing::TestWithParam<const char*>
+	{
+	protected:
+		void SetUp() override
+		{
+			Patches = Tests::LoadRelocationSource((String(CKPE_DATABASE_DIR "/") + GetParam()).c_str());
+			ASSERT_FALSE(Patches.empty());
+			FileName = Temp.File("test.mapdb");
+			ASSERT_TRUE(RelocationMappedDatabase::Build(FileName.c_str(), Patches, MakeStamp(1000, 2000)));
+		}
+
+		Tests::TempDirectory Temp;
+		String FileName;
+		Array<RelocationMappedDatabase::SourcePatch> Patches;
+	};
+}
+
+TEST_P(RelocationDatabaseMappedTest, FindsEveryPatchAndSignature)
+{
+	RelocationMappedDatabase Database;
+	ASSERT_TRUE(Database.Open(FileName.c_str(), MakeStamp(1000, 2000)));
+	ASSERT_EQ(Database.Count(), Patches.size());
+
+	for (auto& Patch : Patches)
+	{
+		auto Index = Database.IndexOf(Patch.Name.c_str());
+		ASSERT_NE(Index, RelocationMappedDatabase::NOT_FOUND) << Patch.Name;
+		EXPECT_STREQ(Database.NameAt(Index), Patch.Name.c_str());
+		EXPECT_EQ(Database.VersionAt(Index), Patch.Version);
+		ASSERT_EQ(Database.CountAt(Index), Patch.RVAs.size());
+
+		for (uint32_t i = 0; i < Patch.RVAs.size(); i++)
+		{
+			EXPECT_EQ(Database.RVAAt(Index, i), Patch.RVAs[i]);
+
+			uint32_t Length = 0;
+			auto Pattern = Database.PatternAt(Index, i, &Length);
+			EXPECT_EQ(String(Pattern ? Pattern : "", Length), Patch.Patterns[i]);
+		}
+	}
+}
+
+TEST_P(RelocationDatabaseMappedTest, RejectsForeignNamesAndIgnoresCase)
+{
+	RelocationMappedDatabase Database;
+	ASSERT_TRUE(Database.Open(FileName.c_str(), MakeStamp(1000, 2000)));
+
+	EXPECT_EQ(Database.IndexOf("No such patch"), RelocationMappedDatabase::NOT_FOUND);
+	EXPECT_EQ(Database.IndexOf(""), RelocationMappedDatabase::NOT_FOUND);
+	EXPECT_EQ(Database.IndexOf(nullptr), RelocationMappedDatabase::NOT_FOUND);
+
+	String Upper = Patches[0].Name;
+	for (auto& Ch : Upper)
+		Ch = (char)toupper((uint8_t)Ch);
+	EXPECT_EQ(Database.IndexOf(Upper.c_str()), Database.IndexOf(Patches[0].Name.c_str()));
+}
+
+INSTANTIATE_TEST_SUITE_P(Database, RelocationDatabaseMappedTest,
+	::testing::Values("SSE/1_6_1130", "FO4/1_10_982_3", "SF/1_14_74_0"));
+
+TEST(RelocationDatabaseMapped, RejectsStaleSource)
+{
+	Tests::TempDirectory Temp;
+	auto FileName = Temp.File("test.mapdb");
+	Array<RelocationMappedDatabase::SourcePatch> Patches(1);
+	Patches[0].Name = "Patch";
+	Patches[0].Version = 1;
+	ASSERT_TRUE(RelocationMappedDatabase::Build(FileName.c_str(), Patches, MakeStamp(1000, 2000)));
+
+	RelocationMappedDatabase Database;
+	EXPECT_TRUE(Database.Open(FileName.c_str(), MakeStamp(1000, 2000)));
+	EXPECT_FALSE(Database.Open(FileName.c_str(), MakeStamp(1001, 2000)));
+	EXPECT_FALSE(Database.Open(FileName.c_str(), MakeStamp(1000, 2001)));
+}
+
+TEST(RelocationDatabaseMapped, ChecksBuildStampWithoutSource)
+{
+	Tests::TempDirectory Temp;
+	auto FileName = Temp.File("test.mapdb");
+	Array<RelocationMappedDatabase::SourcePatch> Patches(1);
+	Patches[0].Name = "Patch";
+	Patches[0].Version = 1;
+	ASSERT_TRUE(RelocationMappedDatabase::Build(FileName.c_str(), Patches, MakeStamp(1000, 2000)));
+
+	// Исходной базы нет: файл принимается только от той же сборки платформы и того же редактора
+	RelocationMappedDatabase Database;
+	EXPECT_TRUE(Database.Open(FileName.c_str(), MakeStamp(0, 0)));
+
+	auto OtherPlatform = MakeStamp(0, 0);
+	OtherPlatform.PlatformVersion++;
+	EXPECT_FALSE(Database.Open(FileName.c_str(), OtherPlatform));
+
+	auto OtherEditor = MakeStamp(0, 0);
+	OtherEditor.EditorCRC32 ^= 1;
+	EXPECT_FALSE(Database.Open(FileName.c_str(), OtherEditor));
+	EXPECT_FALSE(Database.IsOpen());
+}
+
+TEST(RelocationDatabaseMapped, RejectsDamagedFile)
+{
+	Tests::TempDirectory Temp;
+	auto FileName = Temp.File("test.mapdb");
+	Array<RelocationMappedDatabase::SourcePatch> Patches(2);
+	Patches[0].Name = "First";
+	Patches[0].RVAs = { 0x1000, 0x2000 };
+	Patches[0].Patterns = { "4889", "" };
+	Patches[1].Name = "Second";
+	ASSERT_TRUE(RelocationMappedDatabase::Build(FileName.c_str(), Patches, MakeStamp(0, 0)));
+
+	auto Size = std::filesystem::file_size(FileName.c_str());
+	RelocationMappedDatabase Database;
+	ASSERT_TRUE(Database.Open(FileName.c_str(), MakeStamp(0, 0)));
+	Database.Close();
+
+	// Усечённый файл
+	std::filesystem::resize_file(FileName.c_str(), Size - 1);
+	EXPECT_FALSE(Database.Open(FileName.c_str(), MakeStamp(0, 0)));
+
+	// Чужая сигнатура
+	std::filesystem::resize_file(FileName.c_str(), Size);
+	{
+		std::fstream Stream(FileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		Stream.write("XXXX", 4);
+	}
+	EXPECT_FALSE(Database.Open(FileName.c_str(), MakeStamp(0, 0)));
+	EXPECT_FALSE(Database.Open(Temp.File("missing.mapdb").c_str(), MakeStamp(0, 0)));
+}
+
+TEST(RelocationDatabaseMapped, EmptyDatabase)
+{
+	Tests::TempDirectory Temp;
+	auto FileName = Temp.File("test.mapdb");
+	ASSERT_TRUE(RelocationMappedDatabase::Build(FileName.c_str(), {}, MakeStamp(0, 0)));
+
+	RelocationMappedDatabase Database;
+	ASSERT_TRUE(Database.Open(FileName.c_str(), MakeStamp(0, 0)));
+	EXPECT_EQ(Database.Count(), 0u);
+	EXPECT_EQ(Database.IndexOf("Patch"), RelocationMappedDatabase::NOT_FOUND);
+}
\ No newline at end of file
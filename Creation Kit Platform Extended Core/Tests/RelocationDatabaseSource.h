@@ -0,0 +1,65 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include <sstream>
+
+#include "Core/RelocationDatabaseMapped.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Читает исходники базы (Database/<редактор>/<версия>/*.relb): имя патча, версия,
+		// затем строки "RVA [длина шаблон]"
+		inline Array<Core::RelocationMappedDatabase::SourcePatch> LoadRelocationSource(const char* directory)
+		{
+			Array<Core::RelocationMappedDatabase::SourcePatch> Patches;
+			Array<std::filesystem::path> Files;
+			for (auto& Entry : std::filesystem::directory_iterator(directory))
+			{
+				if (Entry.path().extension() == ".relb")
+					Files.push_back(Entry.path());
+			}
+			std::sort(Files.begin(), Files.end());
+
+			auto ReadLine = [](std::ifstream& stream, std::string& line) -> bool {
+				if (!std::getline(stream, line))
+					return false;
+				while (!line.empty() && ((line.back() == '\r') || (line.back() == ' ')))
+					line.pop_back();
+				return true;
+			};
+
+			for (auto& File : Files)
+			{
+				std::ifstream Stream(File);
+				std::string Line;
+				Core::RelocationMappedDatabase::SourcePatch Patch;
+
+				ReadLine(Stream, Line);
+				Patch.Name = Line.c_str();
+				ReadLine(Stream, Line);
+				Patch.Version = (uint32_t)atoi(Line.c_str());
+
+				while (ReadLine(Stream, Line))
+				{
+					if (Line.empty() || (Line == "extended"))
+						continue;
+
+					std::istringstream Fields(Line);
+					std::string Rva, Length, Pattern;
+					Fields >> Rva >> Length >> Pattern;
+					Patch.RVAs.push_back((uint32_t)strtoul(Rva.c_str(), nullptr, 16));
+					Patch.Patterns.push_back(Pattern.c_str());
+				}
+
+				Patches.push_back(Patch);
+			}
+
+			return Patches;
+		}
+	}
+}
\ No newline at end of file
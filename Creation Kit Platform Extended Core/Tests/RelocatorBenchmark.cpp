@@ -0,0 +1,71 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Патч вроде UnicodePatch: сотни NOP в разных местах 4 МБ кода. Каждая запись со своей сменой защиты
+// против одного пакета RelocatorTransaction (защита меняется по разу на диапазон страниц)
+
+#include <random>
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	constexpr static uint32_t CODE_SIZE = 4 * 1024 * 1024;
+
+	struct Fixture
+	{
+		uintptr_t Base;
+		Array<uintptr_t> Sites;
+
+		Fixture()
+		{
+			Base = (uintptr_t)VirtualAlloc(nullptr, CODE_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READ);
+
+			auto& Config = Tests::GetEngineConfig();
+			Config.ModuleBase = Base;
+			Config.ModuleSize = CODE_SIZE;
+			Config.Sections[SECTION_TEXT] = { Base, Base + CODE_SIZE };
+			GlobalRelocatorPtr = new Relocator(Tests::CreateEngine());
+
+			std::mt19937 Random(1);
+			for (uint32_t i = 0; i < 4096; i++)
+				Sites.push_back(16 + Random() % (CODE_SIZE - 32));
+		}
+	};
+
+	Fixture& GetFixture()
+	{
+		static Fixture Data;
+		return Data;
+	}
+}
+
+static void BM_RelocatorPatchNopEach(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	for (auto _ : state)
+	{
+		for (int64_t i = 0; i < state.range(0); i++)
+			GlobalRelocatorPtr->PatchNop(Data.Sites[i], 5);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RelocatorPatchNopEach)->Arg(64)->Arg(1024)->Arg(4096);
+
+static void BM_RelocatorPatchNopTransaction(benchmark::State& state)
+{
+	auto& Data = GetFixture();
+	for (auto _ : state)
+	{
+		RelocatorTransaction Transaction;
+		for (int64_t i = 0; i < state.range(0); i++)
+			GlobalRelocatorPtr->PatchNop(Data.Sites[i], 5);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RelocatorPatchNopTransaction)->Arg(64)->Arg(1024)->Arg(4096);
\ No newline at end of file
@@ -0,0 +1,210 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Образ: 48 страниц кода (только чтение и исполнение), 15 страниц данных только для чтения
+	// и последняя страница без доступа. Запись мимо снятой защиты завершает тест по SIGSEGV.
+	class RelocatorTest : public ::testing::Test
+	{
+	protected:
+		constexpr static uint32_t CODE_PAGES = 48;
+		constexpr static uint32_t TOTAL_PAGES = 64;
+
+		void SetUp() override
+		{
+			SYSTEM_INFO Info;
+			GetSystemInfo(&Info);
+			PageSize = Info.dwPageSize;
+
+			Base = (uintptr_t)VirtualAlloc(nullptr, TOTAL_PAGES * PageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			ASSERT_NE(Base, 0u);
+			memset((void*)Base, 0xCC, TOTAL_PAGES * PageSize);
+
+			DWORD OldFlag;
+			ASSERT_TRUE(VirtualProtect((LPVOID)Base, CODE_PAGES * PageSize, PAGE_EXECUTE_READ, &OldFlag));
+			ASSERT_TRUE(VirtualProtect((LPVOID)(Base + CODE_PAGES * PageSize), (TOTAL_PAGES - CODE_PAGES - 1) * PageSize,
+				PAGE_READONLY, &OldFlag));
+			ASSERT_TRUE(VirtualProtect((LPVOID)(Base + (TOTAL_PAGES - 1) * PageSize), PageSize, PAGE_NOACCESS, &OldFlag));
+
+			auto& Config = Tests::GetEngineConfig();
+			Config.ModuleBase = Base;
+			Config.ModuleSize = TOTAL_PAGES * PageSize;
+			Config.Sections[SECTION_TEXT] = { Base, Base + CODE_PAGES * PageSize };
+			Config.Sections[SECTION_DATA_READONLY] = { Base + CODE_PAGES * PageSize, Base + (TOTAL_PAGES - 1) * PageSize };
+			Config.Sections[SECTION_DATA] = { Base + (TOTAL_PAGES - 1) * PageSize, Base + TOTAL_PAGES * PageSize };
+			GlobalRelocatorPtr = new Relocator(Tests::CreateEngine());
+		}
+
+		void TearDown() override
+		{
+			delete GlobalRelocatorPtr;
+			GlobalRelocatorPtr = nullptr;
+			Tests::DestroyEngine();
+			VirtualFree((LPVOID)Base, 0, MEM_RELEASE);
+		}
+
+		DWORD ProtectionAt(uintptr_t rav) const
+		{
+			MEMORY_BASIC_INFORMATION Mbi;
+			EXPECT_EQ(VirtualQuery((LPCVOID)(Base + rav), &Mbi, sizeof(Mbi)), sizeof(Mbi));
+			return Mbi.Protect;
+		}
+
+		void ExpectOriginalProtection() const
+		{
+			for (uint32_t i = 0; i < TOTAL_PAGES; i++)
+				EXPECT_EQ(ProtectionAt(i * PageSize), (i < CODE_PAGES) ? PAGE_EXECUTE_READ :
+					((i < (TOTAL_PAGES - 1)) ? PAGE_READONLY : PAGE_NOACCESS)) << "page " << i;
+		}
+
+		const uint8_t* At(uintptr_t rav) const
+		{
+			return (const uint8_t*)(Base + rav);
+		}
+
+		uintptr_t Base = 0;
+		uintptr_t PageSize = 0;
+	};
+}
+
+TEST_F(RelocatorTest, PatchesOutsideTransactionProtectEachWrite)
+{
+	auto Calls = Tests::GetVirtualProtectCount();
+	for (uint32_t i = 1; i <= 10; i++)
+		GlobalRelocatorPtr->PatchNop(i * 100, 5);
+
+	EXPECT_EQ(Tests::GetVirtualProtectCount(), Calls + 20);
+	EXPECT_EQ(At(100)[0], 0x90);
+	EXPECT_EQ(At(104)[0], 0x90);
+	EXPECT_EQ(At(105)[0], 0xCC);
+	ExpectOriginalProtection();
+}
+
+TEST_F(RelocatorTest, TransactionCoalescesPages)
+{
+	auto Calls = Tests::GetVirtualProtectCount();
+	auto Flushes = Tests::GetFlushInstructionCacheCount();
+	{
+		RelocatorTransaction Transaction;
+		EXPECT_EQ(RelocatorTransaction::GetCurrent(), &Transaction);
+
+		// Страницы 1-3 подряд и отдельно страница 10
+		for (uint32_t i = 0; i < 300; i++)
+			GlobalRelocatorPtr->PatchNop(PageSize + i * 10, 3);
+		GlobalRelocatorPtr->Patch(10 * PageSize + 16, { 0x48, 0x89, 0x05 });
+		GlobalRelocatorPtr->PatchJump(10 * PageSize + 32, 10 * PageSize + 0x100);
+
+		EXPECT_EQ(Transaction.Count(), 303u);
+		EXPECT_EQ(At(PageSize)[0], 0xCC);
+		EXPECT_EQ(Tests::GetVirtualProtectCount(), Calls);
+	}
+	EXPECT_EQ(RelocatorTransaction::GetCurrent(), nullptr);
+
+	// Два диапазона: снять и вернуть защиту по одному разу на каждый
+	EXPECT_EQ(Tests::GetVirtualProtectCount(), Calls + 4);
+	EXPECT_EQ(Tests::GetFlushInstructionCacheCount(), Flushes + 1);
+
+	EXPECT_EQ(At(PageSize)[2], 0x90);
+	EXPECT_EQ(At(PageSize + 3)[0], 0xCC);
+	EXPECT_EQ(At(PageSize + 2990)[2], 0x90);
+	EXPECT_EQ(At(10 * PageSize + 16)[2], 0x05);
+	EXPECT_EQ(At(10 * PageSize + 32)[0], 0xE9);
+	EXPECT_EQ(*(int32_t*)At(10 * PageSize + 33), 0x100 - 32 - 5);
+	ExpectOriginalProtection();
+}
+
+TEST_F(RelocatorTest, TransactionKeepsWriteOrder)
+{
+	{
+		RelocatorTransaction Transaction;
+		GlobalRelocatorPtr->Patch(200, { 1, 2, 3, 4 });
+		GlobalRelocatorPtr->PatchNop(201, 2);
+		GlobalRelocatorPtr->Patch(202, { 7 });
+	}
+
+	EXPECT_EQ(At(200)[0], 1);
+	EXPECT_EQ(At(200)[1], 0x90);
+	EXPECT_EQ(At(200)[2], 7);
+	EXPECT_EQ(At(200)[3], 4);
+}
+
+TEST_F(RelocatorTest, TransactionRestoresEachPageOwnProtection)
+{
+	// Запись через границу кода и данных только для чтения и запись вплотную к странице без доступа
+	{
+		RelocatorTransaction Transaction;
+		GlobalRelocatorPtr->PatchNop(CODE_PAGES * PageSize - 4, 8);
+		GlobalRelocatorPtr->PatchNop((TOTAL_PAGES - 1) * PageSize - 4, 4);
+	}
+
+	EXPECT_EQ(At(CODE_PAGES * PageSize - 4)[0], 0x90);
+	EXPECT_EQ(At(CODE_PAGES * PageSize + 3)[0], 0x90);
+	EXPECT_EQ(At(CODE_PAGES * PageSize + 4)[0], 0xCC);
+	EXPECT_EQ(At((TOTAL_PAGES - 1) * PageSize - 1)[0], 0x90);
+	ExpectOriginalProtection();
+}
+
+TEST_F(RelocatorTest, NestedTransactionCommitsOnItsOwn)
+{
+	RelocatorTransaction Outer;
+	GlobalRelocatorPtr->PatchNop(300, 1);
+	{
+		RelocatorTransaction Inner;
+		GlobalRelocatorPtr->PatchNop(400, 1);
+		EXPECT_EQ(Outer.Count(), 1u);
+	}
+
+	EXPECT_EQ(RelocatorTransaction::GetCurrent(), &Outer);
+	EXPECT_EQ(At(400)[0], 0x90);
+	EXPECT_EQ(At(300)[0], 0xCC);
+
+	Outer.Commit();
+	EXPECT_EQ(Outer.Count(), 0u);
+	EXPECT_EQ(At(300)[0], 0x90);
+}
+
+TEST_F(RelocatorTest, DetourCommitsPendingWrites)
+{
+	RelocatorTransaction Transaction;
+	GlobalRelocatorPtr->Patch(500, { 0x55, 0x56 });
+	EXPECT_TRUE(GlobalRelocatorPtr->DetourJump(600, Base + 0x1000));
+
+	EXPECT_EQ(Transaction.Count(), 0u);
+	EXPECT_EQ(At(500)[1], 0x56);
+	EXPECT_EQ(At(600)[0], 0xE9);
+	EXPECT_EQ(*(int32_t*)At(601), 0x1000 - 600 - 5);
+	ExpectOriginalProtection();
+}
+
+TEST_F(RelocatorTest, ScopeUnlocksTextOnce)
+{
+	auto Calls = Tests::GetVirtualProtectCount();
+	{
+		ScopeRelocator Text;
+		EXPECT_EQ(Tests::GetVirtualProtectCount(), Calls + 1);
+		EXPECT_EQ(ProtectionAt(0), PAGE_EXECUTE_READWRITE);
+		EXPECT_FALSE(GlobalRelocatorPtr->IsLock(Base, PageSize));
+
+		// Повторное открытие того же региона ничего не делает
+		GlobalRelocatorPtr->Unlock();
+		EXPECT_EQ(Tests::GetVirtualProtectCount(), Calls + 1);
+
+		RelocatorTransaction Transaction;
+		for (uint32_t i = 1; i <= 100; i++)
+			GlobalRelocatorPtr->PatchNop(i * 16, 2);
+	}
+
+	EXPECT_EQ(ProtectionAt(0), PAGE_EXECUTE_READ);
+	EXPECT_TRUE(GlobalRelocatorPtr->IsLock(Base, PageSize));
+	EXPECT_EQ(At(16)[1], 0x90);
+	ExpectOriginalProtection();
+}
\ No newline at end of file
@@ -0,0 +1,327 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <typeinfo>
+#include <sys/mman.h>
+
+#include "Shim/TestEngine.h"
+#include "RttiImage.h"
+
+using namespace CreationKitPlatformExtended::Core::MSRTTI::detail;
+
+extern "C"
+{
+	typedef void* (*malloc_func_t)(size_t);
+	typedef void(*free_func_t)(void*);
+
+	// Замена undname из CRT, ms_rtti.cpp вызывает её для имён TypeDescriptor без ведущей точки
+	char* __unDNameEx(char* outputString, const char* name, int maxStringLength, malloc_func_t pAlloc,
+		free_func_t pFree, char* (__fastcall* pGetParameter)(int), unsigned int disableFlags)
+	{
+		auto Name = CreationKitPlatformExtended::Tests::DemangleRawName(name);
+		auto Result = (char*)pAlloc(Name.length() + 1);
+		memcpy(Result, Name.c_str(), Name.length() + 1);
+		return Result;
+	}
+}
+
+static std::atomic<uint64_t> RTDynamicCastCalls;
+
+extern "C" PVOID __RTDynamicCast(PVOID inptr, LONG VfDelta, PVOID SrcType, PVOID TargetType, BOOL isReference)
+{
+	RTDynamicCastCalls.fetch_add(1, std::memory_order_relaxed);
+
+	if (!inptr)
+		return nullptr;
+
+	auto Object = (uintptr_t)inptr + VfDelta;
+	auto Locator = *(CompleteObjectLocator**)(*(uintptr_t*)Object - sizeof(uintptr_t));
+	auto Complete = Object - Locator->Offset;
+	auto Hierarchy = Locator->ClassDescriptor.Get();
+	auto Target = (TypeDescriptor*)TargetType;
+
+	for (uint32_t i = 0; i < Hierarchy->NumBaseClasses; i++)
+	{
+		auto Base = ((RVA<BaseClassDescriptor*>*)Hierarchy->BaseClassArray.Get()->ArrayOfBaseClassDescriptors)[i].Get();
+		auto Type = Base->TypeDescriptor.Get();
+		if ((Type == Target) || !strcmp(Type->name, Target->name))
+			return (PVOID)(Complete + Base->Disp.Mdisp);
+	}
+
+	if (isReference)
+		throw std::bad_cast();
+
+	return nullptr;
+}
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		uint64_t GetRTDynamicCastCalls()
+		{
+			return RTDynamicCastCalls.load(std::memory_order_relaxed);
+		}
+
+		static uint32_t AlignUp(uint32_t Value, uint32_t Align)
+		{
+			return (Value + Align - 1) & ~(Align - 1);
+		}
+
+		RttiImage::RttiImage(uint32_t codeSize, uint32_t rdataSize, uint32_t dataSize, uint32_t seed) :
+			_codeRVA(0x1000), _codeSize(codeSize), _rdataSize(rdataSize), _rdataUsed(0), _dataSize(dataSize),
+			_dataUsed(0), _seed(seed)
+		{
+			_rdataRVA = AlignUp(_codeRVA + _codeSize, 0x1000);
+			_dataRVA = AlignUp(_rdataRVA + _rdataSize, 0x1000);
+			_imageSize = AlignUp(_dataRVA + _dataSize, 0x1000);
+
+			_image = (uint8_t*)mmap(nullptr, _imageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (_image == MAP_FAILED)
+				abort();
+
+			memset(_image + _codeRVA, 0xCC, _codeSize);
+
+			std::mt19937_64 Random(seed);
+			for (uint32_t i = 0; (i + sizeof(uint64_t)) <= _rdataSize; i += sizeof(uint64_t))
+				*(uint64_t*)(_image + _rdataRVA + i) = Random();
+		}
+
+		RttiImage::~RttiImage()
+		{
+			munmap(_image, _imageSize);
+		}
+
+		uint32_t RttiImage::AllocRdata(uint32_t Size, uint32_t Align)
+		{
+			auto Offset = AlignUp(_rdataUsed, Align);
+			if ((Offset + Size) > _rdataSize)
+				abort();
+
+			memset(_image + _rdataRVA + Offset, 0, Size);
+			_rdataUsed = Offset + Size;
+			return _rdataRVA + Offset;
+		}
+
+		uint32_t RttiImage::GetTypeRVA(const char* RawName)
+		{
+			auto It = _types.find(RawName);
+			if (It != _types.end())
+				return It->second;
+
+			auto Size = (uint32_t)(offsetof(TypeDescriptor, name) + strlen(RawName) + 1);
+			auto Offset = AlignUp(_dataUsed, 16);
+			if ((Offset + Size) > _dataSize)
+				abort();
+
+			auto Type = (TypeDescriptor*)(_image + _dataRVA + Offset);
+			Type->vftable = nullptr;
+			Type->unknown = 0;
+			strcpy(Type->name, RawName);
+
+			_dataUsed = Offset + Size;
+			_types.emplace(RawName, _dataRVA + Offset);
+			return _dataRVA + Offset;
+		}
+
+		uintptr_t RttiImage::WriteVTable(uint32_t LocatorRVA, uint32_t FunctionCount, uint32_t RdataOffset)
+		{
+			uint32_t RVA;
+			auto Size = (FunctionCount + 2) * (uint32_t)sizeof(uintptr_t);
+
+			if (RdataOffset)
+			{
+				// Промежуток перед таблицей остаётся заполненным случайными байтами
+				if ((RdataOffset - sizeof(uintptr_t)) < _rdataUsed)
+					abort();
+
+				_rdataUsed = RdataOffset - sizeof(uintptr_t);
+				RVA = AllocRdata(Size, 1);
+			}
+			else
+				RVA = AllocRdata(Size, sizeof(uintptr_t));
+
+			std::mt19937 Random(_seed ^ RVA);
+			auto Table = (uintptr_t*)(_image + RVA);
+			Table[0] = GetBase() + LocatorRVA;
+			for (uint32_t i = 1; i <= FunctionCount; i++)
+				Table[i] = GetBase() + _codeRVA + (Random() % (_codeSize / 16)) * 16;
+			Table[FunctionCount + 1] = 0;
+
+			return (uintptr_t)&Table[1];
+		}
+
+		uintptr_t RttiImage::AddClass(const char* RawName, std::initializer_list<Base> Bases, uint32_t FunctionCount,
+			uint32_t RdataOffset)
+		{
+			auto& Info = _classes[RawName];
+			Info.TypeRVA = GetTypeRVA(RawName);
+
+			auto Count = (uint32_t)Bases.size() + 1;
+			Info.HierarchyRVA = AllocRdata(sizeof(ClassHierarchyDescriptor), 4);
+			auto ArrayRVA = AllocRdata(Count * sizeof(uint32_t), 4);
+
+			auto Hierarchy = (ClassHierarchyDescriptor*)(_image + Info.HierarchyRVA);
+			Hierarchy->Signature = 0;
+			Hierarchy->Attributes = (Count > 2) ? ClassHierarchyDescriptor::HCD_MultipleInheritance :
+				ClassHierarchyDescriptor::HCD_NoInheritance;
+			Hierarchy->NumBaseClasses = Count;
+			Hierarchy->BaseClassArray.Offset = ArrayRVA;
+
+			auto WriteBase = [&](uint32_t Index, const char* Name, int32_t Offset)
+			{
+				auto DescriptorRVA = AllocRdata(sizeof(BaseClassDescriptor), 4);
+				auto Descriptor = (BaseClassDescriptor*)(_image + DescriptorRVA);
+				Descriptor->TypeDescriptor.Offset = GetTypeRVA(Name);
+				Descriptor->NumContainedBases = 0;
+				Descriptor->Disp = { Offset, -1, 0 };
+				Descriptor->Attributes = BaseClassDescriptor::BCD_HasHierarchyDescriptor;
+				((uint32_t*)(_image + ArrayRVA))[Index] = DescriptorRVA;
+			};
+
+			WriteBase(0, RawName, 0);
+			uint32_t Index = 1;
+			for (auto& It : Bases)
+				WriteBase(Index++, It.RawName, It.Offset);
+
+			return AddVTable(RawName, 0, FunctionCount, RdataOffset);
+		}
+
+		uintptr_t RttiImage::AddVTable(const char* RawName, uint32_t Offset, uint32_t FunctionCount, uint32_t RdataOffset)
+		{
+			auto& Info = _classes.at(RawName);
+
+			auto LocatorRVA = AllocRdata(sizeof(CompleteObjectLocator), 4);
+			auto Locator = (CompleteObjectLocator*)(_image + LocatorRVA);
+			Locator->Signature = CompleteObjectLocator::COL_Signature64;
+			Locator->Offset = Offset;
+			Locator->CDOffset = 0;
+			Locator->TypeDescriptor.Offset = Info.TypeRVA;
+			Locator->ClassDescriptor.Offset = Info.HierarchyRVA;
+			Info.Locators[Offset] = LocatorRVA;
+
+			auto Address = WriteVTable(LocatorRVA, FunctionCount, RdataOffset);
+			_vtables.push_back({ Address, Offset, FunctionCount, RawName });
+			return Address;
+		}
+
+		void RttiImage::AddDecoys()
+		{
+			auto TypeRVA = GetTypeRVA(".?AVDecoy@@");
+
+			// COL с 32-битной подписью
+			auto LocatorRVA = AllocRdata(sizeof(CompleteObjectLocator), 4);
+			auto Locator = (CompleteObjectLocator*)(_image + LocatorRVA);
+			*Locator = { CompleteObjectLocator::COL_Signature32, 0, 0, { TypeRVA }, { 0 } };
+			WriteVTable(LocatorRVA, 3, 0);
+
+			// TypeDescriptor за пределами образа
+			LocatorRVA = AllocRdata(sizeof(CompleteObjectLocator), 4);
+			Locator = (CompleteObjectLocator*)(_image + LocatorRVA);
+			*Locator = { CompleteObjectLocator::COL_Signature64, 0, 0, { _imageSize + 0x1000 }, { 0 } };
+			WriteVTable(LocatorRVA, 3, 0);
+
+			// Правильный COL, но за ним нет ни одной функции
+			LocatorRVA = AllocRdata(sizeof(CompleteObjectLocator), 4);
+			Locator = (CompleteObjectLocator*)(_image + LocatorRVA);
+			*Locator = { CompleteObjectLocator::COL_Signature64, 0, 0, { TypeRVA }, { 0 } };
+			WriteVTable(LocatorRVA, 0, 0);
+		}
+
+		void RttiImage::Install() const
+		{
+			auto& Config = GetEngineConfig();
+			Config.ModuleBase = GetBase();
+			Config.ModuleSize = _imageSize;
+			Config.Sections[Core::SECTION_TEXT] = { GetBase() + _codeRVA, GetBase() + _codeRVA + _codeSize };
+			Config.Sections[Core::SECTION_DATA_READONLY] = { GetBase() + _rdataRVA, GetBase() + _rdataRVA + _rdataSize };
+			Config.Sections[Core::SECTION_DATA] = { GetBase() + _dataRVA, GetBase() + _dataRVA + _dataSize };
+		}
+
+		TypeDescriptor* RttiImage::GetTypeDescriptor(const char* RawName) const
+		{
+			auto It = _types.find(RawName);
+			return (It != _types.end()) ? (TypeDescriptor*)(_image + It->second) : nullptr;
+		}
+
+		CompleteObjectLocator* RttiImage::GetLocator(const char* RawName, uint32_t Offset) const
+		{
+			auto It = _classes.find(RawName);
+			if (It == _classes.end())
+				return nullptr;
+
+			auto Locator = It->second.Locators.find(Offset);
+			return (Locator != It->second.Locators.end()) ? (CompleteObjectLocator*)(_image + Locator->second) : nullptr;
+		}
+
+		Array<String> AddGeneratedClasses(RttiImage& Image, uint32_t Count, uint32_t Seed)
+		{
+			std::mt19937 Random(Seed);
+			Array<String> Names;
+			Names.reserve(Count);
+
+			for (uint32_t i = 0; i < Count; i++)
+			{
+				char szName[64];
+				if (i % 3)
+					sprintf_s(szName, ".?A%cGen%uForm@@", (i % 5) ? 'V' : 'U', i);
+				else
+					sprintf_s(szName, ".?A%cGen%uForm@Space%u@@", (i % 5) ? 'V' : 'U', i, i % 7);
+
+				auto Functions = 1 + Random() % 40;
+				if (Names.empty() || !(Random() % 4))
+					Image.AddClass(szName, {}, Functions);
+				else if (Random() % 3)
+					Image.AddClass(szName, { { Names[Random() % Names.size()].c_str(), 0 } }, Functions);
+				else
+				{
+					// Вторая база со своей vtable в середине объекта
+					auto Offset = (1 + Random() % 8) * (uint32_t)sizeof(uintptr_t);
+					Image.AddClass(szName, { { Names[Random() % Names.size()].c_str(), 0 },
+						{ Names[Random() % Names.size()].c_str(), (int32_t)Offset } }, Functions);
+					Image.AddVTable(szName, Offset, 1 + Random() % 10);
+				}
+
+				Names.emplace_back(szName);
+			}
+
+			return Names;
+		}
+
+		String DemangleRawName(const char* RawName)
+		{
+			auto Name = (*RawName == '.') ? RawName + 1 : RawName;
+
+			const char* Kind = nullptr;
+			if (!strncmp(Name, "?AV", 3))
+				Kind = "class ";
+			else if (!strncmp(Name, "?AU", 3))
+				Kind = "struct ";
+			else
+				return Name;
+
+			Array<String> Parts;
+			for (auto s = Name + 3; *s && (*s != '@');)
+			{
+				auto e = strchr(s, '@');
+				if (!e)
+					return Name;
+
+				Parts.emplace_back(s, e - s);
+				s = e + 1;
+			}
+
+			String Result = Kind;
+			for (auto It = Parts.rbegin(); It != Parts.rend(); It++)
+			{
+				if (It != Parts.rbegin())
+					Result.append("::");
+				Result.append(*It);
+			}
+
+			return Result;
+		}
+	}
+}
\ No newline at end of file
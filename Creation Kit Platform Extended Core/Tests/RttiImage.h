@@ -0,0 +1,90 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include "Core/TypeInfo/ms_rtti.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Синтетический образ модуля x64 с RTTI в раскладке MSVC: .text, .rdata (COL, иерархии, vtable)
+		// и .data (TypeDescriptor). Промежутки .rdata заполнены случайными байтами, чтобы сканер
+		// проходил не только по нулям. Install() делает образ модулем тестового Engine.
+		class RttiImage
+		{
+		public:
+			// База в массиве BaseClassDescriptor и её смещение (PMD.mdisp) в полном объекте
+			struct Base
+			{
+				const char* RawName;
+				int32_t Offset;
+			};
+
+			struct VTable
+			{
+				uintptr_t Address;
+				uint32_t Offset;
+				uint32_t FunctionCount;
+				String RawName;
+			};
+
+			RttiImage(uint32_t codeSize, uint32_t rdataSize, uint32_t dataSize, uint32_t seed = 1);
+			~RttiImage();
+
+			// Класс с иерархией [сам класс, Bases...] и главной vtable. Если задан RdataOffset,
+			// vtable начинается ровно с этого смещения в .rdata (оно не меньше уже занятого).
+			uintptr_t AddClass(const char* RawName, std::initializer_list<Base> Bases, uint32_t FunctionCount,
+				uint32_t RdataOffset = 0);
+			// Ещё одна vtable уже добавленного класса для базы со смещением Offset
+			uintptr_t AddVTable(const char* RawName, uint32_t Offset, uint32_t FunctionCount, uint32_t RdataOffset = 0);
+			// Похожие на vtable данные, которые сканер должен пропустить
+			void AddDecoys();
+
+			void Install() const;
+
+			inline uintptr_t GetBase() const { return (uintptr_t)_image; }
+			inline uint32_t GetRdataUsed() const { return _rdataUsed; }
+			inline const Array<VTable>& GetVTables() const { return _vtables; }
+			Core::MSRTTI::detail::TypeDescriptor* GetTypeDescriptor(const char* RawName) const;
+			Core::MSRTTI::detail::CompleteObjectLocator* GetLocator(const char* RawName, uint32_t Offset) const;
+		private:
+			RttiImage(const RttiImage&) = delete;
+			RttiImage& operator=(const RttiImage&) = delete;
+
+			struct Class
+			{
+				uint32_t TypeRVA;
+				uint32_t HierarchyRVA;
+				UnorderedMap<uint32_t, uint32_t> Locators;
+			};
+
+			uint32_t AllocRdata(uint32_t Size, uint32_t Align);
+			uint32_t GetTypeRVA(const char* RawName);
+			uintptr_t WriteVTable(uint32_t LocatorRVA, uint32_t FunctionCount, uint32_t RdataOffset);
+
+			uint8_t* _image;
+			uint32_t _imageSize;
+			uint32_t _codeRVA, _codeSize;
+			uint32_t _rdataRVA, _rdataSize, _rdataUsed;
+			uint32_t _dataRVA, _dataSize, _dataUsed;
+			uint32_t _seed;
+			UnorderedMap<String, uint32_t> _types;
+			UnorderedMap<String, Class> _classes;
+			Array<VTable> _vtables;
+		};
+
+		// Count классов и структур, часть в пространствах имён, с одиночным и множественным наследованием
+		// от уже добавленных. Возвращает их искажённые имена.
+		Array<String> AddGeneratedClasses(RttiImage& Image, uint32_t Count, uint32_t Seed);
+
+		// Сколько раз вызывалась замена __RTDynamicCast из RttiImage.cpp. Она ищет целевой тип в массиве
+		// баз полного объекта и возвращает указатель со смещением PMD.mdisp, виртуальные базы не поддерживаются.
+		uint64_t GetRTDynamicCastCalls();
+
+		// Полное имя типа "class A::B" по ".?AVB@A@@", как у __unDNameEx с флагами MSRTTI (только простые имена)
+		String DemangleRawName(const char* RawName);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Замена Common.h для сборки тестов под Linux. Подключается принудительно (-include),
+// как и Common.h в проекте, и даёт проверяемым исходникам то же окружение: Win32 (Shim/Windows.h),
+// заменители VoltekLib, concurrency и mINI (Shim/ini.h), Types.h, Core/CoreCommon.h, Utils.h, Core/Relocator.h,
+// Core/INIWrapper.h и функции журнала.
+
+#include "Windows.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <memory.h>
+#include <ctype.h>
+#include <strings.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <version>
+#include <vector>
+#include <list>
+#include <execution>
+#include <chrono>
+#include <array>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <initializer_list>
+
+#include <tbb/concurrent_vector.h>
+#include <tbb/concurrent_unordered_map.h>
+
+namespace concurrency
+{
+	template<typename _Ty, typename _Alloc = std::allocator<_Ty>>
+	using concurrent_vector = tbb::concurrent_vector<_Ty, _Alloc>;
+
+	template<typename _kTy, typename _Ty, typename _Hasher = std::hash<_kTy>, typename _Equal = std::equal_to<_kTy>,
+		typename _Alloc = std::allocator<std::pair<const _kTy, _Ty>>>
+	using concurrent_unordered_map = tbb::concurrent_unordered_map<_kTy, _Ty, _Hasher, _Equal, _Alloc>;
+}
+
+// VoltekLib: тесты проверяют код платформы, а не распределитель, поэтому используется системный
+namespace voltek
+{
+	template<typename _Ty>
+	using allocator = std::allocator<_Ty>;
+
+	void scalable_memory_manager_initialize();
+	void* scalable_alloc(size_t size);
+	void* scalable_realloc(void* ptr, size_t size);
+	void scalable_free(void* ptr);
+	size_t scalable_msize(void* ptr);
+
+	// Запись в код через VirtualProtect, как в VoltekLib (Shim/Detours.cpp)
+	void detours_patch_memory(uintptr_t target, const uint8_t* data, size_t size);
+	void detours_patch_memory(uintptr_t target, std::initializer_list<uint8_t> data);
+	void detours_patch_memory_unsafe(uintptr_t target, const uint8_t* data, size_t size);
+	void detours_patch_memory_unsafe(uintptr_t target, std::initializer_list<uint8_t> data);
+	void detours_patch_memory_nop(uintptr_t target, size_t size);
+	void detours_patch_memory_nop_unsafe(uintptr_t target, size_t size);
+	uintptr_t detours_jump(uintptr_t target, uintptr_t function);
+	uintptr_t detours_call(uintptr_t target, uintptr_t function);
+	// Таблицы импорта у тестов нет, вызов ничего не меняет (Shim/Detours.cpp)
+	uintptr_t detours_patch_iat(uintptr_t module, const char* import_module, const char* import_name, uintptr_t function);
+	DWORD detours_unlock_protected(uintptr_t target, size_t size);
+	void detours_lock_protected(uintptr_t target, size_t size, DWORD flag);
+}
+
+#include "../../Crc32.h"
+#include "ini.h"
+#include "../../Types.h"
+#include "../../Core/CoreCommon.h"
+#include "../../Utils.h"
+#include "../../Core/Relocator.h"
+#include "../../Core/INIWrapper.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		class DebugLog;
+	}
+
+	// Журнал пишется в stderr, _FATALERROR завершает тест
+	void _FATALERROR(const char* fmt, ...);
+	void _ERROR(const char* fmt, ...);
+	void _WARNING(const char* fmt, ...);
+	void _MESSAGE(const char* fmt, ...);
+	void _CONSOLE(const char* fmt, ...);
+	void _CONSOLEVA(const char* fmt, va_list va);
+}
+
+// Свойства MSVC места в объекте не занимают, здесь поле уходит в статические, чтобы размеры классов совпали
+#define PROPERTY(read_func, write_func)	static inline
+#define READ_PROPERTY(read_func)		static inline
+#define Assert(Cond)					if(!(Cond)) CreationKitPlatformExtended::Utils::__Assert(__FILE__, __LINE__, #Cond);
+#define AssertMsgVa(Cond, Msg, ...)		if(!(Cond)) CreationKitPlatformExtended::Utils::__Assert(__FILE__, __LINE__, "%s\n\n" Msg, #Cond, ##__VA_ARGS__);
+#define AssertMsg(Cond, Msg)			AssertMsgVa(Cond, Msg)
+
+#define DECLARE_CONSTRUCTOR_HOOK(Class) \
+	static Class *__ctor__(void *Instance) \
+	{ \
+		return new (Instance) Class(); \
+	} \
+	\
+	static Class *__dtor__(Class *Thisptr, unsigned __int8) \
+	{ \
+		Thisptr->~Class(); \
+		return Thisptr; \
+	}
\ No newline at end of file
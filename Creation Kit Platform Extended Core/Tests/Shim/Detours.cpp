@@ -0,0 +1,92 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Замена функций записи в код из VoltekLib. Защищённые варианты, как и оригинал, снимают защиту
+// страниц на время каждой записи, _unsafe пишут сразу. Перехваты пишут только jmp/call rel32,
+// трамплинов нет, поэтому адрес функции должен быть в пределах 2 ГБ от места перехвата.
+
+#include "TestEngine.h"
+
+namespace voltek
+{
+	static void WriteProtected(uintptr_t target, const void* data, int fill, size_t size)
+	{
+		DWORD OldFlag = 0;
+		VirtualProtect((LPVOID)target, size, PAGE_EXECUTE_READWRITE, &OldFlag);
+		if (data)
+			memcpy((void*)target, data, size);
+		else
+			memset((void*)target, fill, size);
+		VirtualProtect((LPVOID)target, size, OldFlag, &OldFlag);
+		FlushInstructionCache(GetCurrentProcess(), (LPCVOID)target, size);
+	}
+
+	void detours_patch_memory(uintptr_t target, const uint8_t* data, size_t size)
+	{
+		WriteProtected(target, data, 0, size);
+	}
+
+	void detours_patch_memory(uintptr_t target, std::initializer_list<uint8_t> data)
+	{
+		WriteProtected(target, data.begin(), 0, data.size());
+	}
+
+	void detours_patch_memory_unsafe(uintptr_t target, const uint8_t* data, size_t size)
+	{
+		memcpy((void*)target, data, size);
+	}
+
+	void detours_patch_memory_unsafe(uintptr_t target, std::initializer_list<uint8_t> data)
+	{
+		memcpy((void*)target, data.begin(), data.size());
+	}
+
+	void detours_patch_memory_nop(uintptr_t target, size_t size)
+	{
+		WriteProtected(target, nullptr, 0x90, size);
+	}
+
+	void detours_patch_memory_nop_unsafe(uintptr_t target, size_t size)
+	{
+		memset((void*)target, 0x90, size);
+	}
+
+	static uintptr_t WriteBranch(uint8_t opcode, uintptr_t target, uintptr_t function)
+	{
+		uint8_t Code[5] = { opcode };
+		auto RelOff = (int32_t)(function - (target + 5));
+		memcpy(Code + 1, &RelOff, sizeof(RelOff));
+		WriteProtected(target, Code, 0, sizeof(Code));
+		return target;
+	}
+
+	uintptr_t detours_jump(uintptr_t target, uintptr_t function)
+	{
+		return WriteBranch(0xE9, target, function);
+	}
+
+	uintptr_t detours_call(uintptr_t target, uintptr_t function)
+	{
+		return WriteBranch(0xE8, target, function);
+	}
+
+	uintptr_t detours_patch_iat(uintptr_t, const char*, const char*, uintptr_t)
+	{
+		return 0;
+	}
+
+	DWORD detours_unlock_protected(uintptr_t target, size_t size)
+	{
+		DWORD OldFlag = 0;
+		VirtualProtect((LPVOID)target, size, PAGE_EXECUTE_READWRITE, &OldFlag);
+		return OldFlag;
+	}
+
+	void detours_lock_protected(uintptr_t target, size_t size, DWORD flag)
+	{
+		DWORD OldFlag = 0;
+		VirtualProtect((LPVOID)target, size, flag, &OldFlag);
+		FlushInstructionCache(GetCurrentProcess(), (LPCVOID)target, size);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,322 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Тестовая реализация Engine и служебных функций ядра, которые в проекте живут в Engine.cpp, Module.cpp,
+// DebugLog.cpp, ConsoleWindow.cpp, INIWrapper.cpp, StringUtil.cpp и Utils.cpp и зависят от самого редактора
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include "TestEngine.h"
+#include "../../Core/ConsoleWindow.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Core
+	{
+		Engine* GlobalEnginePtr = nullptr;
+
+		Engine::Engine(HMODULE hModule, EDITOR_EXECUTABLE_TYPE eEditorVersion, uintptr_t nModuleBase,
+			uint32_t nExecutableCRC32) : _moduleBase(nModuleBase), _executableCRC32(nExecutableCRC32),
+			_editorVersion(eEditorVersion), _module(hModule), PatchesManager(nullptr), UserPluginsManager(nullptr),
+			_Theme(nullptr), _ClassicTheme(nullptr)
+		{
+			auto& Config = Tests::GetEngineConfig();
+			_moduleSize = Config.ModuleSize;
+			_hasAVX2 = Config.HasAVX2;
+			_hasSSE41 = Config.HasSSE41;
+			_hasAVX512 = Config.HasAVX512;
+			_hasCommandRun = false;
+			memcpy(Sections, Config.Sections, sizeof(Sections));
+			_OsVersion = { 10, 0, 19045 };
+			_hyperThreads = false;
+			_threads = Config.LogicalCores;
+			_logicalCores = Config.LogicalCores;
+			_physicalCores = Config.LogicalCores;
+		}
+
+		uintptr_t Engine::GetModuleBase() const { return _moduleBase; }
+		uint64_t Engine::GetModuleSize() const { return _moduleSize; }
+		EDITOR_EXECUTABLE_TYPE Engine::GetEditorVersion() const { return _editorVersion; }
+		bool Engine::HasAVX2() const { return _hasAVX2; }
+		bool Engine::HasSSE41() const { return _hasSSE41; }
+		bool Engine::HasCommandRun() const { return _hasCommandRun; }
+		Section Engine::GetSection(uint32_t nIndex) const { return Sections[nIndex]; }
+		OsVersion Engine::GetSystemVersion() const { return _OsVersion; }
+		bool Engine::HasPatch(const char*) const { return false; }
+		bool Engine::HasPlugin(const char*) const { return false; }
+		bool Engine::HasHyperThreads() const noexcept { return _hyperThreads; }
+		unsigned char Engine::GetTotalThreadsProcessor() const noexcept { return _threads; }
+		unsigned char Engine::GetTotalLogicalCores() const noexcept { return _logicalCores; }
+		unsigned char Engine::GetTotalPhysicalCores() const noexcept { return _physicalCores; }
+
+		// INIConfig: только чтение строк, путь относительно текущей папки, как у редактора в папке игры
+		INIConfig* GlobalINIConfigPtr = nullptr;
+
+		INIConfig::INIConfig() {}
+
+		INIConfig::INIConfig(const char* filename) : INIConfig()
+		{
+			Open(filename);
+		}
+
+		void INIConfig::Open(const char* filename)
+		{
+			OpenFile(filename);
+		}
+
+		String INIConfig::ReadString(const char* section, const char* option, const char* def)
+		{
+			if (_iniFile->has(section))
+			{
+				auto sec = _iniFile->get(section);
+				if (sec.has(option))
+					return sec.get(option).c_str();
+			}
+
+			return def;
+		}
+
+		void INIConfig::OpenFile(const char* filename)
+		{
+			_iniFile = MakeSmartPointer<mINI::INIStructure>();
+			mINI::INIFile fileIni(filename);
+			fileIni.read(**_iniFile);
+		}
+	}
+
+	namespace Tests
+	{
+		static String ApplicationPath = "./";
+
+		EngineConfig& GetEngineConfig()
+		{
+			static EngineConfig Config = { 0, 0, {}, Core::EDITOR_SKYRIM_SE_1_6_1130, 0x1234ABCDul,
+				(bool)__builtin_cpu_supports("avx2"), (bool)__builtin_cpu_supports("sse4.1"),
+				(bool)__builtin_cpu_supports("avx512bw"), (unsigned char)std::max(1u, std::thread::hardware_concurrency()) };
+			return Config;
+		}
+
+		Core::Engine* CreateEngine()
+		{
+			DestroyEngine();
+
+			auto& Config = GetEngineConfig();
+			Core::GlobalEnginePtr = new Core::Engine((HMODULE)Config.ModuleBase, Config.EditorVersion, Config.ModuleBase,
+				Config.ExecutableCRC32);
+			return Core::GlobalEnginePtr;
+		}
+
+		void DestroyEngine()
+		{
+			delete Core::GlobalEnginePtr;
+			Core::GlobalEnginePtr = nullptr;
+		}
+
+		void SetApplicationPath(const char* path)
+		{
+			ApplicationPath = path;
+			if (!ApplicationPath.empty() && (ApplicationPath.back() != '/'))
+				ApplicationPath.push_back('/');
+		}
+
+		TempDirectory::TempDirectory()
+		{
+			char Template[] = "/tmp/ckpe-test-XXXXXX";
+			if (!mkdtemp(Template))
+				abort();
+			_path = Template;
+		}
+
+		TempDirectory::~TempDirectory()
+		{
+			std::error_code Error;
+			std::filesystem::remove_all(_path.c_str(), Error);
+		}
+
+		String TempDirectory::File(const char* name) const
+		{
+			return _path + "/" + name;
+		}
+	}
+
+	namespace Conversion
+	{
+		WideString Utf8ToUtf16(const String& str)
+		{
+			// wchar_t под Linux 32-битный, поэтому суррогатные пары не нужны
+			WideString Result;
+			for (size_t i = 0; i < str.length();)
+			{
+				auto Byte = (uint8_t)str[i];
+				auto Length = (Byte < 0x80) ? 1 : (Byte < 0xE0) ? 2 : (Byte < 0xF0) ? 3 : 4;
+				uint32_t Code = (Length == 1) ? Byte : (Byte & (0x7F >> Length));
+				for (int j = 1; (j < Length) && ((i + j) < str.length()); j++)
+					Code = (Code << 6) | ((uint8_t)str[i + j] & 0x3F);
+				Result.push_back((wchar_t)Code);
+				i += Length;
+			}
+			return Result;
+		}
+
+		// ANSI в тестах - это Latin-1, символы вне него заменяются на '?'
+		String WideToAnsi(const WideString& str)
+		{
+			String Result;
+			Result.reserve(str.length());
+			for (auto Char : str)
+				Result.push_back(((uint32_t)Char < 0x100) ? (char)Char : '?');
+			return Result;
+		}
+
+		WideString AnsiToWide(const String& str)
+		{
+			WideString Result;
+			Result.reserve(str.length());
+			for (auto Char : str)
+				Result.push_back((wchar_t)(uint8_t)Char);
+			return Result;
+		}
+	}
+
+	namespace Utils
+	{
+		void __Assert(LPCSTR File, int Line, LPCSTR Format, ...)
+		{
+			va_list Args;
+			va_start(Args, Format);
+			fprintf(stderr, "Assertion failed %s(%d): ", File, Line);
+			vfprintf(stderr, Format, Args);
+			fputc('\n', stderr);
+			va_end(Args);
+			abort();
+		}
+
+		String GetApplicationPath()
+		{
+			return Tests::ApplicationPath;
+		}
+	}
+
+	static void LogVa(const char* level, const char* fmt, va_list args)
+	{
+		if (!getenv("CKPE_TEST_LOG"))
+			return;
+
+		fputs(level, stderr);
+		vfprintf(stderr, fmt, args);
+		fputc('\n', stderr);
+	}
+
+	void _FATALERROR(const char* fmt, ...)
+	{
+		va_list Args;
+		va_start(Args, fmt);
+		vfprintf(stderr, fmt, Args);
+		fputc('\n', stderr);
+		va_end(Args);
+		abort();
+	}
+
+	void _ERROR(const char* fmt, ...)
+	{
+		va_list Args;
+		va_start(Args, fmt);
+		LogVa("[ERROR] ", fmt, Args);
+		va_end(Args);
+	}
+
+	void _WARNING(const char* fmt, ...)
+	{
+		va_list Args;
+		va_start(Args, fmt);
+		LogVa("[WARNING] ", fmt, Args);
+		va_end(Args);
+	}
+
+	void _MESSAGE(const char* fmt, ...)
+	{
+		va_list Args;
+		va_start(Args, fmt);
+		LogVa("", fmt, Args);
+		va_end(Args);
+	}
+
+	void _CONSOLE(const char* fmt, ...)
+	{
+		va_list Args;
+		va_start(Args, fmt);
+		LogVa("[CONSOLE] ", fmt, Args);
+		va_end(Args);
+	}
+
+	void _CONSOLEVA(const char* fmt, va_list va)
+	{
+		LogVa("[CONSOLE] ", fmt, va);
+	}
+
+	namespace Core
+	{
+		// Модули в тестах создаются напрямую, без менеджера патчей
+		Module::Module(Engine* lpEngine) : _engine(lpEngine), _relocator(nullptr),
+			_relocationDatabaseItem(nullptr), _Active(false)
+		{}
+
+		Module::~Module()
+		{}
+	}
+
+	namespace Core
+	{
+		// Окна консоли нет, сообщения идут в журнал теста
+		ConsoleWindow* GlobalConsoleWindowPtr = nullptr;
+
+		ConsoleWindow::ConsoleWindow(Engine* lpEngine) : hWindow(nullptr), HashLastMsg(0), _engine(lpEngine),
+			_richEditHwnd(nullptr), _autoScroll(true), _outputFileHandle(nullptr), _ExternalPipeWriterHandle(nullptr),
+			_ExternalPipeReaderHandle(nullptr)
+		{}
+
+		ConsoleWindow::~ConsoleWindow()
+		{}
+
+		void ConsoleWindow::InputLog(const char* Format, ...)
+		{
+			va_list Args;
+			va_start(Args, Format);
+			InputLogVa(Format, Args);
+			va_end(Args);
+		}
+
+		void ConsoleWindow::InputLogVa(const char* Format, va_list Va)
+		{
+			LogVa("[CONSOLE] ", Format, Va);
+		}
+	}
+}
+
+namespace voltek
+{
+	void scalable_memory_manager_initialize()
+	{}
+
+	void* scalable_alloc(size_t size)
+	{
+		return malloc(size);
+	}
+
+	void* scalable_realloc(void* ptr, size_t size)
+	{
+		return realloc(ptr, size);
+	}
+
+	void scalable_free(void* ptr)
+	{
+		free(ptr);
+	}
+
+	size_t scalable_msize(void* ptr)
+	{
+		return malloc_usable_size(ptr);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+#include "../../Core/Engine.h"
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		// Параметры, которые тестовый Engine (Shim/Engine.cpp) возвращает вместо данных редактора
+		struct EngineConfig
+		{
+			uintptr_t ModuleBase;
+			uint64_t ModuleSize;
+			Core::Section Sections[3];
+			Core::EDITOR_EXECUTABLE_TYPE EditorVersion;
+			uint32_t ExecutableCRC32;
+			bool HasAVX2;
+			bool HasSSE41;
+			bool HasAVX512;
+			unsigned char LogicalCores;
+		};
+
+		EngineConfig& GetEngineConfig();
+
+		// Создаёт Engine по текущей конфигурации и делает его глобальным (GlobalEnginePtr)
+		Core::Engine* CreateEngine();
+		void DestroyEngine();
+
+		// Каталог, который возвращает Utils::GetApplicationPath() (с завершающим '/')
+		void SetApplicationPath(const char* path);
+
+		// Число вызовов VirtualProtect и FlushInstructionCache (Shim/Windows.cpp) с начала процесса
+		uint64_t GetVirtualProtectCount();
+		uint64_t GetFlushInstructionCacheCount();
+
+		// Задержка ReadFile, как у холодного диска: первое чтение блока 64 КБ файла ждёт microseconds (0 - без
+		// задержки). Прочитанные блоки помнятся для всех дескрипторов файла, пока их не сбросит DropReadCache.
+		// GetReadMissCount - число блоков, прочитанных с задержкой с начала процесса
+		void SetReadLatency(uint32_t microseconds);
+		void DropReadCache();
+		uint64_t GetReadMissCount();
+
+		// Резидентный размер процесса в байтах (/proc/self/statm)
+		size_t GetResidentSize();
+
+		// Уникальный временный каталог теста, удаляется вместе с содержимым
+		class TempDirectory
+		{
+		public:
+			TempDirectory();
+			~TempDirectory();
+
+			inline const String& Path() const { return _path; }
+			String File(const char* name) const;
+		private:
+			TempDirectory(const TempDirectory&) = delete;
+			TempDirectory& operator=(const TempDirectory&) = delete;
+
+			String _path;
+		};
+	}
+}
\ No newline at end of file
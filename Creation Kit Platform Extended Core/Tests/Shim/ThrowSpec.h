@@ -0,0 +1,10 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// DynamicCast.cpp объявляет __RTDynamicCast со спецификацией MSVC throw(...), которую C++20 не принимает.
+// Подключается принудительно только к этому файлу, после Common.h.
+
+#define throw(...)
\ No newline at end of file
@@ -0,0 +1,13 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Замена заголовка VoltekLib: тестам, подключающим Core/RelocationDatabase.h, базы VoltekLib не нужны,
+// достаточно объявлений типов
+namespace voltek
+{
+	struct reldb_stream;
+	struct reldb_patch;
+}
\ No newline at end of file
@@ -0,0 +1,1722 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <condition_variable>
+#include <tuple>
+
+#include "TestEngine.h"
+
+namespace
+{
+	thread_local DWORD LastError = ERROR_SUCCESS;
+
+	enum HandleKind
+	{
+		kFile,
+		kMapping,
+		kThread,
+		kEvent,
+		kFind,
+		kChange,
+	};
+
+	struct ShimHandle
+	{
+		HandleKind Kind;
+
+		ShimHandle(HandleKind kind) : Kind(kind) {}
+		virtual ~ShimHandle() = default;
+	};
+
+	struct FileHandle : ShimHandle
+	{
+		int Descriptor;
+
+		FileHandle(int fd) : ShimHandle(kFile), Descriptor(fd) {}
+		~FileHandle() { close(Descriptor); }
+	};
+
+	struct MappingHandle : ShimHandle
+	{
+		int Descriptor;
+		uint64_t Size;
+		bool Writable;
+
+		MappingHandle(int fd, uint64_t size, bool writable) : ShimHandle(kMapping), Descriptor(dup(fd)),
+			Size(size), Writable(writable) {}
+		~MappingHandle() { close(Descriptor); }
+	};
+
+	struct EventHandle : ShimHandle
+	{
+		std::mutex Lock;
+		std::condition_variable Signal;
+		bool ManualReset;
+		bool State;
+
+		EventHandle(bool manualReset, bool state) : ShimHandle(kEvent), ManualReset(manualReset), State(state) {}
+
+		bool Wait(DWORD ms)
+		{
+			std::unique_lock<std::mutex> Guard(Lock);
+			auto Ready = [this] { return State; };
+			if (ms == INFINITE)
+				Signal.wait(Guard, Ready);
+			else if (!Signal.wait_for(Guard, std::chrono::milliseconds(ms), Ready))
+				return false;
+			if (!ManualReset)
+				State = false;
+			return true;
+		}
+	};
+
+	struct ThreadState
+	{
+		std::mutex StartLock;
+		std::condition_variable StartSignal;
+		bool Started;
+		EventHandle Done;
+
+		ThreadState(bool started) : Started(started), Done(true, false) {}
+	};
+
+	// Состояние потока разделяется с самим потоком: описатель можно закрыть сразу после создания
+	struct ThreadHandle : ShimHandle
+	{
+		std::thread Thread;
+		std::shared_ptr<ThreadState> State;
+
+		ThreadHandle(bool started) : ShimHandle(kThread), State(std::make_shared<ThreadState>(started)) {}
+		~ThreadHandle()
+		{
+			if (Thread.joinable())
+				Thread.detach();
+		}
+	};
+
+	struct FindHandle : ShimHandle
+	{
+		std::vector<std::string> Names;
+		std::string Directory;
+		size_t Next;
+
+		FindHandle() : ShimHandle(kFind), Next(0) {}
+	};
+
+	// Уведомление об изменениях в папке поверх inotify. Как и в Windows, объект остаётся сигнальным, пока
+	// не вызван FindNextChangeNotification. inotify не следит за подпапками сам, поэтому они добавляются
+	// по одной, в том числе появившиеся позже
+	struct ChangeHandle : ShimHandle
+	{
+		int Descriptor;
+		uint32_t Mask;
+		bool Subtree;
+		std::unordered_map<int, std::string> Paths;
+
+		ChangeHandle(uint32_t mask, bool subtree) : ShimHandle(kChange),
+			Descriptor(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), Mask(mask), Subtree(subtree) {}
+		~ChangeHandle() { if (Descriptor >= 0) close(Descriptor); }
+
+		bool Add(const std::string& path)
+		{
+			auto Watch = inotify_add_watch(Descriptor, path.c_str(), Mask | (Subtree ? IN_CREATE | IN_MOVED_TO : 0));
+			if (Watch < 0)
+				return false;
+			Paths[Watch] = path;
+			return true;
+		}
+
+		bool Watch(const std::string& path)
+		{
+			if (!Add(path))
+				return false;
+
+			if (Subtree)
+			{
+				std::error_code Error;
+				for (auto It = std::filesystem::recursive_directory_iterator(path, Error);
+					!Error && (It != std::filesystem::recursive_directory_iterator()); It.increment(Error))
+				{
+					if (It->is_directory(Error) && !It->is_symlink(Error))
+						Add(It->path().string());
+				}
+			}
+
+			return true;
+		}
+
+		bool Wait(DWORD ms)
+		{
+			pollfd Poll = { Descriptor, POLLIN, 0 };
+			return poll(&Poll, 1, (ms == INFINITE) ? -1 : (int)ms) > 0;
+		}
+	};
+
+	template<typename T>
+	T* Cast(HANDLE h, HandleKind kind)
+	{
+		if (!h || (h == INVALID_HANDLE_VALUE) || (((ShimHandle*)h)->Kind != kind))
+		{
+			LastError = ERROR_INVALID_HANDLE;
+			return nullptr;
+		}
+		return (T*)h;
+	}
+
+	DWORD FromErrno(int error)
+	{
+		switch (error)
+		{
+		case 0: return ERROR_SUCCESS;
+		case ENOENT: return ERROR_FILE_NOT_FOUND;
+		case ENOTDIR: return ERROR_PATH_NOT_FOUND;
+		case EACCES:
+		case EPERM: return ERROR_ACCESS_DENIED;
+		case EEXIST: return ERROR_ALREADY_EXISTS;
+		case ENOMEM: return ERROR_NOT_ENOUGH_MEMORY;
+		case EBADF: return ERROR_INVALID_HANDLE;
+		default: return ERROR_INVALID_PARAMETER;
+		}
+	}
+
+	BOOL Fail()
+	{
+		LastError = FromErrno(errno);
+		return FALSE;
+	}
+
+	// Пути Windows приводятся к POSIX: разделители и "C:" не поддерживаются, только относительные
+	// и абсолютные пути тестов
+	std::string NativePath(LPCSTR path)
+	{
+		std::string Result(path ? path : "");
+		std::replace(Result.begin(), Result.end(), '\\', '/');
+		return Result;
+	}
+
+	std::string NativePath(LPCWSTR path)
+	{
+		std::string Result;
+		for (; path && *path; path++)
+		{
+			auto Code = (uint32_t)*path;
+			if (Code < 0x80)
+				Result.push_back((char)Code);
+			else if (Code < 0x800)
+			{
+				Result.push_back((char)(0xC0 | (Code >> 6)));
+				Result.push_back((char)(0x80 | (Code & 0x3F)));
+			}
+			else if (Code < 0x10000)
+			{
+				Result.push_back((char)(0xE0 | (Code >> 12)));
+				Result.push_back((char)(0x80 | ((Code >> 6) & 0x3F)));
+				Result.push_back((char)(0x80 | (Code & 0x3F)));
+			}
+			else
+			{
+				Result.push_back((char)(0xF0 | (Code >> 18)));
+				Result.push_back((char)(0x80 | ((Code >> 12) & 0x3F)));
+				Result.push_back((char)(0x80 | ((Code >> 6) & 0x3F)));
+				Result.push_back((char)(0x80 | (Code & 0x3F)));
+			}
+		}
+		return NativePath(Result.c_str());
+	}
+
+	void ToWide(const std::string& src, WCHAR* dst, size_t count)
+	{
+		size_t i = 0;
+		for (auto it = src.begin(); (it != src.end()) && (i + 1 < count); it++)
+			dst[i++] = (WCHAR)(uint8_t)*it;
+		dst[i] = 0;
+	}
+
+	FILETIME ToFileTime(const struct timespec& time)
+	{
+		auto Ticks = ((uint64_t)time.tv_sec + 11644473600ull) * 10000000ull + (uint64_t)time.tv_nsec / 100;
+		return { (DWORD)Ticks, (DWORD)(Ticks >> 32) };
+	}
+
+	DWORD ToAttributes(const struct stat& st)
+	{
+		return S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+	}
+
+	HANDLE OpenFile(const std::string& path, DWORD access, DWORD disposition)
+	{
+		int Flags = O_CLOEXEC;
+		if ((access & GENERIC_READ) && (access & GENERIC_WRITE))
+			Flags |= O_RDWR;
+		else if (access & GENERIC_WRITE)
+			Flags |= O_WRONLY;
+		else
+			Flags |= O_RDONLY;
+
+		switch (disposition)
+		{
+		case CREATE_NEW: Flags |= O_CREAT | O_EXCL; break;
+		case CREATE_ALWAYS: Flags |= O_CREAT | O_TRUNC; break;
+		case OPEN_ALWAYS: Flags |= O_CREAT; break;
+		case TRUNCATE_EXISTING: Flags |= O_TRUNC; break;
+		default: break;
+		}
+
+		int fd = open(path.c_str(), Flags, 0644);
+		if (fd < 0)
+		{
+			Fail();
+			return INVALID_HANDLE_VALUE;
+		}
+
+		struct stat st;
+		if (!fstat(fd, &st) && S_ISDIR(st.st_mode))
+		{
+			close(fd);
+			LastError = ERROR_ACCESS_DENIED;
+			return INVALID_HANDLE_VALUE;
+		}
+
+		LastError = ERROR_SUCCESS;
+		return new FileHandle(fd);
+	}
+
+	BOOL GetAttributes(const std::string& path, WIN32_FILE_ATTRIBUTE_DATA* data)
+	{
+		// Ссылка, как в Windows, помечается FILE_ATTRIBUTE_REPARSE_POINT, остальное берётся у цели
+		struct stat st;
+		if (lstat(path.c_str(), &st))
+			return Fail();
+		auto Link = S_ISLNK(st.st_mode);
+		if (Link && stat(path.c_str(), &st))
+			return Fail();
+
+		data->dwFileAttributes = ToAttributes(st) | (Link ? FILE_ATTRIBUTE_REPARSE_POINT : 0);
+		data->ftCreationTime = ToFileTime(st.st_ctim);
+		data->ftLastAccessTime = ToFileTime(st.st_atim);
+		data->ftLastWriteTime = ToFileTime(st.st_mtim);
+		data->nFileSizeHigh = (DWORD)((uint64_t)st.st_size >> 32);
+		data->nFileSizeLow = (DWORD)st.st_size;
+		return TRUE;
+	}
+
+	FindHandle* OpenFind(const std::string& pattern)
+	{
+		auto Separator = pattern.find_last_of('/');
+		auto Directory = (Separator == std::string::npos) ? std::string(".") : pattern.substr(0, Separator);
+		auto Mask = (Separator == std::string::npos) ? pattern : pattern.substr(Separator + 1);
+
+		auto Dir = opendir(Directory.c_str());
+		if (!Dir)
+		{
+			Fail();
+			return nullptr;
+		}
+
+		auto Find = new FindHandle;
+		Find->Directory = Directory;
+		while (auto Entry = readdir(Dir))
+		{
+			if (!fnmatch(Mask.c_str(), Entry->d_name, FNM_CASEFOLD))
+				Find->Names.push_back(Entry->d_name);
+		}
+		closedir(Dir);
+
+		std::sort(Find->Names.begin(), Find->Names.end());
+		if (Find->Names.empty())
+		{
+			delete Find;
+			LastError = ERROR_FILE_NOT_FOUND;
+			return nullptr;
+		}
+		return Find;
+	}
+
+	template<typename T>
+	bool NextFind(FindHandle* find, T* data, void (*copyName)(const std::string&, T*))
+	{
+		while (find->Next < find->Names.size())
+		{
+			auto& Name = find->Names[find->Next++];
+			WIN32_FILE_ATTRIBUTE_DATA Attributes;
+			if (!GetAttributes(find->Directory + "/" + Name, &Attributes))
+				continue;
+
+			data->dwFileAttributes = Attributes.dwFileAttributes;
+			data->ftCreationTime = Attributes.ftCreationTime;
+			data->ftLastAccessTime = Attributes.ftLastAccessTime;
+			data->ftLastWriteTime = Attributes.ftLastWriteTime;
+			data->nFileSizeHigh = Attributes.nFileSizeHigh;
+			data->nFileSizeLow = Attributes.nFileSizeLow;
+			copyName(Name, data);
+			return true;
+		}
+
+		LastError = 18; // ERROR_NO_MORE_FILES
+		return false;
+	}
+
+	// Слова ожидания WaitOnAddress: адрес отображается на счётчик, изменение которого и ждёт futex.
+	// Так пробуждение не теряется при ожидании значения любого размера.
+	constexpr size_t PARKING_SLOTS = 256;
+	std::atomic<uint32_t> ParkingSlots[PARKING_SLOTS];
+
+	std::atomic<uint32_t>& ParkingSlot(const volatile void* address)
+	{
+		auto Key = (uintptr_t)address;
+		return ParkingSlots[((Key >> 3) ^ (Key >> 12)) % PARKING_SLOTS];
+	}
+
+	long Futex(volatile void* address, int op, uint32_t value, DWORD ms)
+	{
+		struct timespec Timeout = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+		return syscall(SYS_futex, (void*)address, op, value, (ms == INFINITE) ? nullptr : &Timeout, nullptr, 0);
+	}
+
+	// SRWLOCK: младшие 32 бита слова, бит 0 - владение на запись, бит 1 - есть ждущие,
+	// остальное - число читателей * 4. Освобождение без ждущих обходится без системного вызова.
+	constexpr uint32_t SRW_EXCLUSIVE = 1;
+	constexpr uint32_t SRW_WAITERS = 2;
+	constexpr uint32_t SRW_READER = 4;
+
+	void ParkSRWLock(std::atomic<uint32_t>* word, uint32_t state)
+	{
+		if (!(state & SRW_WAITERS) && !word->compare_exchange_weak(state, state | SRW_WAITERS, std::memory_order_relaxed))
+			return;
+		Futex(word, FUTEX_WAIT_PRIVATE, state | SRW_WAITERS, INFINITE);
+	}
+	std::atomic<uint32_t>* LockWord(PSRWLOCK lock)
+	{
+		return (std::atomic<uint32_t>*)&lock->Ptr;
+	}
+
+	std::atomic<uint32_t>* SequenceWord(PCONDITION_VARIABLE cv)
+	{
+		return (std::atomic<uint32_t>*)&cv->Ptr;
+	}
+
+	// Страницы, защиту которых менял VirtualProtect или VirtualAlloc
+	std::mutex ProtectionLock;
+	std::map<uintptr_t, DWORD> PageProtection;
+	std::map<uintptr_t, size_t> Reservations;
+	std::atomic<uint64_t> VirtualProtectCount;
+	std::atomic<uint64_t> FlushInstructionCacheCount;
+	std::mutex ViewLock;
+	std::map<uintptr_t, size_t> Views;
+
+	// Модель кеша страниц для задержки чтения (Tests::SetReadLatency): блок файла и время, когда его чтение
+	// завершится. Блок, который уже читает другой поток, ждёт того же времени, а не новой задержки
+	constexpr uint64_t ReadLatencyBlock = 64 * 1024;
+	std::mutex ReadCacheLock;
+	std::map<std::tuple<dev_t, ino_t, uint64_t>, std::chrono::steady_clock::time_point> ReadCache;
+	std::atomic<uint32_t> ReadLatency;
+	std::atomic<uint64_t> ReadMissCount;
+
+	// Один запрос ждёт одну задержку, сколько бы блоков в нём ни было, как одно обращение к диску
+	void DelayRead(int fd, uint64_t offset, uint64_t size)
+	{
+		auto Latency = ReadLatency.load();
+		struct stat st;
+		if (!Latency || !size || fstat(fd, &st) || (offset >= (uint64_t)st.st_size))
+			return;
+
+		size = std::min<uint64_t>(size, st.st_size - offset);
+		auto Now = std::chrono::steady_clock::now();
+		auto Ready = Now;
+
+		{
+			std::lock_guard Guard(ReadCacheLock);
+			for (auto Block = offset / ReadLatencyBlock; Block <= ((offset + size - 1) / ReadLatencyBlock); Block++)
+			{
+				auto [It, Inserted] = ReadCache.try_emplace({ st.st_dev, st.st_ino, Block },
+					Now + std::chrono::microseconds(Latency));
+				ReadMissCount += Inserted;
+				Ready = std::max(Ready, It->second);
+			}
+		}
+
+		std::this_thread::sleep_until(Ready);
+	}
+
+	int ToNativeProtect(DWORD protect)
+	{
+		switch (protect & 0xFF)
+		{
+		case PAGE_NOACCESS: return PROT_NONE;
+		case PAGE_READONLY: return PROT_READ;
+		case PAGE_READWRITE:
+		case PAGE_WRITECOPY: return PROT_READ | PROT_WRITE;
+		case PAGE_EXECUTE: return PROT_EXEC;
+		case PAGE_EXECUTE_READ: return PROT_READ | PROT_EXEC;
+		case PAGE_EXECUTE_READWRITE: return PROT_READ | PROT_WRITE | PROT_EXEC;
+		default: return PROT_READ | PROT_WRITE;
+		}
+	}
+
+	// Исходная защита страницы, которую не трогали через эти функции, берётся из /proc/self/maps
+	DWORD QueryProtect(uintptr_t page)
+	{
+		auto It = PageProtection.find(page);
+		if (It != PageProtection.end())
+			return It->second;
+
+		DWORD Result = PAGE_NOACCESS;
+		if (auto Maps = fopen("/proc/self/maps", "r"))
+		{
+			char Line[512];
+			while (fgets(Line, sizeof(Line), Maps))
+			{
+				unsigned long long Start, End;
+				char Perms[5] = { 0 };
+				if ((sscanf(Line, "%llx-%llx %4s", &Start, &End, Perms) != 3) || (page < Start) || (page >= End))
+					continue;
+
+				bool Read = Perms[0] == 'r', Write = Perms[1] == 'w', Exec = Perms[2] == 'x';
+				if (Exec)
+					Result = Write ? PAGE_EXECUTE_READWRITE : (Read ? PAGE_EXECUTE_READ : PAGE_EXECUTE);
+				else
+					Result = Write ? PAGE_READWRITE : (Read ? PAGE_READONLY : PAGE_NOACCESS);
+				break;
+			}
+			fclose(Maps);
+		}
+		return Result;
+	}
+
+	void SetProtect(uintptr_t start, size_t size, DWORD protect)
+	{
+		auto PageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+		start &= ~(PageSize - 1);
+
+		// Чтение-запись и отсутствие доступа однозначно читаются из /proc/self/maps, их не запоминаем.
+		// Иначе резерв арены (128 Гб) и её спаны заняли бы миллионы записей.
+		if ((protect == PAGE_READWRITE) || (protect == PAGE_NOACCESS))
+		{
+			PageProtection.erase(PageProtection.lower_bound(start), PageProtection.lower_bound(start + size));
+			return;
+		}
+
+		for (auto Page = start; Page < start + size; Page += PageSize)
+			PageProtection[Page] = protect;
+	}
+}
+
+HANDLE CreateFileA(LPCSTR lpFileName, DWORD dwDesiredAccess, DWORD, LPSECURITY_ATTRIBUTES,
+	DWORD dwCreationDisposition, DWORD, HANDLE)
+{
+	return OpenFile(NativePath(lpFileName), dwDesiredAccess, dwCreationDisposition);
+}
+
+HANDLE CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD, LPSECURITY_ATTRIBUTES,
+	DWORD dwCreationDisposition, DWORD, HANDLE)
+{
+	return OpenFile(NativePath(lpFileName), dwDesiredAccess, dwCreationDisposition);
+}
+
+BOOL ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead,
+	LPOVERLAPPED lpOverlapped)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	if (!File)
+		return FALSE;
+
+	DelayRead(File->Descriptor, lpOverlapped ? (((uint64_t)lpOverlapped->OffsetHigh << 32) | lpOverlapped->Offset) :
+		(uint64_t)lseek(File->Descriptor, 0, SEEK_CUR), nNumberOfBytesToRead);
+
+	ssize_t Total = 0;
+	while (Total < (ssize_t)nNumberOfBytesToRead)
+	{
+		ssize_t Result;
+		if (lpOverlapped)
+			Result = pread(File->Descriptor, (uint8_t*)lpBuffer + Total, nNumberOfBytesToRead - Total,
+				(off_t)(((uint64_t)lpOverlapped->OffsetHigh << 32) | lpOverlapped->Offset) + Total);
+		else
+			Result = read(File->Descriptor, (uint8_t*)lpBuffer + Total, nNumberOfBytesToRead - Total);
+
+		if (Result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return Fail();
+		}
+		if (!Result)
+			break;
+		Total += Result;
+	}
+
+	if (lpNumberOfBytesRead)
+		*lpNumberOfBytesRead = (DWORD)Total;
+	if (lpOverlapped)
+		lpOverlapped->InternalHigh = (ULONG_PTR)Total;
+	return TRUE;
+}
+
+BOOL WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten,
+	LPOVERLAPPED lpOverlapped)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	if (!File)
+		return FALSE;
+
+	ssize_t Total = 0;
+	while (Total < (ssize_t)nNumberOfBytesToWrite)
+	{
+		ssize_t Result;
+		if (lpOverlapped)
+			Result = pwrite(File->Descriptor, (const uint8_t*)lpBuffer + Total, nNumberOfBytesToWrite - Total,
+				(off_t)(((uint64_t)lpOverlapped->OffsetHigh << 32) | lpOverlapped->Offset) + Total);
+		else
+			Result = write(File->Descriptor, (const uint8_t*)lpBuffer + Total, nNumberOfBytesToWrite - Total);
+
+		if (Result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return Fail();
+		}
+		Total += Result;
+	}
+
+	if (lpNumberOfBytesWritten)
+		*lpNumberOfBytesWritten = (DWORD)Total;
+	return TRUE;
+}
+
+BOOL FlushFileBuffers(HANDLE hFile)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	return File && !fsync(File->Descriptor);
+}
+
+BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	struct stat st;
+	if (!File || fstat(File->Descriptor, &st))
+		return FALSE;
+	lpFileSize->QuadPart = st.st_size;
+	return TRUE;
+}
+
+DWORD GetFileSize(HANDLE hFile, LPDWORD lpFileSizeHigh)
+{
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(hFile, &Size))
+		return INVALID_FILE_SIZE;
+	if (lpFileSizeHigh)
+		*lpFileSizeHigh = (DWORD)Size.HighPart;
+	return Size.LowPart;
+}
+
+BOOL SetFilePointerEx(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer,
+	DWORD dwMoveMethod)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	if (!File)
+		return FALSE;
+
+	int Whence = (dwMoveMethod == FILE_END) ? SEEK_END : ((dwMoveMethod == FILE_CURRENT) ? SEEK_CUR : SEEK_SET);
+	auto Result = lseek(File->Descriptor, (off_t)liDistanceToMove.QuadPart, Whence);
+	if (Result < 0)
+		return Fail();
+	if (lpNewFilePointer)
+		lpNewFilePointer->QuadPart = Result;
+	return TRUE;
+}
+
+BOOL GetFileTime(HANDLE hFile, PFILETIME lpCreationTime, PFILETIME lpLastAccessTime, PFILETIME lpLastWriteTime)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	struct stat st;
+	if (!File || fstat(File->Descriptor, &st))
+		return FALSE;
+	if (lpCreationTime)
+		*lpCreationTime = ToFileTime(st.st_ctim);
+	if (lpLastAccessTime)
+		*lpLastAccessTime = ToFileTime(st.st_atim);
+	if (lpLastWriteTime)
+		*lpLastWriteTime = ToFileTime(st.st_mtim);
+	return TRUE;
+}
+
+BOOL GetFileAttributesExA(LPCSTR lpFileName, GET_FILEEX_INFO_LEVELS, LPVOID lpFileInformation)
+{
+	return GetAttributes(NativePath(lpFileName), (WIN32_FILE_ATTRIBUTE_DATA*)lpFileInformation);
+}
+
+BOOL GetFileAttributesExW(LPCWSTR lpFileName, GET_FILEEX_INFO_LEVELS, LPVOID lpFileInformation)
+{
+	return GetAttributes(NativePath(lpFileName), (WIN32_FILE_ATTRIBUTE_DATA*)lpFileInformation);
+}
+
+DWORD GetFileAttributesA(LPCSTR lpFileName)
+{
+	WIN32_FILE_ATTRIBUTE_DATA Data;
+	return GetAttributes(NativePath(lpFileName), &Data) ? Data.dwFileAttributes : INVALID_FILE_ATTRIBUTES;
+}
+
+DWORD GetFileAttributesW(LPCWSTR lpFileName)
+{
+	WIN32_FILE_ATTRIBUTE_DATA Data;
+	return GetAttributes(NativePath(lpFileName), &Data) ? Data.dwFileAttributes : INVALID_FILE_ATTRIBUTES;
+}
+
+BOOL MoveFileExA(LPCSTR lpExistingFileName, LPCSTR lpNewFileName, DWORD dwFlags)
+{
+	auto Target = NativePath(lpNewFileName);
+	struct stat st;
+	if (!(dwFlags & MOVEFILE_REPLACE_EXISTING) && !stat(Target.c_str(), &st))
+	{
+		LastError = ERROR_ALREADY_EXISTS;
+		return FALSE;
+	}
+	return rename(NativePath(lpExistingFileName).c_str(), Target.c_str()) ? Fail() : TRUE;
+}
+
+BOOL MoveFileExW(LPCWSTR lpExistingFileName, LPCWSTR lpNewFileName, DWORD dwFlags)
+{
+	return MoveFileExA(NativePath(lpExistingFileName).c_str(), NativePath(lpNewFileName).c_str(), dwFlags);
+}
+
+BOOL DeleteFileA(LPCSTR lpFileName)
+{
+	return unlink(NativePath(lpFileName).c_str()) ? Fail() : TRUE;
+}
+
+BOOL DeleteFileW(LPCWSTR lpFileName)
+{
+	return unlink(NativePath(lpFileName).c_str()) ? Fail() : TRUE;
+}
+
+BOOL CreateDirectoryA(LPCSTR lpPathName, LPSECURITY_ATTRIBUTES)
+{
+	return mkdir(NativePath(lpPathName).c_str(), 0755) ? Fail() : TRUE;
+}
+
+HANDLE FindFirstFileA(LPCSTR lpFileName, WIN32_FIND_DATAA* lpFindFileData)
+{
+	auto Find = OpenFind(NativePath(lpFileName));
+	if (!Find)
+		return INVALID_HANDLE_VALUE;
+	if (!FindNextFileA(Find, lpFindFileData))
+	{
+		delete Find;
+		return INVALID_HANDLE_VALUE;
+	}
+	return Find;
+}
+
+HANDLE FindFirstFileExA(LPCSTR lpFileName, FINDEX_INFO_LEVELS, LPVOID lpFindFileData, FINDEX_SEARCH_OPS, LPVOID, DWORD)
+{
+	return FindFirstFileA(lpFileName, (WIN32_FIND_DATAA*)lpFindFileData);
+}
+
+BOOL FindNextFileA(HANDLE hFindFile, WIN32_FIND_DATAA* lpFindFileData)
+{
+	auto Find = Cast<FindHandle>(hFindFile, kFind);
+	return Find && NextFind<WIN32_FIND_DATAA>(Find, lpFindFileData, [](const std::string& name, WIN32_FIND_DATAA* data) {
+		snprintf(data->cFileName, sizeof(data->cFileName), "%s", name.c_str());
+		data->cAlternateFileName[0] = 0;
+	});
+}
+
+HANDLE FindFirstFileW(LPCWSTR lpFileName, WIN32_FIND_DATAW* lpFindFileData)
+{
+	auto Find = OpenFind(NativePath(lpFileName));
+	if (!Find)
+		return INVALID_HANDLE_VALUE;
+	if (!FindNextFileW(Find, lpFindFileData))
+	{
+		delete Find;
+		return INVALID_HANDLE_VALUE;
+	}
+	return Find;
+}
+
+BOOL FindNextFileW(HANDLE hFindFile, WIN32_FIND_DATAW* lpFindFileData)
+{
+	auto Find = Cast<FindHandle>(hFindFile, kFind);
+	return Find && NextFind<WIN32_FIND_DATAW>(Find, lpFindFileData, [](const std::string& name, WIN32_FIND_DATAW* data) {
+		ToWide(name, data->cFileName, MAX_PATH);
+		data->cAlternateFileName[0] = 0;
+	});
+}
+
+BOOL FindClose(HANDLE hFindFile)
+{
+	auto Find = Cast<FindHandle>(hFindFile, kFind);
+	delete Find;
+	return Find != nullptr;
+}
+
+HANDLE FindFirstChangeNotificationA(LPCSTR lpPathName, BOOL bWatchSubtree, DWORD dwNotifyFilter)
+{
+	uint32_t Mask = 0;
+	if (dwNotifyFilter & (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME))
+		Mask |= IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+	if (dwNotifyFilter & (FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE))
+		Mask |= IN_MODIFY | IN_CLOSE_WRITE;
+
+	auto Change = new ChangeHandle(Mask, bWatchSubtree);
+	if ((Change->Descriptor < 0) || !Change->Watch(NativePath(lpPathName)))
+	{
+		Fail();
+		delete Change;
+		return INVALID_HANDLE_VALUE;
+	}
+	return Change;
+}
+
+BOOL FindNextChangeNotification(HANDLE hChangeHandle)
+{
+	auto Change = Cast<ChangeHandle>(hChangeHandle, kChange);
+	if (!Change)
+		return FALSE;
+
+	// Накопленные события сбрасываются, новые папки берутся под наблюдение
+	alignas(inotify_event) char Buffer[16384];
+	std::vector<std::string> Directories;
+	for (;;)
+	{
+		auto Size = read(Change->Descriptor, Buffer, sizeof(Buffer));
+		if (Size <= 0)
+			break;
+
+		for (auto Pos = Buffer; Pos < (Buffer + Size);)
+		{
+			auto Event = (const inotify_event*)Pos;
+			auto Parent = Change->Paths.find(Event->wd);
+			if (Change->Subtree && (Event->mask & IN_ISDIR) && (Event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+				Event->len && (Parent != Change->Paths.end()))
+				Directories.push_back(Parent->second + "/" + Event->name);
+			Pos += sizeof(inotify_event) + Event->len;
+		}
+	}
+
+	for (auto& Directory : Directories)
+		Change->Watch(Directory);
+	return TRUE;
+}
+
+BOOL FindCloseChangeNotification(HANDLE hChangeHandle)
+{
+	auto Change = Cast<ChangeHandle>(hChangeHandle, kChange);
+	delete Change;
+	return Change != nullptr;
+}
+
+DWORD GetFullPathNameA(LPCSTR lpFileName, DWORD nBufferLength, LPSTR lpBuffer, LPSTR* lpFilePart)
+{
+	// Разбор без обращения к диску, как в Windows: "." и ".." убираются, завершающий разделитель сохраняется.
+	// Разбор идёт в буфере на стеке, без выделения памяти на каждую часть пути
+	if (!lpFileName || !*lpFileName)
+	{
+		LastError = ERROR_INVALID_PARAMETER;
+		return 0;
+	}
+
+	char Path[8192];
+	size_t PathLength = 0;
+	auto Source = strlen(lpFileName);
+	if ((lpFileName[0] != '\\') && (lpFileName[0] != '/'))
+	{
+		if (!getcwd(Path, sizeof(Path) - 1))
+			return Fail();
+		PathLength = strlen(Path);
+		Path[PathLength++] = '/';
+	}
+	if ((PathLength + Source) >= sizeof(Path))
+	{
+		LastError = ERROR_FILENAME_EXCED_RANGE;
+		return 0;
+	}
+	memcpy(Path + PathLength, lpFileName, Source);
+	PathLength += Source;
+
+	char Result[8192];
+	size_t Length = 0;
+	for (size_t Start = 0; Start < PathLength;)
+	{
+		auto End = Start;
+		while ((End < PathLength) && (Path[End] != '/') && (Path[End] != '\\'))
+			End++;
+
+		auto Part = std::string_view(Path + Start, End - Start);
+		if (Part == "..")
+		{
+			while (Length && (Result[Length - 1] != '\\'))
+				Length--;
+			if (Length)
+				Length--;
+		}
+		else if (!Part.empty() && (Part != "."))
+		{
+			Result[Length++] = '\\';
+			memcpy(Result + Length, Part.data(), Part.length());
+			Length += Part.length();
+		}
+		Start = End + 1;
+	}
+
+	auto Last = Path[PathLength - 1];
+	if (!Length || (Last == '/') || (Last == '\\'))
+		Result[Length++] = '\\';
+
+	if ((Length + 1) > nBufferLength)
+		return (DWORD)(Length + 1);
+
+	memcpy(lpBuffer, Result, Length);
+	lpBuffer[Length] = 0;
+	if (lpFilePart)
+	{
+		auto Separator = std::string_view(lpBuffer, Length).find_last_of('\\');
+		*lpFilePart = (Separator == (Length - 1)) ? nullptr : lpBuffer + Separator + 1;
+	}
+	return (DWORD)Length;
+}
+
+DWORD GetCurrentDirectoryA(DWORD nBufferLength, LPSTR lpBuffer)
+{
+	char Path[4096];
+	if (!getcwd(Path, sizeof(Path)))
+		return 0;
+	auto Length = (DWORD)strlen(Path);
+	if (Length + 1 > nBufferLength)
+		return Length + 1;
+	memcpy(lpBuffer, Path, Length + 1);
+	return Length;
+}
+
+DWORD GetCurrentDirectoryW(DWORD nBufferLength, LPWSTR lpBuffer)
+{
+	char Path[4096];
+	if (!getcwd(Path, sizeof(Path)))
+		return 0;
+	auto Length = (DWORD)strlen(Path);
+	if (Length + 1 > nBufferLength)
+		return Length + 1;
+	ToWide(Path, lpBuffer, nBufferLength);
+	return Length;
+}
+
+BOOL CopyFileA(LPCSTR lpExistingFileName, LPCSTR lpNewFileName, BOOL bFailIfExists)
+{
+	std::error_code Error;
+	auto Options = bFailIfExists ? std::filesystem::copy_options::none :
+		std::filesystem::copy_options::overwrite_existing;
+	if (!std::filesystem::copy_file(NativePath(lpExistingFileName), NativePath(lpNewFileName), Options, Error))
+	{
+		LastError = Error ? FromErrno(Error.value()) : ERROR_ALREADY_EXISTS;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL PathIsRelativeA(LPCSTR pszPath)
+{
+	auto Path = NativePath(pszPath);
+	return Path.empty() || (Path[0] != '/');
+}
+
+BOOL PathIsRelativeW(LPCWSTR pszPath)
+{
+	auto Path = NativePath(pszPath);
+	return Path.empty() || (Path[0] != '/');
+}
+
+UINT GetPrivateProfileIntA(LPCSTR, LPCSTR, INT nDefault, LPCSTR)
+{
+	return (UINT)nDefault;
+}
+
+UINT GetPrivateProfileIntW(LPCWSTR, LPCWSTR, INT nDefault, LPCWSTR)
+{
+	return (UINT)nDefault;
+}
+
+DWORD GetPrivateProfileStringA(LPCSTR, LPCSTR, LPCSTR lpDefault, LPSTR lpReturnedString, DWORD nSize, LPCSTR)
+{
+	if (!lpReturnedString || !nSize)
+		return 0;
+	auto Length = std::min((DWORD)strlen(lpDefault ? lpDefault : ""), nSize - 1);
+	memcpy(lpReturnedString, lpDefault ? lpDefault : "", Length);
+	lpReturnedString[Length] = '\0';
+	return Length;
+}
+
+DWORD GetPrivateProfileStringW(LPCWSTR, LPCWSTR, LPCWSTR lpDefault, LPWSTR lpReturnedString, DWORD nSize, LPCWSTR)
+{
+	if (!lpReturnedString || !nSize)
+		return 0;
+	auto Length = std::min((DWORD)wcslen(lpDefault ? lpDefault : L""), nSize - 1);
+	memcpy(lpReturnedString, lpDefault ? lpDefault : L"", Length * sizeof(WCHAR));
+	lpReturnedString[Length] = L'\0';
+	return Length;
+}
+
+BOOL GetPrivateProfileStructA(LPCSTR, LPCSTR, LPVOID, UINT, LPCSTR)
+{
+	return FALSE;
+}
+
+BOOL WritePrivateProfileStringA(LPCSTR, LPCSTR, LPCSTR, LPCSTR)
+{
+	return FALSE;
+}
+
+BOOL WritePrivateProfileStringW(LPCWSTR, LPCWSTR, LPCWSTR, LPCWSTR)
+{
+	return FALSE;
+}
+
+BOOL WritePrivateProfileStructA(LPCSTR, LPCSTR, LPVOID, UINT, LPCSTR)
+{
+	return FALSE;
+}
+
+HANDLE CreateFileMappingA(HANDLE hFile, LPSECURITY_ATTRIBUTES, DWORD flProtect, DWORD dwMaximumSizeHigh,
+	DWORD dwMaximumSizeLow, LPCSTR)
+{
+	auto File = Cast<FileHandle>(hFile, kFile);
+	if (!File)
+		return nullptr;
+
+	uint64_t Size = ((uint64_t)dwMaximumSizeHigh << 32) | dwMaximumSizeLow;
+	struct stat st;
+	if (fstat(File->Descriptor, &st))
+		return Fail(), nullptr;
+	if (!Size)
+		Size = (uint64_t)st.st_size;
+	if (!Size)
+	{
+		// Как и Windows, пустой файл отобразить нельзя
+		LastError = 1006; // ERROR_FILE_INVALID
+		return nullptr;
+	}
+
+	return new MappingHandle(File->Descriptor, Size, (flProtect & 0xFF) == PAGE_READWRITE);
+}
+
+HANDLE CreateFileMappingW(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileMappingAttributes, DWORD flProtect,
+	DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCWSTR)
+{
+	return CreateFileMappingA(hFile, lpFileMappingAttributes, flProtect, dwMaximumSizeHigh, dwMaximumSizeLow, nullptr);
+}
+
+LPVOID MapViewOfFile(HANDLE hFileMappingObject, DWORD dwDesiredAccess, DWORD dwFileOffsetHigh,
+	DWORD dwFileOffsetLow, SIZE_T dwNumberOfBytesToMap)
+{
+	auto Mapping = Cast<MappingHandle>(hFileMappingObject, kMapping);
+	if (!Mapping)
+		return nullptr;
+
+	uint64_t Offset = ((uint64_t)dwFileOffsetHigh << 32) | dwFileOffsetLow;
+	if (Offset >= Mapping->Size)
+	{
+		LastError = ERROR_INVALID_PARAMETER;
+		return nullptr;
+	}
+
+	auto Size = dwNumberOfBytesToMap ? (size_t)dwNumberOfBytesToMap : (size_t)(Mapping->Size - Offset);
+	bool Write = (dwDesiredAccess & FILE_MAP_WRITE) && Mapping->Writable;
+	auto View = mmap(nullptr, Size, Write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, Mapping->Descriptor,
+		(off_t)Offset);
+	if (View == MAP_FAILED)
+		return Fail(), nullptr;
+
+	std::lock_guard<std::mutex> Guard(ViewLock);
+	Views[(uintptr_t)View] = Size;
+	return View;
+}
+
+BOOL UnmapViewOfFile(LPCVOID lpBaseAddress)
+{
+	size_t Size;
+	{
+		std::lock_guard<std::mutex> Guard(ViewLock);
+		auto It = Views.find((uintptr_t)lpBaseAddress);
+		if (It == Views.end())
+		{
+			LastError = ERROR_INVALID_PARAMETER;
+			return FALSE;
+		}
+		Size = It->second;
+		Views.erase(It);
+	}
+	return munmap((void*)lpBaseAddress, Size) ? Fail() : TRUE;
+}
+
+BOOL CloseHandle(HANDLE hObject)
+{
+	if (!hObject || (hObject == INVALID_HANDLE_VALUE))
+	{
+		LastError = ERROR_INVALID_HANDLE;
+		return FALSE;
+	}
+	delete (ShimHandle*)hObject;
+	return TRUE;
+}
+
+DWORD GetLastError()
+{
+	return LastError;
+}
+
+void SetLastError(DWORD dwErrCode)
+{
+	LastError = dwErrCode;
+}
+
+LPVOID VirtualAlloc(LPVOID lpAddress, SIZE_T dwSize, DWORD flAllocationType, DWORD flProtect)
+{
+	auto PageSize = (size_t)sysconf(_SC_PAGESIZE);
+	auto Size = (dwSize + PageSize - 1) & ~(PageSize - 1);
+	std::lock_guard<std::mutex> Guard(ProtectionLock);
+
+	if (lpAddress && !(flAllocationType & MEM_RESERVE))
+	{
+		// Фиксация страниц в уже зарезервированном диапазоне
+		auto Start = (uintptr_t)lpAddress & ~(PageSize - 1);
+		auto End = ((uintptr_t)lpAddress + dwSize + PageSize - 1) & ~(PageSize - 1);
+		if (mprotect((void*)Start, End - Start, ToNativeProtect(flProtect)))
+			return Fail(), nullptr;
+		SetProtect(Start, End - Start, flProtect);
+		return lpAddress;
+	}
+
+	// Как и в Windows, новый резерв выровнен по гранулярности 64 Кб, лишнее по краям отдаётся обратно
+	constexpr size_t Granularity = 0x10000;
+	bool Commit = flAllocationType & MEM_COMMIT;
+	auto MapSize = lpAddress ? Size : (Size + Granularity);
+	auto Memory = mmap(lpAddress, MapSize, Commit ? ToNativeProtect(flProtect) : PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | (lpAddress ? MAP_FIXED_NOREPLACE : 0), -1, 0);
+	if (Memory == MAP_FAILED)
+		return Fail(), nullptr;
+
+	if (!lpAddress)
+	{
+		auto Start = (uintptr_t)Memory;
+		auto Aligned = (Start + Granularity - 1) & ~(Granularity - 1);
+		if (Aligned > Start)
+			munmap(Memory, Aligned - Start);
+		if ((Start + MapSize) > (Aligned + Size))
+			munmap((void*)(Aligned + Size), (Start + MapSize) - (Aligned + Size));
+		Memory = (void*)Aligned;
+	}
+
+	Reservations[(uintptr_t)Memory] = Size;
+	SetProtect((uintptr_t)Memory, Size, Commit ? flProtect : PAGE_NOACCESS);
+	return Memory;
+}
+
+BOOL VirtualFree(LPVOID lpAddress, SIZE_T dwSize, DWORD dwFreeType)
+{
+	auto PageSize = (size_t)sysconf(_SC_PAGESIZE);
+	std::lock_guard<std::mutex> Guard(ProtectionLock);
+
+	if (dwFreeType & MEM_RELEASE)
+	{
+		auto It = Reservations.find((uintptr_t)lpAddress);
+		if (dwSize || (It == Reservations.end()))
+		{
+			LastError = ERROR_INVALID_PARAMETER;
+			return FALSE;
+		}
+
+		munmap(lpAddress, It->second);
+		PageProtection.erase(PageProtection.lower_bound(It->first), PageProtection.lower_bound(It->first + It->second));
+		Reservations.erase(It);
+		return TRUE;
+	}
+
+	// Вывод из фиксации: содержимое теряется, адреса остаются зарезервированы
+	auto Start = (uintptr_t)lpAddress & ~(PageSize - 1);
+	auto End = ((uintptr_t)lpAddress + dwSize + PageSize - 1) & ~(PageSize - 1);
+	if (mmap((void*)Start, End - Start, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) ==
+		MAP_FAILED)
+		return Fail();
+	SetProtect(Start, End - Start, PAGE_NOACCESS);
+	return TRUE;
+}
+
+BOOL VirtualProtect(LPVOID lpAddress, SIZE_T dwSize, DWORD flNewProtect, PDWORD lpflOldProtect)
+{
+	auto PageSize = (size_t)sysconf(_SC_PAGESIZE);
+	auto Start = (uintptr_t)lpAddress & ~(PageSize - 1);
+	auto End = ((uintptr_t)lpAddress + dwSize + PageSize - 1) & ~(PageSize - 1);
+	std::lock_guard<std::mutex> Guard(ProtectionLock);
+
+	VirtualProtectCount++;
+	auto Old = QueryProtect(Start);
+	if (mprotect((void*)Start, End - Start, ToNativeProtect(flNewProtect)))
+		return Fail();
+	SetProtect(Start, End - Start, flNewProtect);
+	if (lpflOldProtect)
+		*lpflOldProtect = Old;
+	return TRUE;
+}
+
+SIZE_T VirtualQuery(LPCVOID lpAddress, PMEMORY_BASIC_INFORMATION lpBuffer, SIZE_T dwLength)
+{
+	if (dwLength < sizeof(MEMORY_BASIC_INFORMATION))
+	{
+		LastError = ERROR_INVALID_PARAMETER;
+		return 0;
+	}
+
+	auto PageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+	auto Start = (uintptr_t)lpAddress & ~(PageSize - 1);
+	std::lock_guard<std::mutex> Guard(ProtectionLock);
+
+	auto Protect = QueryProtect(Start);
+	auto End = Start + PageSize;
+	for (auto It = PageProtection.find(End); (It != PageProtection.end()) && (It->first == End) &&
+		(It->second == Protect); It++)
+		End += PageSize;
+
+	lpBuffer->BaseAddress = (PVOID)Start;
+	lpBuffer->AllocationBase = (PVOID)Start;
+	lpBuffer->AllocationProtect = Protect;
+	lpBuffer->RegionSize = End - Start;
+	lpBuffer->State = MEM_COMMIT;
+	lpBuffer->Protect = Protect;
+	lpBuffer->Type = MEM_PRIVATE;
+	return sizeof(MEMORY_BASIC_INFORMATION);
+}
+
+SIZE_T GetLargePageMinimum()
+{
+	return 0;
+}
+
+BOOL OpenProcessToken(HANDLE, DWORD, PHANDLE TokenHandle)
+{
+	// Привилегий Windows нет, большие страницы недоступны
+	*TokenHandle = nullptr;
+	LastError = ERROR_ACCESS_DENIED;
+	return FALSE;
+}
+
+BOOL LookupPrivilegeValueA(LPCSTR, LPCSTR, PLUID)
+{
+	LastError = ERROR_ACCESS_DENIED;
+	return FALSE;
+}
+
+BOOL AdjustTokenPrivileges(HANDLE, BOOL, PTOKEN_PRIVILEGES, DWORD, PTOKEN_PRIVILEGES, PDWORD)
+{
+	LastError = ERROR_ACCESS_DENIED;
+	return FALSE;
+}
+
+void GetSystemInfo(SYSTEM_INFO* lpSystemInfo)
+{
+	memset(lpSystemInfo, 0, sizeof(SYSTEM_INFO));
+	lpSystemInfo->dwPageSize = (DWORD)sysconf(_SC_PAGESIZE);
+	lpSystemInfo->dwAllocationGranularity = 0x10000;
+	lpSystemInfo->dwNumberOfProcessors = (DWORD)sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+HANDLE GetCurrentProcess()
+{
+	return (HANDLE)(LONG_PTR)-1;
+}
+
+BOOL FlushInstructionCache(HANDLE, LPCVOID, SIZE_T)
+{
+	FlushInstructionCacheCount++;
+	return TRUE;
+}
+
+int MessageBoxA(HWND, LPCSTR lpText, LPCSTR lpCaption, UINT)
+{
+	// Тесты не ждут пользователя: любой вопрос подтверждается
+	if (getenv("CKPE_TEST_LOG"))
+		fprintf(stderr, "[MESSAGEBOX] %s: %s\n", lpCaption ? lpCaption : "", lpText ? lpText : "");
+	return IDOK;
+}
+
+DWORD CharLowerBuffA(LPSTR lpsz, DWORD cchLength)
+{
+	for (DWORD i = 0; i < cchLength; i++)
+		lpsz[i] = (char)tolower((unsigned char)lpsz[i]);
+	return cchLength;
+}
+
+HMODULE GetModuleHandleA(LPCSTR)
+{
+	return (HMODULE)CreationKitPlatformExtended::Tests::GetEngineConfig().ModuleBase;
+}
+
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES, SIZE_T, LPTHREAD_START_ROUTINE lpStartAddress, LPVOID lpParameter,
+	DWORD dwCreationFlags, LPDWORD lpThreadId)
+{
+	auto Thread = new ThreadHandle(!(dwCreationFlags & CREATE_SUSPENDED));
+	auto State = Thread->State;
+
+	std::atomic<DWORD> Id = 0;
+	Thread->Thread = std::thread([State, lpStartAddress, lpParameter, &Id] {
+		Id = GetCurrentThreadId();
+		{
+			std::unique_lock<std::mutex> Guard(State->StartLock);
+			State->StartSignal.wait(Guard, [&State] { return State->Started; });
+		}
+
+		lpStartAddress(lpParameter);
+		SetEvent(&State->Done);
+	});
+
+	while (!Id)
+		std::this_thread::yield();
+	if (lpThreadId)
+		*lpThreadId = Id;
+	return Thread;
+}
+
+BOOL SetThreadPriority(HANDLE, int)
+{
+	return TRUE;
+}
+
+DWORD ResumeThread(HANDLE hThread)
+{
+	auto Thread = Cast<ThreadHandle>(hThread, kThread);
+	if (!Thread)
+		return (DWORD)-1;
+
+	auto& State = *Thread->State;
+	std::lock_guard<std::mutex> Guard(State.StartLock);
+	auto Suspended = !State.Started;
+	State.Started = true;
+	State.StartSignal.notify_all();
+	return Suspended ? 1 : 0;
+}
+
+HANDLE CreateEventA(LPSECURITY_ATTRIBUTES, BOOL bManualReset, BOOL bInitialState, LPCSTR)
+{
+	return new EventHandle(bManualReset, bInitialState);
+}
+
+BOOL SetEvent(HANDLE hEvent)
+{
+	auto Event = Cast<EventHandle>(hEvent, kEvent);
+	if (!Event)
+		return FALSE;
+
+	std::lock_guard<std::mutex> Guard(Event->Lock);
+	Event->State = true;
+	Event->Signal.notify_all();
+	return TRUE;
+}
+
+BOOL ResetEvent(HANDLE hEvent)
+{
+	auto Event = Cast<EventHandle>(hEvent, kEvent);
+	if (!Event)
+		return FALSE;
+
+	std::lock_guard<std::mutex> Guard(Event->Lock);
+	Event->State = false;
+	return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds)
+{
+	if (!hHandle || (hHandle == INVALID_HANDLE_VALUE))
+		return WAIT_FAILED;
+
+	auto Object = (ShimHandle*)hHandle;
+	if (Object->Kind == kEvent)
+		return ((EventHandle*)Object)->Wait(dwMilliseconds) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+	if (Object->Kind == kChange)
+		return ((ChangeHandle*)Object)->Wait(dwMilliseconds) ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+	if (Object->Kind == kThread)
+	{
+		auto Thread = (ThreadHandle*)Object;
+		if (!Thread->State->Done.Wait(dwMilliseconds))
+			return WAIT_TIMEOUT;
+		if (Thread->Thread.joinable())
+			Thread->Thread.join();
+		return WAIT_OBJECT_0;
+	}
+	return WAIT_FAILED;
+}
+
+DWORD WaitForMultipleObjects(DWORD nCount, const HANDLE* lpHandles, BOOL bWaitAll, DWORD dwMilliseconds)
+{
+	if (bWaitAll)
+	{
+		for (DWORD i = 0; i < nCount; i++)
+		{
+			auto Result = WaitForSingleObject(lpHandles[i], dwMilliseconds);
+			if (Result != WAIT_OBJECT_0)
+				return Result;
+		}
+		return WAIT_OBJECT_0;
+	}
+
+	auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(dwMilliseconds);
+	for (;;)
+	{
+		for (DWORD i = 0; i < nCount; i++)
+		{
+			if (WaitForSingleObject(lpHandles[i], 0) == WAIT_OBJECT_0)
+				return WAIT_OBJECT_0 + i;
+		}
+		if ((dwMilliseconds != INFINITE) && (std::chrono::steady_clock::now() >= Deadline))
+			return WAIT_TIMEOUT;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+DWORD GetCurrentThreadId()
+{
+	static thread_local DWORD Id = (DWORD)syscall(SYS_gettid);
+	return Id;
+}
+
+DWORD GetCurrentProcessId()
+{
+	return (DWORD)getpid();
+}
+
+void Sleep(DWORD dwMilliseconds)
+{
+	if (!dwMilliseconds)
+		sched_yield();
+	else
+		std::this_thread::sleep_for(std::chrono::milliseconds(dwMilliseconds));
+}
+
+BOOL SwitchToThread()
+{
+	return !sched_yield();
+}
+
+void YieldProcessor()
+{
+	_mm_pause();
+}
+
+DWORD GetTickCount()
+{
+	return (DWORD)GetTickCount64();
+}
+
+ULONGLONG GetTickCount64()
+{
+	return (ULONGLONG)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* lpPerformanceCount)
+{
+	lpPerformanceCount->QuadPart = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* lpFrequency)
+{
+	lpFrequency->QuadPart = 1000000000ll;
+	return TRUE;
+}
+
+BOOL WaitOnAddress(volatile void* Address, PVOID CompareAddress, SIZE_T AddressSize, DWORD dwMilliseconds)
+{
+	auto& Slot = ParkingSlot(Address);
+	auto Sequence = Slot.load(std::memory_order_acquire);
+	if (memcmp((const void*)Address, CompareAddress, AddressSize))
+		return TRUE;
+
+	if ((Futex(&Slot, FUTEX_WAIT_PRIVATE, Sequence, dwMilliseconds) < 0) && (errno == ETIMEDOUT))
+	{
+		LastError = ERROR_TIMEOUT;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void WakeByAddressSingle(PVOID Address)
+{
+	WakeByAddressAll(Address);
+}
+
+void WakeByAddressAll(PVOID Address)
+{
+	auto& Slot = ParkingSlot(Address);
+	Slot.fetch_add(1, std::memory_order_release);
+	Futex(&Slot, FUTEX_WAKE_PRIVATE, INT32_MAX, 0);
+}
+
+void InitializeSRWLock(PSRWLOCK SRWLock)
+{
+	SRWLock->Ptr = nullptr;
+}
+
+BOOLEAN TryAcquireSRWLockExclusive(PSRWLOCK SRWLock)
+{
+	auto Word = LockWord(SRWLock);
+	uint32_t State = Word->load(std::memory_order_relaxed);
+	return !(State & ~SRW_WAITERS) &&
+		Word->compare_exchange_strong(State, State | SRW_EXCLUSIVE, std::memory_order_acquire);
+}
+
+void AcquireSRWLockExclusive(PSRWLOCK SRWLock)
+{
+	auto Word = LockWord(SRWLock);
+	for (;;)
+	{
+		uint32_t State = Word->load(std::memory_order_relaxed);
+		if (!(State & ~SRW_WAITERS))
+		{
+			if (Word->compare_exchange_weak(State, State | SRW_EXCLUSIVE, std::memory_order_acquire))
+				return;
+			continue;
+		}
+		ParkSRWLock(Word, State);
+	}
+}
+
+void ReleaseSRWLockExclusive(PSRWLOCK SRWLock)
+{
+	auto Word = LockWord(SRWLock);
+	if (Word->exchange(0, std::memory_order_release) & SRW_WAITERS)
+		Futex(Word, FUTEX_WAKE_PRIVATE, INT32_MAX, 0);
+}
+
+BOOLEAN TryAcquireSRWLockShared(PSRWLOCK SRWLock)
+{
+	auto Word = LockWord(SRWLock);
+	uint32_t State = Word->load(std::memory_order_relaxed);
+	while (!(State & SRW_EXCLUSIVE))
+	{
+		if (Word->compare_exchange_weak(State, State + SRW_READER, std::memory_order_acquire))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+void AcquireSRWLockShared(PSRWLOCK SRWLock)
+{
+	auto Word = LockWord(SRWLock);
+	for (;;)
+	{
+		uint32_t State = Word->load(std::memory_order_relaxed);
+		if (!(State & SRW_EXCLUSIVE))
+		{
+			if (Word->compare_exchange_weak(State, State + SRW_READER, std::memory_order_acquire))
+				return;
+			continue;
+		}
+		ParkSRWLock(Word, State);
+	}
+}
+
+void ReleaseSRWLockShared(PSRWLOCK SRWLock)
+{
+	// Последний читатель будит ждущих писателей
+	auto Word = LockWord(SRWLock);
+	uint32_t Expected = SRW_WAITERS;
+	if ((Word->fetch_sub(SRW_READER, std::memory_order_release) == (SRW_READER | SRW_WAITERS)) &&
+		Word->compare_exchange_strong(Expected, 0, std::memory_order_relaxed))
+		Futex(Word, FUTEX_WAKE_PRIVATE, INT32_MAX, 0);
+}
+
+void InitializeConditionVariable(PCONDITION_VARIABLE ConditionVariable)
+{
+	ConditionVariable->Ptr = nullptr;
+}
+
+BOOL SleepConditionVariableSRW(PCONDITION_VARIABLE ConditionVariable, PSRWLOCK SRWLock, DWORD dwMilliseconds,
+	ULONG Flags)
+{
+	auto Word = SequenceWord(ConditionVariable);
+	auto Sequence = Word->load(std::memory_order_acquire);
+	bool Shared = Flags & CONDITION_VARIABLE_LOCKMODE_SHARED;
+
+	if (Shared)
+		ReleaseSRWLockShared(SRWLock);
+	else
+		ReleaseSRWLockExclusive(SRWLock);
+
+	bool TimedOut = (Futex(Word, FUTEX_WAIT_PRIVATE, Sequence, dwMilliseconds) < 0) && (errno == ETIMEDOUT);
+
+	if (Shared)
+		AcquireSRWLockShared(SRWLock);
+	else
+		AcquireSRWLockExclusive(SRWLock);
+
+	if (TimedOut)
+	{
+		LastError = ERROR_TIMEOUT;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void WakeConditionVariable(PCONDITION_VARIABLE ConditionVariable)
+{
+	auto Word = SequenceWord(ConditionVariable);
+	Word->fetch_add(1, std::memory_order_release);
+	Futex(Word, FUTEX_WAKE_PRIVATE, 1, 0);
+}
+
+void WakeAllConditionVariable(PCONDITION_VARIABLE ConditionVariable)
+{
+	auto Word = SequenceWord(ConditionVariable);
+	Word->fetch_add(1, std::memory_order_release);
+	Futex(Word, FUTEX_WAKE_PRIVATE, INT32_MAX, 0);
+}
+
+BOOL InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, PVOID Parameter, LPVOID* Context)
+{
+	// 0 - не выполнялась, 1 - выполняется, 2 - выполнена
+	auto Word = (std::atomic<uint32_t>*)&InitOnce->Ptr;
+	for (;;)
+	{
+		uint32_t State = Word->load(std::memory_order_acquire);
+		if (State == 2)
+			return TRUE;
+		if (!State && Word->compare_exchange_strong(State, 1, std::memory_order_acquire))
+		{
+			bool Success = InitFn(InitOnce, Parameter, Context);
+			Word->store(Success ? 2 : 0, std::memory_order_release);
+			Futex(Word, FUTEX_WAKE_PRIVATE, INT32_MAX, 0);
+			return Success;
+		}
+		Futex(Word, FUTEX_WAIT_PRIVATE, 1, INFINITE);
+	}
+}
+
+void InitializeCriticalSection(LPCRITICAL_SECTION lpCriticalSection)
+{
+	lpCriticalSection->Ptr = new std::recursive_mutex;
+}
+
+void DeleteCriticalSection(LPCRITICAL_SECTION lpCriticalSection)
+{
+	delete (std::recursive_mutex*)lpCriticalSection->Ptr;
+	lpCriticalSection->Ptr = nullptr;
+}
+
+void EnterCriticalSection(LPCRITICAL_SECTION lpCriticalSection)
+{
+	((std::recursive_mutex*)lpCriticalSection->Ptr)->lock();
+}
+
+void LeaveCriticalSection(LPCRITICAL_SECTION lpCriticalSection)
+{
+	((std::recursive_mutex*)lpCriticalSection->Ptr)->unlock();
+}
+
+unsigned char _BitScanForward(unsigned long* Index, uint32_t Mask)
+{
+	if (!Mask)
+		return 0;
+	*Index = (unsigned long)__builtin_ctz(Mask);
+	return 1;
+}
+
+unsigned char _BitScanForward64(unsigned long* Index, uint64_t Mask)
+{
+	if (!Mask)
+		return 0;
+	*Index = (unsigned long)__builtin_ctzll(Mask);
+	return 1;
+}
+
+unsigned char _BitScanReverse(unsigned long* Index, uint32_t Mask)
+{
+	if (!Mask)
+		return 0;
+	*Index = 31ul - (unsigned long)__builtin_clz(Mask);
+	return 1;
+}
+
+unsigned char _BitScanReverse64(unsigned long* Index, uint64_t Mask)
+{
+	if (!Mask)
+		return 0;
+	*Index = 63ul - (unsigned long)__builtin_clzll(Mask);
+	return 1;
+}
+
+int _fileno(FILE* stream)
+{
+	return fileno(stream);
+}
+
+int _commit(int fd)
+{
+	return fsync(fd);
+}
+
+int _chsize_s(int fd, int64_t size)
+{
+	return ftruncate(fd, (off_t)size) ? errno : 0;
+}
+
+FILE* _wfsopen(const wchar_t* filename, const wchar_t* mode, int)
+{
+	return fopen(NativePath(filename).c_str(), NativePath(mode).c_str());
+}
+
+namespace CreationKitPlatformExtended
+{
+	namespace Tests
+	{
+		uint64_t GetVirtualProtectCount()
+		{
+			return VirtualProtectCount.load();
+		}
+
+		uint64_t GetFlushInstructionCacheCount()
+		{
+			return FlushInstructionCacheCount.load();
+		}
+
+		void SetReadLatency(uint32_t microseconds)
+		{
+			ReadLatency = microseconds;
+		}
+
+		void DropReadCache()
+		{
+			std::lock_guard Guard(ReadCacheLock);
+			ReadCache.clear();
+		}
+
+		uint64_t GetReadMissCount()
+		{
+			return ReadMissCount.load();
+		}
+
+		size_t GetResidentSize()
+		{
+			size_t Size = 0, Resident = 0;
+			auto File = fopen("/proc/self/statm", "r");
+			if (File)
+			{
+				if (fscanf(File, "%zu %zu", &Size, &Resident) != 2)
+					Resident = 0;
+				fclose(File);
+			}
+			return Resident * (size_t)sysconf(_SC_PAGESIZE);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,301 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Замена mINI (ini.h из зависимостей проекта) для сборки тестов. Устроена так же: ключи без учёта регистра
+// (приводятся к нижнему), порядок вставки хранится в векторе, индекс в unordered_map, get() отдаёт копию.
+// INIFile::write, как и mINI, переписывает существующий файл, сохраняя комментарии и порядок строк:
+// удалённые ключи и секции выпадают, новые ключи дописываются в конец своей секции, новые секции в конец файла.
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+namespace mINI
+{
+	namespace INIStringUtil
+	{
+		inline void trim(std::string& str)
+		{
+			static const char* whitespaceDelimiters = " \t\n\r\f\v";
+			str.erase(str.find_last_not_of(whitespaceDelimiters) + 1);
+			str.erase(0, str.find_first_not_of(whitespaceDelimiters));
+		}
+
+		inline void toLower(std::string& str)
+		{
+			std::transform(str.begin(), str.end(), str.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+		}
+	}
+
+	template<typename T>
+	class INIMap
+	{
+	public:
+		using T_DataItem = std::pair<std::string, T>;
+		using T_DataContainer = std::vector<T_DataItem>;
+		using const_iterator = typename T_DataContainer::const_iterator;
+
+		T& operator[](std::string key)
+		{
+			Normalize(key);
+			auto it = _index.find(key);
+			if (it == _index.end())
+			{
+				it = _index.emplace(key, _data.size()).first;
+				_data.emplace_back(key, T());
+			}
+			return _data[it->second].second;
+		}
+
+		T get(std::string key) const
+		{
+			Normalize(key);
+			auto it = _index.find(key);
+			return (it == _index.end()) ? T() : _data[it->second].second;
+		}
+
+		bool has(std::string key) const
+		{
+			Normalize(key);
+			return _index.count(key) > 0;
+		}
+
+		void set(std::string key, T obj)
+		{
+			(*this)[key] = obj;
+		}
+
+		bool remove(std::string key)
+		{
+			Normalize(key);
+			auto it = _index.find(key);
+			if (it == _index.end())
+				return false;
+
+			_data.erase(_data.begin() + it->second);
+			_index.clear();
+			for (size_t i = 0; i < _data.size(); i++)
+				_index.emplace(_data[i].first, i);
+			return true;
+		}
+
+		void clear()
+		{
+			_data.clear();
+			_index.clear();
+		}
+
+		inline size_t size() const { return _data.size(); }
+		inline const_iterator begin() const { return _data.begin(); }
+		inline const_iterator end() const { return _data.end(); }
+	private:
+		static void Normalize(std::string& key)
+		{
+			INIStringUtil::trim(key);
+			INIStringUtil::toLower(key);
+		}
+
+		std::unordered_map<std::string, size_t> _index;
+		T_DataContainer _data;
+	};
+
+	using INIStructure = INIMap<INIMap<std::string>>;
+
+	class INIFile
+	{
+	public:
+		INIFile(const std::string& filename) : _filename(filename) {}
+
+		bool read(INIStructure& data, bool = false) const
+		{
+			data.clear();
+
+			std::vector<std::string> lines;
+			if (!ReadLines(lines))
+				return false;
+
+			std::string section;
+			bool inSection = false;
+			for (auto line : lines)
+			{
+				std::string key, value;
+				switch (Parse(line, key, value))
+				{
+				case LineSection:
+					section = key;
+					inSection = true;
+					data[section];
+					break;
+				case LineKeyValue:
+					if (inSection)
+						data[section][key] = value;
+					break;
+				default:
+					break;
+				}
+			}
+
+			return true;
+		}
+
+		bool generate(const INIStructure& data, bool = false) const
+		{
+			std::ofstream file(_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+
+			for (auto& section : data)
+			{
+				file << "[" << section.first << "]\n";
+				for (auto& value : section.second)
+					file << value.first << "=" << value.second << "\n";
+			}
+
+			return file.good();
+		}
+
+		bool write(const INIStructure& data, bool pretty = false) const
+		{
+			std::vector<std::string> lines;
+			if (!ReadLines(lines))
+				return generate(data, pretty);
+
+			std::vector<std::string> output;
+			std::unordered_set<std::string> writtenSections, writtenKeys;
+			std::string section;
+			bool keep = true;
+
+			auto finishSection = [&]
+				{
+					if (!section.empty() && keep)
+					{
+						// Ключи, которых в файле не было, в конец секции перед пустыми строками
+						auto insertAt = output.size();
+						while ((insertAt > 0) && output[insertAt - 1].empty())
+							insertAt--;
+
+						std::vector<std::string> added;
+						for (auto& value : data.get(section))
+						{
+							if (!writtenKeys.count(value.first))
+								added.push_back(value.first + "=" + value.second);
+						}
+						output.insert(output.begin() + insertAt, added.begin(), added.end());
+					}
+					writtenKeys.clear();
+				};
+
+			for (auto& line : lines)
+			{
+				std::string key, value;
+				switch (Parse(line, key, value))
+				{
+				case LineSection:
+					finishSection();
+					section = key;
+					keep = data.has(section) && !writtenSections.count(section);
+					if (keep)
+					{
+						writtenSections.insert(section);
+						output.push_back(line);
+					}
+					break;
+				case LineKeyValue:
+					if (keep && data.get(section).has(key) && !writtenKeys.count(key))
+					{
+						writtenKeys.insert(key);
+						output.push_back(line.substr(0, line.find('=') + 1) + data.get(section).get(key));
+					}
+					break;
+				default:
+					if (keep)
+						output.push_back(line);
+					break;
+				}
+			}
+			finishSection();
+
+			for (auto& it : data)
+			{
+				if (writtenSections.count(it.first))
+					continue;
+
+				output.push_back("[" + it.first + "]");
+				for (auto& value : it.second)
+					output.push_back(value.first + "=" + value.second);
+			}
+
+			std::ofstream file(_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+			for (auto& line : output)
+				file << line << "\n";
+
+			return file.good();
+		}
+	private:
+		enum LineType
+		{
+			LineNone,
+			LineComment,
+			LineSection,
+			LineKeyValue
+		};
+
+		bool ReadLines(std::vector<std::string>& lines) const
+		{
+			std::ifstream file(_filename, std::ios::in | std::ios::binary);
+			if (!file.is_open())
+				return false;
+
+			std::string line;
+			while (std::getline(file, line))
+			{
+				if (!line.empty() && (line.back() == '\r'))
+					line.pop_back();
+				lines.push_back(line);
+			}
+			return true;
+		}
+
+		static LineType Parse(std::string line, std::string& key, std::string& value)
+		{
+			INIStringUtil::trim(line);
+			if (line.empty())
+				return LineNone;
+			if ((line[0] == ';') || (line[0] == '#'))
+				return LineComment;
+
+			if (line[0] == '[')
+			{
+				auto end = line.find(']');
+				if (end == std::string::npos)
+					return LineNone;
+
+				key = line.substr(1, end - 1);
+				INIStringUtil::trim(key);
+				INIStringUtil::toLower(key);
+				return LineSection;
+			}
+
+			auto equal = line.find('=');
+			if (equal == std::string::npos)
+				return LineNone;
+
+			key = line.substr(0, equal);
+			value = line.substr(equal + 1);
+			INIStringUtil::trim(key);
+			INIStringUtil::toLower(key);
+			INIStringUtil::trim(value);
+			return LineKeyValue;
+		}
+
+		std::string _filename;
+	};
+}
\ No newline at end of file
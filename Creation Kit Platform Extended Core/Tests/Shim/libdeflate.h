@@ -0,0 +1,39 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#pragma once
+
+// Объявления libdeflate (1.x) для сборки тестов: в системе есть только сама библиотека (libdeflate.so.0),
+// без заголовка. Объявлено то, чем пользуется ядро.
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C"
+{
+	struct libdeflate_decompressor;
+
+	enum libdeflate_result
+	{
+		LIBDEFLATE_SUCCESS = 0,
+		LIBDEFLATE_BAD_DATA = 1,
+		LIBDEFLATE_SHORT_OUTPUT = 2,
+		LIBDEFLATE_INSUFFICIENT_SPACE = 3,
+	};
+
+	libdeflate_decompressor* libdeflate_alloc_decompressor(void);
+	void libdeflate_free_decompressor(libdeflate_decompressor* decompressor);
+
+	libdeflate_result libdeflate_deflate_decompress_ex(libdeflate_decompressor* decompressor,
+		const void* in, size_t in_nbytes, void* out, size_t out_nbytes_avail,
+		size_t* actual_in_nbytes_ret, size_t* actual_out_nbytes_ret);
+	libdeflate_result libdeflate_zlib_decompress(libdeflate_decompressor* decompressor,
+		const void* in, size_t in_nbytes, void* out, size_t out_nbytes_avail,
+		size_t* actual_out_nbytes_ret);
+	libdeflate_result libdeflate_zlib_decompress_ex(libdeflate_decompressor* decompressor,
+		const void* in, size_t in_nbytes, void* out, size_t out_nbytes_avail,
+		size_t* actual_in_nbytes_ret, size_t* actual_out_nbytes_ret);
+
+	uint32_t libdeflate_adler32(uint32_t adler, const void* buffer, size_t len);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+// Push/Pop при заданном числе живых блоков: таблица по шардам против прежнего массива под одним
+// recursive_mutex с линейным поиском в Pop. И цена трассировки на пути выделения памяти: выключенная
+// (одна проверка флага) и включённая.
+
+#include <benchmark/benchmark.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ConsoleWindow.h"
+#include "Core/TracerManager.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	// Прежний TracerManager (до переработки): std::vector, линейный поиск и erase в Pop
+	class LegacyTracer
+	{
+	public:
+		void Push(const char* _Name, uintptr_t _MemAddress, size_t _Size, uintptr_t _RetAddress)
+		{
+			lock.lock();
+			_Items.push_back({ _Name, _RetAddress, _MemAddress, _Size });
+			lock.unlock();
+		}
+
+		void Pop(uintptr_t _MemAddress)
+		{
+			lock.lock();
+			for (auto It = _Items.begin(); It != _Items.end(); It++)
+			{
+				if (It->MemAddress == _MemAddress)
+				{
+					_Items.erase(It);
+					break;
+				}
+			}
+			lock.unlock();
+		}
+	private:
+		std::recursive_mutex lock;
+		std::vector<TracerManager::TracerInfo> _Items;
+	};
+
+	// Каждый поток держит range(0) живых блоков и заменяет самый старый: Pop старого, Push нового
+	template<typename Tracer>
+	void ReplaceOldest(benchmark::State& state, Tracer& tracer)
+	{
+		auto Live = (uintptr_t)state.range(0);
+		auto Base = ((uintptr_t)state.thread_index() + 1) << 40;
+		for (uintptr_t i = 0; i < Live; i++)
+			tracer.Push("Heap", Base + i * 16, 16, 0x1000);
+
+		uintptr_t Next = Live;
+		for (auto _ : state)
+		{
+			tracer.Pop(Base + (Next - Live) * 16);
+			tracer.Push("Heap", Base + Next * 16, 16, 0x1000);
+			Next++;
+		}
+
+		for (uintptr_t i = Next - Live; i < Next; i++)
+			tracer.Pop(Base + i * 16);
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	LegacyTracer* Legacy = nullptr;
+
+	// Setup и Teardown вызываются один раз на все потоки замера
+	void SetUpTracer(const benchmark::State& state)
+	{
+		if (!GlobalConsoleWindowPtr)
+			GlobalConsoleWindowPtr = new ConsoleWindow(nullptr);
+
+		Legacy = new LegacyTracer();
+		GlobalTracerManagerPtr = new TracerManager();
+		if (state.range(0) > 0)
+			GlobalTracerManagerPtr->Record();
+	}
+
+	void TearDownTracer(const benchmark::State&)
+	{
+		delete GlobalTracerManagerPtr;
+		GlobalTracerManagerPtr = nullptr;
+		delete Legacy;
+		Legacy = nullptr;
+	}
+}
+
+static void BM_TracerLegacy(benchmark::State& state)
+{
+	ReplaceOldest(state, *Legacy);
+}
+BENCHMARK(BM_TracerLegacy)->Arg(1000)->Arg(20000)->ThreadRange(1, 4)->Setup(SetUpTracer)->Teardown(TearDownTracer);
+
+static void BM_TracerSharded(benchmark::State& state)
+{
+	ReplaceOldest(state, *GlobalTracerManagerPtr);
+}
+BENCHMARK(BM_TracerSharded)->Arg(1000)->Arg(20000)->Arg(1000000)->ThreadRange(1, 4)->Setup(SetUpTracer)
+	->Teardown(TearDownTracer);
+
+// Выделение и освобождение блока (malloc) с макросами трассировки, как в хуках куч
+static void BM_TracerAllocPath(benchmark::State& state)
+{
+	// Трассировщика нет вовсе, как было при CKPE_USES_TRACER 0
+	if (state.range(0) < 0)
+	{
+		delete GlobalTracerManagerPtr;
+		GlobalTracerManagerPtr = nullptr;
+	}
+
+	for (auto _ : state)
+	{
+		auto Block = malloc(64);
+		benchmark::DoNotOptimize(Block);
+		_CKPE_TracerPush("Heap", Block, 64);
+		_CKPE_TracerPop(Block);
+		free(Block);
+	}
+}
+// -1 без трассировщика, 0 трассировщик есть, но не пишет, 1 запись
+BENCHMARK(BM_TracerAllocPath)->Arg(-1)->Arg(0)->Arg(1)->Setup(SetUpTracer)->Teardown(TearDownTracer);
\ No newline at end of file
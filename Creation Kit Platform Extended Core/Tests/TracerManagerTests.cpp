@@ -0,0 +1,220 @@
+﻿// Copyright © 2023-2024 aka perchik71. All rights reserved.
+// Contacts: <email:timencevaleksej@gmail.com>
+// License: https://www.gnu.org/licenses/gpl-3.0.html
+
+#include <random>
+#include <gtest/gtest.h>
+
+#include "Shim/TestEngine.h"
+#include "Core/ConsoleWindow.h"
+#include "Core/TracerManager.h"
+
+using namespace CreationKitPlatformExtended;
+using namespace CreationKitPlatformExtended::Core;
+
+namespace
+{
+	class TracerManagerTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			GlobalConsoleWindowPtr = new ConsoleWindow(nullptr);
+			GlobalTracerManagerPtr = new TracerManager();
+		}
+
+		void TearDown() override
+		{
+			delete GlobalTracerManagerPtr;
+			GlobalTracerManagerPtr = nullptr;
+			delete GlobalConsoleWindowPtr;
+			GlobalConsoleWindowPtr = nullptr;
+		}
+
+		static const TracerManager::CallSite* Find(const TracerManager::Snapshot& snapshot, uintptr_t retAddress)
+		{
+			for (auto& Site : snapshot)
+			{
+				if (Site.RetAddress == retAddress)
+					return &Site;
+			}
+			return nullptr;
+		}
+	};
+}
+
+TEST_F(TracerManagerTest, AggregatesLiveBlocksByCallSite)
+{
+	auto Tracer = GlobalTracerManagerPtr;
+	Tracer->Push("Heap", 0x1000, 100, 0xA);
+	EXPECT_TRUE(Tracer->TakeSnapshot().empty());
+
+	Tracer->Record();
+	Tracer->Push("Heap", 0x1000, 100, 0xA);
+	Tracer->Push("Heap", 0x2000, 50, 0xA);
+	Tracer->Push("Scrap", 0x3000, 1000, 0xB);
+	Tracer->Push("Heap", 0, 10, 0xA);
+	// Повторный адрес: освобождение прошло мимо трассировки, запись заменяется
+	Tracer->Push("Scrap", 0x2000, 70, 0xB);
+	Tracer->Pop(0x1000);
+	Tracer->Pop(0x9000);
+
+	auto Snapshot = Tracer->TakeSnapshot();
+	ASSERT_EQ(Snapshot.size(), 1u);
+	EXPECT_EQ(Snapshot[0].RetAddress, 0xBu);
+	EXPECT_STREQ(Snapshot[0].Name, "Scrap");
+	EXPECT_EQ(Snapshot[0].Count, 2);
+	EXPECT_EQ(Snapshot[0].Bytes, 1070);
+
+	Tracer->Stop();
+	Tracer->Pop(0x3000);
+	EXPECT_EQ(Tracer->TakeSnapshot()[0].Count, 2);
+
+	Tracer->Clear();
+	EXPECT_TRUE(Tracer->TakeSnapshot().empty());
+}
+
+TEST_F(TracerManagerTest, SnapshotsAreSortedAndDiffed)
+{
+	auto Tracer = GlobalTracerManagerPtr;
+	Tracer->Record();
+	for (uintptr_t i = 1; i <= 10; i++)
+		Tracer->Push("Heap", i * 0x100, i * 10, 0xA0 + i);
+
+	auto Older = Tracer->TakeSnapshot();
+	ASSERT_EQ(Older.size(), 10u);
+	for (size_t i = 1; i < Older.size(); i++)
+		EXPECT_GT(Older[i - 1].Bytes, Older[i].Bytes);
+
+	Tracer->Pop(0x100);
+	Tracer->Pop(0x200);
+	Tracer->Push("Heap", 0x1000, 500, 0xA3);
+	Tracer->Push("Heap", 0x2000, 7, 0xC0);
+
+	auto Changes = TracerManager::Diff(Older, Tracer->TakeSnapshot());
+	ASSERT_EQ(Changes.size(), 4u);
+	EXPECT_EQ(Changes[0].RetAddress, 0xA3u);
+	EXPECT_EQ(Changes[0].Count, 1);
+	EXPECT_EQ(Changes[0].Bytes, 500);
+	EXPECT_EQ(Find(Changes, 0xC0)->Bytes, 7);
+	EXPECT_EQ(Find(Changes, 0xA1)->Count, -1);
+	EXPECT_EQ(Find(Changes, 0xA2)->Bytes, -20);
+	EXPECT_EQ(Find(Changes, 0xA4), nullptr);
+}
+
+TEST_F(TracerManagerTest, GrowsAndErasesUnderLoad)
+{
+	// Соседние адреса с шагом выравнивания, таблицы шардов растут несколько раз,
+	// удаление со сдвигом назад не должно терять соседей по цепочке
+	auto Tracer = GlobalTracerManagerPtr;
+	Tracer->Record();
+	for (uintptr_t i = 1; i <= 200000; i++)
+		Tracer->Push("Heap", i * 16, 16, 0x10 + (i & 3));
+	for (uintptr_t i = 1; i <= 200000; i += 2)
+		Tracer->Pop(i * 16);
+
+	auto Snapshot = Tracer->TakeSnapshot();
+	int64_t Count = 0;
+	for (auto& Site : Snapshot)
+		Count += Site.Count;
+	EXPECT_EQ(Count, 100000);
+
+	for (uintptr_t i = 2; i <= 200000; i += 2)
+		Tracer->Pop(i * 16);
+	EXPECT_TRUE(Tracer->TakeSnapshot().empty());
+}
+
+TEST_F(TracerManagerTest, ConcurrentPushPopKeepsCounts)
+{
+	// У каждого потока свои адреса и свой адрес возврата, часть блоков живёт до конца.
+	// Параллельно снимаются снимки, они не должны мешать записи.
+	constexpr uint32_t THREADS = 16;
+	constexpr uint32_t OPERATIONS = 100000;
+	auto Tracer = GlobalTracerManagerPtr;
+	Tracer->Record();
+
+	Array<int64_t> Expected(THREADS);
+	std::atomic<bool> Done = false;
+	std::thread Reader([&]
+		{
+			while (!Done.load())
+				(void)Tracer->TakeSnapshot().size();
+		});
+
+	Array<std::thread> Threads;
+	for (uint32_t t = 0; t < THREADS; t++)
+	{
+		Threads.emplace_back([&, t]
+			{
+				std::mt19937 Random(t);
+				Array<uintptr_t> Live;
+				auto Base = ((uintptr_t)t + 1) << 40;
+
+				for (uint32_t i = 0; i < OPERATIONS; i++)
+				{
+					if (Live.empty() || (Random() % 3))
+					{
+						auto Address = Base + (uintptr_t)i * 16;
+						Tracer->Push("Heap", Address, 16, 0x100 + t);
+						Live.push_back(Address);
+					}
+					else
+					{
+						auto Index = Random() % Live.size();
+						Tracer->Pop(Live[Index]);
+						Live[Index] = Live.back();
+						Live.pop_back();
+					}
+				}
+
+				Expected[t] = (int64_t)Live.size();
+			});
+	}
+	for (auto& Thread : Threads)
+		Thread.join();
+	Done = true;
+	Reader.join();
+
+	auto Snapshot = Tracer->TakeSnapshot();
+	ASSERT_EQ(Snapshot.size(), THREADS);
+	for (uint32_t t = 0; t < THREADS; t++)
+	{
+		auto Site = Find(Snapshot, 0x100 + t);
+		ASSERT_NE(Site, nullptr);
+		EXPECT_EQ(Site->Count, Expected[t]) << "thread " << t;
+		EXPECT_EQ(Site->Bytes, Expected[t] * 16) << "thread " << t;
+	}
+}
+
+TEST_F(TracerManagerTest, DumpWritesCallSitesAndBlocks)
+{
+	Tests::TempDirectory Temp;
+	Tests::SetApplicationPath((Temp.Path() + "/").c_str());
+
+	char First[] = "first";
+	char Second[] = "second";
+	auto Tracer = GlobalTracerManagerPtr;
+	Tracer->Record();
+	Tracer->Push("Heap", (uintptr_t)First, sizeof(First), 0xA);
+	Tracer->Push("Scrap", (uintptr_t)Second, sizeof(Second), 0xB);
+
+	// Во время записи дамп не делается
+	Tracer->Dump();
+	EXPECT_FALSE(std::filesystem::exists(Temp.File("CreationKitPlatformExtendedTracerMemory.log").c_str()));
+
+	Tracer->Stop();
+	Tracer->Dump();
+	Tests::SetApplicationPath("./");
+
+	std::ifstream File(Temp.File("CreationKitPlatformExtendedTracerMemory.log").c_str());
+	ASSERT_TRUE(File.is_open());
+	String Text((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+
+	EXPECT_NE(Text.find("Dumping call sites."), String::npos);
+	EXPECT_NE(Text.find("Scrap -> from 0xb, 1 blocks, 7 bytes"), String::npos);
+	EXPECT_NE(Text.find("Changes since the previous dump."), String::npos);
+	EXPECT_NE(Text.find("Heap -> from 0xa, +1 blocks, +6 bytes"), String::npos);
+	EXPECT_NE(Text.find("Data <second "), String::npos);
+	EXPECT_NE(Text.find("Total memory allocated size 13 bytes."), String::npos);
+	EXPECT_NE(Text.find("Object dump complete."), String::npos);
+}
\ No newline at end of file
@@ -23,6 +23,9 @@ namespace CreationKitPlatformExtended
 	template<typename _kTy, typename _Ty, typename _Pr = std::less<_kTy>>
 	using Map = std::map<_kTy, _Ty, _Pr, voltek::allocator<std::pair<const _kTy, _Ty>>>;
 
+	template<typename _kTy, typename _Ty, typename _Pr = std::less<_kTy>>
+	using MultiMap = std::multimap<_kTy, _Ty, _Pr, voltek::allocator<std::pair<const _kTy, _Ty>>>;
+
 	template<typename _kTy, typename _Ty, typename _Hasher = std::hash<_kTy>,
 		typename _Equal = std::equal_to<_kTy>>
 	using UnorderedMap = std::unordered_map<_kTy, _Ty, _Hasher, _Equal, 
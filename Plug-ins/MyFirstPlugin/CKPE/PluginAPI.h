@@ -202,6 +202,9 @@ namespace CreationKitPlatformExtended
 				const char* lpstrFromType, const char* lpstrTargetType, bool isReference = false);
 			virtual void* CastNoCache(const void* InPtr, long VfDelta,
 				const char* lpstrFromType, const char* lpstrTargetType, bool isReference = false);
+			virtual const void* GetTypeDescriptor(const char* lpstrType);
+			virtual void* CastByDescriptor(const void* InPtr, long VfDelta,
+				const void* FromType, const void* TargetType, bool isReference = false);
 
 			inline static DynamicCast* Instance;
 		};
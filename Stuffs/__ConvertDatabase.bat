@@ -0,0 +1 @@
+CreationKit -PEConvertDatabase
\ No newline at end of file